@@ -0,0 +1,69 @@
+#include <agent_broadphase.hpp>
+#include <benchmark/benchmark.h>
+#include <random>
+
+namespace
+{
+
+const float_t RADIUS = 0.4f;
+// Square metres of ground per agent, like a busy street
+const float_t AREA_PER_AGENT = 4.f;
+// Distance walked per frame, i.e. 1.5 m/s at 60 fps
+const float_t STEP = 0.025f;
+
+struct CrowdFixture
+{
+  CrowdFixture(size_t n)
+  {
+    float_t size = sqrt(n * AREA_PER_AGENT);
+    std::uniform_real_distribution<float_t> p(0.f, size);
+    std::uniform_real_distribution<float_t> a(0.f, 2.f * PIf);
+
+    for (size_t i = 0; i < n; ++i) {
+      broadphase.addAgent({ p(gen), p(gen) }, RADIUS);
+      float_t angle = a(gen);
+      velocities.push_back(Vec2f{ cosine(angle), sine(angle) } * STEP);
+    }
+    displacements.resize(broadphase.capacity());
+  }
+
+  // Each agent walks in a straight line and is then pushed out of its neighbours
+  void step()
+  {
+    for (uint32_t id = 0; id < broadphase.capacity(); ++id) {
+      broadphase.setPosition(id, broadphase.position(id) + velocities[id] + displacements[id]);
+    }
+    broadphase.findPairs();
+    broadphase.separation(displacements);
+  }
+
+  AgentBroadphase broadphase;
+  std::vector<Vec2f> velocities;
+  std::vector<Vec2f> displacements;
+  std::mt19937 gen{ 1234 };
+};
+
+} // namespace
+
+static void AgentBroadphase_step(benchmark::State& state)
+{
+  CrowdFixture fixture(state.range(0));
+
+  // Let the crowd spread out so the timed frames are typical
+  for (int i = 0; i < 10; ++i) {
+    fixture.step();
+  }
+
+  for (auto _ : state) {
+    fixture.step();
+  }
+
+  state.counters["pairs"] = static_cast<double>(fixture.broadphase.findPairs().size());
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(AgentBroadphase_step)
+  ->ArgName("agents")
+  ->Arg(1000)
+  ->Arg(10000)
+  ->Arg(50000)
+  ->Unit(benchmark::kMicrosecond);
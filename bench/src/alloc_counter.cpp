@@ -0,0 +1,155 @@
+#include "alloc_counter.hpp"
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+// Every form of global operator new is replaced, so that none go uncounted and each is freed by
+// the matching operator delete
+
+namespace
+{
+
+std::atomic<size_t> g_allocations = 0;
+
+void* allocate(size_t size) noexcept
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void* allocateAligned(size_t size, std::align_val_t align) noexcept
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+
+  size_t alignment = static_cast<size_t>(align);
+  // aligned_alloc wants the size to be a multiple of the alignment
+  size = (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment;
+#ifdef _WIN32
+  return _aligned_malloc(size, alignment);
+#else
+  return std::aligned_alloc(alignment, size);
+#endif
+}
+
+void freeAligned(void* p) noexcept
+{
+#ifdef _WIN32
+  _aligned_free(p);
+#else
+  std::free(p);
+#endif
+}
+
+} // namespace
+
+size_t allocationCount()
+{
+  return g_allocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size)
+{
+  if (void* p = allocate(size)) {
+    return p;
+  }
+  throw std::bad_alloc{};
+}
+
+void* operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+  return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+  return allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t align)
+{
+  if (void* p = allocateAligned(size, align)) {
+    return p;
+  }
+  throw std::bad_alloc{};
+}
+
+void* operator new[](size_t size, std::align_val_t align)
+{
+  return operator new(size, align);
+}
+
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+  return allocateAligned(size, align);
+}
+
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+  return allocateAligned(size, align);
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+  freeAligned(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+  freeAligned(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+  freeAligned(p);
+}
+
+void operator delete[](void* p, size_t, std::align_val_t) noexcept
+{
+  freeAligned(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+  freeAligned(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+  freeAligned(p);
+}
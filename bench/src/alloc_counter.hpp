@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstddef>
+
+// Number of calls to global operator new since the program started
+size_t allocationCount();
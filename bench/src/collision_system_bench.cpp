@@ -0,0 +1,315 @@
+#include <collision_system.hpp>
+#include <spatial_system.hpp>
+#include <logger.hpp>
+#include <job_system.hpp>
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <random>
+#include <sstream>
+
+namespace
+{
+
+const float_t RADIUS = 0.5f;
+const float_t STEP_HEIGHT = 0.3f;
+
+struct CollisionFixture
+{
+  CollisionFixture()
+    : logger(createLogger(stream, stream, stream, stream))
+    , spatialSystem(createSpatialSystem(*logger, SpatialIndexType::Grid, &jobs))
+    , collisionSystem(createCollisionSystem(*spatialSystem, *logger, &jobs))
+  {
+    collisionSystem->initialise(Vec2f{ 0.f, 0.f }, Vec2f{ 200.f, 200.f });
+  }
+
+  void addWall(const Vec2f& A, const Vec2f& B)
+  {
+    Vec2f n = Vec2f{ A[1] - B[1], B[0] - A[0] }.normalise() * 0.1f;
+    addVolume({ A + n, B + n, B - n, A - n }, 3.f);
+  }
+
+  // A grid of 4x4 rooms with doorways, like a dense interior
+  void buildRooms()
+  {
+    for (int i = 0; i <= 40; ++i) {
+      float_t x = i * 4.f + 20.f;
+      for (int j = 0; j < 40; ++j) {
+        float_t z = j * 4.f + 20.f;
+        addWall({ x, z }, { x, z + 1.5f });
+        addWall({ x, z + 2.5f }, { x, z + 4.f });
+        addWall({ z, x }, { z + 1.5f, x });
+        addWall({ z + 2.5f, x }, { z + 4.f, x });
+      }
+    }
+  }
+
+  // Spiky concave pockets where many walls meet at sharp angles
+  void buildStars()
+  {
+    for (int k = 0; k < 100; ++k) {
+      Vec2f centre{ 20.f + 16.f * (k % 10), 20.f + 16.f * (k / 10) };
+      const int numSpikes = 12;
+      for (int s = 0; s < numSpikes; ++s) {
+        float_t a0 = 2.f * PIf * s / numSpikes;
+        float_t a1 = 2.f * PIf * (s + 0.5f) / numSpikes;
+        float_t a2 = 2.f * PIf * (s + 1.f) / numSpikes;
+        Vec2f P0 = centre + Vec2f{ cosine(a0), sine(a0) } * 2.f;
+        Vec2f P1 = centre + Vec2f{ cosine(a1), sine(a1) } * 5.f;
+        Vec2f P2 = centre + Vec2f{ cosine(a2), sine(a2) } * 2.f;
+        addWall(P0, P1);
+        addWall(P1, P2);
+      }
+    }
+  }
+
+  // Square floor tiles at varying heights, with raised L-shaped platforms on every fourth tile,
+  // like stepped terrain
+  void buildFloors()
+  {
+    for (int i = 0; i < 90; ++i) {
+      for (int j = 0; j < 90; ++j) {
+        Vec2f min{ 10.f + i * 2.f, 10.f + j * 2.f };
+        addVolume({ min, min + Vec2f{ 2.f, 0.f }, min + Vec2f{ 2.f, 2.f }, min + Vec2f{ 0.f, 2.f } },
+          0.1f * ((i * 7 + j * 3) % 5));
+
+        if ((i + j) % 4 == 0) {
+          addVolume({
+            min + Vec2f{ 0.2f, 0.2f },
+            min + Vec2f{ 1.8f, 0.2f },
+            min + Vec2f{ 1.8f, 0.8f },
+            min + Vec2f{ 0.8f, 0.8f },
+            min + Vec2f{ 0.8f, 1.8f },
+            min + Vec2f{ 0.2f, 1.8f }
+          }, 1.f);
+        }
+      }
+    }
+  }
+
+  EntityId addVolume(const std::vector<Vec2f>& perimeter, float_t height)
+  {
+    EntityId id = nextId++;
+    spatialSystem->addComponent(std::make_unique<CSpatial>(id, identityMatrix<float_t, 4>(),
+      1.f));
+
+    auto volume = std::make_unique<CCollision>(id);
+    volume->perimeter = perimeter;
+    volume->height = height;
+    collisionSystem->addComponent(std::move(volume));
+
+    return id;
+  }
+
+  std::stringstream stream;
+  LoggerPtr logger;
+  JobSystem jobs;
+  SpatialSystemPtr spatialSystem;
+  CollisionSystemPtr collisionSystem;
+  EntityId nextId = 0;
+};
+
+// Times each call individually so the worst case shows up alongside the average. The maximum
+// includes the odd pre-emption by the OS, so the 99th percentile is given too
+void timeMoves(benchmark::State& state, const CollisionSystem& collisionSystem,
+  const std::vector<std::pair<Vec3f, Vec3f>>& moves)
+{
+  using Clock = std::chrono::steady_clock;
+
+  std::vector<double> times;
+  times.reserve(moves.size() * 1000);
+
+  for (auto _ : state) {
+    for (auto& move : moves) {
+      auto start = Clock::now();
+      Vec3f delta = collisionSystem.tryMove(move.first, move.second, RADIUS, STEP_HEIGHT);
+      double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+      benchmark::DoNotOptimize(delta);
+
+      times.push_back(ns);
+    }
+  }
+
+  double total = std::accumulate(times.begin(), times.end(), 0.0);
+  auto p99 = times.begin() + times.size() * 99 / 100;
+  std::nth_element(times.begin(), p99, times.end());
+
+  state.counters["avgNs"] = total / times.size();
+  state.counters["p99Ns"] = *p99;
+  state.counters["maxNs"] = *std::max_element(times.begin(), times.end());
+  state.SetItemsProcessed(times.size());
+}
+
+} // namespace
+
+// Random moves through a grid of rooms, many of which hit walls or door frames
+static void CollisionSystem_tryMove_rooms(benchmark::State& state)
+{
+  CollisionFixture fixture;
+  fixture.buildRooms();
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> p(20.f, 180.f);
+  std::uniform_real_distribution<float_t> d(-0.5f, 0.5f);
+  std::vector<std::pair<Vec3f, Vec3f>> moves;
+  for (size_t i = 0; i < 1000; ++i) {
+    moves.push_back({ Vec3f{ p(gen), 0.f, p(gen) }, Vec3f{ d(gen), 0.f, d(gen) } });
+  }
+
+  timeMoves(state, *fixture.collisionSystem, moves);
+}
+BENCHMARK(CollisionSystem_tryMove_rooms);
+
+// Movers pushed from the centre of each star into its spikes, where the walls meet at sharp
+// angles. This used to be the worst case
+static void CollisionSystem_tryMove_wedged(benchmark::State& state)
+{
+  CollisionFixture fixture;
+  fixture.buildStars();
+
+  std::vector<std::pair<Vec3f, Vec3f>> moves;
+  for (int k = 0; k < 100; ++k) {
+    Vec3f centre{ 20.f + 16.f * (k % 10), 0.f, 20.f + 16.f * (k / 10) };
+    for (int s = 0; s < 12; ++s) {
+      float_t a = 2.f * PIf * (s + 0.5f) / 12.f;
+      Vec3f dir{ cosine(a), 0.f, sine(a) };
+      moves.push_back({ centre + dir * 3.6f, dir * 0.3f });
+    }
+  }
+
+  timeMoves(state, *fixture.collisionSystem, moves);
+}
+BENCHMARK(CollisionSystem_tryMove_wedged);
+
+// Moves long enough to cross several rooms in one call, which would tunnel through the walls if
+// only the destination were tested
+static void CollisionSystem_tryMove_highSpeed(benchmark::State& state)
+{
+  CollisionFixture fixture;
+  fixture.buildRooms();
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> p(20.f, 180.f);
+  std::uniform_real_distribution<float_t> d(-8.f, 8.f);
+  std::vector<std::pair<Vec3f, Vec3f>> moves;
+  for (size_t i = 0; i < 1000; ++i) {
+    moves.push_back({ Vec3f{ p(gen), 0.f, p(gen) }, Vec3f{ d(gen), 0.f, d(gen) } });
+  }
+
+  timeMoves(state, *fixture.collisionSystem, moves);
+}
+BENCHMARK(CollisionSystem_tryMove_highSpeed);
+
+static void CollisionSystem_altitude(benchmark::State& state)
+{
+  CollisionFixture fixture;
+  fixture.buildFloors();
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> p(10.f, 190.f);
+  std::vector<Vec3f> positions;
+  for (size_t i = 0; i < 1000; ++i) {
+    positions.push_back(Vec3f{ p(gen), 2.f, p(gen) });
+  }
+
+  for (auto _ : state) {
+    for (auto& pos : positions) {
+      benchmark::DoNotOptimize(fixture.collisionSystem->altitude(pos));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * positions.size());
+}
+BENCHMARK(CollisionSystem_altitude);
+
+static void CollisionSystem_altitude_batched(benchmark::State& state)
+{
+  CollisionFixture fixture;
+  fixture.buildFloors();
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> p(10.f, 190.f);
+  std::vector<Vec3f> positions;
+  for (size_t i = 0; i < 1000; ++i) {
+    positions.push_back(Vec3f{ p(gen), 2.f, p(gen) });
+  }
+  std::vector<float_t> altitudes(positions.size());
+
+  for (auto _ : state) {
+    fixture.collisionSystem->altitude(positions, altitudes);
+    benchmark::DoNotOptimize(altitudes.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * positions.size());
+}
+BENCHMARK(CollisionSystem_altitude_batched);
+
+// Many agents wandering the rooms at once, resolved either in one batch or one at a time
+static void CollisionSystem_tryMoveBatch(benchmark::State& state)
+{
+  const size_t n = state.range(0);
+  const bool batched = state.range(1);
+
+  CollisionFixture fixture;
+  fixture.buildRooms();
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> p(20.f, 180.f);
+  std::uniform_real_distribution<float_t> d(-0.5f, 0.5f);
+  std::vector<Vec3f> positions;
+  std::vector<Vec3f> deltas;
+  for (size_t i = 0; i < n; ++i) {
+    positions.push_back(Vec3f{ p(gen), 0.f, p(gen) });
+    deltas.push_back(Vec3f{ d(gen), 0.f, d(gen) });
+  }
+  std::vector<float_t> radii(n, RADIUS);
+  std::vector<float_t> stepHeights(n, STEP_HEIGHT);
+  std::vector<Vec3f> results(n);
+
+  for (auto _ : state) {
+    if (batched) {
+      fixture.collisionSystem->tryMoveBatch(positions, deltas, radii, stepHeights, results);
+    }
+    else {
+      for (size_t i = 0; i < n; ++i) {
+        results[i] = fixture.collisionSystem->tryMove(positions[i], deltas[i], radii[i],
+          stepHeights[i]);
+      }
+    }
+    benchmark::DoNotOptimize(results.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(CollisionSystem_tryMoveBatch)
+  ->ArgNames({ "agents", "batched" })
+  ->ArgsProduct({ { 100, 1000, 10000, 100000 }, { 0, 1 } })
+  ->Unit(benchmark::kMicrosecond);
+
+// One platform sliding back and forth over the stepped terrain. The collision system only touches
+// the cells under the platform, so its share of the cost doesn't depend on the size of the world
+static void CollisionSystem_moveVolume(benchmark::State& state)
+{
+  CollisionFixture fixture;
+  fixture.buildFloors();
+  fixture.buildRooms();
+
+  EntityId platform = fixture.addVolume({
+    { 0.f, 0.f },
+    { 3.f, 0.f },
+    { 3.f, 3.f },
+    { 0.f, 3.f }
+  }, 2.f);
+
+  int frame = 0;
+  for (auto _ : state) {
+    float_t x = 20.f + static_cast<float_t>(frame++ % 100);
+    fixture.spatialSystem->setTransform(platform, translationMatrix4x4(Vec3f{ x, 0.f, 50.f }));
+    fixture.spatialSystem->update();
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(CollisionSystem_moveVolume)->Unit(benchmark::kMicrosecond);
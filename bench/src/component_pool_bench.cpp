@@ -0,0 +1,109 @@
+#include <component_pool.hpp>
+#include <spatial_system.hpp>
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <random>
+
+namespace
+{
+
+const size_t NUM_COMPONENTS = 100000;
+
+// The previous storage, for comparison
+using ComponentMap = std::map<EntityId, CSpatialPtr>;
+
+CSpatial createComponent(EntityId id)
+{
+  Vec3f pos{ static_cast<float_t>(id % 1000), 0.f, static_cast<float_t>(id / 1000) };
+  return CSpatial{ id, translationMatrix4x4(pos), 1.f };
+}
+
+std::vector<EntityId> shuffledIds()
+{
+  std::vector<EntityId> ids(NUM_COMPONENTS);
+  std::iota(ids.begin(), ids.end(), 0);
+  std::shuffle(ids.begin(), ids.end(), std::mt19937{ 1234 });
+  return ids;
+}
+
+} // namespace
+
+static void ComponentMap_lookup(benchmark::State& state)
+{
+  ComponentMap components;
+  for (EntityId id = 0; id < NUM_COMPONENTS; ++id) {
+    components[id] = std::make_unique<CSpatial>(createComponent(id));
+  }
+  auto ids = shuffledIds();
+
+  for (auto _ : state) {
+    float_t sum = 0.f;
+    for (EntityId id : ids) {
+      sum += components.at(id)->radius();
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+
+  state.SetItemsProcessed(state.iterations() * ids.size());
+}
+BENCHMARK(ComponentMap_lookup)->Unit(benchmark::kMicrosecond);
+
+static void ComponentPool_lookup(benchmark::State& state)
+{
+  ComponentPool<CSpatial> components;
+  for (EntityId id = 0; id < NUM_COMPONENTS; ++id) {
+    components.add(id, createComponent(id));
+  }
+  auto ids = shuffledIds();
+
+  for (auto _ : state) {
+    float_t sum = 0.f;
+    for (EntityId id : ids) {
+      sum += components.get(id).radius();
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+
+  state.SetItemsProcessed(state.iterations() * ids.size());
+}
+BENCHMARK(ComponentPool_lookup)->Unit(benchmark::kMicrosecond);
+
+static void ComponentMap_iterate(benchmark::State& state)
+{
+  ComponentMap components;
+  for (EntityId id = 0; id < NUM_COMPONENTS; ++id) {
+    components[id] = std::make_unique<CSpatial>(createComponent(id));
+  }
+
+  for (auto _ : state) {
+    float_t sum = 0.f;
+    for (auto& entry : components) {
+      sum += entry.second->absTransform().at(0, 3);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+
+  state.SetItemsProcessed(state.iterations() * components.size());
+}
+BENCHMARK(ComponentMap_iterate)->Unit(benchmark::kMicrosecond);
+
+static void ComponentPool_iterate(benchmark::State& state)
+{
+  ComponentPool<CSpatial> components;
+  for (EntityId id = 0; id < NUM_COMPONENTS; ++id) {
+    components.add(id, createComponent(id));
+  }
+
+  for (auto _ : state) {
+    float_t sum = 0.f;
+    for (auto& component : components) {
+      sum += component.absTransform().at(0, 3);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+
+  state.SetItemsProcessed(state.iterations() * components.size());
+}
+BENCHMARK(ComponentPool_iterate)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,159 @@
+#include <draw_list.hpp>
+#include <tree_set.hpp>
+#include <benchmark/benchmark.h>
+#include <random>
+
+using namespace render;
+
+namespace
+{
+
+struct Node
+{
+  Mat4x4f transform;
+};
+
+// Draws spread over a few pipelines, materials, and meshes, as the renderer would submit them
+struct DrawFixture
+{
+  DrawFixture(size_t numDraws)
+    : nodes(numDraws)
+  {
+    std::mt19937 gen{ 1234 };
+    std::uniform_int_distribution<uint32_t> pipeline(0, 7);
+    std::uniform_int_distribution<RenderItemId> material(0, 63);
+    std::uniform_int_distribution<RenderItemId> mesh(0, 255);
+    std::uniform_real_distribution<float_t> depth(0.f, 1.f);
+
+    for (size_t i = 0; i < numDraws; ++i) {
+      keys.push_back(DrawKey{
+        .pass = RenderPass::Main,
+        .layer = i % 16 == 0 ? DrawLayer::Transparent : DrawLayer::Opaque,
+        .pipeline = pipeline(gen) * 0x9e3779b97f4a7c15ull,
+        .material = material(gen),
+        .mesh = mesh(gen),
+        .depth = depth(gen)
+      });
+    }
+  }
+
+  std::vector<Node> nodes;
+  std::vector<DrawKey> keys;
+};
+
+// The render graph as it was, with a list key per draw and a unique id on the end
+using RenderGraph = TreeSet<long, Node*>;
+
+RenderGraph::Key treeSetKey(const DrawKey& key)
+{
+  static long nextId = 0;
+
+  return RenderGraph::Key{
+    static_cast<long>(key.layer),
+    static_cast<long>(key.pipeline),
+    static_cast<long>(key.mesh),
+    static_cast<long>(key.material),
+    nextId++
+  };
+}
+
+void fillTreeSet(RenderGraph& graph, DrawFixture& fixture)
+{
+  for (size_t i = 0; i < fixture.nodes.size(); ++i) {
+    graph.insert(treeSetKey(fixture.keys[i]), &fixture.nodes[i]);
+  }
+}
+
+void fillDrawList(DrawList<Node>& list, DrawFixture& fixture)
+{
+  for (size_t i = 0; i < fixture.nodes.size(); ++i) {
+    list.add(packDrawKey(fixture.keys[i]), &fixture.nodes[i]);
+  }
+}
+
+} // namespace
+
+// The trie is kept in order as it's built, so this covers sorting too
+static void TreeSet_insert(benchmark::State& state)
+{
+  DrawFixture fixture(state.range(0));
+  RenderGraph graph;
+
+  for (auto _ : state) {
+    graph.clear();
+    fillTreeSet(graph, fixture);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(TreeSet_insert)->ArgName("draws")->Arg(1000)->Arg(10000)->Arg(100000)
+  ->Unit(benchmark::kMicrosecond);
+
+static void TreeSet_iterate(benchmark::State& state)
+{
+  DrawFixture fixture(state.range(0));
+  RenderGraph graph;
+  fillTreeSet(graph, fixture);
+
+  for (auto _ : state) {
+    for (auto& node : graph) {
+      benchmark::DoNotOptimize(node->transform);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(TreeSet_iterate)->ArgName("draws")->Arg(1000)->Arg(10000)->Arg(100000)
+  ->Unit(benchmark::kMicrosecond);
+
+static void DrawList_insert(benchmark::State& state)
+{
+  DrawFixture fixture(state.range(0));
+  DrawList<Node> list;
+
+  for (auto _ : state) {
+    list.clear();
+    fillDrawList(list, fixture);
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(DrawList_insert)->ArgName("draws")->Arg(1000)->Arg(10000)->Arg(100000)
+  ->Unit(benchmark::kMicrosecond);
+
+static void DrawList_sort(benchmark::State& state)
+{
+  DrawFixture fixture(state.range(0));
+  DrawList<Node> list;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    list.clear();
+    fillDrawList(list, fixture);
+    state.ResumeTiming();
+
+    list.sort();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(DrawList_sort)->ArgName("draws")->Arg(1000)->Arg(10000)->Arg(100000)
+  ->Unit(benchmark::kMicrosecond);
+
+static void DrawList_iterate(benchmark::State& state)
+{
+  DrawFixture fixture(state.range(0));
+  DrawList<Node> list;
+  fillDrawList(list, fixture);
+  list.sort();
+
+  for (auto _ : state) {
+    for (auto& entry : list.range(firstDrawKey(RenderPass::Main), lastDrawKey(RenderPass::Main))) {
+      benchmark::DoNotOptimize(entry.item->transform);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(DrawList_iterate)->ArgName("draws")->Arg(1000)->Arg(10000)->Arg(100000)
+  ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,33 @@
+#include <frustum.hpp>
+#include <benchmark/benchmark.h>
+#include <random>
+
+static void Frustum_cullSpheres(benchmark::State& state)
+{
+  const size_t n = state.range(0);
+
+  Mat4x4f view = lookAt(Vec3f{ 0.f, 0.f, 0.f }, Vec3f{ 0.f, 0.f, 1.f });
+  Mat4x4f proj = perspective(PIf / 2.f, PIf / 3.f, 0.1f, 1000.f);
+  Frustum frustum = computeFrustum(proj * view);
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> p(-1000.f, 1000.f);
+  std::uniform_real_distribution<float_t> r(1.f, 20.f);
+
+  std::vector<float_t> x(n), y(n), z(n), radius(n);
+  for (size_t i = 0; i < n; ++i) {
+    x[i] = p(gen);
+    y[i] = p(gen);
+    z[i] = p(gen);
+    radius[i] = r(gen);
+  }
+  std::vector<uint8_t> visible(n);
+
+  for (auto _ : state) {
+    cullSpheres(frustum, x.data(), y.data(), z.data(), radius.data(), n, visible.data());
+    benchmark::DoNotOptimize(visible.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(Frustum_cullSpheres)->Arg(1000)->Arg(10000)->Arg(100000);
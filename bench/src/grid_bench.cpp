@@ -0,0 +1,134 @@
+#include "alloc_counter.hpp"
+#include <grid.hpp>
+#include <system.hpp>
+#include <benchmark/benchmark.h>
+#include <random>
+
+namespace
+{
+
+using BenchGrid = Grid<EntityId, 50, 50>;
+
+const Vec2f WORLD_MIN{ -400.f, -400.f };
+const Vec2f WORLD_MAX{ 1600.f, 1600.f };
+
+std::unique_ptr<BenchGrid> createPopulatedGrid(size_t numItems)
+{
+  auto grid = std::make_unique<BenchGrid>(WORLD_MIN, WORLD_MAX);
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> x(WORLD_MIN[0], WORLD_MAX[0]);
+  std::uniform_real_distribution<float_t> y(WORLD_MIN[1], WORLD_MAX[1]);
+  std::uniform_real_distribution<float_t> r(1.f, 20.f);
+
+  for (EntityId id = 0; id < numItems; ++id) {
+    grid->addItemByRadius(Vec2f{ x(gen), y(gen) }, r(gen), id);
+  }
+
+  return grid;
+}
+
+std::vector<Vec2f> frustumPoly()
+{
+  return { { 590.f, 600.f }, { 100.f, 1100.f }, { 1100.f, 1100.f }, { 610.f, 600.f } };
+}
+
+void reportAllocations(benchmark::State& state, size_t allocationsBefore)
+{
+  state.counters["allocs"] = benchmark::Counter(
+    static_cast<double>(allocationCount() - allocationsBefore), benchmark::Counter::kAvgIterations);
+}
+
+} // namespace
+
+static void Grid_radiusQuery_set(benchmark::State& state)
+{
+  auto grid = createPopulatedGrid(state.range(0));
+
+  size_t allocs = allocationCount();
+  for (auto _ : state) {
+    auto items = grid->getItems(Vec2f{ 600.f, 600.f }, 60.f);
+    benchmark::DoNotOptimize(items);
+  }
+  reportAllocations(state, allocs);
+}
+BENCHMARK(Grid_radiusQuery_set)->Arg(1000)->Arg(10000)->Arg(100000);
+
+static void Grid_radiusQuery_buffer(benchmark::State& state)
+{
+  auto grid = createPopulatedGrid(state.range(0));
+  std::vector<EntityId> items;
+  grid->getItems(Vec2f{ 600.f, 600.f }, 60.f, items);
+
+  size_t allocs = allocationCount();
+  for (auto _ : state) {
+    grid->getItems(Vec2f{ 600.f, 600.f }, 60.f, items);
+    benchmark::DoNotOptimize(items.data());
+  }
+  reportAllocations(state, allocs);
+}
+BENCHMARK(Grid_radiusQuery_buffer)->Arg(1000)->Arg(10000)->Arg(100000);
+
+static void Grid_radiusQuery_visitor(benchmark::State& state)
+{
+  auto grid = createPopulatedGrid(state.range(0));
+
+  size_t allocs = allocationCount();
+  for (auto _ : state) {
+    EntityId sum = 0;
+    grid->forEachItem(Vec2f{ 600.f, 600.f }, 60.f, [&sum](EntityId id) { sum += id; });
+    benchmark::DoNotOptimize(sum);
+  }
+  reportAllocations(state, allocs);
+}
+BENCHMARK(Grid_radiusQuery_visitor)->Arg(1000)->Arg(10000)->Arg(100000);
+
+static void Grid_polyQuery_set(benchmark::State& state)
+{
+  auto grid = createPopulatedGrid(state.range(0));
+  auto poly = frustumPoly();
+
+  size_t allocs = allocationCount();
+  for (auto _ : state) {
+    auto items = grid->getItems(poly);
+    benchmark::DoNotOptimize(items);
+  }
+  reportAllocations(state, allocs);
+}
+BENCHMARK(Grid_polyQuery_set)->Arg(1000)->Arg(10000)->Arg(100000);
+
+static void Grid_polyQuery_buffer(benchmark::State& state)
+{
+  auto grid = createPopulatedGrid(state.range(0));
+  auto poly = frustumPoly();
+  std::vector<EntityId> items;
+  grid->getItems(poly, items);
+
+  size_t allocs = allocationCount();
+  for (auto _ : state) {
+    grid->getItems(poly, items);
+    benchmark::DoNotOptimize(items.data());
+  }
+  reportAllocations(state, allocs);
+}
+BENCHMARK(Grid_polyQuery_buffer)->Arg(1000)->Arg(10000)->Arg(100000);
+
+// Argument is the width of a square zone polygon, in cells
+static void Grid_addItemByArea(benchmark::State& state)
+{
+  float_t cellSize = (WORLD_MAX[0] - WORLD_MIN[0]) / 50.f;
+  float_t w = cellSize * static_cast<float_t>(state.range(0));
+  std::vector<Vec2f> poly{
+    { 0.5f, 0.5f }, { w + 0.5f, 0.5f }, { w + 0.5f, w + 0.5f }, { 0.5f, w + 0.5f }
+  };
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto grid = std::make_unique<BenchGrid>(WORLD_MIN, WORLD_MAX);
+    state.ResumeTiming();
+
+    grid->addItemByArea(poly, 0);
+    benchmark::DoNotOptimize(grid);
+  }
+}
+BENCHMARK(Grid_addItemByArea)->Arg(1)->Arg(10)->Arg(40);
@@ -0,0 +1,140 @@
+#include <job_system.hpp>
+#include <thread.hpp>
+#include <benchmark/benchmark.h>
+#include <cmath>
+
+namespace
+{
+
+const size_t NUM_TASKS = 1000;
+const size_t NUM_ELEMENTS = 1000000;
+
+unsigned numThreads()
+{
+  return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+float sumOfRoots(const std::vector<float>& values, size_t begin, size_t end)
+{
+  float sum = 0.f;
+  for (size_t i = begin; i < end; ++i) {
+    sum += std::sqrt(values[i]);
+  }
+  benchmark::DoNotOptimize(sum);
+  return sum;
+}
+
+} // namespace
+
+// Items are tasks, each doing next to nothing, so this is the cost of scheduling
+static void Thread_throughput(benchmark::State& state)
+{
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (unsigned i = 0; i < numThreads(); ++i) {
+    threads.push_back(std::make_unique<Thread>());
+  }
+  std::vector<std::future<void>> futures;
+  std::atomic<size_t> count = 0;
+
+  for (auto _ : state) {
+    for (size_t i = 0; i < NUM_TASKS; ++i) {
+      futures.push_back(threads[i % threads.size()]->run<void>([&]() { ++count; }));
+    }
+    for (auto& future : futures) {
+      future.get();
+    }
+    futures.clear();
+  }
+
+  state.SetItemsProcessed(state.iterations() * NUM_TASKS);
+}
+BENCHMARK(Thread_throughput)->Unit(benchmark::kMicrosecond);
+
+static void JobSystem_throughput(benchmark::State& state)
+{
+  JobSystem jobs;
+  std::atomic<size_t> count = 0;
+
+  for (auto _ : state) {
+    Job* root = jobs.create([]() {});
+    for (size_t i = 0; i < NUM_TASKS; ++i) {
+      jobs.run(jobs.create([&]() { ++count; }, root));
+    }
+    jobs.run(root);
+    jobs.wait(root);
+  }
+
+  state.SetItemsProcessed(state.iterations() * NUM_TASKS);
+}
+BENCHMARK(JobSystem_throughput)->Unit(benchmark::kMicrosecond);
+
+// Round trip of a single empty task, from submitting it to seeing it finish
+static void Thread_latency(benchmark::State& state)
+{
+  Thread thread;
+
+  for (auto _ : state) {
+    thread.run<void>([]() {}).wait();
+  }
+}
+BENCHMARK(Thread_latency)->Unit(benchmark::kNanosecond);
+
+static void JobSystem_latency(benchmark::State& state)
+{
+  JobSystem jobs;
+
+  for (auto _ : state) {
+    Job* job = jobs.create([]() {});
+    jobs.run(job);
+    jobs.wait(job);
+  }
+}
+BENCHMARK(JobSystem_latency)->Unit(benchmark::kNanosecond);
+
+// A chunk per thread, as SpatialSystem splits its work today
+static void Thread_parallelFor(benchmark::State& state)
+{
+  std::vector<float> values(NUM_ELEMENTS, 2.f);
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (unsigned i = 1; i < numThreads(); ++i) {
+    threads.push_back(std::make_unique<Thread>());
+  }
+  std::vector<std::future<float>> futures;
+
+  for (auto _ : state) {
+    const size_t chunkSize = (NUM_ELEMENTS + threads.size()) / (threads.size() + 1);
+    for (size_t i = 0; i < threads.size(); ++i) {
+      size_t begin = (i + 1) * chunkSize;
+      size_t end = std::min(NUM_ELEMENTS, begin + chunkSize);
+      futures.push_back(threads[i]->run<float>([&values, begin, end]() {
+        return sumOfRoots(values, begin, end);
+      }));
+    }
+    float sum = sumOfRoots(values, 0, std::min(NUM_ELEMENTS, chunkSize));
+    for (auto& future : futures) {
+      sum += future.get();
+    }
+    futures.clear();
+    benchmark::DoNotOptimize(sum);
+  }
+
+  state.SetItemsProcessed(state.iterations() * NUM_ELEMENTS);
+}
+BENCHMARK(Thread_parallelFor)->Unit(benchmark::kMicrosecond);
+
+static void JobSystem_parallelFor(benchmark::State& state)
+{
+  std::vector<float> values(NUM_ELEMENTS, 2.f);
+  JobSystem jobs;
+
+  for (auto _ : state) {
+    std::atomic<float> sum = 0.f;
+    jobs.parallelFor(NUM_ELEMENTS, [&](size_t begin, size_t end) {
+      sum += sumOfRoots(values, begin, end);
+    });
+    benchmark::DoNotOptimize(sum.load());
+  }
+
+  state.SetItemsProcessed(state.iterations() * NUM_ELEMENTS);
+}
+BENCHMARK(JobSystem_parallelFor)->Unit(benchmark::kMicrosecond);
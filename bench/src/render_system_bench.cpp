@@ -0,0 +1,141 @@
+#include <render_system.hpp>
+#include <renderer.hpp>
+#include <spatial_system.hpp>
+#include <camera.hpp>
+#include <logger.hpp>
+#include <benchmark/benchmark.h>
+#include <random>
+#include <sstream>
+
+using namespace render;
+
+namespace
+{
+
+// Accepts draw calls and does nothing with them, so only the render system's own work is timed
+class NullRenderer : public Renderer
+{
+  public:
+    void start() override {}
+    double frameRate() const override { return 0.0; }
+    void onResize() override {}
+    const ViewParams& getViewParams() const override { return m_params; }
+    void checkError() const override {}
+
+    void compileShader(const MeshFeatureSet&, const MaterialFeatureSet&) override {}
+
+    RenderItemId addTexture(TexturePtr) override { return 0; }
+    RenderItemId addNormalMap(TexturePtr) override { return 0; }
+    RenderItemId addCubeMap(std::array<TexturePtr, 6>&&) override { return 0; }
+    void removeTexture(RenderItemId) override {}
+    void removeCubeMap(RenderItemId) override {}
+
+    MeshHandle addMesh(MeshPtr) override { return {}; }
+    void removeMesh(RenderItemId) override {}
+
+    MaterialHandle addMaterial(MaterialPtr) override { return {}; }
+    void removeMaterial(RenderItemId) override {}
+
+    void beginFrame() override {}
+    void beginPass(RenderPass, const Vec3f&, const Mat4x4f&) override {}
+    void drawModel(MeshHandle, MaterialHandle, const Mat4x4f& transform) override
+    {
+      benchmark::DoNotOptimize(transform);
+      ++drawCalls;
+    }
+    void drawModel(MeshHandle, MaterialHandle, const Mat4x4f& transform,
+      const std::vector<Mat4x4f>&) override
+    {
+      benchmark::DoNotOptimize(transform);
+      ++drawCalls;
+    }
+    void drawInstance(MeshHandle, MaterialHandle, const Mat4x4f& transform) override
+    {
+      benchmark::DoNotOptimize(transform);
+      ++drawCalls;
+    }
+    void drawLight(const Vec3f&, float_t, float_t, float_t, const Mat4x4f&) override {}
+    void drawSkybox(MeshHandle, MaterialHandle) override {}
+    void endPass() override {}
+    void endFrame() override {}
+
+    size_t drawCalls = 0;
+
+  private:
+    ViewParams m_params{
+      .hFov = degreesToRadians(90.f),
+      .vFov = degreesToRadians(60.f),
+      .aspectRatio = 1.5f,
+      .nearPlane = 0.1f,
+      .farPlane = 1000.f
+    };
+};
+
+// A field of models around the camera, half of them instanced, with a light and a skybox
+struct RenderFixture
+{
+  RenderFixture(size_t numModels)
+    : logger(createLogger(stream, stream, stream, stream))
+    , spatialSystem(createSpatialSystem(*logger))
+    , renderSystem(createRenderSystem(*spatialSystem, renderer, *logger))
+  {
+    spatialSystem->initialise(Vec2f{ -500.f, -500.f }, Vec2f{ 500.f, 500.f });
+
+    MeshHandle mesh;
+    mesh.features.flags.set(MeshFeatures::CastsShadow);
+    mesh.transform = identityMatrix<float_t, 4>();
+
+    std::mt19937 gen{ 1234 };
+    std::uniform_real_distribution<float_t> x(-500.f, 500.f);
+
+    for (size_t i = 0; i < numModels; ++i) {
+      EntityId id = System::nextId();
+      Vec3f pos{ x(gen), 0.f, x(gen) };
+      spatialSystem->addComponent(std::make_unique<CSpatial>(id, translationMatrix4x4(pos), 1.f));
+
+      auto model = std::make_unique<CRenderModel>(id);
+      model->isInstanced = i % 2 == 0;
+      model->submodels.push_back(Submodel{ .mesh = mesh, .material = {}, .skin = nullptr });
+      renderSystem->addComponent(std::move(model));
+    }
+
+    EntityId lightId = System::nextId();
+    spatialSystem->addComponent(std::make_unique<CSpatial>(lightId,
+      lookAt(Vec3f{ 0.f, 100.f, -300.f }, Vec3f{ 0.f, 0.f, 0.f }), 1.f));
+    auto light = std::make_unique<CRenderLight>(lightId);
+    light->colour = Vec3f{ 1.f, 1.f, 1.f };
+    renderSystem->addComponent(std::move(light));
+
+    EntityId skyboxId = System::nextId();
+    spatialSystem->addComponent(std::make_unique<CSpatial>(skyboxId,
+      identityMatrix<float_t, 4>(), 1000.f));
+    renderSystem->addComponent(std::make_unique<CRenderSkybox>(skyboxId));
+
+    spatialSystem->update();
+    renderSystem->camera().setPosition(Vec3f{ 0.f, 2.f, -300.f });
+  }
+
+  std::stringstream stream;
+  LoggerPtr logger;
+  NullRenderer renderer;
+  SpatialSystemPtr spatialSystem;
+  RenderSystemPtr renderSystem;
+};
+
+} // namespace
+
+// Items are draw calls, so the rate is the CPU cost per visible entity per pass, culling included
+static void RenderSystem_update(benchmark::State& state)
+{
+  RenderFixture fixture(state.range(0));
+
+  for (auto _ : state) {
+    fixture.renderSystem->update();
+  }
+
+  size_t drawCalls = fixture.renderer.drawCalls;
+  state.counters["drawsPerFrame"] = static_cast<double>(drawCalls) / state.iterations();
+  state.SetItemsProcessed(drawCalls);
+}
+BENCHMARK(RenderSystem_update)->ArgName("models")->Arg(10000)->Arg(100000)
+  ->Unit(benchmark::kMicrosecond);
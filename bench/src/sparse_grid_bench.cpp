@@ -0,0 +1,101 @@
+#include <sparse_grid.hpp>
+#include <system.hpp>
+#include <benchmark/benchmark.h>
+#include <random>
+
+namespace
+{
+
+// Matches the cell size chosen by gridCellSize()
+float_t cellSizeForWorld(float_t worldSize)
+{
+  return std::max(worldSize / 50.f, 4.f);
+}
+
+std::unique_ptr<SparseGrid<EntityId>> createPopulatedGrid(size_t numItems, float_t worldSize)
+{
+  auto grid = std::make_unique<SparseGrid<EntityId>>(cellSizeForWorld(worldSize));
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> x(0.f, worldSize);
+  std::uniform_real_distribution<float_t> r(1.f, 20.f);
+
+  for (EntityId id = 0; id < numItems; ++id) {
+    grid->addItemByRadius(Vec2f{ x(gen), x(gen) }, r(gen), id);
+  }
+
+  return grid;
+}
+
+void scalingArgs(benchmark::internal::Benchmark* b)
+{
+  for (int64_t worldSize : { 2000, 20000, 200000 }) {
+    for (int64_t numItems : { 1000, 10000, 100000, 1000000 }) {
+      b->Args({ numItems, worldSize });
+    }
+  }
+}
+
+} // namespace
+
+// Arguments are number of items and world width
+static void SparseGrid_insert(benchmark::State& state)
+{
+  for (auto _ : state) {
+    auto grid = createPopulatedGrid(state.range(0), static_cast<float_t>(state.range(1)));
+    state.counters["cells"] = static_cast<double>(grid->numOccupiedCells());
+    benchmark::DoNotOptimize(grid);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(SparseGrid_insert)->Apply(scalingArgs)->Unit(benchmark::kMillisecond);
+
+static void SparseGrid_radiusQuery(benchmark::State& state)
+{
+  float_t worldSize = static_cast<float_t>(state.range(1));
+  auto grid = createPopulatedGrid(state.range(0), worldSize);
+
+  std::mt19937 gen{ 5678 };
+  std::uniform_real_distribution<float_t> x(0.f, worldSize);
+  std::vector<EntityId> items;
+  size_t found = 0;
+
+  for (auto _ : state) {
+    grid->getItems(Vec2f{ x(gen), x(gen) }, 60.f, items);
+    found += items.size();
+  }
+
+  state.counters["cells"] = static_cast<double>(grid->numOccupiedCells());
+  state.counters["found"] = benchmark::Counter(static_cast<double>(found),
+    benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(SparseGrid_radiusQuery)->Apply(scalingArgs);
+
+static void SparseGrid_polyQuery(benchmark::State& state)
+{
+  float_t worldSize = static_cast<float_t>(state.range(1));
+  auto grid = createPopulatedGrid(state.range(0), worldSize);
+
+  std::mt19937 gen{ 5678 };
+  std::uniform_real_distribution<float_t> x(0.f, worldSize - 1000.f);
+  std::vector<EntityId> items;
+  size_t found = 0;
+
+  for (auto _ : state) {
+    // Roughly the shape of a view frustum with a far distance of 500
+    Vec2f p{ x(gen), x(gen) };
+    std::vector<Vec2f> poly{
+      p + Vec2f{ 490.f, 0.f },
+      p + Vec2f{ 0.f, 500.f },
+      p + Vec2f{ 1000.f, 500.f },
+      p + Vec2f{ 510.f, 0.f }
+    };
+    grid->getItems(poly, items);
+    found += items.size();
+  }
+
+  state.counters["cells"] = static_cast<double>(grid->numOccupiedCells());
+  state.counters["found"] = benchmark::Counter(static_cast<double>(found),
+    benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(SparseGrid_polyQuery)->Apply(scalingArgs);
@@ -0,0 +1,197 @@
+#include <spatial_index.hpp>
+#include <benchmark/benchmark.h>
+#include <random>
+
+namespace
+{
+
+enum IndexArg : int64_t
+{
+  GRID,
+  BVH
+};
+
+enum MapArg : int64_t
+{
+  MAP1,
+  DENSE
+};
+
+struct Map
+{
+  Vec2f min;
+  Vec2f max;
+  std::vector<std::pair<Vec2f, float_t>> items;
+};
+
+// Roughly the population of map1.svg once loaded: a few thousand walls, floor tiles and props
+// spread over the map, plus the skybox, which covers everything
+Map createMap1()
+{
+  Map map{ .min = Vec2f{ -350.f, -350.f }, .max = Vec2f{ 1550.f, 1550.f }, .items = {} };
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> x(-350.f, 1550.f);
+  std::uniform_real_distribution<float_t> r(1.f, 20.f);
+
+  for (size_t i = 0; i < 3000; ++i) {
+    map.items.push_back({ Vec2f{ x(gen), x(gen) }, r(gen) });
+  }
+  map.items.push_back({ Vec2f{ 600.f, 600.f }, 10000.f });
+
+  return map;
+}
+
+// 200k small items in tight clusters over a large world, with most of the world empty
+Map createDenseMap()
+{
+  Map map{ .min = Vec2f{ 0.f, 0.f }, .max = Vec2f{ 20000.f, 20000.f }, .items = {} };
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> x(1000.f, 19000.f);
+  std::normal_distribution<float_t> offset(0.f, 150.f);
+  std::uniform_real_distribution<float_t> r(0.5f, 5.f);
+
+  for (size_t c = 0; c < 200; ++c) {
+    Vec2f centre{ x(gen), x(gen) };
+    for (size_t i = 0; i < 1000; ++i) {
+      map.items.push_back({ centre + Vec2f{ offset(gen), offset(gen) }, r(gen) });
+    }
+  }
+
+  return map;
+}
+
+const Map& getMap(int64_t arg)
+{
+  static const Map map1 = createMap1();
+  static const Map dense = createDenseMap();
+  return arg == MAP1 ? map1 : dense;
+}
+
+SpatialIndexPtr createIndex(int64_t arg, const Map& map)
+{
+  auto index = arg == GRID ? createGridIndex() : createBvhIndex();
+  index->initialise(map.min, map.max);
+
+  for (EntityId id = 0; id < map.items.size(); ++id) {
+    index->addItem(id, map.items[id].first, map.items[id].second);
+  }
+  index->update();
+
+  return index;
+}
+
+// Roughly the shape of a view frustum with a far distance of 500
+std::vector<Vec2f> viewFootprint(const Vec2f& p)
+{
+  return {
+    p + Vec2f{ -10.f, 0.f },
+    p + Vec2f{ 10.f, 0.f },
+    p + Vec2f{ 500.f, 500.f },
+    p + Vec2f{ -500.f, 500.f }
+  };
+}
+
+void indexArgs(benchmark::internal::Benchmark* b)
+{
+  b->ArgNames({ "bvh", "dense" });
+  for (int64_t map : { MAP1, DENSE }) {
+    for (int64_t index : { GRID, BVH }) {
+      b->Args({ index, map });
+    }
+  }
+}
+
+} // namespace
+
+// Arguments are the index type and the map. Includes the first update, which is when the BVH is
+// built
+static void SpatialIndex_build(benchmark::State& state)
+{
+  const Map& map = getMap(state.range(1));
+  size_t memory = 0;
+
+  for (auto _ : state) {
+    auto index = createIndex(state.range(0), map);
+    memory = index->memoryUsage();
+    benchmark::DoNotOptimize(index);
+  }
+
+  state.counters["bytes"] = static_cast<double>(memory);
+  state.counters["bytesPerItem"] = static_cast<double>(memory) / map.items.size();
+  state.SetItemsProcessed(state.iterations() * map.items.size());
+}
+BENCHMARK(SpatialIndex_build)->Apply(indexArgs)->Unit(benchmark::kMillisecond);
+
+static void SpatialIndex_query(benchmark::State& state)
+{
+  const Map& map = getMap(state.range(1));
+  auto index = createIndex(state.range(0), map);
+
+  std::mt19937 gen{ 5678 };
+  std::uniform_int_distribution<size_t> item(0, map.items.size() - 1);
+  std::vector<EntityId> entities;
+  size_t found = 0;
+
+  for (auto _ : state) {
+    // Look out from a random item, so the dense map is queried where there's something to find
+    index->getItems(viewFootprint(map.items[item(gen)].first), entities);
+    found += entities.size();
+  }
+
+  state.counters["found"] = benchmark::Counter(static_cast<double>(found),
+    benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(SpatialIndex_query)->Apply(indexArgs)->Unit(benchmark::kMicrosecond);
+
+// Four views at once, like the main camera and the shadow views that cover it
+static void SpatialIndex_queryViews(benchmark::State& state)
+{
+  const Map& map = getMap(state.range(1));
+  auto index = createIndex(state.range(0), map);
+
+  std::mt19937 gen{ 5678 };
+  std::uniform_int_distribution<size_t> item(0, map.items.size() - 1);
+  std::vector<ViewVolume> views(4);
+  std::vector<EntityId> entities;
+  std::vector<uint32_t> masks;
+  size_t found = 0;
+
+  for (auto _ : state) {
+    Vec2f p = map.items[item(gen)].first;
+    for (size_t i = 0; i < views.size(); ++i) {
+      views[i].footprint = viewFootprint(p + Vec2f{ 20.f * i, -10.f * i });
+    }
+    index->getItems(views, entities, masks);
+    found += entities.size();
+  }
+
+  state.counters["found"] = benchmark::Counter(static_cast<double>(found),
+    benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(SpatialIndex_queryViews)->Apply(indexArgs)->Unit(benchmark::kMicrosecond);
+
+// One item in a hundred moves every frame. In the BVH they're all handed over to its grid on the
+// first frame, and the tree is left alone after that
+static void SpatialIndex_update_movingItems(benchmark::State& state)
+{
+  const Map& map = getMap(state.range(1));
+  auto index = createIndex(state.range(0), map);
+  auto items = map.items;
+
+  std::mt19937 gen{ 5678 };
+  std::uniform_real_distribution<float_t> step(-2.f, 2.f);
+  const size_t MOVER_SPACING = 100;
+
+  for (auto _ : state) {
+    for (EntityId id = 0; id < items.size(); id += MOVER_SPACING) {
+      items[id].first = items[id].first + Vec2f{ step(gen), step(gen) };
+      index->moveItem(id, items[id].first, items[id].second);
+    }
+    index->update();
+  }
+
+  state.SetItemsProcessed(state.iterations() * (items.size() / MOVER_SPACING));
+}
+BENCHMARK(SpatialIndex_update_movingItems)->Apply(indexArgs)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,281 @@
+#include "alloc_counter.hpp"
+#include <spatial_system.hpp>
+#include <logger.hpp>
+#include <job_system.hpp>
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <sstream>
+
+namespace
+{
+
+const size_t NUM_ENTITIES = 100000;
+
+struct SpatialFixture
+{
+  SpatialFixture(SpatialIndexType indexType = SpatialIndexType::Grid)
+    : logger(createLogger(stream, stream, stream, stream))
+    , spatialSystem(createSpatialSystem(*logger, indexType))
+  {
+    std::uniform_real_distribution<float_t> x(-350.f, 1550.f);
+    std::uniform_real_distribution<float_t> r(1.f, 5.f);
+
+    for (EntityId id = 0; id < NUM_ENTITIES; ++id) {
+      Vec3f pos{ x(gen), 0.f, x(gen) };
+      positions.push_back(pos);
+      spatialSystem->addComponent(std::make_unique<CSpatial>(id, translationMatrix4x4(pos),
+        r(gen)));
+    }
+    spatialSystem->update();
+  }
+
+  std::stringstream stream;
+  LoggerPtr logger;
+  SpatialSystemPtr spatialSystem;
+  std::vector<Vec3f> positions;
+  std::mt19937 gen{ 1234 };
+};
+
+// Camera at pos looking along +z, with a 90 degree field of view and a far distance of 300
+ViewVolume createView(const Vec3f& pos)
+{
+  Mat4x4f view = lookAt(pos, pos + Vec3f{ 0.f, 0.f, 1.f });
+  Mat4x4f proj = perspective(PIf / 2.f, PIf / 3.f, 0.1f, 300.f);
+
+  return ViewVolume{
+    .footprint = {
+      { pos[0] - 0.1f, pos[2] + 0.1f }, { pos[0] + 0.1f, pos[2] + 0.1f },
+      { pos[0] + 300.f, pos[2] + 300.f }, { pos[0] - 300.f, pos[2] + 300.f }
+    },
+    .frustum = computeFrustum(proj * view)
+  };
+}
+
+// Views clustered around the same point, like a main camera and the shadow views that cover it
+std::vector<ViewVolume> createViews(size_t n)
+{
+  std::vector<ViewVolume> views;
+  for (size_t i = 0; i < n; ++i) {
+    views.push_back(createView(Vec3f{ 400.f + 20.f * i, 0.f, 400.f - 10.f * i }));
+  }
+  return views;
+}
+
+} // namespace
+
+// Argument is the percentage of entities that move each frame
+static void SpatialSystem_update_movingEntities(benchmark::State& state)
+{
+  SpatialFixture fixture;
+  auto& spatialSystem = *fixture.spatialSystem;
+
+  size_t numMoving = NUM_ENTITIES * state.range(0) / 100;
+  std::uniform_real_distribution<float_t> step(-2.f, 2.f);
+  size_t next = 0;
+
+  for (auto _ : state) {
+    for (size_t n = 0; n < numMoving; ++n) {
+      EntityId id = next++ % NUM_ENTITIES;
+      Vec3f& pos = fixture.positions[id];
+      pos[0] = clip(pos[0] + step(fixture.gen), -350.f, 1550.f);
+      pos[2] = clip(pos[2] + step(fixture.gen), -350.f, 1550.f);
+      spatialSystem.setTransform(id, translationMatrix4x4(pos));
+    }
+    spatialSystem.update();
+  }
+
+  state.SetItemsProcessed(state.iterations() * numMoving);
+}
+BENCHMARK(SpatialSystem_update_movingEntities)->Arg(1)->Arg(10)->Arg(100)
+  ->Unit(benchmark::kMicrosecond);
+
+// 20k parents, each with a chain of 4 attached descendants. Only the parents are moved, so every
+// descendant's absolute transform is recomputed through the hierarchy
+static void SpatialSystem_update_attachedEntities(benchmark::State& state)
+{
+  const EntityId NUM_PARENTS = 20000;
+  const EntityId CHAIN_LENGTH = 4;
+
+  std::stringstream stream;
+  LoggerPtr logger = createLogger(stream, stream, stream, stream);
+  JobSystem jobs;
+  SpatialSystemPtr spatialSystem = createSpatialSystem(*logger, SpatialIndexType::Grid, &jobs);
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> x(-350.f, 1550.f);
+  std::uniform_real_distribution<float_t> step(-2.f, 2.f);
+  std::vector<Vec3f> positions;
+
+  EntityId id = 0;
+  for (EntityId i = 0; i < NUM_PARENTS; ++i) {
+    Vec3f pos{ x(gen), 0.f, x(gen) };
+    positions.push_back(pos);
+    EntityId parent = id;
+    spatialSystem->addComponent(std::make_unique<CSpatial>(id++, translationMatrix4x4(pos), 2.f));
+
+    for (EntityId j = 0; j < CHAIN_LENGTH; ++j) {
+      spatialSystem->addComponent(std::make_unique<CSpatial>(id,
+        translationMatrix4x4(Vec3f{ 0.f, 1.f, 0.f }), 1.f, parent));
+      parent = id++;
+    }
+  }
+
+  for (auto _ : state) {
+    for (EntityId i = 0; i < NUM_PARENTS; ++i) {
+      Vec3f& pos = positions[i];
+      pos[0] = clip(pos[0] + step(gen), -350.f, 1550.f);
+      pos[2] = clip(pos[2] + step(gen), -350.f, 1550.f);
+      spatialSystem->setTransform(i * (CHAIN_LENGTH + 1), translationMatrix4x4(pos));
+    }
+    spatialSystem->update();
+  }
+
+  state.SetItemsProcessed(state.iterations() * id);
+}
+BENCHMARK(SpatialSystem_update_attachedEntities)->Unit(benchmark::kMicrosecond);
+
+// Argument is the number of views
+static void SpatialSystem_cullViews_separate(benchmark::State& state)
+{
+  SpatialFixture fixture;
+  auto views = createViews(state.range(0));
+  std::vector<std::vector<EntityId>> visible(views.size());
+
+  for (auto _ : state) {
+    for (size_t i = 0; i < views.size(); ++i) {
+      fixture.spatialSystem->getIntersecting(views[i].footprint, views[i].frustum, visible[i]);
+    }
+    benchmark::DoNotOptimize(visible.data());
+  }
+}
+BENCHMARK(SpatialSystem_cullViews_separate)->Arg(1)->Arg(2)->Arg(4)->Arg(8)
+  ->Unit(benchmark::kMicrosecond);
+
+// Arguments are the number of views and whether to use the BVH index
+static void SpatialSystem_cullViews_batched(benchmark::State& state)
+{
+  SpatialFixture fixture(state.range(1) ? SpatialIndexType::Bvh : SpatialIndexType::Grid);
+  auto views = createViews(state.range(0));
+  std::vector<EntityId> visible;
+  std::vector<uint32_t> masks;
+  std::vector<CullingStats> stats;
+
+  for (auto _ : state) {
+    fixture.spatialSystem->getIntersecting(views, visible, masks, stats);
+    benchmark::DoNotOptimize(visible.data());
+  }
+}
+BENCHMARK(SpatialSystem_cullViews_batched)->ArgsProduct({ { 1, 2, 4, 8 }, { 0, 1 } })
+  ->ArgNames({ "views", "bvh" })->Unit(benchmark::kMicrosecond);
+
+// Arguments are the number of rays per iteration, like a frame's worth of line-of-sight and
+// audio occlusion checks, and whether to use the BVH index. Rays are up to 200 long, starting
+// from random entities
+static void SpatialSystem_raycast(benchmark::State& state)
+{
+  SpatialFixture fixture(state.range(1) ? SpatialIndexType::Bvh : SpatialIndexType::Grid);
+  const size_t numRays = state.range(0);
+
+  std::uniform_int_distribution<EntityId> entity(0, NUM_ENTITIES - 1);
+  std::uniform_real_distribution<float_t> d(-1.f, 1.f);
+  std::vector<std::pair<Vec3f, Vec3f>> rays;
+  for (size_t i = 0; i < numRays; ++i) {
+    rays.push_back({ fixture.positions[entity(fixture.gen)], Vec3f{ d(fixture.gen), 0.f,
+      d(fixture.gen) } });
+  }
+
+  // Don't count the ray's own origin entity
+  size_t numHits = 0;
+  size_t allocs = allocationCount();
+  for (auto _ : state) {
+    for (auto& ray : rays) {
+      RaycastHit hit;
+      Vec3f origin = ray.first + ray.second.normalise() * 6.f;
+      numHits += fixture.spatialSystem->raycast(origin, ray.second, 200.f, hit);
+    }
+  }
+
+  state.counters["allocs"] = benchmark::Counter(static_cast<double>(allocationCount() - allocs),
+    benchmark::Counter::kAvgIterations);
+  state.counters["hitRate"] = static_cast<double>(numHits) / (state.iterations() * numRays);
+  state.SetItemsProcessed(state.iterations() * numRays);
+}
+BENCHMARK(SpatialSystem_raycast)->ArgsProduct({ { 1000, 4000 }, { 0, 1 } })
+  ->ArgNames({ "rays", "bvh" })->Unit(benchmark::kMicrosecond);
+
+// Arguments are k and whether to use the BVH index. 1000 queries per iteration
+static void SpatialSystem_nearest(benchmark::State& state)
+{
+  SpatialFixture fixture(state.range(1) ? SpatialIndexType::Bvh : SpatialIndexType::Grid);
+  const size_t k = state.range(0);
+
+  std::uniform_real_distribution<float_t> x(-350.f, 1550.f);
+  std::vector<Vec3f> points;
+  for (size_t i = 0; i < 1000; ++i) {
+    points.push_back(Vec3f{ x(fixture.gen), 0.f, x(fixture.gen) });
+  }
+  std::vector<EntityId> entities;
+  entities.reserve(k);
+
+  size_t allocs = allocationCount();
+  for (auto _ : state) {
+    for (auto& p : points) {
+      fixture.spatialSystem->nearest(p, k, entities);
+      benchmark::DoNotOptimize(entities.data());
+    }
+  }
+
+  state.counters["allocs"] = benchmark::Counter(static_cast<double>(allocationCount() - allocs),
+    benchmark::Counter::kAvgIterations);
+  state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(SpatialSystem_nearest)->ArgsProduct({ { 1, 8, 64 }, { 0, 1 } })
+  ->ArgNames({ "k", "bvh" })->Unit(benchmark::kMicrosecond);
+
+// Argument is whether to use the BVH index. 1000 queries of radius 20 per iteration
+static void SpatialSystem_withinRadius(benchmark::State& state)
+{
+  SpatialFixture fixture(state.range(0) ? SpatialIndexType::Bvh : SpatialIndexType::Grid);
+
+  std::uniform_real_distribution<float_t> x(-350.f, 1550.f);
+  std::vector<Vec3f> points;
+  for (size_t i = 0; i < 1000; ++i) {
+    points.push_back(Vec3f{ x(fixture.gen), 0.f, x(fixture.gen) });
+  }
+  std::vector<EntityId> entities;
+
+  for (auto _ : state) {
+    for (auto& p : points) {
+      fixture.spatialSystem->withinRadius(p, 20.f, entities);
+      benchmark::DoNotOptimize(entities.data());
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(SpatialSystem_withinRadius)->ArgNames({ "bvh" })->Arg(0)->Arg(1)
+  ->Unit(benchmark::kMicrosecond);
+
+// The lookups other systems make each frame, e.g. the render system fetching each visible
+// entity's transform. Ids are visited in a shuffled order, as they come out of the index
+static void SpatialSystem_getComponent(benchmark::State& state)
+{
+  SpatialFixture fixture;
+
+  std::vector<EntityId> ids(NUM_ENTITIES);
+  std::iota(ids.begin(), ids.end(), 0);
+  std::shuffle(ids.begin(), ids.end(), fixture.gen);
+
+  for (auto _ : state) {
+    float_t sum = 0.f;
+    for (EntityId id : ids) {
+      sum += fixture.spatialSystem->getComponent(id).radius();
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+
+  state.SetItemsProcessed(state.iterations() * ids.size());
+}
+BENCHMARK(SpatialSystem_getComponent)->Unit(benchmark::kMicrosecond);
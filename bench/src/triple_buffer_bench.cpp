@@ -0,0 +1,93 @@
+#include <triple_buffer.hpp>
+#include <benchmark/benchmark.h>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+namespace
+{
+
+// The previous implementation, which takes a lock on every handoff
+template<typename T>
+class MutexTripleBuffer
+{
+  public:
+    T& writeComplete()
+    {
+      std::lock_guard lock(m_mutex);
+      m_timestamps[m_writeIndex] = ++m_frameCount;
+      std::swap(m_writeIndex, m_freeIndex);
+      return m_items[m_writeIndex];
+    }
+
+    T& getWritable()
+    {
+      return m_items[m_writeIndex];
+    }
+
+    T& readComplete()
+    {
+      std::lock_guard lock(m_mutex);
+      if (m_timestamps[m_freeIndex] > m_timestamps[m_readIndex]) {
+        std::swap(m_readIndex, m_freeIndex);
+      }
+      return m_items[m_readIndex];
+    }
+
+  private:
+    std::array<T, 3> m_items{};
+    std::array<size_t, 3> m_timestamps{};
+
+    std::mutex m_mutex;
+    size_t m_writeIndex = 0;
+    size_t m_readIndex = 1;
+    size_t m_freeIndex = 2;
+    size_t m_frameCount = 0;
+};
+
+struct Frame
+{
+  size_t value = 0;
+};
+
+// A writer thread publishes frames as fast as it can while the timed loop reads them, so every
+// handoff is contended
+template<typename Buffer>
+void handoff(benchmark::State& state)
+{
+  Buffer buffer;
+  std::atomic<bool> stop = false;
+
+  std::thread writer([&]() {
+    size_t frame = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      buffer.getWritable().value = ++frame;
+      buffer.writeComplete();
+    }
+  });
+
+  size_t sum = 0;
+  for (auto _ : state) {
+    sum += buffer.readComplete().value;
+  }
+  benchmark::DoNotOptimize(sum);
+
+  stop = true;
+  writer.join();
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+static void TripleBuffer_mutex(benchmark::State& state)
+{
+  handoff<MutexTripleBuffer<Frame>>(state);
+}
+BENCHMARK(TripleBuffer_mutex);
+
+static void TripleBuffer_atomic(benchmark::State& state)
+{
+  handoff<TripleBuffer<Frame>>(state);
+}
+BENCHMARK(TripleBuffer_atomic);
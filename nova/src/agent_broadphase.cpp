@@ -0,0 +1,201 @@
+#include "agent_broadphase.hpp"
+#include "exception.hpp"
+#include <algorithm>
+
+namespace
+{
+
+template<typename T>
+bool before(const T& a, const T& b)
+{
+  if (a.band != b.band) {
+    return a.band < b.band;
+  }
+  return a.minX < b.minX || (a.minX == b.minX && a.id < b.id);
+}
+
+} // namespace
+
+uint32_t AgentBroadphase::addAgent(const Vec2f& pos, float_t radius)
+{
+  uint32_t id;
+  if (m_freeIds.empty()) {
+    id = static_cast<uint32_t>(m_agents.size());
+    m_agents.emplace_back();
+  }
+  else {
+    id = m_freeIds.back();
+    m_freeIds.pop_back();
+  }
+
+  m_agents[id] = Agent{ pos, radius, true };
+  m_maxRadius = std::max(m_maxRadius, radius);
+
+  // If the largest radius has grown, the other keys are stale, but the next sort fixes them
+  Entry entry{ band(pos), pos[0] - radius, id };
+  auto i = std::lower_bound(m_order.begin(), m_order.end(), entry,
+    [](const Entry& a, const Entry& b) { return before(a, b); });
+  m_order.insert(i, entry);
+
+  return id;
+}
+
+void AgentBroadphase::removeAgent(uint32_t id)
+{
+  ASSERT(id < m_agents.size() && m_agents[id].alive, "No agent with id " << id);
+
+  m_agents[id].alive = false;
+  m_order.erase(std::find_if(m_order.begin(), m_order.end(),
+    [id](const Entry& entry) { return entry.id == id; }));
+  m_freeIds.push_back(id);
+}
+
+void AgentBroadphase::setPosition(uint32_t id, const Vec2f& pos)
+{
+  DBG_ASSERT(id < m_agents.size() && m_agents[id].alive, "No agent with id " << id);
+  m_agents[id].pos = pos;
+}
+
+const Vec2f& AgentBroadphase::position(uint32_t id) const
+{
+  DBG_ASSERT(id < m_agents.size() && m_agents[id].alive, "No agent with id " << id);
+  return m_agents[id].pos;
+}
+
+size_t AgentBroadphase::numAgents() const
+{
+  return m_order.size();
+}
+
+size_t AgentBroadphase::capacity() const
+{
+  return m_agents.size();
+}
+
+// Bands are as deep as the largest agent is wide, so overlapping agents are in the same band or
+// neighbouring ones
+int32_t AgentBroadphase::band(const Vec2f& pos) const
+{
+  if (m_maxRadius <= 0.f) {
+    return 0;
+  }
+  return static_cast<int32_t>(floor(pos[1] / (2.f * m_maxRadius)));
+}
+
+// Refreshes the keys and restores the order with an insertion sort, which is close to linear when
+// the agents have barely moved since the last frame
+void AgentBroadphase::sort()
+{
+  for (auto& entry : m_order) {
+    const Agent& agent = m_agents[entry.id];
+    entry.band = band(agent.pos);
+    entry.minX = agent.pos[0] - agent.radius;
+  }
+
+  for (size_t i = 1; i < m_order.size(); ++i) {
+    Entry entry = m_order[i];
+    size_t j = i;
+    while (j > 0 && before(entry, m_order[j - 1])) {
+      m_order[j] = m_order[j - 1];
+      --j;
+    }
+    m_order[j] = entry;
+  }
+}
+
+const std::vector<AgentBroadphase::Pair>& AgentBroadphase::findPairs()
+{
+  sort();
+
+  const size_t n = m_order.size();
+  m_maxX.resize(n);
+  m_minZ.resize(n);
+  m_maxZ.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    const Agent& agent = m_agents[m_order[i].id];
+    m_maxX[i] = agent.pos[0] + agent.radius;
+    m_minZ[i] = agent.pos[1] - agent.radius;
+    m_maxZ[i] = agent.pos[1] + agent.radius;
+  }
+
+  m_pairs.clear();
+
+  size_t bandBegin = 0;
+  while (bandBegin < n) {
+    int32_t b = m_order[bandBegin].band;
+    size_t bandEnd = bandBegin;
+    while (bandEnd < n && m_order[bandEnd].band == b) {
+      ++bandEnd;
+    }
+    size_t nextEnd = bandEnd;
+    if (bandEnd < n && m_order[bandEnd].band == b + 1) {
+      while (nextEnd < n && m_order[nextEnd].band == b + 1) {
+        ++nextEnd;
+      }
+    }
+
+    // The cursor into the next band only moves forward, as each agent in this band starts to its
+    // right of the last. Agents in the next band ending before the current one starts are skipped
+    size_t cursor = bandEnd;
+    for (size_t i = bandBegin; i < bandEnd; ++i) {
+      sweep(i, i + 1, bandEnd);
+
+      float_t minX = m_order[i].minX;
+      while (cursor < nextEnd && m_order[cursor].minX < minX - 2.f * m_maxRadius) {
+        ++cursor;
+      }
+      sweep(i, cursor, nextEnd);
+    }
+
+    bandBegin = bandEnd;
+  }
+
+  return m_pairs;
+}
+
+// Compares agent i with those in [begin, end) of the sorted order whose left edges aren't past its
+// right edge
+void AgentBroadphase::sweep(size_t i, size_t begin, size_t end)
+{
+  for (size_t j = begin; j < end && m_order[j].minX <= m_maxX[i]; ++j) {
+    if (m_maxX[j] < m_order[i].minX || m_minZ[j] > m_maxZ[i] || m_maxZ[j] < m_minZ[i]) {
+      continue;
+    }
+
+    uint32_t a = m_order[i].id;
+    uint32_t b = m_order[j].id;
+    const Agent& A = m_agents[a];
+    const Agent& B = m_agents[b];
+    Vec2f d = B.pos - A.pos;
+    float_t r = A.radius + B.radius;
+    if (d.dot(d) < r * r) {
+      m_pairs.push_back(a < b ? Pair{ a, b } : Pair{ b, a });
+    }
+  }
+}
+
+void AgentBroadphase::separation(std::span<Vec2f> displacements, float_t stiffness) const
+{
+  ASSERT(displacements.size() >= m_agents.size(), "Expected a displacement per agent id");
+
+  std::fill(displacements.begin(), displacements.end(), Vec2f{});
+
+  for (auto& pair : m_pairs) {
+    const Agent& A = m_agents[pair.a];
+    const Agent& B = m_agents[pair.b];
+
+    Vec2f d = B.pos - A.pos;
+    float_t distance = d.magnitude();
+    float_t overlap = A.radius + B.radius - distance;
+    if (overlap <= 0.f) {
+      continue;
+    }
+
+    // Agents at the same point are split along x, lower id to the left
+    Vec2f normal = distance > 0.f ? d / distance : Vec2f{ 1.f, 0.f };
+    Vec2f push = normal * (0.5f * overlap * stiffness);
+
+    displacements[pair.a] -= push;
+    displacements[pair.b] += push;
+  }
+}
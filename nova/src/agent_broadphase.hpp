@@ -0,0 +1,78 @@
+#pragma once
+
+#include "math.hpp"
+#include <vector>
+#include <span>
+#include <cstdint>
+
+// Finds overlapping pairs among many circular agents, e.g. a crowd of characters, by sweep and
+// prune. A single sweep along x would compare each agent with everything in a strip running the
+// whole depth of the world, so the world is cut into bands along z, each as deep as the largest
+// agent is wide. Agents are kept sorted by band and then by the left edge of their bounding boxes,
+// and each band is swept against itself and the next one up.
+//
+// Agents move only a little between frames, so an insertion sort restores the order in close to
+// linear time.
+//
+// The pairs are in a deterministic order, so results don't depend on anything but the positions.
+// Ids of removed agents are reused.
+class AgentBroadphase
+{
+  public:
+    struct Pair
+    {
+      uint32_t a;   // The lower id
+      uint32_t b;
+    };
+
+    uint32_t addAgent(const Vec2f& pos, float_t radius);
+    void removeAgent(uint32_t id);
+    void setPosition(uint32_t id, const Vec2f& pos);
+    const Vec2f& position(uint32_t id) const;
+    size_t numAgents() const;
+    // One more than the highest id handed out, i.e. the number of elements needed to hold a value
+    // per agent
+    size_t capacity() const;
+
+    // Re-sorts the agents and returns each pair whose circles overlap. The list is valid until the
+    // next call
+    const std::vector<Pair>& findPairs();
+
+    // Works out how far to move each agent, indexed by id, so that the pairs found by the last
+    // call to findPairs() no longer overlap. Each agent in a pair takes half of the push, scaled
+    // by stiffness. Nothing is moved, so the caller can pass the result through the collision
+    // system to keep agents out of walls
+    void separation(std::span<Vec2f> displacements, float_t stiffness = 1.f) const;
+
+  private:
+    struct Agent
+    {
+      Vec2f pos;
+      float_t radius;
+      bool alive;
+    };
+
+    // Sort key, kept next to the id so the insertion sort moves as little as possible
+    struct Entry
+    {
+      int32_t band;
+      float_t minX;
+      uint32_t id;
+    };
+
+    std::vector<Agent> m_agents;        // Indexed by id
+    std::vector<uint32_t> m_freeIds;
+    std::vector<Entry> m_order;         // Live agents, sorted by band and then minX
+    float_t m_maxRadius = 0.f;
+
+    // The agents in sorted order, packed for the sweep
+    std::vector<float_t> m_maxX;
+    std::vector<float_t> m_minZ;
+    std::vector<float_t> m_maxZ;
+
+    std::vector<Pair> m_pairs;
+
+    int32_t band(const Vec2f& pos) const;
+    void sort();
+    void sweep(size_t i, size_t begin, size_t end);
+};
@@ -0,0 +1,363 @@
+#include "bvh.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+// Plain floats rather than Vec2f, as this is on the build's hot path
+struct Bounds
+{
+  float_t minX = std::numeric_limits<float_t>::max();
+  float_t minY = std::numeric_limits<float_t>::max();
+  float_t maxX = std::numeric_limits<float_t>::lowest();
+  float_t maxY = std::numeric_limits<float_t>::lowest();
+
+  void grow(float_t x, float_t y)
+  {
+    minX = std::min(minX, x);
+    minY = std::min(minY, y);
+    maxX = std::max(maxX, x);
+    maxY = std::max(maxY, y);
+  }
+
+  void grow(const Bounds& b)
+  {
+    minX = std::min(minX, b.minX);
+    minY = std::min(minY, b.minY);
+    maxX = std::max(maxX, b.maxX);
+    maxY = std::max(maxY, b.maxY);
+  }
+
+  float_t min(size_t axis) const
+  {
+    return axis == 0 ? minX : minY;
+  }
+
+  float_t max(size_t axis) const
+  {
+    return axis == 0 ? maxX : maxY;
+  }
+
+  // Plays the role of surface area in the 2D heuristic
+  float_t halfPerimeter() const
+  {
+    return (maxX - minX) + (maxY - minY);
+  }
+};
+
+Bounds itemBounds(const Bvh::Item& item)
+{
+  return Bounds{
+    .minX = item.pos[0] - item.radius,
+    .minY = item.pos[1] - item.radius,
+    .maxX = item.pos[0] + item.radius,
+    .maxY = item.pos[1] + item.radius
+  };
+}
+
+struct Bin
+{
+  Bounds bounds;
+  uint32_t count = 0;
+};
+
+// Separating axis test of segment AB against the closed box. The only candidate axes are the
+// box's own and the segment's normal, so this needs no divisions
+bool segmentIntersectsBox(const Vec2f& A, const Vec2f& B, const Vec2f& min, const Vec2f& max)
+{
+  if (std::max(A[0], B[0]) < min[0] || std::min(A[0], B[0]) > max[0] ||
+    std::max(A[1], B[1]) < min[1] || std::min(A[1], B[1]) > max[1]) {
+
+    return false;
+  }
+
+  float_t nx = A[1] - B[1];
+  float_t ny = B[0] - A[0];
+  float_t hx = (max[0] - min[0]) * 0.5f;
+  float_t hy = (max[1] - min[1]) * 0.5f;
+  float_t d = nx * (min[0] + hx - A[0]) + ny * (min[1] + hy - A[1]);
+
+  return std::abs(d) <= std::abs(nx) * hx + std::abs(ny) * hy;
+}
+
+float_t squareDistanceToSegment(const Vec2f& p, const Vec2f& A, const Vec2f& B)
+{
+  Vec2f AB = B - A;
+  Vec2f AP = p - A;
+  float_t lengthSquared = AB.dot(AB);
+  float_t t = lengthSquared > 0.f ? std::clamp(AP.dot(AB) / lengthSquared, 0.f, 1.f) : 0.f;
+  Vec2f d = AP - AB * t;
+  return d.dot(d);
+}
+
+} // namespace
+
+void Bvh::build(std::vector<Item> items)
+{
+  ASSERT(items.size() < std::numeric_limits<uint32_t>::max(), "Too many items");
+
+  m_items = std::move(items);
+  m_removed.assign(m_items.size(), 0);
+  m_numRemoved = 0;
+  m_nodes.clear();
+  m_indices.clear();
+
+  if (m_items.empty()) {
+    return;
+  }
+
+  // A binary tree with at least one item per leaf has fewer than 2n nodes
+  m_nodes.reserve(2 * m_items.size());
+  m_nodes.push_back(Node{});
+  subdivide(0, 0, static_cast<uint32_t>(m_items.size()));
+
+  m_indices.reserve(m_items.size());
+  for (uint32_t i = 0; i < m_items.size(); ++i) {
+    m_indices[m_items[i].id] = i;
+  }
+}
+
+void Bvh::subdivide(uint32_t nodeIndex, uint32_t first, uint32_t count)
+{
+  Bounds bounds;
+  Bounds centroids;
+  for (uint32_t i = first; i < first + count; ++i) {
+    bounds.grow(itemBounds(m_items[i]));
+    centroids.grow(m_items[i].pos[0], m_items[i].pos[1]);
+  }
+
+  m_nodes[nodeIndex].min = Vec2f{ bounds.minX, bounds.minY };
+  m_nodes[nodeIndex].max = Vec2f{ bounds.maxX, bounds.maxY };
+  m_nodes[nodeIndex].first = first;
+  m_nodes[nodeIndex].count = count;
+
+  if (count <= MAX_LEAF_ITEMS) {
+    return;
+  }
+
+  std::array<float_t, 2> scale{};
+  for (size_t axis = 0; axis < 2; ++axis) {
+    float_t extent = centroids.max(axis) - centroids.min(axis);
+    scale[axis] = extent > 0.f ? NUM_BINS / extent : 0.f;
+  }
+
+  auto binIndex = [&](const Item& item, size_t axis) {
+    float_t t = (item.pos[axis] - centroids.min(axis)) * scale[axis];
+    return std::min(static_cast<uint32_t>(t), NUM_BINS - 1);
+  };
+
+  // Bin along both axes in a single pass
+  std::array<std::array<Bin, NUM_BINS>, 2> bins;
+  for (uint32_t i = first; i < first + count; ++i) {
+    Bounds b = itemBounds(m_items[i]);
+    for (size_t axis = 0; axis < 2; ++axis) {
+      Bin& bin = bins[axis][binIndex(m_items[i], axis)];
+      bin.bounds.grow(b);
+      ++bin.count;
+    }
+  }
+
+  float_t bestCost = std::numeric_limits<float_t>::max();
+  size_t bestAxis = 0;
+  uint32_t bestSplit = 0;
+
+  for (size_t axis = 0; axis < 2; ++axis) {
+    if (scale[axis] == 0.f) {
+      continue;
+    }
+
+    // Cost of everything to the right of each split
+    std::array<float_t, NUM_BINS> rightCost{};
+    Bounds right;
+    uint32_t rightCount = 0;
+    for (uint32_t b = NUM_BINS - 1; b > 0; --b) {
+      right.grow(bins[axis][b].bounds);
+      rightCount += bins[axis][b].count;
+      rightCost[b] = rightCount > 0 ? right.halfPerimeter() * rightCount : 0.f;
+    }
+
+    Bounds left;
+    uint32_t leftCount = 0;
+    for (uint32_t b = 1; b < NUM_BINS; ++b) {
+      left.grow(bins[axis][b - 1].bounds);
+      leftCount += bins[axis][b - 1].count;
+      if (leftCount == 0 || leftCount == count) {
+        continue;
+      }
+
+      float_t cost = left.halfPerimeter() * leftCount + rightCost[b];
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestAxis = axis;
+        bestSplit = b;
+      }
+    }
+  }
+
+  uint32_t mid = first + count / 2;
+  if (bestSplit != 0) {
+    auto i = std::partition(m_items.begin() + first, m_items.begin() + first + count,
+      [&](const Item& item) { return binIndex(item, bestAxis) < bestSplit; });
+    mid = static_cast<uint32_t>(i - m_items.begin());
+  }
+  // Otherwise all centroids coincide, so any split is as good as another
+
+  uint32_t left = static_cast<uint32_t>(m_nodes.size());
+  m_nodes.push_back(Node{});
+  m_nodes.push_back(Node{});
+  m_nodes[nodeIndex].first = left;
+  m_nodes[nodeIndex].count = 0;
+
+  subdivide(left, first, mid - first);
+  subdivide(left + 1, mid, first + count - mid);
+}
+
+void Bvh::clear()
+{
+  build({});
+}
+
+bool Bvh::removeItem(EntityId id)
+{
+  auto i = m_indices.find(id);
+  if (i == m_indices.end()) {
+    return false;
+  }
+
+  m_removed[i->second] = 1;
+  ++m_numRemoved;
+  m_indices.erase(i);
+
+  return true;
+}
+
+bool Bvh::hasItem(EntityId id) const
+{
+  return m_indices.contains(id);
+}
+
+size_t Bvh::numItems() const
+{
+  return m_indices.size();
+}
+
+size_t Bvh::numRemoved() const
+{
+  return m_numRemoved;
+}
+
+size_t Bvh::numNodes() const
+{
+  return m_nodes.size();
+}
+
+size_t Bvh::memoryUsage() const
+{
+  using IndexEntry = std::unordered_map<EntityId, uint32_t>::value_type;
+
+  return m_nodes.capacity() * sizeof(Node)
+    + m_items.capacity() * sizeof(Item)
+    + m_removed.capacity() * sizeof(uint8_t)
+    + m_stack.capacity() * sizeof(StackEntry)
+    + m_indices.bucket_count() * sizeof(void*)
+    + m_indices.size() * (sizeof(IndexEntry) + sizeof(void*));
+}
+
+void Bvh::getItems(std::vector<Item>& items) const
+{
+  for (size_t i = 0; i < m_items.size(); ++i) {
+    if (!m_removed[i]) {
+      items.push_back(m_items[i]);
+    }
+  }
+}
+
+float_t Bvh::boxDistance(const Node& node, const Vec2f& pos)
+{
+  float_t dx = std::max({ node.min[0] - pos[0], 0.f, pos[0] - node.max[0] });
+  float_t dy = std::max({ node.min[1] - pos[1], 0.f, pos[1] - node.max[1] });
+  return sqrt(dx * dx + dy * dy);
+}
+
+// Slab test. invDir holds infinity for zero components of the direction
+bool Bvh::rayHitsBox(const Node& node, const Vec2f& origin, const Vec2f& invDir, float_t maxT,
+  float_t& t)
+{
+  float_t t0 = 0.f;
+  float_t t1 = maxT;
+
+  for (size_t k = 0; k < 2; ++k) {
+    if (std::isinf(invDir[k])) {
+      if (origin[k] < node.min[k] || origin[k] > node.max[k]) {
+        return false;
+      }
+      continue;
+    }
+    float_t ta = (node.min[k] - origin[k]) * invDir[k];
+    float_t tb = (node.max[k] - origin[k]) * invDir[k];
+    t0 = std::max(t0, std::min(ta, tb));
+    t1 = std::min(t1, std::max(ta, tb));
+  }
+
+  t = t0;
+  return t0 <= t1;
+}
+
+bool Bvh::itemOverlapsPoly(const Item& item, const std::vector<Vec2f>& poly)
+{
+  return poly.size() >= 3 && circleOverlapsPoly(item, poly, polyBounds(poly));
+}
+
+Bvh::PolyBounds Bvh::polyBounds(const std::vector<Vec2f>& poly)
+{
+  Bounds b;
+  for (auto& p : poly) {
+    b.grow(p[0], p[1]);
+  }
+  return PolyBounds{ Vec2f{ b.minX, b.minY }, Vec2f{ b.maxX, b.maxY } };
+}
+
+Bvh::Overlap Bvh::boxPolyOverlap(const Node& node, const std::vector<Vec2f>& poly,
+  const PolyBounds& bounds)
+{
+  if (node.max[0] < bounds.min[0] || node.min[0] > bounds.max[0] ||
+    node.max[1] < bounds.min[1] || node.min[1] > bounds.max[1]) {
+
+    return Overlap::None;
+  }
+
+  for (size_t i = 0; i < poly.size(); ++i) {
+    if (segmentIntersectsBox(poly[i], poly[(i + 1) % poly.size()], node.min, node.max)) {
+      return Overlap::Partial;
+    }
+  }
+
+  // No edge touches the box, so it's either entirely inside or entirely outside
+  return pointIsInsidePoly((node.min + node.max) * 0.5f, poly) ? Overlap::Contained : Overlap::None;
+}
+
+bool Bvh::circleOverlapsPoly(const Item& item, const std::vector<Vec2f>& poly,
+  const PolyBounds& bounds)
+{
+  const Vec2f& c = item.pos;
+  float_t r = item.radius;
+
+  if (c[0] + r < bounds.min[0] || c[0] - r > bounds.max[0] ||
+    c[1] + r < bounds.min[1] || c[1] - r > bounds.max[1]) {
+
+    return false;
+  }
+
+  if (pointIsInsidePoly(c, poly)) {
+    return true;
+  }
+
+  for (size_t i = 0; i < poly.size(); ++i) {
+    if (squareDistanceToSegment(c, poly[i], poly[(i + 1) % poly.size()]) <= r * r) {
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,307 @@
+#pragma once
+
+#include "math.hpp"
+#include "system.hpp"
+#include "exception.hpp"
+#include <unordered_map>
+#include <vector>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+// Static bounding volume hierarchy over circles on a plane, built top-down with a binned surface
+// area heuristic (perimeter, in 2D). Items can be removed, but not added or moved, without a
+// rebuild. Removed items are only marked as such, so rebuild once enough of them accumulate.
+//
+// Queries test polygons exactly against node bounds and item circles, so unlike the grids they
+// return only items that actually overlap. Uses internal scratch buffers, so queries must not run
+// concurrently.
+class Bvh
+{
+  public:
+    static constexpr uint32_t MAX_LEAF_ITEMS = 4;
+    static constexpr uint32_t NUM_BINS = 16;
+
+    struct Item
+    {
+      EntityId id;
+      Vec2f pos;
+      float_t radius;
+    };
+
+    void build(std::vector<Item> items);
+    void clear();
+    // Returns false if the item isn't in the tree
+    bool removeItem(EntityId id);
+    bool hasItem(EntityId id) const;
+
+    // Excludes removed items
+    size_t numItems() const;
+    size_t numRemoved() const;
+    size_t numNodes() const;
+    // Approximate heap usage in bytes
+    size_t memoryUsage() const;
+
+    // Appends items that haven't been removed
+    void getItems(std::vector<Item>& items) const;
+
+    // The test used by queries, for items not yet in a tree
+    static bool itemOverlapsPoly(const Item& item, const std::vector<Vec2f>& poly);
+
+    // Call visitor(EntityId) once for each item overlapping the polygon
+    template<typename F>
+    void forEachItem(const std::vector<Vec2f>& poly, F&& visitor) const;
+
+    // Query several polygons in one traversal. getPoly(i) should return the i'th of n polygons,
+    // where n is at most 32. Calls visitor(EntityId, uint32_t mask) once for each item in any of
+    // them, with bit i of mask set if the item is in polygon i
+    template<typename P, typename F>
+    void forEachItemInPolys(size_t n, P&& getPoly, F&& visitor) const;
+
+    // Call visitor(EntityId) for each item within radius of pos
+    template<typename F>
+    void forEachItem(const Vec2f& pos, float_t radius, F&& visitor) const;
+
+    // Call visitor(EntityId) for each item whose circle the ray origin + t * dir, 0 <= t <= maxT,
+    // enters, visiting nearer nodes first. The visitor returns the t beyond which it's no longer
+    // interested, so the search can end early
+    template<typename F>
+    void forEachItemOnRay(const Vec2f& origin, const Vec2f& dir, float_t maxT,
+      F&& visitor) const;
+
+    // Call visitor(EntityId) for items, visiting nodes nearer pos first. The visitor returns the
+    // distance beyond which it's no longer interested, so the search can end early. Items further
+    // than that from pos aren't visited
+    template<typename F>
+    void forEachItemByDistance(const Vec2f& pos, F&& visitor) const;
+
+  private:
+    // Interior nodes have count == 0 and their children at first and first + 1
+    struct Node
+    {
+      Vec2f min;
+      Vec2f max;
+      uint32_t first;
+      uint32_t count;
+    };
+
+    enum class Overlap
+    {
+      None,
+      Partial,
+      Contained
+    };
+
+    struct StackEntry
+    {
+      uint32_t node;
+      uint32_t partial;   // Polygons that overlap the node but may not contain it
+      uint32_t contained; // Polygons that contain the node entirely
+    };
+
+    struct PolyBounds
+    {
+      Vec2f min;
+      Vec2f max;
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<Item> m_items;
+    std::vector<uint8_t> m_removed;
+    std::unordered_map<EntityId, uint32_t> m_indices;
+    size_t m_numRemoved = 0;
+    mutable std::vector<StackEntry> m_stack;
+    mutable std::vector<std::pair<uint32_t, float_t>> m_nodeStack; // Node and its entry distance
+
+    void subdivide(uint32_t nodeIndex, uint32_t first, uint32_t count);
+    static float_t boxDistance(const Node& node, const Vec2f& pos);
+    static bool rayHitsBox(const Node& node, const Vec2f& origin, const Vec2f& invDir,
+      float_t maxT, float_t& t);
+    template<typename D, typename F>
+    void forEachItemNearestFirst(float_t limit, D&& nodeDistance, F&& visitItem) const;
+    static PolyBounds polyBounds(const std::vector<Vec2f>& poly);
+    static Overlap boxPolyOverlap(const Node& node, const std::vector<Vec2f>& poly,
+      const PolyBounds& bounds);
+    static bool circleOverlapsPoly(const Item& item, const std::vector<Vec2f>& poly,
+      const PolyBounds& bounds);
+};
+
+template<typename F>
+void Bvh::forEachItem(const std::vector<Vec2f>& poly, F&& visitor) const
+{
+  forEachItemInPolys(1, [&poly](size_t) -> const std::vector<Vec2f>& { return poly; },
+    [&visitor](EntityId id, uint32_t) { visitor(id); });
+}
+
+template<typename P, typename F>
+void Bvh::forEachItemInPolys(size_t n, P&& getPoly, F&& visitor) const
+{
+  ASSERT(n <= 32, "Too many polygons");
+
+  if (n == 0 || m_nodes.empty()) {
+    return;
+  }
+
+  std::array<const std::vector<Vec2f>*, 32> polys;
+  std::array<PolyBounds, 32> bounds;
+  uint32_t all = 0;
+  for (size_t i = 0; i < n; ++i) {
+    polys[i] = &getPoly(i);
+    bounds[i] = polyBounds(*polys[i]);
+    if (polys[i]->size() >= 3) {
+      all |= 1u << i;
+    }
+  }
+
+  m_stack.clear();
+  m_stack.push_back(StackEntry{ 0, all, 0 });
+
+  while (!m_stack.empty()) {
+    StackEntry entry = m_stack.back();
+    m_stack.pop_back();
+
+    const Node& node = m_nodes[entry.node];
+
+    for (uint32_t bits = entry.partial; bits != 0; bits &= bits - 1) {
+      uint32_t i = std::countr_zero(bits);
+      uint32_t bit = 1u << i;
+
+      switch (boxPolyOverlap(node, *polys[i], bounds[i])) {
+        case Overlap::None:
+          entry.partial &= ~bit;
+          break;
+        case Overlap::Contained:
+          entry.partial &= ~bit;
+          entry.contained |= bit;
+          break;
+        case Overlap::Partial:
+          break;
+      }
+    }
+
+    if ((entry.partial | entry.contained) == 0) {
+      continue;
+    }
+
+    if (node.count == 0) {
+      m_stack.push_back(StackEntry{ node.first + 1, entry.partial, entry.contained });
+      m_stack.push_back(StackEntry{ node.first, entry.partial, entry.contained });
+      continue;
+    }
+
+    for (uint32_t k = node.first; k < node.first + node.count; ++k) {
+      if (m_removed[k]) {
+        continue;
+      }
+
+      const Item& item = m_items[k];
+      uint32_t mask = entry.contained;
+      for (uint32_t bits = entry.partial; bits != 0; bits &= bits - 1) {
+        uint32_t i = std::countr_zero(bits);
+        if (circleOverlapsPoly(item, *polys[i], bounds[i])) {
+          mask |= 1u << i;
+        }
+      }
+
+      if (mask != 0) {
+        visitor(item.id, mask);
+      }
+    }
+  }
+}
+
+template<typename F>
+void Bvh::forEachItem(const Vec2f& pos, float_t radius, F&& visitor) const
+{
+  forEachItemNearestFirst(radius, [&pos](const Node& node) { return boxDistance(node, pos); },
+    [&](const Item& item, float_t) {
+      Vec2f d = item.pos - pos;
+      if (d.dot(d) <= square(radius + item.radius)) {
+        visitor(item.id);
+      }
+      return radius;
+    });
+}
+
+// Depth-first, visiting the nearer child first and skipping nodes further than limit.
+// nodeDistance(node) returns the node's distance, or infinity if it can be skipped.
+// visitItem(item, limit) visits the item if it's within limit and returns the new limit
+template<typename D, typename F>
+void Bvh::forEachItemNearestFirst(float_t limit, D&& nodeDistance, F&& visitItem) const
+{
+  if (m_nodes.empty()) {
+    return;
+  }
+
+  m_nodeStack.clear();
+  m_nodeStack.push_back({ 0, nodeDistance(m_nodes[0]) });
+
+  while (!m_nodeStack.empty()) {
+    auto [index, distance] = m_nodeStack.back();
+    m_nodeStack.pop_back();
+
+    if (distance > limit) {
+      continue;
+    }
+
+    const Node& node = m_nodes[index];
+
+    if (node.count == 0) {
+      float_t d0 = nodeDistance(m_nodes[node.first]);
+      float_t d1 = nodeDistance(m_nodes[node.first + 1]);
+
+      // Nearer child on top
+      if (d0 <= d1) {
+        m_nodeStack.push_back({ node.first + 1, d1 });
+        m_nodeStack.push_back({ node.first, d0 });
+      }
+      else {
+        m_nodeStack.push_back({ node.first, d0 });
+        m_nodeStack.push_back({ node.first + 1, d1 });
+      }
+      continue;
+    }
+
+    for (uint32_t k = node.first; k < node.first + node.count; ++k) {
+      if (!m_removed[k]) {
+        limit = std::min(limit, visitItem(m_items[k], limit));
+      }
+    }
+  }
+}
+
+template<typename F>
+void Bvh::forEachItemOnRay(const Vec2f& origin, const Vec2f& dir, float_t maxT,
+  F&& visitor) const
+{
+  const float_t inf = std::numeric_limits<float_t>::infinity();
+  Vec2f invDir{
+    dir[0] != 0.f ? 1.f / dir[0] : inf,
+    dir[1] != 0.f ? 1.f / dir[1] : inf
+  };
+
+  forEachItemNearestFirst(maxT, [&](const Node& node) {
+    float_t t = 0.f;
+    return rayHitsBox(node, origin, invDir, maxT, t) ? t : inf;
+  },
+  [&](const Item& item, float_t limit) {
+    float_t t = 0.f;
+    if (raySphereIntersect(origin, dir, item.pos, item.radius, t) && t <= limit) {
+      return visitor(item.id);
+    }
+    return limit;
+  });
+}
+
+template<typename F>
+void Bvh::forEachItemByDistance(const Vec2f& pos, F&& visitor) const
+{
+  forEachItemNearestFirst(std::numeric_limits<float_t>::infinity(),
+    [&pos](const Node& node) { return boxDistance(node, pos); },
+    [&](const Item& item, float_t limit) {
+      Vec2f d = item.pos - pos;
+      float_t distance = std::max(0.f, d.magnitude() - item.radius);
+      return distance <= limit ? visitor(item.id) : limit;
+    });
+}
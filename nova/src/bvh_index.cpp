@@ -0,0 +1,298 @@
+#include "spatial_index.hpp"
+#include "sparse_grid.hpp"
+#include "bvh.hpp"
+
+namespace
+{
+
+// Items that haven't moved for this many updates are candidates for the tree
+const uint64_t SETTLE_UPDATES = 60;
+// Rebuild when there are at least this many candidates, or this fraction of the tree's size
+const size_t MIN_REBUILD_ITEMS = 64;
+const float_t REBUILD_FRACTION = 0.05f;
+// Rebuild when this fraction of the tree's items have been removed
+const float_t MAX_REMOVED_FRACTION = 0.25f;
+
+// Items added between updates are held in a list and searched by brute force until the next
+// update, when they're either built into the BVH along with the existing items, or, if there
+// aren't enough of them to justify a rebuild, put in a sparse grid. Items that move go into the
+// grid, and once they've settled they're built into the BVH. Items in the BVH that move are
+// removed from it and go into the grid, so the tree only has to be rebuilt once the number of
+// settled or removed items is significant
+class BvhIndex : public SpatialIndex
+{
+  public:
+    BvhIndex();
+
+    void initialise(const Vec2f& worldMin, const Vec2f& worldMax) override;
+    void addItem(EntityId entityId, const Vec2f& pos, float_t radius) override;
+    void moveItem(EntityId entityId, const Vec2f& pos, float_t radius) override;
+    void removeItem(EntityId entityId) override;
+    void update() override;
+
+    void getItems(const std::vector<Vec2f>& poly, std::vector<EntityId>& entities) const override;
+    void getItems(const std::vector<ViewVolume>& views, std::vector<EntityId>& entities,
+      std::vector<uint32_t>& viewMasks) const override;
+
+    void getItems(const Vec2f& pos, float_t radius,
+      std::vector<EntityId>& entities) const override;
+    void castRay(const Vec2f& origin, const Vec2f& dir, float_t maxT,
+      const std::function<float_t(EntityId)>& visitor) const override;
+    void searchOutwards(const Vec2f& pos,
+      const std::function<float_t(EntityId)>& visitor) const override;
+
+    size_t memoryUsage() const override;
+
+  private:
+    struct DynamicItem
+    {
+      Vec2f pos;
+      float_t radius;
+      uint64_t lastMoved;
+    };
+
+    Bvh m_bvh;
+    SparseGrid<EntityId> m_grid;
+    std::unordered_map<EntityId, DynamicItem> m_dynamic;
+    std::vector<Bvh::Item> m_pending;
+    std::unordered_map<EntityId, size_t> m_pendingIndices;
+    uint64_t m_updates = SETTLE_UPDATES;
+    std::vector<Bvh::Item> m_rebuildItems;
+
+    bool isSettled(const DynamicItem& item) const;
+    bool removePending(EntityId entityId);
+    void rebuild();
+};
+
+} // namespace
+
+BvhIndex::BvhIndex()
+  : m_grid(gridCellSize())
+{
+}
+
+void BvhIndex::initialise(const Vec2f& worldMin, const Vec2f& worldMax)
+{
+  m_grid.setCellSize(gridCellSize(worldMin, worldMax));
+}
+
+void BvhIndex::addItem(EntityId entityId, const Vec2f& pos, float_t radius)
+{
+  m_pendingIndices[entityId] = m_pending.size();
+  m_pending.push_back(Bvh::Item{ entityId, pos, radius });
+}
+
+bool BvhIndex::removePending(EntityId entityId)
+{
+  auto i = m_pendingIndices.find(entityId);
+  if (i == m_pendingIndices.end()) {
+    return false;
+  }
+
+  size_t index = i->second;
+  m_pendingIndices.erase(i);
+
+  if (index + 1 < m_pending.size()) {
+    m_pending[index] = m_pending.back();
+    m_pendingIndices[m_pending[index].id] = index;
+  }
+  m_pending.pop_back();
+
+  return true;
+}
+
+void BvhIndex::moveItem(EntityId entityId, const Vec2f& pos, float_t radius)
+{
+  if (m_bvh.removeItem(entityId) || removePending(entityId)) {
+    m_grid.addItemByRadius(pos, radius, entityId);
+  }
+  else {
+    m_grid.moveItemByRadius(pos, radius, entityId);
+  }
+  m_dynamic[entityId] = DynamicItem{ pos, radius, m_updates };
+}
+
+void BvhIndex::removeItem(EntityId entityId)
+{
+  if (!m_bvh.removeItem(entityId) && !removePending(entityId)) {
+    m_grid.removeItem(entityId);
+    m_dynamic.erase(entityId);
+  }
+}
+
+bool BvhIndex::isSettled(const DynamicItem& item) const
+{
+  return m_updates - item.lastMoved >= SETTLE_UPDATES;
+}
+
+void BvhIndex::update()
+{
+  ++m_updates;
+
+  size_t numSettled = 0;
+  for (auto& entry : m_dynamic) {
+    if (isSettled(entry.second)) {
+      ++numSettled;
+    }
+  }
+
+  size_t treeSize = m_bvh.numItems();
+  size_t rebuildThreshold = std::max(MIN_REBUILD_ITEMS,
+    static_cast<size_t>(treeSize * REBUILD_FRACTION));
+  size_t maxRemoved = std::max(MIN_REBUILD_ITEMS,
+    static_cast<size_t>(treeSize * MAX_REMOVED_FRACTION));
+
+  size_t numNew = numSettled + m_pending.size();
+  bool rebuildNeeded = (numNew > 0 && (treeSize == 0 || numNew >= rebuildThreshold)) ||
+    m_bvh.numRemoved() > maxRemoved;
+
+  if (rebuildNeeded) {
+    rebuild();
+    return;
+  }
+
+  // Too few to rebuild for, so they wait in the grid, already settled
+  for (auto& item : m_pending) {
+    m_grid.addItemByRadius(item.pos, item.radius, item.id);
+    m_dynamic[item.id] = DynamicItem{ item.pos, item.radius, m_updates - SETTLE_UPDATES };
+  }
+  m_pending.clear();
+  m_pendingIndices.clear();
+}
+
+void BvhIndex::rebuild()
+{
+  m_rebuildItems.clear();
+  m_bvh.getItems(m_rebuildItems);
+  m_rebuildItems.insert(m_rebuildItems.end(), m_pending.begin(), m_pending.end());
+  m_pending.clear();
+  m_pendingIndices.clear();
+
+  for (auto i = m_dynamic.begin(); i != m_dynamic.end();) {
+    if (isSettled(i->second)) {
+      m_rebuildItems.push_back(Bvh::Item{ i->first, i->second.pos, i->second.radius });
+      m_grid.removeItem(i->first);
+      i = m_dynamic.erase(i);
+    }
+    else {
+      ++i;
+    }
+  }
+
+  m_bvh.build(m_rebuildItems);
+}
+
+void BvhIndex::getItems(const std::vector<Vec2f>& poly, std::vector<EntityId>& entities) const
+{
+  // The tree, grid and pending list hold disjoint sets of items
+  m_grid.getItems(poly, entities);
+  m_bvh.forEachItem(poly, [&entities](EntityId id) { entities.push_back(id); });
+
+  for (auto& item : m_pending) {
+    if (Bvh::itemOverlapsPoly(item, poly)) {
+      entities.push_back(item.id);
+    }
+  }
+}
+
+void BvhIndex::getItems(const std::vector<ViewVolume>& views, std::vector<EntityId>& entities,
+  std::vector<uint32_t>& viewMasks) const
+{
+  entities.clear();
+  viewMasks.clear();
+
+  auto getPoly = [&views](size_t i) -> const std::vector<Vec2f>& { return views[i].footprint; };
+  auto visitor = [&](EntityId id, uint32_t mask) {
+    entities.push_back(id);
+    viewMasks.push_back(mask);
+  };
+
+  m_grid.forEachItemInPolys(views.size(), getPoly, visitor);
+  m_bvh.forEachItemInPolys(views.size(), getPoly, visitor);
+
+  for (auto& item : m_pending) {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < views.size(); ++i) {
+      if (Bvh::itemOverlapsPoly(item, views[i].footprint)) {
+        mask |= 1u << i;
+      }
+    }
+    if (mask != 0) {
+      visitor(item.id, mask);
+    }
+  }
+}
+
+void BvhIndex::getItems(const Vec2f& pos, float_t radius, std::vector<EntityId>& entities) const
+{
+  m_grid.getItems(pos, radius, entities);
+  m_bvh.forEachItem(pos, radius, [&entities](EntityId id) { entities.push_back(id); });
+
+  for (auto& item : m_pending) {
+    Vec2f d = item.pos - pos;
+    if (d.dot(d) <= square(radius + item.radius)) {
+      entities.push_back(item.id);
+    }
+  }
+}
+
+// The visitor's limit only ever shrinks, so whatever the grid finds narrows the tree's search
+void BvhIndex::castRay(const Vec2f& origin, const Vec2f& dir, float_t maxT,
+  const std::function<float_t(EntityId)>& visitor) const
+{
+  float_t limit = maxT;
+  auto visit = [&](EntityId id) {
+    limit = std::min(limit, visitor(id));
+    return limit;
+  };
+
+  m_grid.forEachItemOnRay(origin, dir, limit, visit);
+  m_bvh.forEachItemOnRay(origin, dir, limit, visit);
+
+  for (auto& item : m_pending) {
+    float_t t = 0.f;
+    if (raySphereIntersect(origin, dir, item.pos, item.radius, t) && t <= limit) {
+      visit(item.id);
+    }
+  }
+}
+
+void BvhIndex::searchOutwards(const Vec2f& pos,
+  const std::function<float_t(EntityId)>& visitor) const
+{
+  float_t limit = std::numeric_limits<float_t>::infinity();
+  auto visit = [&](EntityId id) {
+    limit = std::min(limit, visitor(id));
+    return limit;
+  };
+
+  m_grid.forEachItemByDistance(pos, visit);
+  m_bvh.forEachItemByDistance(pos, visit);
+
+  for (auto& item : m_pending) {
+    Vec2f d = item.pos - pos;
+    if (d.magnitude() - item.radius <= limit) {
+      visit(item.id);
+    }
+  }
+}
+
+size_t BvhIndex::memoryUsage() const
+{
+  using DynamicEntry = std::unordered_map<EntityId, DynamicItem>::value_type;
+  using PendingEntry = std::unordered_map<EntityId, size_t>::value_type;
+
+  return m_bvh.memoryUsage()
+    + m_grid.memoryUsage()
+    + m_rebuildItems.capacity() * sizeof(Bvh::Item)
+    + m_pending.capacity() * sizeof(Bvh::Item)
+    + m_pendingIndices.bucket_count() * sizeof(void*)
+    + m_pendingIndices.size() * (sizeof(PendingEntry) + sizeof(void*))
+    + m_dynamic.bucket_count() * sizeof(void*)
+    + m_dynamic.size() * (sizeof(DynamicEntry) + sizeof(void*));
+}
+
+SpatialIndexPtr createBvhIndex()
+{
+  return std::make_unique<BvhIndex>();
+}
@@ -3,6 +3,8 @@
 Camera::Camera()
   : m_position{0, 0, 0}
   , m_direction{0, 0, -1}
+  , m_prevPosition{0, 0, 0}
+  , m_prevDirection{0, 0, -1}
 {
 }
 
@@ -37,3 +39,23 @@ const Vec3f& Camera::getDirection() const
 {
   return m_direction;
 }
+
+void Camera::beginStep()
+{
+  m_prevPosition = m_position;
+  m_prevDirection = m_direction;
+}
+
+Camera Camera::interpolated(float_t alpha) const
+{
+  Camera camera = *this;
+  if (alpha < 1.f) {
+    camera.m_position = m_prevPosition + (m_position - m_prevPosition) * alpha;
+
+    Vec3f direction = m_prevDirection + (m_direction - m_prevDirection) * alpha;
+    if (direction != Vec3f{}) {
+      camera.m_direction = direction.normalise();
+    }
+  }
+  return camera;
+}
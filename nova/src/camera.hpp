@@ -14,7 +14,15 @@ class Camera
     const Vec3f& getPosition() const;
     Mat4x4f  getMatrix() const;
 
+    // Remembers where the camera is at the start of a simulation step
+    void beginStep();
+    // The camera part way between its state at the start of the step and now, where alpha is 0
+    // and 1 respectively
+    Camera interpolated(float_t alpha) const;
+
   private:
     Vec3f m_position;
     Vec3f m_direction;
+    Vec3f m_prevPosition;
+    Vec3f m_prevDirection;
 };
@@ -2,14 +2,33 @@
 #include "spatial_system.hpp"
 #include "logger.hpp"
 #include "utils.hpp"
-#include "grid.hpp"
+#include "segment_grid.hpp"
+#include "floor_grid.hpp"
+#include "job_system.hpp"
+#include "component_pool.hpp"
+#include <algorithm>
 #include <array>
-#include <list>
 #include <set>
 
 const size_t GRID_W = 50;
 const size_t GRID_H = 50;
 
+// Each iteration pushes the mover out of every wall it overlaps, so this bounds the cost of
+// tryMove() however many walls meet at a corner
+const int MAX_SOLVER_ITERATIONS = 8;
+// Pushes overshoot slightly so the mover ends up clear of the wall, not touching it
+const float_t PUSH_FACTOR = 1.01f;
+// The mover may not be pushed further than this many radii from where it wanted to go
+const float_t MAX_PUSH_RADII = 2.f;
+// Each sweep after a hit slides along the wall with what's left of the delta
+const int MAX_SWEEPS = 3;
+// Sweeps stop short of the wall by this many radii so the next one doesn't start in contact
+const float_t SWEEP_SKIN_RADII = 0.01f;
+// Batches smaller than this aren't worth handing to the job system
+const size_t MIN_PARALLEL_BATCH = 256;
+// Each job moves this many movers from a batch
+const size_t BATCH_CHUNK_SIZE = 64;
+
 CCollision::CCollision(EntityId entityId)
   : Component(entityId)
 {
@@ -34,24 +53,60 @@ struct CollisionItem
   // In world space
   std::vector<Vec2f> absPerimeter;
   float_t absHeight;
-};
 
-using CollisionItemPtr = std::unique_ptr<CollisionItem>;
+  // Where the volume is baked into the grids
+  std::vector<uint32_t> segmentIds;
+  uint32_t floorId;
+};
 
 CollisionItem::CollisionItem(CCollisionPtr volume)
   : volume(std::move(volume))
 {
 }
 
+// Buffers used by one call to tryMove() at a time. Each job system thread has its own
+struct MoveScratch
+{
+  std::vector<LineSegment> lineSegments;
+  std::vector<Vec2f> sweepPoly;
+  SegmentGrid::QueryScratch query;
+};
+
+bool firstContact(const std::vector<LineSegment>& lineSegments, const Vec2f& pos,
+  const Vec2f& delta, float_t radius, float_t& toi, Vec2f& normal)
+{
+  bool hit = false;
+  toi = std::numeric_limits<float_t>::max();
+
+  for (auto& lseg : lineSegments) {
+    float_t t = 0.f;
+    Vec2f segmentNormal;
+    if (sweepCircleLineSegment(pos, delta, radius, lseg, t, segmentNormal) && t < toi) {
+      toi = t;
+      normal = segmentNormal;
+      hit = true;
+    }
+  }
+
+  return hit;
+}
+
 class CollisionSystemImpl : public CollisionSystem
 {
   public:
-    CollisionSystemImpl(const SpatialSystem& spatialSystem, Logger& logger);
+    CollisionSystemImpl(SpatialSystem& spatialSystem, Logger& logger, JobSystem* jobs);
+    ~CollisionSystemImpl() override;
 
     void initialise(const Vec2f& worldMin, const Vec2f& worldMax) override;
     Vec3f tryMove(const Vec3f& pos, const Vec3f& delta, float_t radius,
       float_t stepHeight) const override;
+    void tryMoveBatch(std::span<const Vec3f> positions, std::span<const Vec3f> deltas,
+      std::span<const float_t> radii, std::span<const float_t> stepHeights,
+      std::span<Vec3f> results) const override;
+    bool sweep(const Vec3f& pos, const Vec3f& delta, float_t radius, float_t stepHeight,
+      SweepHit& hit) const override;
     float_t altitude(const Vec3f& pos) const override;
+    void altitude(std::span<const Vec3f> positions, std::span<float_t> altitudes) const override;
 
     void update() override;
     void addComponent(ComponentPtr component) override;
@@ -62,182 +117,381 @@ class CollisionSystemImpl : public CollisionSystem
 
   private:
     Logger& m_logger;
-    const SpatialSystem& m_spatialSystem;
-    std::list<CollisionItemPtr> m_items;
-    std::unique_ptr<Grid<const CollisionItem*, GRID_W, GRID_H>> m_edgeGrid;
-    std::unique_ptr<Grid<const CollisionItem*, GRID_W, GRID_H>> m_areaGrid;
-
-    Vec3f tryMove(const Vec3f& pos, const Vec3f& delta, float_t radius, float_t stepHeight,
-      int depth) const;
-    std::vector<LineSegment> intersectingLineSegments(
-      std::unordered_set<const CollisionItem*>& items, const Vec3f& pos3, float_t radius,
-      float_t stepHeight) const;
+    SpatialSystem& m_spatialSystem;
+    TransformListenerId m_transformListener;
+    ComponentPool<CollisionItem> m_items;
+    std::unique_ptr<SegmentGrid> m_segmentGrid;
+    std::unique_ptr<FloorGrid> m_floorGrid;
+    JobSystem* m_jobs;
+
+    // Reused between calls to avoid allocation
+    mutable MoveScratch m_scratch;
+    mutable std::vector<MoveScratch> m_threadScratch;    // Indexed by job system thread
+    mutable std::vector<uint64_t> m_batchOrder;
+
+    void onTransformsChanged(const std::vector<EntityId>& entityIds);
+    void bake(CollisionItem& item);
+    void unbake(CollisionItem& item);
+
+    Vec3f move(const Vec3f& pos3, const Vec3f& delta, float_t radius, float_t stepHeight,
+      MoveScratch& scratch) const;
+    void nearbyLineSegments(const Vec3f& pos3, float_t radius, float_t stepHeight,
+      MoveScratch& scratch) const;
+    void sweptLineSegments(const Vec3f& pos3, const Vec2f& delta, float_t radius,
+      float_t stepHeight, MoveScratch& scratch) const;
+    bool resolveOverlaps(const Vec2f& pos, const Vec2f& nextPos, float_t radius,
+      const std::vector<LineSegment>& lineSegments, Vec2f& adjusted) const;
 };
 
-CollisionSystemImpl::CollisionSystemImpl(const SpatialSystem& spatialSystem, Logger& logger)
+CollisionSystemImpl::CollisionSystemImpl(SpatialSystem& spatialSystem, Logger& logger,
+  JobSystem* jobs)
   : m_logger(logger)
   , m_spatialSystem(spatialSystem)
+  , m_jobs(jobs)
+{
+  if (m_jobs != nullptr) {
+    m_threadScratch.resize(m_jobs->numThreads());
+  }
+
+  m_transformListener = m_spatialSystem.addTransformListener(
+    [this](const std::vector<EntityId>& entityIds) { onTransformsChanged(entityIds); });
+}
+
+CollisionSystemImpl::~CollisionSystemImpl()
 {
+  m_spatialSystem.removeTransformListener(m_transformListener);
 }
 
 void CollisionSystemImpl::initialise(const Vec2f& worldMin, const Vec2f& worldMax)
 {
-  m_edgeGrid = std::make_unique<Grid<const CollisionItem*, GRID_W, GRID_H>>(worldMin, worldMax);
-  m_areaGrid = std::make_unique<Grid<const CollisionItem*, GRID_W, GRID_H>>(worldMin, worldMax);
+  m_segmentGrid = std::make_unique<SegmentGrid>(worldMin, worldMax, GRID_W, GRID_H);
+  m_floorGrid = std::make_unique<FloorGrid>(worldMin, worldMax, GRID_W, GRID_H);
 }
 
 void CollisionSystemImpl::update()
 {
 }
 
-void CollisionSystemImpl::removeComponent(EntityId)
+void CollisionSystemImpl::removeComponent(EntityId entityId)
 {
-  // TODO
-  EXCEPTION("Not implemented");
+  CollisionItem* item = m_items.find(entityId);
+  if (item == nullptr) {
+    return;
+  }
+
+  unbake(*item);
+  m_items.remove(entityId);
 }
 
-bool CollisionSystemImpl::hasComponent(EntityId) const
+bool CollisionSystemImpl::hasComponent(EntityId entityId) const
 {
-  // TODO
-  EXCEPTION("Not implemented");
+  return m_items.contains(entityId);
 }
 
-CCollision& CollisionSystemImpl::getComponent(EntityId)
+CCollision& CollisionSystemImpl::getComponent(EntityId entityId)
 {
-  // TODO
-  EXCEPTION("Not implemented");
+  return *m_items.get(entityId).volume;
 }
 
-const CCollision& CollisionSystemImpl::getComponent(EntityId) const
+const CCollision& CollisionSystemImpl::getComponent(EntityId entityId) const
 {
-  // TODO
-  EXCEPTION("Not implemented");
+  return *m_items.get(entityId).volume;
 }
 
 void CollisionSystemImpl::addComponent(ComponentPtr component)
 {
-  ASSERT(m_edgeGrid, "Collision system not initialised");
+  ASSERT(m_segmentGrid, "Collision system not initialised");
+
+  EntityId entityId = component->id();
+  ASSERT(!m_items.contains(entityId), "Entity " << entityId << " already has a collision volume");
 
-  auto spatialComp = m_spatialSystem.getComponent(component->id());
   auto collisionComp = CCollisionPtr(dynamic_cast<CCollision*>(component.release()));
-  auto item = std::make_unique<CollisionItem>(std::move(collisionComp));
+  auto& item = m_items.add(entityId, CollisionItem{ std::move(collisionComp) });
+
+  bake(item);
+}
 
-  for (auto& p : item->volume->perimeter) {
-    Vec4f transformedP = spatialComp.absTransform() * Vec4f{ p[0], item->volume->height, p[1], 1 };
-    item->absPerimeter.push_back({ transformedP[0], transformedP[2] });
-    item->absHeight = transformedP[1];
+// Re-bakes only the volumes that moved, so the cost depends on the cells they cover and not the
+// size of the world
+void CollisionSystemImpl::onTransformsChanged(const std::vector<EntityId>& entityIds)
+{
+  for (EntityId entityId : entityIds) {
+    CollisionItem* item = m_items.find(entityId);
+    if (item == nullptr) {
+      continue;
+    }
+
+    unbake(*item);
+    bake(*item);
+  }
+}
+
+// Transforms the volume into world space and adds its walls and floor to the grids
+void CollisionSystemImpl::bake(CollisionItem& item)
+{
+  auto& spatialComp = m_spatialSystem.getComponent(item.volume->id());
+
+  item.absPerimeter.clear();
+  for (auto& p : item.volume->perimeter) {
+    Vec4f transformedP = spatialComp.absTransform() * Vec4f{ p[0], item.volume->height, p[1], 1 };
+    item.absPerimeter.push_back({ transformedP[0], transformedP[2] });
+    item.absHeight = transformedP[1];
+  }
+
+  const size_t n = item.absPerimeter.size();
+  item.segmentIds.clear();
+  for (size_t i = 0; i < n; ++i) {
+    LineSegment lseg{ item.absPerimeter[i], item.absPerimeter[(i + 1) % n] };
+    item.segmentIds.push_back(m_segmentGrid->addSegment(lseg, item.absHeight));
+  }
+
+  item.floorId = m_floorGrid->addFloor(item.absPerimeter, item.absHeight);
+}
+
+void CollisionSystemImpl::unbake(CollisionItem& item)
+{
+  for (uint32_t id : item.segmentIds) {
+    m_segmentGrid->removeSegment(id);
   }
+  item.segmentIds.clear();
 
-  m_items.push_back(std::move(item));
-  m_edgeGrid->addItemByPerimeter(m_items.back()->absPerimeter, m_items.back().get());
-  m_areaGrid->addItemByArea(m_items.back()->absPerimeter, m_items.back().get());
+  m_floorGrid->removeFloor(item.floorId);
 }
 
-Vec3f CollisionSystemImpl::tryMove(const Vec3f& pos, const Vec3f& dir, float_t radius,
+// Sweeps the mover along delta, stopping just short of the first wall it would touch and sliding
+// along it with the remainder, so no delta is large enough to tunnel through a thin wall. The end
+// point is then handed to resolveOverlaps() to clean up any contact the sweeps left behind.
+//
+// The sweeps and the clean up never take the mover further than the length of delta plus the push
+// limit from where it started, so for short moves the walls are gathered once, up front. Longer
+// moves gather only the walls along each swept path, and then around the end point
+Vec3f CollisionSystemImpl::tryMove(const Vec3f& pos3, const Vec3f& delta, float_t radius,
   float_t stepHeight) const
 {
-  ASSERT(m_edgeGrid, "Collision system not initialised");
+  ASSERT(m_segmentGrid, "Collision system not initialised");
 
-  return tryMove(pos, dir, radius, stepHeight, 0);
+  return move(pos3, delta, radius, stepHeight, m_scratch);
 }
 
-float_t CollisionSystemImpl::altitude(const Vec3f& pos3) const
+// Movers are visited in order of grid cell, so consecutive ones tend to gather the same walls.
+// Each only reads the world and writes its own result, so the order and the split between threads
+// make no difference to the results
+void CollisionSystemImpl::tryMoveBatch(std::span<const Vec3f> positions,
+  std::span<const Vec3f> deltas, std::span<const float_t> radii,
+  std::span<const float_t> stepHeights, std::span<Vec3f> results) const
 {
-  Vec2f pos{ pos3[0], pos3[2] };
+  ASSERT(m_segmentGrid, "Collision system not initialised");
 
-  auto items = m_areaGrid->getItems(pos);
-  float_t highestFloor = std::numeric_limits<float_t>::lowest();
+  const size_t n = positions.size();
+  ASSERT(deltas.size() == n && radii.size() == n && stepHeights.size() == n &&
+    results.size() == n, "Expected one delta, radius, step height and result per position");
+  ASSERT(n <= std::numeric_limits<uint32_t>::max(), "Batch too large");
 
-  for (auto& item : items) {
-    if (pointIsInsidePoly(pos, item->absPerimeter)) {
-      float_t h = item->absHeight;
-      if (h > highestFloor) {
-        highestFloor = h;
-      }
-    }
+  m_batchOrder.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    uint64_t cell = m_segmentGrid->cellIndex(Vec2f{ positions[i][0], positions[i][2] });
+    m_batchOrder[i] = cell << 32 | i;
   }
+  std::sort(m_batchOrder.begin(), m_batchOrder.end());
 
-  if (highestFloor == std::numeric_limits<float_t>::lowest()) {
-    EXCEPTION("Player is not inside any collision volume");
+  auto moveRange = [&](MoveScratch& scratch, size_t begin, size_t end) {
+    for (size_t k = begin; k < end; ++k) {
+      size_t i = m_batchOrder[k] & 0xffffffff;
+      results[i] = move(positions[i], deltas[i], radii[i], stepHeights[i], scratch);
+    }
+  };
+
+  if (n < MIN_PARALLEL_BATCH || m_jobs == nullptr) {
+    moveRange(m_scratch, 0, n);
+    return;
   }
 
-  return pos3[1] - highestFloor;
+  // Small chunks, so that threads idling after those in cluttered parts of the map finish their
+  // own can steal the rest
+  m_jobs->parallelFor(n, [&](size_t begin, size_t end) {
+    moveRange(m_threadScratch[m_jobs->threadIndex()], begin, end);
+  }, BATCH_CHUNK_SIZE);
 }
 
-std::vector<LineSegment> CollisionSystemImpl::intersectingLineSegments(
-  std::unordered_set<const CollisionItem*>& items, const Vec3f& pos3, float_t radius,
-  float_t stepHeight) const
+Vec3f CollisionSystemImpl::move(const Vec3f& pos3, const Vec3f& delta, float_t radius,
+  float_t stepHeight, MoveScratch& scratch) const
 {
   Vec2f pos{ pos3[0], pos3[2] };
-  std::vector<LineSegment> lineSegments;
+  Vec2f current = pos;
+  Vec2f remaining{ delta[0], delta[2] };
+  Vec3f gatherPos3{ pos3[0], pos3[1] + delta[1], pos3[2] };
+  float_t maxPush = MAX_PUSH_RADII * radius;
+  float_t skin = SWEEP_SKIN_RADII * radius;
+
+  bool shortMove = remaining.magnitude() <= maxPush;
+  if (shortMove) {
+    nearbyLineSegments(gatherPos3, remaining.magnitude() + radius + maxPush, stepHeight,
+      scratch);
+  }
 
-  auto permitsEntry = [stepHeight](const CollisionItem& item, const Vec3f& pos) {
-    return item.absHeight - pos[1] <= stepHeight;
-  };
+  for (int i = 0; i < MAX_SWEEPS; ++i) {
+    if (!shortMove) {
+      gatherPos3 = Vec3f{ current[0], gatherPos3[1], current[1] };
+      sweptLineSegments(gatherPos3, remaining, radius, stepHeight, scratch);
+    }
 
-  for (auto item : items) {
-    if (permitsEntry(*item, pos3)) {
-      continue;
+    float_t toi = 0.f;
+    Vec2f normal;
+    if (!firstContact(scratch.lineSegments, current, remaining, radius, toi, normal)) {
+      current += remaining;
+      break;
     }
 
-    const size_t n = item->absPerimeter.size();
-    for (size_t i = 0; i < n; ++i) {
-      auto& p1 = item->absPerimeter[i];
-      auto& p2 = item->absPerimeter[(i + 1) % n];
+    // Back off along the path so the gap to the wall, measured along its normal, is the skin
+    float_t approach = -normal.dot(remaining);
+    float_t advance = std::max(0.f, toi - skin / approach);
+    current += remaining * advance;
+    remaining = remaining * (1.f - advance);
+    remaining -= normal * normal.dot(remaining);
+  }
 
-      LineSegment lseg{ p1, p2 };
-      if (lineSegmentCircleIntersect(lseg, pos, radius)) {
-        lineSegments.push_back(lseg);
-      }
-    }
+  if (!shortMove) {
+    nearbyLineSegments(Vec3f{ current[0], gatherPos3[1], current[1] }, radius + maxPush,
+      stepHeight, scratch);
   }
 
-  return lineSegments;
+  Vec2f adjusted;
+  if (!resolveOverlaps(pos, current, radius, scratch.lineSegments, adjusted)) {
+    return Vec3f{};
+  }
+
+  return Vec3f{ adjusted[0] - pos[0], delta[1], adjusted[1] - pos[1] };
 }
 
-Vec3f CollisionSystemImpl::tryMove(const Vec3f& pos3, const Vec3f& delta, float_t radius,
-  float_t stepHeight, int depth) const
+bool CollisionSystemImpl::sweep(const Vec3f& pos3, const Vec3f& delta, float_t radius,
+  float_t stepHeight, SweepHit& hit) const
 {
-  if (depth > 10) {
-    m_logger.warn("Max depth reached in CollisionSystemImpl::tryMove()");
-    return Vec3f{};
-  }
+  ASSERT(m_segmentGrid, "Collision system not initialised");
 
   Vec2f pos{ pos3[0], pos3[2] };
+  Vec2f delta2{ delta[0], delta[2] };
+  sweptLineSegments(pos3, delta2, radius, stepHeight, m_scratch);
+
+  Vec2f normal;
+  if (!firstContact(m_scratch.lineSegments, pos, delta2, radius, hit.toi, normal)) {
+    return false;
+  }
 
-  Vec3f nextPos3 = pos3 + delta;
-  Vec2f nextPos{ nextPos3[0], nextPos3[2] };
+  hit.normal = Vec3f{ normal[0], 0.f, normal[1] };
+  return true;
+}
 
-  auto items = m_edgeGrid->getItems(nextPos, radius);
-  auto lineSegments = intersectingLineSegments(items, nextPos3, radius, stepHeight);
+// Projects nextPos out of each wall in lineSegments it overlaps in turn, Gauss-Seidel style, so
+// the mover slides along walls and around corners. Each iteration is a single pass over the
+// segments, so the cost is bounded. Returns false if the mover is still overlapping a wall after
+// the last iteration, e.g. when wedged into a sharp corner
+bool CollisionSystemImpl::resolveOverlaps(const Vec2f& pos, const Vec2f& nextPos, float_t radius,
+  const std::vector<LineSegment>& lineSegments, Vec2f& adjusted) const
+{
+  float_t maxPush = MAX_PUSH_RADII * radius;
 
-  float_t smallestAdjustment = std::numeric_limits<float_t>::max();
-  Vec3f finalDelta = delta;
+  Vec2f target = nextPos;
 
-  for (auto& lseg : lineSegments) {
-    Line line(lseg.A, lseg.B);
-    Vec2f X = projectionOntoLine(line, nextPos);
-    Vec2f toLine = nextPos - X;
+  for (int i = 0; i < MAX_SOLVER_ITERATIONS; ++i) {
+    bool penetrating = false;
 
-    Vec2f adjustment = toLine.normalise() * (radius - toLine.magnitude()) * 1.01f;
-    Vec3f adjustment3{ adjustment[0], 0, adjustment[1] };
+    for (auto& lseg : lineSegments) {
+      Vec2f toTarget = target - closestPointOnLineSegment(lseg, target);
+      float_t distance = toTarget.magnitude();
 
-    auto newDelta = tryMove(pos3, delta + adjustment3, radius, stepHeight, depth + 1);
+      if (distance >= radius) {
+        continue;
+      }
+      penetrating = true;
 
-    float_t adjustmentSize = (newDelta - delta).magnitude();
+      Vec2f normal;
+      if (distance > 0.f) {
+        normal = toTarget / distance;
+      }
+      else {
+        // Centre is on the segment, so push back towards the side we came from
+        Vec2f D = lseg.B - lseg.A;
+        normal = Vec2f{ -D[1], D[0] }.normalise();
+        if (normal.dot(pos - lseg.A) < 0.f) {
+          normal = -normal;
+        }
+      }
 
-    if (adjustmentSize < smallestAdjustment) {
-      finalDelta = newDelta;
-      smallestAdjustment = adjustmentSize;
+      target += normal * (radius - distance) * PUSH_FACTOR;
     }
+
+    if (!penetrating) {
+      if ((target - nextPos).magnitude() > maxPush) {
+        break;
+      }
+      adjusted = target;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+float_t CollisionSystemImpl::altitude(const Vec3f& pos3) const
+{
+  float_t highestFloor = 0.f;
+  if (!m_floorGrid->highestFloor(Vec2f{ pos3[0], pos3[2] }, highestFloor)) {
+    EXCEPTION("Player is not inside any collision volume");
+  }
+
+  return pos3[1] - highestFloor;
+}
+
+void CollisionSystemImpl::altitude(std::span<const Vec3f> positions,
+  std::span<float_t> altitudes) const
+{
+  ASSERT(positions.size() == altitudes.size(), "Expected one altitude per position");
+
+  for (size_t i = 0; i < positions.size(); ++i) {
+    float_t highestFloor = 0.f;
+    if (!m_floorGrid->highestFloor(Vec2f{ positions[i][0], positions[i][2] }, highestFloor)) {
+      EXCEPTION("Position " << i << " is not inside any collision volume");
+    }
+    altitudes[i] = positions[i][1] - highestFloor;
   }
+}
+
+// Walls the mover can step onto don't block it
+void CollisionSystemImpl::nearbyLineSegments(const Vec3f& pos3, float_t radius,
+  float_t stepHeight, MoveScratch& scratch) const
+{
+  scratch.lineSegments.clear();
+  m_segmentGrid->getSegments(Vec2f{ pos3[0], pos3[2] }, radius, pos3[1] + stepHeight,
+    scratch.lineSegments, scratch.query);
+}
 
-  return finalDelta;
+// Gathers walls from the grid cells under a rectangle enclosing the circle swept along delta
+void CollisionSystemImpl::sweptLineSegments(const Vec3f& pos3, const Vec2f& delta,
+  float_t radius, float_t stepHeight, MoveScratch& scratch) const
+{
+  Vec2f pos{ pos3[0], pos3[2] };
+  scratch.lineSegments.clear();
+
+  float_t length = delta.magnitude();
+  Vec2f along = length > 0.f ? delta / length : Vec2f{ 1.f, 0.f };
+  Vec2f across{ -along[1], along[0] };
+  Vec2f back = pos - along * radius;
+  Vec2f front = pos + delta + along * radius;
+
+  auto& poly = scratch.sweepPoly;
+  poly.clear();
+  poly.push_back(back - across * radius);
+  poly.push_back(front - across * radius);
+  poly.push_back(front + across * radius);
+  poly.push_back(back + across * radius);
+
+  m_segmentGrid->getSegments(poly, pos3[1] + stepHeight, scratch.lineSegments, scratch.query);
 }
 
 } // namespace
 
-CollisionSystemPtr createCollisionSystem(const SpatialSystem& spatialSystem, Logger& logger)
+CollisionSystemPtr createCollisionSystem(SpatialSystem& spatialSystem, Logger& logger,
+  JobSystem* jobs)
 {
-  return std::make_unique<CollisionSystemImpl>(spatialSystem, logger);
+  return std::make_unique<CollisionSystemImpl>(spatialSystem, logger, jobs);
 }
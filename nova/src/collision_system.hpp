@@ -4,6 +4,7 @@
 #include "system.hpp"
 #include <vector>
 #include <memory>
+#include <span>
 
 struct CCollision : public Component
 {
@@ -16,6 +17,12 @@ struct CCollision : public Component
 
 using CCollisionPtr = std::unique_ptr<CCollision>;
 
+struct SweepHit
+{
+  float_t toi;    // Fraction of the delta travelled before contact
+  Vec3f normal;   // Points away from the wall, in the xz plane
+};
+
 class CollisionSystem : public System
 {
   public:
@@ -24,7 +31,21 @@ class CollisionSystem : public System
     virtual Vec3f tryMove(const Vec3f& pos, const Vec3f& delta, float_t radius,
       float_t stepHeight) const = 0;
 
+    // Resolves many movers at once, on the job system if there is one, writing each adjusted
+    // delta to results. There's one element per mover in each span. The results are exactly those
+    // of calling tryMove() for each mover in turn
+    virtual void tryMoveBatch(std::span<const Vec3f> positions, std::span<const Vec3f> deltas,
+      std::span<const float_t> radii, std::span<const float_t> stepHeights,
+      std::span<Vec3f> results) const = 0;
+
+    // Sweeps a circle of the given radius along delta in the xz plane and finds the first wall it
+    // touches. Returns false if nothing is hit
+    virtual bool sweep(const Vec3f& pos, const Vec3f& delta, float_t radius, float_t stepHeight,
+      SweepHit& hit) const = 0;
+
     virtual float_t altitude(const Vec3f& pos) const = 0;
+    // Writes the altitude of each position to the corresponding element of altitudes
+    virtual void altitude(std::span<const Vec3f> positions, std::span<float_t> altitudes) const = 0;
 
     virtual ~CollisionSystem() {}
 };
@@ -33,5 +54,9 @@ using CollisionSystemPtr = std::unique_ptr<CollisionSystem>;
 
 class SpatialSystem;
 class Logger;
+class JobSystem;
 
-CollisionSystemPtr createCollisionSystem(const SpatialSystem& spatialSystem, Logger& logger);
+// The collision system listens for transform changes, so the spatial system must outlive it.
+// Large batches of moves are spread over the job system's threads if one is given
+CollisionSystemPtr createCollisionSystem(SpatialSystem& spatialSystem, Logger& logger,
+  JobSystem* jobs = nullptr);
@@ -0,0 +1,201 @@
+#pragma once
+
+#include "system.hpp"
+#include "exception.hpp"
+#include <vector>
+#include <span>
+#include <cstdint>
+
+// Components packed into a dense array, in no particular order, with a sparse index from entity
+// slot to position. Adding, removing and looking up are all constant time, and iterating visits the
+// components in memory order. Removing a component moves the last one into its place, so
+// references and iterators are invalidated by any add or remove.
+//
+// The sparse index is indexed directly by the slot part of the entity id. The full id is checked
+// on lookup, so a stale id whose slot has been reused finds nothing.
+template<typename T>
+class ComponentPool
+{
+  public:
+    using iterator = typename std::vector<T>::iterator;
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    T& add(EntityId id, T component);
+    // Returns false if the entity has no component
+    bool remove(EntityId id);
+    void clear();
+
+    bool contains(EntityId id) const;
+    // Throws if the entity has no component
+    T& get(EntityId id);
+    const T& get(EntityId id) const;
+    // Returns nullptr if the entity has no component
+    T* find(EntityId id);
+    const T* find(EntityId id) const;
+
+    size_t size() const;
+    bool empty() const;
+
+    // The entity owning each component, in the same order as iteration
+    std::span<const EntityId> ids() const;
+
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+
+  private:
+    static constexpr uint32_t NULL_INDEX = std::numeric_limits<uint32_t>::max();
+
+    std::vector<T> m_dense;
+    std::vector<EntityId> m_ids;
+    std::vector<uint32_t> m_sparse;  // Indexed by entity slot
+
+    uint32_t indexOf(EntityId id) const;
+    void setIndex(EntityId id, uint32_t index);
+};
+
+template<typename T>
+uint32_t ComponentPool<T>::indexOf(EntityId id) const
+{
+  uint32_t slot = entityIndex(id);
+  if (slot >= m_sparse.size()) {
+    return NULL_INDEX;
+  }
+
+  uint32_t index = m_sparse[slot];
+  return index != NULL_INDEX && m_ids[index] == id ? index : NULL_INDEX;
+}
+
+template<typename T>
+void ComponentPool<T>::setIndex(EntityId id, uint32_t index)
+{
+  uint32_t slot = entityIndex(id);
+  if (slot >= m_sparse.size()) {
+    m_sparse.resize(slot + 1, NULL_INDEX);
+  }
+  m_sparse[slot] = index;
+}
+
+template<typename T>
+T& ComponentPool<T>::add(EntityId id, T component)
+{
+  ASSERT(id != NULL_ENTITY_ID, "Can't add a component for the null entity");
+
+  uint32_t slot = entityIndex(id);
+  ASSERT(slot >= m_sparse.size() || m_sparse[slot] == NULL_INDEX,
+    "Entity " << id << " already has a component, or its slot's previous owner wasn't removed");
+
+  setIndex(id, static_cast<uint32_t>(m_dense.size()));
+  m_dense.push_back(std::move(component));
+  m_ids.push_back(id);
+
+  return m_dense.back();
+}
+
+template<typename T>
+bool ComponentPool<T>::remove(EntityId id)
+{
+  uint32_t index = indexOf(id);
+  if (index == NULL_INDEX) {
+    return false;
+  }
+
+  uint32_t last = static_cast<uint32_t>(m_dense.size() - 1);
+  if (index != last) {
+    m_dense[index] = std::move(m_dense[last]);
+    m_ids[index] = m_ids[last];
+    setIndex(m_ids[index], index);
+  }
+  m_dense.pop_back();
+  m_ids.pop_back();
+  setIndex(id, NULL_INDEX);
+
+  return true;
+}
+
+template<typename T>
+void ComponentPool<T>::clear()
+{
+  m_dense.clear();
+  m_ids.clear();
+  m_sparse.clear();
+}
+
+template<typename T>
+bool ComponentPool<T>::contains(EntityId id) const
+{
+  return indexOf(id) != NULL_INDEX;
+}
+
+template<typename T>
+T& ComponentPool<T>::get(EntityId id)
+{
+  uint32_t index = indexOf(id);
+  ASSERT(index != NULL_INDEX, "Entity " << id << " has no component");
+  return m_dense[index];
+}
+
+template<typename T>
+const T& ComponentPool<T>::get(EntityId id) const
+{
+  uint32_t index = indexOf(id);
+  ASSERT(index != NULL_INDEX, "Entity " << id << " has no component");
+  return m_dense[index];
+}
+
+template<typename T>
+T* ComponentPool<T>::find(EntityId id)
+{
+  uint32_t index = indexOf(id);
+  return index == NULL_INDEX ? nullptr : &m_dense[index];
+}
+
+template<typename T>
+const T* ComponentPool<T>::find(EntityId id) const
+{
+  uint32_t index = indexOf(id);
+  return index == NULL_INDEX ? nullptr : &m_dense[index];
+}
+
+template<typename T>
+size_t ComponentPool<T>::size() const
+{
+  return m_dense.size();
+}
+
+template<typename T>
+bool ComponentPool<T>::empty() const
+{
+  return m_dense.empty();
+}
+
+template<typename T>
+std::span<const EntityId> ComponentPool<T>::ids() const
+{
+  return m_ids;
+}
+
+template<typename T>
+typename ComponentPool<T>::iterator ComponentPool<T>::begin()
+{
+  return m_dense.begin();
+}
+
+template<typename T>
+typename ComponentPool<T>::iterator ComponentPool<T>::end()
+{
+  return m_dense.end();
+}
+
+template<typename T>
+typename ComponentPool<T>::const_iterator ComponentPool<T>::begin() const
+{
+  return m_dense.begin();
+}
+
+template<typename T>
+typename ComponentPool<T>::const_iterator ComponentPool<T>::end() const
+{
+  return m_dense.end();
+}
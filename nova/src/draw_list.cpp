@@ -0,0 +1,73 @@
+#include "draw_list.hpp"
+#include "math.hpp"
+
+namespace render
+{
+namespace
+{
+
+const uint64_t PASS_BITS = 2;
+const uint64_t LAYER_BITS = 2;
+const uint64_t PIPELINE_BITS = 13;
+const uint64_t MATERIAL_BITS = 16;
+const uint64_t MESH_BITS = 16;
+const uint64_t DEPTH_BITS = 15;
+
+static_assert(PASS_BITS + LAYER_BITS + PIPELINE_BITS + MATERIAL_BITS + MESH_BITS
+  + DEPTH_BITS == 64);
+
+const uint64_t PASS_SHIFT = 64 - PASS_BITS;
+const uint64_t LAYER_SHIFT = PASS_SHIFT - LAYER_BITS;
+
+inline uint64_t field(uint64_t value, uint64_t bits)
+{
+  return value & ((uint64_t(1) << bits) - 1);
+}
+
+inline uint64_t quantiseDepth(float_t depth)
+{
+  const uint64_t maxDepth = (uint64_t(1) << DEPTH_BITS) - 1;
+  return static_cast<uint64_t>(clip(depth, 0.f, 1.f) * maxDepth);
+}
+
+} // namespace
+
+uint64_t packDrawKey(const DrawKey& key)
+{
+  uint64_t packed = field(static_cast<uint64_t>(key.pass), PASS_BITS) << PASS_SHIFT;
+  packed |= field(static_cast<uint64_t>(key.layer), LAYER_BITS) << LAYER_SHIFT;
+
+  uint64_t pipeline = field(key.pipeline, PIPELINE_BITS);
+  uint64_t material = field(static_cast<uint64_t>(key.material), MATERIAL_BITS);
+  uint64_t mesh = field(static_cast<uint64_t>(key.mesh), MESH_BITS);
+  uint64_t depth = quantiseDepth(key.depth);
+
+  if (key.layer == DrawLayer::Transparent) {
+    uint64_t reversedDepth = field(~depth, DEPTH_BITS);
+
+    packed |= reversedDepth << (LAYER_SHIFT - DEPTH_BITS);
+    packed |= pipeline << (MATERIAL_BITS + MESH_BITS);
+    packed |= material << MESH_BITS;
+    packed |= mesh;
+  }
+  else {
+    packed |= pipeline << (LAYER_SHIFT - PIPELINE_BITS);
+    packed |= material << (MESH_BITS + DEPTH_BITS);
+    packed |= mesh << DEPTH_BITS;
+    packed |= depth;
+  }
+
+  return packed;
+}
+
+uint64_t firstDrawKey(RenderPass pass)
+{
+  return field(static_cast<uint64_t>(pass), PASS_BITS) << PASS_SHIFT;
+}
+
+uint64_t lastDrawKey(RenderPass pass)
+{
+  return firstDrawKey(pass) | field(~uint64_t(0), PASS_SHIFT);
+}
+
+} // namespace render
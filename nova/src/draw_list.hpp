@@ -0,0 +1,150 @@
+#pragma once
+
+#include "renderer.hpp"
+#include <vector>
+#include <array>
+#include <span>
+#include <algorithm>
+#include <cstdint>
+
+namespace render
+{
+
+// The draws in a pass are made in this order
+enum class DrawLayer : uint8_t
+{
+  Opaque,
+  Background,   // Skyboxes, after the opaque draws so that most of their pixels fail the depth test
+  Transparent   // Blended over everything else
+};
+
+// What a draw is sorted by, before packing. Fields that are too wide are truncated, which only
+// costs some state changes if two values end up the same
+struct DrawKey
+{
+  RenderPass pass;
+  DrawLayer layer;
+  uint64_t pipeline;    // Typically a hash of the pipeline key
+  RenderItemId material;
+  RenderItemId mesh;
+  float_t depth;        // Distance from the viewer, from 0 (near) to 1 (far)
+};
+
+// Packs the key into 64 bits so that ordering the integers orders the draws by pass, then layer,
+// then pipeline, material, mesh, and depth, front to back. Transparent draws have to be blended
+// back to front, so for those, depth (reversed) comes straight after the layer
+uint64_t packDrawKey(const DrawKey& key);
+
+// Lowest and highest keys in the given pass, for looking up its draws with DrawList::range()
+uint64_t firstDrawKey(RenderPass pass);
+uint64_t lastDrawKey(RenderPass pass);
+
+// A frame's draws as a flat array of packed sort keys and item pointers. Adding is an append, and
+// sort() is a radix sort, so the cost is linear in the number of draws. The arrays keep their
+// capacity when cleared, so a list that's reused every frame stops allocating once it's big enough
+template<typename T>
+class DrawList
+{
+  public:
+    struct Entry
+    {
+      uint64_t key;
+      T* item;
+    };
+
+    void add(uint64_t key, T* item);
+    void clear();
+    // Stable, so draws with equal keys stay in the order they were added
+    void sort();
+
+    size_t size() const;
+    std::span<const Entry> entries() const;
+    // The sorted entries with keys from first to last inclusive
+    std::span<const Entry> range(uint64_t first, uint64_t last) const;
+
+  private:
+    static constexpr size_t RADIX_BITS = 8;
+    static constexpr size_t NUM_BUCKETS = 1 << RADIX_BITS;
+    static constexpr size_t NUM_DIGITS = 64 / RADIX_BITS;
+
+    std::vector<Entry> m_entries;
+    std::vector<Entry> m_scratch;
+};
+
+template<typename T>
+void DrawList<T>::add(uint64_t key, T* item)
+{
+  m_entries.push_back(Entry{ key, item });
+}
+
+template<typename T>
+void DrawList<T>::clear()
+{
+  m_entries.clear();
+}
+
+template<typename T>
+size_t DrawList<T>::size() const
+{
+  return m_entries.size();
+}
+
+template<typename T>
+std::span<const typename DrawList<T>::Entry> DrawList<T>::entries() const
+{
+  return m_entries;
+}
+
+// Least significant digit first. The counts for every digit are taken in a single pass, and digits
+// that are the same in every key, e.g. the pass bits in a list with only one pass, are skipped
+template<typename T>
+void DrawList<T>::sort()
+{
+  size_t n = m_entries.size();
+  if (n < 2) {
+    return;
+  }
+
+  std::array<std::array<uint32_t, NUM_BUCKETS>, NUM_DIGITS> counts{};
+  for (auto& entry : m_entries) {
+    for (size_t d = 0; d < NUM_DIGITS; ++d) {
+      ++counts[d][(entry.key >> (d * RADIX_BITS)) & (NUM_BUCKETS - 1)];
+    }
+  }
+
+  m_scratch.resize(n);
+
+  for (size_t d = 0; d < NUM_DIGITS; ++d) {
+    auto& count = counts[d];
+    size_t digit = (m_entries[0].key >> (d * RADIX_BITS)) & (NUM_BUCKETS - 1);
+    if (count[digit] == n) {
+      continue;
+    }
+
+    uint32_t offset = 0;
+    for (auto& c : count) {
+      uint32_t bucketSize = c;
+      c = offset;
+      offset += bucketSize;
+    }
+
+    for (auto& entry : m_entries) {
+      m_scratch[count[(entry.key >> (d * RADIX_BITS)) & (NUM_BUCKETS - 1)]++] = entry;
+    }
+    m_entries.swap(m_scratch);
+  }
+}
+
+template<typename T>
+std::span<const typename DrawList<T>::Entry> DrawList<T>::range(uint64_t first,
+  uint64_t last) const
+{
+  auto begin = std::lower_bound(m_entries.begin(), m_entries.end(), first,
+    [](const Entry& entry, uint64_t key) { return entry.key < key; });
+  auto end = std::upper_bound(begin, m_entries.end(), last,
+    [](uint64_t key, const Entry& entry) { return key < entry.key; });
+
+  return { begin, end };
+}
+
+} // namespace render
@@ -0,0 +1,280 @@
+#include "floor_grid.hpp"
+#include "exception.hpp"
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+
+// Allows for rounding where neighbouring pieces share an edge
+const float_t EDGE_TOLERANCE = 0.0001f;
+
+float_t cross(const Vec2f& O, const Vec2f& A, const Vec2f& B)
+{
+  return (A[0] - O[0]) * (B[1] - O[1]) - (A[1] - O[1]) * (B[0] - O[0]);
+}
+
+float_t signedArea(const std::vector<Vec2f>& poly)
+{
+  float_t area = 0.f;
+  for (size_t i = 0; i < poly.size(); ++i) {
+    const Vec2f& a = poly[i];
+    const Vec2f& b = poly[(i + 1) % poly.size()];
+    area += a[0] * b[1] - b[0] * a[1];
+  }
+  return 0.5f * area;
+}
+
+// Assumes anticlockwise winding. Collinear vertices are allowed
+bool isConvex(const std::vector<Vec2f>& poly)
+{
+  const size_t n = poly.size();
+  for (size_t i = 0; i < n; ++i) {
+    if (cross(poly[i], poly[(i + 1) % n], poly[(i + 2) % n]) < 0.f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+using IndexList = std::vector<uint16_t>;
+
+// Joins b onto a along their shared edge, if they have one. Both must be wound anticlockwise
+bool joinAlongSharedEdge(const IndexList& a, const IndexList& b, IndexList& joined)
+{
+  for (size_t i = 0; i < a.size(); ++i) {
+    uint16_t u = a[i];
+    uint16_t v = a[(i + 1) % a.size()];
+
+    for (size_t j = 0; j < b.size(); ++j) {
+      if (b[j] != v || b[(j + 1) % b.size()] != u) {
+        continue;
+      }
+
+      joined.clear();
+      for (size_t k = 1; k <= a.size(); ++k) {
+        joined.push_back(a[(i + k) % a.size()]);   // v round to u
+      }
+      for (size_t k = 2; k < b.size(); ++k) {
+        joined.push_back(b[(j + k) % b.size()]);   // After u, up to before v
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+// Triangulates the polygon and then greedily merges neighbouring pieces while the result stays
+// convex (Hertel-Mehlhorn). This gives at most four times the minimum number of pieces
+std::vector<std::vector<Vec2f>> convexPieces(const std::vector<Vec2f>& poly)
+{
+  if (isConvex(poly)) {
+    return { poly };
+  }
+
+  std::vector<Vec3f> vertices;
+  for (auto& p : poly) {
+    vertices.push_back(Vec3f{ p[0], 0.f, p[1] });
+  }
+
+  auto indices = triangulatePoly(vertices);
+
+  std::vector<IndexList> pieces;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    pieces.push_back({ indices[i], indices[i + 1], indices[i + 2] });
+  }
+
+  auto toPoly = [&poly](const IndexList& piece) {
+    std::vector<Vec2f> points;
+    for (auto i : piece) {
+      points.push_back(poly[i]);
+    }
+    return points;
+  };
+
+  IndexList joined;
+  bool merged = true;
+  while (merged) {
+    merged = false;
+    for (size_t a = 0; a < pieces.size() && !merged; ++a) {
+      for (size_t b = a + 1; b < pieces.size() && !merged; ++b) {
+        if (joinAlongSharedEdge(pieces[a], pieces[b], joined) && isConvex(toPoly(joined))) {
+          pieces[a] = joined;
+          pieces.erase(pieces.begin() + b);
+          merged = true;
+        }
+      }
+    }
+  }
+
+  std::vector<std::vector<Vec2f>> result;
+  for (auto& piece : pieces) {
+    result.push_back(toPoly(piece));
+  }
+  return result;
+}
+
+} // namespace
+
+FloorGrid::FloorGrid(const Vec2f& worldMin, const Vec2f& worldMax, size_t gridW, size_t gridH)
+  : m_worldMin(worldMin)
+  , m_cellSize{ (worldMax[0] - worldMin[0]) / gridW, (worldMax[1] - worldMin[1]) / gridH }
+  , m_gridW(static_cast<int>(gridW))
+  , m_gridH(static_cast<int>(gridH))
+  , m_cells(gridW * gridH)
+{
+}
+
+size_t FloorGrid::numPieces() const
+{
+  return m_pieces.size() - m_freePieces.size();
+}
+
+uint32_t FloorGrid::addFloor(const std::vector<Vec2f>& perimeter, float_t height)
+{
+  ASSERT(perimeter.size() >= 3, "Floor must have at least 3 vertices");
+
+  std::vector<Vec2f> poly = perimeter;
+  if (signedArea(poly) < 0.f) {
+    std::reverse(poly.begin(), poly.end());
+  }
+
+  uint32_t id;
+  if (m_freeFloorIds.empty()) {
+    id = static_cast<uint32_t>(m_floors.size());
+    m_floors.emplace_back();
+  }
+  else {
+    id = m_freeFloorIds.back();
+    m_freeFloorIds.pop_back();
+  }
+
+  auto& pieces = m_floors[id];
+  pieces.clear();
+  for (auto& piece : convexPieces(poly)) {
+    pieces.push_back(addPiece(piece, height));
+  }
+
+  return id;
+}
+
+void FloorGrid::removeFloor(uint32_t id)
+{
+  ASSERT(id < m_floors.size(), "No floor with id " << id);
+
+  for (uint32_t index : m_floors[id]) {
+    removePiece(index);
+  }
+  m_floors[id].clear();
+  m_freeFloorIds.push_back(id);
+}
+
+uint32_t FloorGrid::addPiece(const std::vector<Vec2f>& poly, float_t height)
+{
+  const size_t n = poly.size();
+
+  uint32_t index;
+  if (m_freePieces.empty()) {
+    index = static_cast<uint32_t>(m_pieces.size());
+    m_pieces.emplace_back();
+    m_pieceCells.emplace_back();
+  }
+  else {
+    index = m_freePieces.back();
+    m_freePieces.pop_back();
+  }
+
+  // New slots are zeroed, so have no capacity
+  Piece piece = m_pieces[index];
+  if (piece.edgeCapacity < n) {
+    piece.firstEdge = static_cast<uint32_t>(m_edges.size());
+    piece.edgeCapacity = static_cast<uint32_t>(n);
+    m_edges.resize(m_edges.size() + n);
+  }
+  piece.min = poly[0];
+  piece.max = poly[0];
+  piece.height = height;
+  piece.numEdges = 0;
+
+  for (size_t i = 0; i < n; ++i) {
+    const Vec2f& a = poly[i];
+    const Vec2f& b = poly[(i + 1) % n];
+
+    piece.min = Vec2f{ std::min(piece.min[0], a[0]), std::min(piece.min[1], a[1]) };
+    piece.max = Vec2f{ std::max(piece.max[0], a[0]), std::max(piece.max[1], a[1]) };
+
+    Vec2f D = b - a;
+    if (D[0] == 0.f && D[1] == 0.f) {
+      continue;
+    }
+    // Anticlockwise winding, so the outside is on the right
+    Vec2f normal = Vec2f{ D[1], -D[0] }.normalise();
+    m_edges[piece.firstEdge + piece.numEdges++] = Edge{ normal, normal.dot(a) };
+  }
+
+  m_pieces[index] = piece;
+
+  auto& pieceCells = m_pieceCells[index];
+  pieceCells.clear();
+
+  auto higher = [this](uint32_t a, uint32_t b) {
+    return m_pieces[a].height > m_pieces[b].height;
+  };
+
+  m_rasteriser.rasterise(poly, m_worldMin, m_cellSize, [&](int j, int first, int last) {
+    for (int i = std::max(first, 0); i <= std::min(last, m_gridW - 1); ++i) {
+      uint32_t cellIndex = static_cast<uint32_t>(j * m_gridW + i);
+      auto& cell = m_cells[cellIndex];
+      cell.insert(std::upper_bound(cell.begin(), cell.end(), index, higher), index);
+      pieceCells.push_back(cellIndex);
+    }
+  }, 0, m_gridH - 1);
+
+  return index;
+}
+
+void FloorGrid::removePiece(uint32_t index)
+{
+  for (uint32_t cellIndex : m_pieceCells[index]) {
+    auto& cell = m_cells[cellIndex];
+    cell.erase(std::find(cell.begin(), cell.end(), index));
+  }
+  m_pieceCells[index].clear();
+  m_freePieces.push_back(index);
+}
+
+bool FloorGrid::pieceContains(const Piece& piece, const Vec2f& pos) const
+{
+  if (pos[0] < piece.min[0] - EDGE_TOLERANCE || pos[0] > piece.max[0] + EDGE_TOLERANCE ||
+    pos[1] < piece.min[1] - EDGE_TOLERANCE || pos[1] > piece.max[1] + EDGE_TOLERANCE) {
+
+    return false;
+  }
+
+  for (uint32_t i = piece.firstEdge; i < piece.firstEdge + piece.numEdges; ++i) {
+    if (m_edges[i].normal.dot(pos) > m_edges[i].offset + EDGE_TOLERANCE) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool FloorGrid::highestFloor(const Vec2f& pos, float_t& height) const
+{
+  int i = static_cast<int>(floor((pos[0] - m_worldMin[0]) / m_cellSize[0]));
+  int j = static_cast<int>(floor((pos[1] - m_worldMin[1]) / m_cellSize[1]));
+  if (i < 0 || i >= m_gridW || j < 0 || j >= m_gridH) {
+    return false;
+  }
+
+  for (uint32_t index : m_cells[j * m_gridW + i]) {
+    const Piece& piece = m_pieces[index];
+    if (pieceContains(piece, pos)) {
+      height = piece.height;
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "math.hpp"
+#include "polygon_rasteriser.hpp"
+#include <vector>
+#include <cstdint>
+
+// Floors of collision volumes, baked into a regular grid for altitude queries. Each floor is split
+// into convex pieces, and each cell lists the pieces overlapping it, highest first, so a query
+// stops at the first piece containing the point. Pieces are tested against their bounding box
+// before their edges.
+//
+// Points on the boundary of a floor are inside it, so there are no gaps where floors meet.
+//
+// Pieces remember the cells they were inserted into, so removing a floor only touches those cells.
+// The slots of removed pieces are reused, along with their edges where the new piece has no more.
+class FloorGrid
+{
+  public:
+    FloorGrid(const Vec2f& worldMin, const Vec2f& worldMax, size_t gridW, size_t gridH);
+
+    // The perimeter may be concave and wound either way, but mustn't intersect itself
+    uint32_t addFloor(const std::vector<Vec2f>& perimeter, float_t height);
+    void removeFloor(uint32_t id);
+    size_t numPieces() const;
+
+    // Returns false if pos isn't on any floor
+    bool highestFloor(const Vec2f& pos, float_t& height) const;
+
+  private:
+    // Points inside the piece satisfy normal.dot(p) <= offset for each of its edges
+    struct Edge
+    {
+      Vec2f normal;
+      float_t offset;
+    };
+
+    struct Piece
+    {
+      Vec2f min;
+      Vec2f max;
+      float_t height;
+      uint32_t firstEdge;
+      uint32_t numEdges;
+      uint32_t edgeCapacity;
+    };
+
+    Vec2f m_worldMin;
+    Vec2f m_cellSize;
+    int m_gridW;
+    int m_gridH;
+    std::vector<std::vector<uint32_t>> m_cells;  // Indices into m_pieces
+    std::vector<Piece> m_pieces;
+    std::vector<std::vector<uint32_t>> m_pieceCells;  // Indexed by piece
+    std::vector<uint32_t> m_freePieces;
+    std::vector<Edge> m_edges;
+    std::vector<std::vector<uint32_t>> m_floors;      // Pieces of each floor, indexed by floor id
+    std::vector<uint32_t> m_freeFloorIds;
+    PolygonRasteriser m_rasteriser;
+
+    uint32_t addPiece(const std::vector<Vec2f>& poly, float_t height);
+    void removePiece(uint32_t index);
+    bool pieceContains(const Piece& piece, const Vec2f& pos) const;
+};
@@ -0,0 +1,61 @@
+#include "frame_arena.hpp"
+#include "exception.hpp"
+
+FrameArena::FrameArena()
+  : FrameArena(DEFAULT_BLOCK_SIZE)
+{
+}
+
+FrameArena::FrameArena(size_t blockSize)
+  : m_blockSize(blockSize)
+{
+  ASSERT(blockSize > 0, "Arena block size must be non-zero");
+}
+
+void* FrameArena::allocateSlow(size_t size, size_t alignment)
+{
+  ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0, "Alignment must be a power of 2");
+
+  // Skip to the next block that's big enough. Anything larger than the block size gets a block of
+  // its own, which is then kept like any other
+  size_t needed = size + alignment - 1;
+  size_t next = m_next == nullptr ? m_currentBlock : m_currentBlock + 1;
+  while (next < m_blocks.size() && m_blocks[next].size < needed) {
+    ++next;
+  }
+  if (next == m_blocks.size()) {
+    size_t blockSize = std::max(m_blockSize, needed);
+    m_blocks.push_back(Block{
+      .data = std::make_unique<std::byte[]>(blockSize),
+      .size = blockSize
+    });
+  }
+
+  m_currentBlock = next;
+  m_next = m_blocks[next].data.get();
+  m_end = m_next + m_blocks[next].size;
+
+  return allocate(size, alignment);
+}
+
+void FrameArena::reset()
+{
+  m_currentBlock = 0;
+  m_next = m_blocks.empty() ? nullptr : m_blocks[0].data.get();
+  m_end = m_blocks.empty() ? nullptr : m_next + m_blocks[0].size;
+  m_bytesUsed = 0;
+}
+
+size_t FrameArena::bytesUsed() const
+{
+  return m_bytesUsed;
+}
+
+size_t FrameArena::capacity() const
+{
+  size_t total = 0;
+  for (auto& block : m_blocks) {
+    total += block.size;
+  }
+  return total;
+}
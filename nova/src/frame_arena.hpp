@@ -0,0 +1,164 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <span>
+#include <new>
+#include <type_traits>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// A linear allocator for data that lives for one frame. Allocation bumps a pointer, and reset()
+// frees everything at once without touching it, so only trivially destructible types are allowed.
+//
+// Memory comes in blocks that are kept between resets, so once the arena has grown to fit a frame
+// it stops allocating from the heap altogether.
+class FrameArena
+{
+  public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 256 * 1024;
+
+    FrameArena();
+    explicit FrameArena(size_t blockSize);
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+    FrameArena(FrameArena&&) = default;
+    FrameArena& operator=(FrameArena&&) = default;
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    template<typename T, typename... Args>
+    T* create(Args&&... args);
+
+    // Uninitialised storage for n objects
+    template<typename T>
+    std::span<T> allocateArray(size_t n);
+
+    template<typename T>
+    std::span<T> copy(std::span<const T> items);
+    template<typename T>
+    std::span<T> copy(const std::vector<T>& items);
+
+    // Everything allocated since the last reset becomes invalid
+    void reset();
+
+    // Bytes handed out since the last reset, not counting padding
+    size_t bytesUsed() const;
+    // Bytes held in blocks, whether in use or not
+    size_t capacity() const;
+
+  private:
+    struct Block
+    {
+      std::unique_ptr<std::byte[]> data;
+      size_t size;
+    };
+
+    size_t m_blockSize;
+    std::vector<Block> m_blocks;
+    size_t m_currentBlock = 0;
+    std::byte* m_next = nullptr;
+    std::byte* m_end = nullptr;
+    size_t m_bytesUsed = 0;
+
+    void* allocateSlow(size_t size, size_t alignment);
+};
+
+// A growable array in a FrameArena, for when a frame's items don't arrive all at once. Growing
+// leaves the old storage behind until the arena is reset, so this is only worth it for short
+// lists or ones whose final size is roughly known up front.
+template<typename T>
+class ArenaVector
+{
+  static_assert(std::is_trivially_destructible_v<T>, "Arena objects are never destroyed");
+
+  public:
+    void push_back(FrameArena& arena, const T& item);
+    void reserve(FrameArena& arena, size_t capacity);
+
+    T* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    T& operator[](size_t i) const { return m_data[i]; }
+    T* begin() const { return m_data; }
+    T* end() const { return m_data + m_size; }
+
+    operator std::span<const T>() const { return { m_data, m_size }; }
+
+  private:
+    T* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_capacity = 0;
+};
+
+inline void* FrameArena::allocate(size_t size, size_t alignment)
+{
+  auto address = reinterpret_cast<uintptr_t>(m_next);
+  auto aligned = (address + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+  auto end = reinterpret_cast<uintptr_t>(m_end);
+
+  if (m_next == nullptr || aligned + size > end) {
+    return allocateSlow(size, alignment);
+  }
+
+  m_next = reinterpret_cast<std::byte*>(aligned + size);
+  m_bytesUsed += size;
+  return reinterpret_cast<void*>(aligned);
+}
+
+template<typename T, typename... Args>
+T* FrameArena::create(Args&&... args)
+{
+  static_assert(std::is_trivially_destructible_v<T>, "Arena objects are never destroyed");
+
+  return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+}
+
+template<typename T>
+std::span<T> FrameArena::allocateArray(size_t n)
+{
+  static_assert(std::is_trivially_destructible_v<T>, "Arena objects are never destroyed");
+
+  if (n == 0) {
+    return {};
+  }
+  return { static_cast<T*>(allocate(n * sizeof(T), alignof(T))), n };
+}
+
+template<typename T>
+std::span<T> FrameArena::copy(std::span<const T> items)
+{
+  auto result = allocateArray<T>(items.size());
+  std::uninitialized_copy(items.begin(), items.end(), result.begin());
+  return result;
+}
+
+template<typename T>
+std::span<T> FrameArena::copy(const std::vector<T>& items)
+{
+  return copy(std::span<const T>{ items });
+}
+
+template<typename T>
+void ArenaVector<T>::reserve(FrameArena& arena, size_t capacity)
+{
+  if (capacity <= m_capacity) {
+    return;
+  }
+
+  T* data = arena.allocateArray<T>(capacity).data();
+  std::uninitialized_move(m_data, m_data + m_size, data);
+  m_data = data;
+  m_capacity = capacity;
+}
+
+template<typename T>
+void ArenaVector<T>::push_back(FrameArena& arena, const T& item)
+{
+  if (m_size == m_capacity) {
+    reserve(arena, std::max<size_t>(8, m_capacity * 2));
+  }
+  new (m_data + m_size++) T(item);
+}
@@ -0,0 +1,107 @@
+#include "frustum.hpp"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define NOVA_FRUSTUM_SSE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define NOVA_FRUSTUM_NEON
+#endif
+
+namespace
+{
+
+Vec4f row(const Mat4x4f& m, size_t i)
+{
+  return Vec4f{ m.at(i, 0), m.at(i, 1), m.at(i, 2), m.at(i, 3) };
+}
+
+Vec4f normalisePlane(const Vec4f& p)
+{
+  float_t len = sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+  return p / len;
+}
+
+void cullSpheresScalar(const Frustum& frustum, const float_t* x, const float_t* y,
+  const float_t* z, const float_t* r, size_t begin, size_t end, uint8_t* visible)
+{
+  for (size_t i = begin; i < end; ++i) {
+    bool inside = true;
+    for (auto& p : frustum.planes) {
+      if (p[0] * x[i] + p[1] * y[i] + p[2] * z[i] + p[3] < -r[i]) {
+        inside = false;
+        break;
+      }
+    }
+    visible[i] = inside;
+  }
+}
+
+} // namespace
+
+Frustum computeFrustum(const Mat4x4f& projView)
+{
+  Vec4f r0 = row(projView, 0);
+  Vec4f r1 = row(projView, 1);
+  Vec4f r2 = row(projView, 2);
+  Vec4f r3 = row(projView, 3);
+
+  return Frustum{{
+    normalisePlane(r3 + r0),  // Left
+    normalisePlane(r3 - r0),  // Right
+    normalisePlane(r3 + r1),  // Top or bottom, depending on the handedness of y
+    normalisePlane(r3 - r1),
+    normalisePlane(r2),       // Near
+    normalisePlane(r3 - r2)   // Far
+  }};
+}
+
+void cullSpheres(const Frustum& frustum, const float_t* x, const float_t* y, const float_t* z,
+  const float_t* r, size_t n, uint8_t* visible)
+{
+  size_t i = 0;
+
+#if defined(NOVA_FRUSTUM_SSE)
+  for (; i + 4 <= n; i += 4) {
+    __m128 px = _mm_loadu_ps(x + i);
+    __m128 py = _mm_loadu_ps(y + i);
+    __m128 pz = _mm_loadu_ps(z + i);
+    __m128 negR = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(r + i));
+    __m128 outside = _mm_setzero_ps();
+
+    for (auto& p : frustum.planes) {
+      __m128 d = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(p[0])), _mm_mul_ps(py, _mm_set1_ps(p[1]))),
+        _mm_add_ps(_mm_mul_ps(pz, _mm_set1_ps(p[2])), _mm_set1_ps(p[3])));
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(d, negR));
+    }
+
+    int mask = _mm_movemask_ps(outside);
+    for (size_t j = 0; j < 4; ++j) {
+      visible[i + j] = !(mask & (1 << j));
+    }
+  }
+#elif defined(NOVA_FRUSTUM_NEON)
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t px = vld1q_f32(x + i);
+    float32x4_t py = vld1q_f32(y + i);
+    float32x4_t pz = vld1q_f32(z + i);
+    float32x4_t negR = vnegq_f32(vld1q_f32(r + i));
+    uint32x4_t outside = vdupq_n_u32(0);
+
+    for (auto& p : frustum.planes) {
+      float32x4_t d = vdupq_n_f32(p[3]);
+      d = vmlaq_n_f32(d, px, p[0]);
+      d = vmlaq_n_f32(d, py, p[1]);
+      d = vmlaq_n_f32(d, pz, p[2]);
+      outside = vorrq_u32(outside, vcltq_f32(d, negR));
+    }
+
+    visible[i] = vgetq_lane_u32(outside, 0) == 0;
+    visible[i + 1] = vgetq_lane_u32(outside, 1) == 0;
+    visible[i + 2] = vgetq_lane_u32(outside, 2) == 0;
+    visible[i + 3] = vgetq_lane_u32(outside, 3) == 0;
+  }
+#endif
+
+  cullSpheresScalar(frustum, x, y, z, r, i, n, visible);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "math.hpp"
+#include <array>
+
+// Each plane is stored as (a, b, c, d), normalised so that ax + by + cz + d is the signed distance
+// from the plane. Points inside the frustum have non-negative distance to every plane
+struct Frustum
+{
+  std::array<Vec4f, 6> planes;
+};
+
+struct CullingStats
+{
+  size_t broadphase = 0;  // Candidates returned by the spatial index
+  size_t survived = 0;    // Candidates whose bounds intersect the frustum
+};
+
+// Extracts the planes from a combined projection and view matrix, using Vulkan's clip space
+// conventions (0 <= z <= w)
+Frustum computeFrustum(const Mat4x4f& projView);
+
+// Sets visible[i] to 1 if the sphere with centre (x[i], y[i], z[i]) and radius r[i] intersects the
+// frustum, otherwise 0. Spheres are tested several at a time using SIMD, where available
+void cullSpheres(const Frustum& frustum, const float_t* x, const float_t* y, const float_t* z,
+  const float_t* r, size_t n, uint8_t* visible);
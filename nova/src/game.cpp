@@ -54,16 +54,16 @@ class GameImpl : public Game
     Vec2f m_mouseDelta;
     Vec2f m_leftStickDelta;
     Timer m_timer;
-    size_t m_frame = 0;
-    double m_measuredFrameRate = 0;
-    float_t m_playerVerticalVelocity = 0;  // World units per frame
+    size_t m_step = 0;
+    double m_measuredStepRate = 0;
+    float_t m_playerVerticalVelocity = 0;  // World units per step
     bool m_freeflyMode = false;
 
-    void measureFrameRate();
+    void measureStepRate();
     void processKeyboardInput();
     void processMouseInput();
     void gravity();
-    float_t g() const; // World units per frame per frame
+    float_t g() const; // World units per step per step
 };
 
 GameImpl::GameImpl(PlayerPtr player, RenderSystem& renderSystem, CollisionSystem& collisionSystem,
@@ -77,7 +77,7 @@ GameImpl::GameImpl(PlayerPtr player, RenderSystem& renderSystem, CollisionSystem
 
 float_t GameImpl::g() const
 {
-  return GRAVITY_STRENGTH * metresToWorldUnits(9.8f) / (TARGET_FRAME_RATE * TARGET_FRAME_RATE);
+  return GRAVITY_STRENGTH * metresToWorldUnits(9.8f) / (SIMULATION_RATE * SIMULATION_RATE);
 }
 
 void GameImpl::onKeyDown(KeyboardKey key)
@@ -86,7 +86,7 @@ void GameImpl::onKeyDown(KeyboardKey key)
 
   switch (key) {
     case KeyboardKey::F:{
-      m_logger.info(STR("Simulation frame rate: " << m_measuredFrameRate));
+      m_logger.info(STR("Simulation step rate: " << m_measuredStepRate));
       break;
     }
     case KeyboardKey::P: {
@@ -220,7 +220,7 @@ void GameImpl::processKeyboardInput()
 
     direction = direction.normalise();
     auto playerPos = m_player->getPosition();
-    auto desiredDelta = direction * speed / static_cast<float_t>(TARGET_FRAME_RATE);
+    auto desiredDelta = direction * speed / static_cast<float_t>(SIMULATION_RATE);
 
     Vec3f delta = m_collisionSystem.tryMove(playerPos, desiredDelta, m_player->getRadius(),
       m_player->getStepHeight());
@@ -235,18 +235,20 @@ void GameImpl::processMouseInput()
   m_mouseDelta = Vec2f{};
 }
 
-void GameImpl::measureFrameRate()
+// Steps are decoupled from drawing, so this isn't the frame rate. The renderer measures that
+void GameImpl::measureStepRate()
 {
-  ++m_frame;
-  if (m_frame % TARGET_FRAME_RATE == 0) {
-    m_measuredFrameRate = TARGET_FRAME_RATE / m_timer.elapsed();
+  ++m_step;
+  if (m_step % SIMULATION_RATE == 0) {
+    m_measuredStepRate = SIMULATION_RATE / m_timer.elapsed();
     m_timer.reset();
   }
 }
 
 void GameImpl::update()
 {
-  measureFrameRate();
+  m_renderSystem.camera().beginStep();
+  measureStepRate();
   processKeyboardInput();
   processMouseInput();
   //m_player->rotate(0.f, 0.01f); // TODO: Remove
@@ -1,9 +1,13 @@
 #pragma once
 
 #include "math.hpp"
+#include "polygon_rasteriser.hpp"
 #include <unordered_set>
+#include <unordered_map>
+#include <vector>
 #include <array>
 #include <cassert>
+#include <cstdint>
 
 struct Vec2iHash
 {
@@ -17,6 +21,10 @@ struct Vec2iHash
 
 using GridCellList = std::unordered_set<Vec2i, Vec2iHash>;
 
+// Each cell holds a compact array of indices into a table of distinct items. Queries that span
+// several cells deduplicate by stamping each item with the current query generation, so they don't
+// need to build a set. Queries mutate the stamps, so a grid must not be queried from more than one
+// thread at a time.
 template<typename T, size_t GRID_W, size_t GRID_H>
 class Grid
 {
@@ -30,28 +38,75 @@ class Grid
     void addItemByArea(const std::vector<Vec2f>& poly, const T& item);
     void addItemByRadius(const Vec2f& pos, float_t radius, const T& item);
 
+    // Re-bin an item previously added by radius. Only cells the item enters or leaves are touched
+    void moveItemByRadius(const Vec2f& pos, float_t radius, const T& item);
+    void removeItem(const T& item);
+    bool hasItem(const T& item) const;
+
+    // These allocate a new set on every call. Prefer the overloads below on hot paths
+    //
     std::unordered_set<T> getItems(const Vec2f& pos, float_t radius) const;
     std::unordered_set<T> getItems(const Vec2f& pos) const;
     std::unordered_set<T> getItems(const std::vector<Vec2f>& poly) const;
 
+    // Clear the buffer and fill it with distinct items. Doesn't allocate once the buffer has grown
+    // large enough
+    //
+    void getItems(const Vec2f& pos, float_t radius, std::vector<T>& items) const;
+    void getItems(const Vec2f& pos, std::vector<T>& items) const;
+    void getItems(const std::vector<Vec2f>& poly, std::vector<T>& items) const;
+
+    // Call visitor(const T&) once for each distinct item
+    //
+    template<typename F>
+    void forEachItem(const Vec2f& pos, float_t radius, F&& visitor) const;
+    template<typename F>
+    void forEachItem(const Vec2f& pos, F&& visitor) const;
+    template<typename F>
+    void forEachItem(const std::vector<Vec2f>& poly, F&& visitor) const;
+
     // Exposed for testing
     //
     GridCellList test_gridCellsBetweenPoints(const Vec2f& A, const Vec2f& B) const;
 
   private:
+    using ItemIndex = uint32_t;
+    using Cell = std::vector<ItemIndex>;
+
     Vec2f m_worldMin;
     Vec2f m_worldMax;
     float_t m_worldW;
     float_t m_worldH;
     float_t m_cellW;
     float_t m_cellH;
-    std::array<std::array<std::unordered_set<T>, GRID_H>, GRID_W> m_items;
+    std::vector<Cell> m_cells;
+    std::vector<T> m_itemValues;
+    std::vector<std::vector<uint32_t>> m_itemCells; // Indices into m_cells, per item
+    std::vector<ItemIndex> m_freeIndices;
+    std::unordered_map<T, ItemIndex> m_itemIndices;
+    std::vector<uint32_t> m_cellStamps;
+    uint32_t m_cellGeneration = 0;
+    mutable std::vector<uint32_t> m_stamps;
+    mutable uint32_t m_generation = 0;
+    mutable PolygonRasteriser m_rasteriser;
 
     bool withinBounds(const Vec2f& p) const;
     void boundsCheck(const Vec2f& p) const;
     Vec2i worldToGridCoords(const Vec2f& p) const;
-    GridCellList gridCellsBetweenPoints(const Vec2f& A, const Vec2f& B) const;
+    template<typename F>
+    void forEachCellBetweenPoints(const Vec2f& A, const Vec2f& B, F&& fn) const;
+    template<typename F>
+    void forEachCellInPoly(const std::vector<Vec2f>& poly, F&& fn) const;
     bool cellInRange(const Vec2i& cell) const;
+    Cell& cell(int i, int j);
+    const Cell& cell(int i, int j) const;
+    ItemIndex internItem(const T& item);
+    void insertIntoCell(int i, int j, ItemIndex index);
+    void eraseFromCell(uint32_t cellIndex, ItemIndex index);
+    uint32_t cellIndex(int i, int j) const;
+    uint32_t nextGeneration() const;
+    template<typename F>
+    void visitCell(const Cell& cell, uint32_t generation, F&& visitor) const;
 };
 
 template<typename T, size_t GRID_W, size_t GRID_H>
@@ -62,7 +117,173 @@ Grid<T, GRID_W, GRID_H>::Grid(const Vec2f& worldMin, const Vec2f& worldMax)
   , m_worldH(m_worldMax[1] - m_worldMin[1])
   , m_cellW(m_worldW / GRID_W)
   , m_cellH(m_worldH / GRID_H)
+  , m_cells(GRID_W * GRID_H)
+  , m_cellStamps(GRID_W * GRID_H, 0)
+{
+}
+
+template<typename T, size_t GRID_W, size_t GRID_H>
+uint32_t Grid<T, GRID_W, GRID_H>::cellIndex(int i, int j) const
+{
+  return static_cast<uint32_t>(static_cast<size_t>(i) * GRID_H + static_cast<size_t>(j));
+}
+
+template<typename T, size_t GRID_W, size_t GRID_H>
+typename Grid<T, GRID_W, GRID_H>::Cell& Grid<T, GRID_W, GRID_H>::cell(int i, int j)
+{
+  return m_cells[cellIndex(i, j)];
+}
+
+template<typename T, size_t GRID_W, size_t GRID_H>
+const typename Grid<T, GRID_W, GRID_H>::Cell& Grid<T, GRID_W, GRID_H>::cell(int i, int j) const
+{
+  return m_cells[cellIndex(i, j)];
+}
+
+template<typename T, size_t GRID_W, size_t GRID_H>
+typename Grid<T, GRID_W, GRID_H>::ItemIndex Grid<T, GRID_W, GRID_H>::internItem(const T& item)
+{
+  auto i = m_itemIndices.find(item);
+  if (i != m_itemIndices.end()) {
+    return i->second;
+  }
+
+  ItemIndex index;
+  if (!m_freeIndices.empty()) {
+    index = m_freeIndices.back();
+    m_freeIndices.pop_back();
+    m_itemValues[index] = item;
+  }
+  else {
+    index = static_cast<ItemIndex>(m_itemValues.size());
+    m_itemValues.push_back(item);
+    m_itemCells.emplace_back();
+    m_stamps.push_back(0);
+  }
+  m_itemIndices.insert({ item, index });
+
+  return index;
+}
+
+template<typename T, size_t GRID_W, size_t GRID_H>
+void Grid<T, GRID_W, GRID_H>::insertIntoCell(int i, int j, ItemIndex index)
+{
+  auto& list = cell(i, j);
+  if (std::find(list.begin(), list.end(), index) == list.end()) {
+    list.push_back(index);
+    m_itemCells[index].push_back(cellIndex(i, j));
+  }
+}
+
+template<typename T, size_t GRID_W, size_t GRID_H>
+void Grid<T, GRID_W, GRID_H>::eraseFromCell(uint32_t cellIndex, ItemIndex index)
+{
+  auto& list = m_cells[cellIndex];
+  auto i = std::find(list.begin(), list.end(), index);
+  assert(i != list.end());
+  *i = list.back();
+  list.pop_back();
+}
+
+template<typename T, size_t GRID_W, size_t GRID_H>
+void Grid<T, GRID_W, GRID_H>::moveItemByRadius(const Vec2f& pos, float_t radius, const T& item)
+{
+  boundsCheck(pos);
+
+  auto entry = m_itemIndices.find(item);
+  if (entry == m_itemIndices.end()) {
+    addItemByRadius(pos, radius, item);
+    return;
+  }
+
+  ItemIndex index = entry->second;
+  auto& itemCells = m_itemCells[index];
+
+  Vec2i p0 = worldToGridCoords(Vec2f{ pos[0] - radius, pos[1] - radius });
+  Vec2i p1 = worldToGridCoords(Vec2f{ pos[0] + radius, pos[1] + radius });
+  int i0 = std::max(0, p0[0]);
+  int i1 = std::min(p1[0], static_cast<int>(GRID_W - 1));
+  int j0 = std::max(0, p0[1]);
+  int j1 = std::min(p1[1], static_cast<int>(GRID_H - 1));
+
+  if (++m_cellGeneration == 0) {
+    std::fill(m_cellStamps.begin(), m_cellStamps.end(), 0);
+    m_cellGeneration = 1;
+  }
+
+  // Leave cells outside the new range, and stamp the ones we stay in
+  for (size_t k = 0; k < itemCells.size();) {
+    uint32_t c = itemCells[k];
+    int i = static_cast<int>(c / GRID_H);
+    int j = static_cast<int>(c % GRID_H);
+
+    if (i < i0 || i > i1 || j < j0 || j > j1) {
+      eraseFromCell(c, index);
+      itemCells[k] = itemCells.back();
+      itemCells.pop_back();
+    }
+    else {
+      m_cellStamps[c] = m_cellGeneration;
+      ++k;
+    }
+  }
+
+  // Enter the cells we weren't already in
+  for (int i = i0; i <= i1; ++i) {
+    for (int j = j0; j <= j1; ++j) {
+      uint32_t c = cellIndex(i, j);
+      if (m_cellStamps[c] != m_cellGeneration) {
+        m_cells[c].push_back(index);
+        itemCells.push_back(c);
+      }
+    }
+  }
+}
+
+template<typename T, size_t GRID_W, size_t GRID_H>
+void Grid<T, GRID_W, GRID_H>::removeItem(const T& item)
 {
+  auto entry = m_itemIndices.find(item);
+  if (entry == m_itemIndices.end()) {
+    return;
+  }
+
+  ItemIndex index = entry->second;
+  for (uint32_t c : m_itemCells[index]) {
+    eraseFromCell(c, index);
+  }
+  m_itemCells[index].clear();
+  m_itemValues[index] = T{};
+  m_freeIndices.push_back(index);
+  m_itemIndices.erase(entry);
+}
+
+template<typename T, size_t GRID_W, size_t GRID_H>
+bool Grid<T, GRID_W, GRID_H>::hasItem(const T& item) const
+{
+  return m_itemIndices.contains(item);
+}
+
+template<typename T, size_t GRID_W, size_t GRID_H>
+uint32_t Grid<T, GRID_W, GRID_H>::nextGeneration() const
+{
+  if (++m_generation == 0) {
+    std::fill(m_stamps.begin(), m_stamps.end(), 0);
+    m_generation = 1;
+  }
+  return m_generation;
+}
+
+template<typename T, size_t GRID_W, size_t GRID_H>
+template<typename F>
+void Grid<T, GRID_W, GRID_H>::visitCell(const Cell& cell, uint32_t generation, F&& visitor) const
+{
+  for (ItemIndex index : cell) {
+    if (m_stamps[index] != generation) {
+      m_stamps[index] = generation;
+      visitor(m_itemValues[index]);
+    }
+  }
 }
 
 template<typename T, size_t GRID_W, size_t GRID_H>
@@ -72,17 +293,18 @@ void Grid<T, GRID_W, GRID_H>::addItemByPerimeter(const std::vector<Vec2f>& poly,
     return;
   }
 
+  ItemIndex index = internItem(item);
+
   const size_t n = poly.size();
   for (size_t i = 0; i < n; ++i) {
     auto& p1 = poly[i];
     auto& p2 = poly[(i + 1) % n];
 
-    auto cells = gridCellsBetweenPoints(p1, p2);
-    for (auto& cell : cells) {
-      if (cellInRange(cell)) {
-        m_items[cell[0]][cell[1]].insert(item);
+    forEachCellBetweenPoints(p1, p2, [&](const Vec2i& c) {
+      if (cellInRange(c)) {
+        insertIntoCell(c[0], c[1], index);
       }
-    }
+    });
   }
 }
 
@@ -93,21 +315,11 @@ void Grid<T, GRID_W, GRID_H>::addItemByArea(const std::vector<Vec2f>& poly, cons
     return;
   }
 
-  addItemByPerimeter(poly, item);
-
-  // TODO: Too slow?
-  for (size_t i = 0; i < GRID_W; ++i) {
-    for (size_t j = 0; j < GRID_H; ++j) {
-      Vec2f cellCentre{
-        m_worldMin[0] + (static_cast<float_t>(i) + 0.5f) * m_cellW,
-        m_worldMin[1] + (static_cast<float_t>(j) + 0.5f) * m_cellH
-      };
+  ItemIndex index = internItem(item);
 
-      if (pointIsInsidePoly(cellCentre, poly)) {
-        m_items[i][j].insert(item);
-      }
-    }
-  }
+  forEachCellInPoly(poly, [&](int i, int j) {
+    insertIntoCell(i, j, index);
+  });
 }
 
 template<typename T, size_t GRID_W, size_t GRID_H>
@@ -115,97 +327,120 @@ void Grid<T, GRID_W, GRID_H>::addItemByRadius(const Vec2f& pos, float_t radius,
 {
   boundsCheck(pos);
 
+  ItemIndex index = internItem(item);
+
   Vec2i p0 = worldToGridCoords(Vec2f{ pos[0] - radius, pos[1] - radius });
   Vec2i p1 = worldToGridCoords(Vec2f{ pos[0] + radius, pos[1] + radius });
 
   for (int i = std::max(0, p0[0]); i <= std::min(p1[0], static_cast<int>(GRID_W - 1)); ++i) {
     for (int j = std::max(0, p0[1]); j <= std::min(p1[1], static_cast<int>(GRID_H - 1)); ++j) {
-      m_items[i][j].insert(item);
+      insertIntoCell(i, j, index);
     }
   }
 }
 
 template<typename T, size_t GRID_W, size_t GRID_H>
-std::unordered_set<T> Grid<T, GRID_W, GRID_H>::getItems(const Vec2f& pos, float_t radius) const
+template<typename F>
+void Grid<T, GRID_W, GRID_H>::forEachItem(const Vec2f& pos, float_t radius, F&& visitor) const
 {
-  std::unordered_set<T> items;
+  uint32_t generation = nextGeneration();
 
   Vec2i p0 = worldToGridCoords(Vec2f{ pos[0] - radius, pos[1] - radius });
   Vec2i p1 = worldToGridCoords(Vec2f{ pos[0] + radius, pos[1] + radius });
 
   for (int i = std::max(0, p0[0]); i <= std::min(p1[0], static_cast<int>(GRID_W - 1)); ++i) {
     for (int j = std::max(0, p0[1]); j <= std::min(p1[1], static_cast<int>(GRID_H - 1)); ++j) {
-      auto& list = m_items[i][j];
-      items.insert(list.begin(), list.end());
+      visitCell(cell(i, j), generation, visitor);
     }
   }
-
-  return items;
 }
 
 template<typename T, size_t GRID_W, size_t GRID_H>
-std::unordered_set<T> Grid<T, GRID_W, GRID_H>::getItems(const Vec2f& pos) const
+template<typename F>
+void Grid<T, GRID_W, GRID_H>::forEachItem(const Vec2f& pos, F&& visitor) const
 {
   boundsCheck(pos);
 
   Vec2i p = worldToGridCoords(pos);
 
-  return m_items[p[0]][p[1]];
+  // Items are never stored twice in the same cell, so no need to deduplicate
+  for (ItemIndex index : cell(p[0], p[1])) {
+    visitor(m_itemValues[index]);
+  }
 }
 
 template<typename T, size_t GRID_W, size_t GRID_H>
-std::unordered_set<T> Grid<T, GRID_W, GRID_H>::getItems(const std::vector<Vec2f>& poly) const
+template<typename F>
+void Grid<T, GRID_W, GRID_H>::forEachItem(const std::vector<Vec2f>& poly, F&& visitor) const
 {
-  std::unordered_set<T> items;
-
   if (poly.size() == 0) {
-    return items;
+    return;
   }
 
-  Vec2i minGridCoord{ GRID_W - 1, GRID_H - 1 };
-  Vec2i maxGridCoord{ 0, 0 };
+  uint32_t generation = nextGeneration();
 
-  const size_t n = poly.size();
-  for (size_t i = 0; i < n; ++i) {
-    auto& p1 = poly[i];
-    auto& p2 = poly[(i + 1) % n];
+  forEachCellInPoly(poly, [&](int i, int j) {
+    visitCell(cell(i, j), generation, visitor);
+  });
+}
 
-    auto cells = gridCellsBetweenPoints(p1, p2);
-    for (auto& cell : cells) {
-      if (cellInRange(cell)) {
-        auto& list = m_items[cell[0]][cell[1]];
-        items.insert(list.begin(), list.end());
+// Calls fn(int i, int j) for each cell in the grid that the polygon overlaps
+template<typename T, size_t GRID_W, size_t GRID_H>
+template<typename F>
+void Grid<T, GRID_W, GRID_H>::forEachCellInPoly(const std::vector<Vec2f>& poly, F&& fn) const
+{
+  m_rasteriser.rasterise(poly, m_worldMin, Vec2f{ m_cellW, m_cellH },
+    [&](int j, int first, int last) {
+      for (int i = std::max(first, 0); i <= std::min(last, static_cast<int>(GRID_W - 1)); ++i) {
+        fn(i, j);
       }
+    }, 0, static_cast<int>(GRID_H - 1));
+}
 
-      if (cell[0] < minGridCoord[0]) {
-        minGridCoord[0] = std::max(cell[0], 0);
-      }
-      if (cell[0] > maxGridCoord[0]) {
-        maxGridCoord[0] = std::min(cell[0], static_cast<int>(GRID_W - 1));
-      }
-      if (cell[1] < minGridCoord[1]) {
-        minGridCoord[1] = std::max(cell[1], 0);
-      }
-      if (cell[1] > maxGridCoord[1]) {
-        maxGridCoord[1] = std::min(cell[1], static_cast<int>(GRID_H - 1));
-      }
-    }
-  }
+template<typename T, size_t GRID_W, size_t GRID_H>
+void Grid<T, GRID_W, GRID_H>::getItems(const Vec2f& pos, float_t radius,
+  std::vector<T>& items) const
+{
+  items.clear();
+  forEachItem(pos, radius, [&items](const T& item) { items.push_back(item); });
+}
 
-  for (int i = minGridCoord[0]; i <= maxGridCoord[0]; ++i) {
-    for (int j = minGridCoord[1]; j <= maxGridCoord[1]; ++j) {
-      Vec2f cellCentre{
-        m_worldMin[0] + (static_cast<float_t>(i) + 0.5f) * m_cellW,
-        m_worldMin[1] + (static_cast<float_t>(j) + 0.5f) * m_cellH
-      };
+template<typename T, size_t GRID_W, size_t GRID_H>
+void Grid<T, GRID_W, GRID_H>::getItems(const Vec2f& pos, std::vector<T>& items) const
+{
+  items.clear();
+  forEachItem(pos, [&items](const T& item) { items.push_back(item); });
+}
 
-      if (pointIsInsidePoly(cellCentre, poly)) {
-        auto& list = m_items[i][j];
-        items.insert(list.begin(), list.end());
-      }
-    }
-  }
+template<typename T, size_t GRID_W, size_t GRID_H>
+void Grid<T, GRID_W, GRID_H>::getItems(const std::vector<Vec2f>& poly,
+  std::vector<T>& items) const
+{
+  items.clear();
+  forEachItem(poly, [&items](const T& item) { items.push_back(item); });
+}
 
+template<typename T, size_t GRID_W, size_t GRID_H>
+std::unordered_set<T> Grid<T, GRID_W, GRID_H>::getItems(const Vec2f& pos, float_t radius) const
+{
+  std::unordered_set<T> items;
+  forEachItem(pos, radius, [&items](const T& item) { items.insert(item); });
+  return items;
+}
+
+template<typename T, size_t GRID_W, size_t GRID_H>
+std::unordered_set<T> Grid<T, GRID_W, GRID_H>::getItems(const Vec2f& pos) const
+{
+  std::unordered_set<T> items;
+  forEachItem(pos, [&items](const T& item) { items.insert(item); });
+  return items;
+}
+
+template<typename T, size_t GRID_W, size_t GRID_H>
+std::unordered_set<T> Grid<T, GRID_W, GRID_H>::getItems(const std::vector<Vec2f>& poly) const
+{
+  std::unordered_set<T> items;
+  forEachItem(poly, [&items](const T& item) { items.insert(item); });
   return items;
 }
 
@@ -239,18 +474,20 @@ Vec2i Grid<T, GRID_W, GRID_H>::worldToGridCoords(const Vec2f& p) const
   };
 }
 
+// Calls fn(const Vec2i&) for each cell the line segment passes through. May visit cells outside the
+// grid
 template<typename T, size_t GRID_W, size_t GRID_H>
-GridCellList Grid<T, GRID_W, GRID_H>::gridCellsBetweenPoints(const Vec2f& A, const Vec2f& B) const
+template<typename F>
+void Grid<T, GRID_W, GRID_H>::forEachCellBetweenPoints(const Vec2f& A, const Vec2f& B,
+  F&& fn) const
 {
-  GridCellList cells;
-
   Vec2i startCell = worldToGridCoords(A);
   Vec2i endCell = worldToGridCoords(B);
 
-  cells.insert(startCell);
+  fn(startCell);
 
   if (startCell == endCell) {
-    return cells;
+    return;
   }
 
   int stepX = B[0] > A[0] ? 1 : -1;
@@ -287,15 +524,15 @@ GridCellList Grid<T, GRID_W, GRID_H>::gridCellsBetweenPoints(const Vec2f& A, con
       ty += dtY;
     }
 
-    cells.insert(cell);
+    fn(cell);
   }
-
-  return cells;
 }
 
 template<typename T, size_t GRID_W, size_t GRID_H>
 GridCellList Grid<T, GRID_W, GRID_H>::test_gridCellsBetweenPoints(const Vec2f& A,
   const Vec2f& B) const
 {
-  return gridCellsBetweenPoints(A, B);
+  GridCellList cells;
+  forEachCellBetweenPoints(A, B, [&cells](const Vec2i& cell) { cells.insert(cell); });
+  return cells;
 }
@@ -0,0 +1,126 @@
+#include "spatial_index.hpp"
+#include "sparse_grid.hpp"
+
+namespace
+{
+
+// Gives the same cell size as the old fixed grid on a map like map1.svg
+const float_t DEFAULT_CELL_SIZE = 40.f;
+const float_t CELLS_ACROSS_WORLD = 50.f;
+const float_t MIN_CELL_SIZE = 4.f;
+
+class GridIndex : public SpatialIndex
+{
+  public:
+    GridIndex();
+
+    void initialise(const Vec2f& worldMin, const Vec2f& worldMax) override;
+    void addItem(EntityId entityId, const Vec2f& pos, float_t radius) override;
+    void moveItem(EntityId entityId, const Vec2f& pos, float_t radius) override;
+    void removeItem(EntityId entityId) override;
+    void update() override;
+
+    void getItems(const std::vector<Vec2f>& poly, std::vector<EntityId>& entities) const override;
+    void getItems(const std::vector<ViewVolume>& views, std::vector<EntityId>& entities,
+      std::vector<uint32_t>& viewMasks) const override;
+
+    void getItems(const Vec2f& pos, float_t radius,
+      std::vector<EntityId>& entities) const override;
+    void castRay(const Vec2f& origin, const Vec2f& dir, float_t maxT,
+      const std::function<float_t(EntityId)>& visitor) const override;
+    void searchOutwards(const Vec2f& pos,
+      const std::function<float_t(EntityId)>& visitor) const override;
+
+    size_t memoryUsage() const override;
+
+  private:
+    SparseGrid<EntityId> m_grid;
+};
+
+} // namespace
+
+GridIndex::GridIndex()
+  : m_grid(gridCellSize())
+{
+}
+
+void GridIndex::initialise(const Vec2f& worldMin, const Vec2f& worldMax)
+{
+  m_grid.setCellSize(gridCellSize(worldMin, worldMax));
+}
+
+void GridIndex::addItem(EntityId entityId, const Vec2f& pos, float_t radius)
+{
+  m_grid.addItemByRadius(pos, radius, entityId);
+}
+
+void GridIndex::moveItem(EntityId entityId, const Vec2f& pos, float_t radius)
+{
+  m_grid.moveItemByRadius(pos, radius, entityId);
+}
+
+void GridIndex::removeItem(EntityId entityId)
+{
+  m_grid.removeItem(entityId);
+}
+
+void GridIndex::update()
+{
+}
+
+void GridIndex::getItems(const std::vector<Vec2f>& poly, std::vector<EntityId>& entities) const
+{
+  m_grid.getItems(poly, entities);
+}
+
+void GridIndex::getItems(const std::vector<ViewVolume>& views, std::vector<EntityId>& entities,
+  std::vector<uint32_t>& viewMasks) const
+{
+  entities.clear();
+  viewMasks.clear();
+
+  m_grid.forEachItemInPolys(views.size(),
+    [&views](size_t i) -> const std::vector<Vec2f>& { return views[i].footprint; },
+    [&](EntityId id, uint32_t mask) {
+      entities.push_back(id);
+      viewMasks.push_back(mask);
+    });
+}
+
+void GridIndex::getItems(const Vec2f& pos, float_t radius, std::vector<EntityId>& entities) const
+{
+  m_grid.getItems(pos, radius, entities);
+}
+
+void GridIndex::castRay(const Vec2f& origin, const Vec2f& dir, float_t maxT,
+  const std::function<float_t(EntityId)>& visitor) const
+{
+  m_grid.forEachItemOnRay(origin, dir, maxT, visitor);
+}
+
+void GridIndex::searchOutwards(const Vec2f& pos,
+  const std::function<float_t(EntityId)>& visitor) const
+{
+  m_grid.forEachItemByDistance(pos, visitor);
+}
+
+size_t GridIndex::memoryUsage() const
+{
+  return m_grid.memoryUsage();
+}
+
+float_t gridCellSize()
+{
+  return DEFAULT_CELL_SIZE;
+}
+
+float_t gridCellSize(const Vec2f& worldMin, const Vec2f& worldMax)
+{
+  Vec2f extent = worldMax - worldMin;
+  return std::max(std::max(extent[0], extent[1]) / CELLS_ACROSS_WORLD, MIN_CELL_SIZE);
+}
+
+SpatialIndexPtr createGridIndex()
+{
+  return std::make_unique<GridIndex>();
+}
@@ -0,0 +1,316 @@
+#include "job_system.hpp"
+#include "exception.hpp"
+
+namespace
+{
+
+const int SPINS_BEFORE_SLEEP = 64;
+
+thread_local const JobSystem* tl_system = nullptr;
+thread_local uint32_t tl_threadIndex = 0;
+
+// Chase-Lev deque of fixed capacity. Only the owning thread pushes and pops, at the bottom; any
+// thread may steal from the top
+class WorkStealingQueue
+{
+  public:
+    static constexpr int64_t CAPACITY = JobSystem::JOBS_PER_THREAD;
+
+    // Returns false if the queue is full
+    bool push(Job* job)
+    {
+      int64_t b = m_bottom.load(std::memory_order_relaxed);
+      int64_t t = m_top.load(std::memory_order_acquire);
+      if (b - t >= CAPACITY) {
+        return false;
+      }
+
+      m_items[b & MASK].store(job, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      m_bottom.store(b + 1, std::memory_order_relaxed);
+
+      return true;
+    }
+
+    Job* pop()
+    {
+      int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+      m_bottom.store(b, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      int64_t t = m_top.load(std::memory_order_relaxed);
+
+      if (t > b) {
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+      }
+
+      Job* job = m_items[b & MASK].load(std::memory_order_relaxed);
+      if (t == b) {
+        // Last item, so race any thieves for it
+        if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+          std::memory_order_relaxed)) {
+
+          job = nullptr;
+        }
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+      }
+
+      return job;
+    }
+
+    // Can fail while there are still items, if another thread takes the same one first
+    Job* steal()
+    {
+      int64_t t = m_top.load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      int64_t b = m_bottom.load(std::memory_order_acquire);
+
+      if (t >= b) {
+        return nullptr;
+      }
+
+      Job* job = m_items[t & MASK].load(std::memory_order_relaxed);
+      if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+        std::memory_order_relaxed)) {
+
+        return nullptr;
+      }
+
+      return job;
+    }
+
+  private:
+    static constexpr int64_t MASK = CAPACITY - 1;
+    static_assert((CAPACITY & MASK) == 0, "Queue capacity must be a power of two");
+
+    // Kept on separate cache lines, as thieves write to the top while the owner writes the bottom
+    alignas(64) std::atomic<int64_t> m_top = 0;
+    alignas(64) std::atomic<int64_t> m_bottom = 0;
+    alignas(64) std::array<std::atomic<Job*>, CAPACITY> m_items{};
+};
+
+} // namespace
+
+struct JobSystem::ThreadState
+{
+  WorkStealingQueue queue;
+  std::unique_ptr<Job[]> jobs = std::make_unique<Job[]>(JOBS_PER_THREAD);
+  size_t nextJob = 0;
+  uint32_t random;          // For choosing whom to steal from
+  std::thread thread;       // Not used by the owner
+};
+
+JobSystem::JobSystem(unsigned numWorkers)
+  : m_owner(std::this_thread::get_id())
+{
+  for (unsigned i = 0; i <= numWorkers; ++i) {
+    m_threads.push_back(std::make_unique<ThreadState>());
+    m_threads.back()->random = 2654435761u * (i + 1);
+  }
+  for (unsigned i = 1; i <= numWorkers; ++i) {
+    m_threads[i]->thread = std::thread([this, i]() { workerLoop(i); });
+  }
+}
+
+JobSystem::~JobSystem()
+{
+  {
+    std::lock_guard lock(m_mutex);
+    m_running = false;
+  }
+  m_wake.notify_all();
+
+  for (size_t i = 1; i < m_threads.size(); ++i) {
+    m_threads[i]->thread.join();
+  }
+}
+
+unsigned JobSystem::defaultNumWorkers()
+{
+  return std::max(std::thread::hardware_concurrency(), 1u) - 1;
+}
+
+unsigned JobSystem::numThreads() const
+{
+  return static_cast<unsigned>(m_threads.size());
+}
+
+uint32_t JobSystem::threadIndex() const
+{
+  if (tl_system == this) {
+    return tl_threadIndex;
+  }
+  ASSERT(std::this_thread::get_id() == m_owner,
+    "Jobs can only be used from the job system's owner or from inside jobs");
+  return 0;
+}
+
+Job* JobSystem::allocate(Job* parent)
+{
+  auto& state = *m_threads[threadIndex()];
+  Job* job = &state.jobs[state.nextJob++ % JOBS_PER_THREAD];
+  ASSERT(job->finished(), "More than " << JOBS_PER_THREAD << " jobs in flight on one thread");
+
+  job->m_invoke = nullptr;
+  job->m_parent = parent;
+  job->m_unfinished.store(1, std::memory_order_relaxed);
+  job->m_pending.store(1, std::memory_order_relaxed);
+  job->m_numContinuations = 0;
+  job->m_error = nullptr;
+
+  if (parent != nullptr) {
+    DBG_ASSERT(!parent->finished(), "Parent job has already finished");
+    parent->m_unfinished.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  return job;
+}
+
+void JobSystem::addDependency(Job* job, Job* prerequisite)
+{
+  ASSERT(prerequisite->m_pending.load(std::memory_order_relaxed) > 0,
+    "Can't add a dependency on a job that's already been run");
+  ASSERT(prerequisite->m_numContinuations < Job::MAX_CONTINUATIONS,
+    "Job has too many dependents");
+
+  prerequisite->m_continuations[prerequisite->m_numContinuations++] = job;
+  job->m_pending.fetch_add(1, std::memory_order_relaxed);
+}
+
+void JobSystem::run(Job* job)
+{
+  release(job);
+}
+
+void JobSystem::release(Job* job)
+{
+  if (job->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    push(job);
+  }
+}
+
+void JobSystem::push(Job* job)
+{
+  // Counted before it's visible, so the count never drops below the number of queued jobs
+  m_queued.fetch_add(1);
+  if (!m_threads[threadIndex()]->queue.push(job)) {
+    m_queued.fetch_sub(1);
+    execute(job);
+    return;
+  }
+
+  if (m_sleeping.load() > 0) {
+    std::lock_guard lock(m_mutex);
+    m_wake.notify_one();
+  }
+}
+
+Job* JobSystem::findJob(uint32_t index)
+{
+  auto& state = *m_threads[index];
+
+  Job* job = state.queue.pop();
+  if (job == nullptr) {
+    state.random ^= state.random << 13;
+    state.random ^= state.random >> 17;
+    state.random ^= state.random << 5;
+
+    uint32_t n = numThreads();
+    for (uint32_t i = 0; i < n && job == nullptr; ++i) {
+      uint32_t victim = (state.random + i) % n;
+      if (victim != index) {
+        job = m_threads[victim]->queue.steal();
+      }
+    }
+  }
+
+  if (job != nullptr) {
+    m_queued.fetch_sub(1);
+  }
+  return job;
+}
+
+void JobSystem::execute(Job* job)
+{
+  try {
+    job->m_invoke(*job);
+  }
+  catch (...) {
+    // None of the ancestors can finish before this job does, so they're all still valid
+    std::exception_ptr error = std::current_exception();
+    std::lock_guard lock(m_errorMutex);
+    for (Job* j = job; j != nullptr; j = j->m_parent) {
+      if (!j->m_error) {
+        j->m_error = error;
+      }
+    }
+  }
+
+  finish(job);
+}
+
+void JobSystem::finish(Job* job)
+{
+  // Once the count reaches zero the job's slot may be reused, so read it first
+  Job* parent = job->m_parent;
+  uint32_t numContinuations = job->m_numContinuations;
+  std::array<Job*, Job::MAX_CONTINUATIONS> continuations = job->m_continuations;
+
+  if (job->m_unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < numContinuations; ++i) {
+    release(continuations[i]);
+  }
+  if (parent != nullptr) {
+    finish(parent);
+  }
+}
+
+void JobSystem::wait(const Job* job)
+{
+  uint32_t index = threadIndex();
+
+  while (!job->finished()) {
+    if (Job* next = findJob(index)) {
+      execute(next);
+    }
+    else {
+      std::this_thread::yield();
+    }
+  }
+
+  // Errors are recorded before the job finishes, and nothing more is recorded afterwards
+  if (job->m_error) {
+    std::rethrow_exception(job->m_error);
+  }
+}
+
+void JobSystem::workerLoop(uint32_t index)
+{
+  tl_system = this;
+  tl_threadIndex = index;
+
+  int spins = 0;
+  while (m_running) {
+    if (Job* job = findJob(index)) {
+      execute(job);
+      spins = 0;
+      continue;
+    }
+
+    if (++spins < SPINS_BEFORE_SLEEP) {
+      std::this_thread::yield();
+      continue;
+    }
+    spins = 0;
+
+    // Registering as a sleeper before checking the count means a push either sees the sleeper
+    // and wakes it, or is seen by the check
+    std::unique_lock lock(m_mutex);
+    m_sleeping.fetch_add(1);
+    m_wake.wait(lock, [this]() { return m_queued.load() > 0 || !m_running; });
+    m_sleeping.fetch_sub(1);
+  }
+}
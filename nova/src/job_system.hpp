@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <exception>
+#include <algorithm>
+#include <type_traits>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+
+// A unit of work for the JobSystem. The callable is stored in the job itself, so creating a job
+// doesn't allocate, but the callable must fit in STORAGE_SIZE bytes. Capture anything larger by
+// reference.
+class alignas(64) Job
+{
+  friend class JobSystem;
+
+  public:
+    static constexpr size_t STORAGE_SIZE = 48;
+    static constexpr size_t MAX_CONTINUATIONS = 4;
+
+    // True once the job and all of its children have run
+    bool finished() const;
+
+  private:
+    using Invoke = void(*)(Job&);
+
+    alignas(std::max_align_t) std::byte m_storage[STORAGE_SIZE];
+    Invoke m_invoke = nullptr;
+    Job* m_parent = nullptr;
+    std::atomic<uint32_t> m_unfinished = 0;   // The job itself, plus its unfinished children
+    std::atomic<uint32_t> m_pending = 0;      // Unfinished prerequisites, plus one until it's run
+    uint32_t m_numContinuations = 0;
+    std::array<Job*, MAX_CONTINUATIONS> m_continuations{};
+    std::exception_ptr m_error;               // First thrown by the job or any of its descendants
+};
+
+// Runs jobs on a pool of worker threads. Each thread has its own deque of jobs, which it pushes
+// to and pops from at one end, and idle threads steal from the other end of someone else's.
+//
+// The thread that creates the job system owns it. Jobs can be created, run, and waited for from
+// that thread or from inside other jobs. A thread waiting for a job runs other jobs in the
+// meantime, so the owner does its share of the work and there are no workers to spare on a single
+// core machine.
+//
+// Jobs come from a ring of JOBS_PER_THREAD on the thread that creates them, and are never freed.
+// A job pointer is only valid until its thread has created that many more, so don't hold on to
+// jobs across frames.
+class JobSystem
+{
+  public:
+    static constexpr size_t JOBS_PER_THREAD = 4096;
+    // Leaves the rest of the caller's jobs for whatever else it has in flight
+    static constexpr size_t MAX_PARALLEL_CHUNKS = JOBS_PER_THREAD / 2;
+
+    // One worker per core besides the owner, by default
+    explicit JobSystem(unsigned numWorkers = defaultNumWorkers());
+    ~JobSystem();
+
+    static unsigned defaultNumWorkers();
+    // Workers plus the owner
+    unsigned numThreads() const;
+    // Which thread the caller is, from 0 for the owner to numThreads() - 1
+    uint32_t threadIndex() const;
+
+    // The job won't start until run() is called and its prerequisites have finished. If a parent
+    // is given, the parent doesn't finish until this job has. Children must be created before the
+    // parent finishes, i.e. before it's run or from inside it
+    template<typename F>
+    Job* create(F&& fn, Job* parent = nullptr);
+
+    // Holds back the job until the prerequisite and its children have finished. Call before the
+    // prerequisite is run
+    void addDependency(Job* job, Job* prerequisite);
+
+    void run(Job* job);
+    // Runs other jobs until the given one has finished. Rethrows the first exception thrown by
+    // the job or any of its descendants; exceptions from unrelated jobs are left to their waiters
+    void wait(const Job* job);
+
+    // Calls fn(begin, end) on chunks of [0, n) in parallel and waits for them all. By default
+    // there are a few chunks per thread, so threads that finish early can steal the remainder.
+    // Every chunk is in flight at once, so the grain size is raised if need be to keep them to
+    // MAX_PARALLEL_CHUNKS
+    template<typename F>
+    void parallelFor(size_t n, F&& fn, size_t grainSize = 0);
+
+  private:
+    struct ThreadState;
+
+    std::thread::id m_owner;
+    std::vector<std::unique_ptr<ThreadState>> m_threads;    // The owner's is first
+    std::atomic<bool> m_running = true;
+    std::atomic<int64_t> m_queued = 0;
+    std::atomic<uint32_t> m_sleeping = 0;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::mutex m_errorMutex;
+
+    Job* allocate(Job* parent);
+    Job* findJob(uint32_t index);
+    void push(Job* job);
+    void release(Job* job);
+    void execute(Job* job);
+    void finish(Job* job);
+    void workerLoop(uint32_t index);
+};
+
+inline bool Job::finished() const
+{
+  return m_unfinished.load(std::memory_order_acquire) == 0;
+}
+
+template<typename F>
+Job* JobSystem::create(F&& fn, Job* parent)
+{
+  using Fn = std::decay_t<F>;
+  static_assert(sizeof(Fn) <= Job::STORAGE_SIZE, "Callable is too large for a job");
+  static_assert(alignof(Fn) <= alignof(std::max_align_t), "Callable is over-aligned for a job");
+
+  Job* job = allocate(parent);
+  new (job->m_storage) Fn(std::forward<F>(fn));
+  job->m_invoke = [](Job& job) {
+    Fn& fn = *std::launder(reinterpret_cast<Fn*>(job.m_storage));
+
+    struct Destroy
+    {
+      Fn& fn;
+      ~Destroy() { fn.~Fn(); }
+    } destroy{ fn };
+
+    fn();
+  };
+
+  return job;
+}
+
+template<typename F>
+void JobSystem::parallelFor(size_t n, F&& fn, size_t grainSize)
+{
+  if (grainSize == 0) {
+    grainSize = std::max<size_t>(1, (n + 4 * numThreads() - 1) / (4 * numThreads()));
+  }
+  grainSize = std::max(grainSize, (n + MAX_PARALLEL_CHUNKS - 1) / MAX_PARALLEL_CHUNKS);
+  if (n <= grainSize) {
+    fn(size_t(0), n);
+    return;
+  }
+
+  Job* root = create([]() {});
+  for (size_t begin = 0; begin < n; begin += grainSize) {
+    size_t end = std::min(n, begin + grainSize);
+    run(create([&fn, begin, end]() { fn(begin, end); }, root));
+  }
+  run(root);
+  wait(root);
+}
@@ -86,6 +86,79 @@ bool lineSegmentCircleIntersect(const LineSegment& lseg, const Vec2f& centre, fl
   return false;
 }
 
+Vec2f closestPointOnLineSegment(const LineSegment& lseg, const Vec2f& p)
+{
+  Vec2f D = lseg.B - lseg.A;
+  float_t lengthSquared = D.dot(D);
+  if (lengthSquared == 0.f) {
+    return lseg.A;
+  }
+
+  float_t t = clip((p - lseg.A).dot(D) / lengthSquared, 0.f, 1.f);
+  return lseg.A + D * t;
+}
+
+bool sweepCircleLineSegment(const Vec2f& start, const Vec2f& delta, float_t radius,
+  const LineSegment& lseg, float_t& t, Vec2f& normal)
+{
+  // Cheap rejection of segments outside the swept circle's bounding box
+  for (int i = 0; i < 2; ++i) {
+    float_t lo = std::min(start[i], start[i] + delta[i]) - radius;
+    float_t hi = std::max(start[i], start[i] + delta[i]) + radius;
+    if (std::max(lseg.A[i], lseg.B[i]) < lo || std::min(lseg.A[i], lseg.B[i]) > hi) {
+      return false;
+    }
+  }
+
+  bool hit = false;
+  t = std::numeric_limits<float_t>::max();
+
+  auto consider = [&](float_t candidateT, const Vec2f& candidateNormal) {
+    if (candidateT <= 1.f && candidateT < t && candidateNormal.dot(delta) < 0.f) {
+      t = candidateT;
+      normal = candidateNormal;
+      hit = true;
+    }
+  };
+
+  // The segment's interior, which the circle touches when its centre reaches a line offset from
+  // the segment by the radius, on the side the circle starts on
+  Vec2f D = lseg.B - lseg.A;
+  float_t length = D.magnitude();
+  if (length > 0.f) {
+    Vec2f n = Vec2f{ -D[1], D[0] } / length;
+    float_t s = n.dot(start - lseg.A);
+    if (s < 0.f) {
+      n = -n;
+      s = -s;
+    }
+
+    float_t approach = n.dot(delta);
+    if (approach < 0.f) {
+      float_t tLine = std::max(0.f, (radius - s) / approach);
+      Vec2f contact = start + delta * tLine;
+      float_t along = D.dot(contact - lseg.A) / (length * length);
+      if (along >= 0.f && along <= 1.f) {
+        consider(tLine, n);
+      }
+    }
+  }
+
+  // The end points
+  for (const Vec2f& P : { lseg.A, lseg.B }) {
+    float_t tEnd = 0.f;
+    if (raySphereIntersect(start, delta, P, radius, tEnd)) {
+      Vec2f toCentre = start + delta * tEnd - P;
+      float_t distance = toCentre.magnitude();
+      if (distance > 0.f) {
+        consider(tEnd, toCentre / distance);
+      }
+    }
+  }
+
+  return hit;
+}
+
 bool pointIsInsidePoly(const Vec2f& p, const std::vector<Vec2f>& poly)
 {
   bool inside = false;
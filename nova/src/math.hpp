@@ -639,6 +639,40 @@ Mat4x4f orthographic(float_t fovX, float_t fovY, float_t n, float_t f);
 bool lineIntersect(const Line& l1, const Line& l2, Vec2f& p);
 Vec2f projectionOntoLine(const Line& line, const Vec2f& p);
 bool lineSegmentCircleIntersect(const LineSegment& lseg, const Vec2f& centre, float_t radius);
+Vec2f closestPointOnLineSegment(const LineSegment& lseg, const Vec2f& p);
+// Sweeps a circle from start to start + delta and finds the first time, as a fraction of delta,
+// that it touches the segment, along with the contact normal pointing away from the segment.
+// Overlaps at the start only count if the circle is moving further in
+bool sweepCircleLineSegment(const Vec2f& start, const Vec2f& delta, float_t radius,
+  const LineSegment& lseg, float_t& t, Vec2f& normal);
 bool pointIsInsidePoly(const Vec2f& p, const std::vector<Vec2f>& poly);
 std::vector<uint16_t> triangulatePoly(const std::vector<Vec3f>& vertices);
 Mat2x2f inverse(const Mat2x2f& M);
+
+// Finds where the ray origin + t * dir, t >= 0, enters the circle or sphere. dir needn't be
+// normalised, but t is in units of its length. If the origin is inside, t is 0
+template<size_t N>
+bool raySphereIntersect(const Vector<float_t, N>& origin, const Vector<float_t, N>& dir,
+  const Vector<float_t, N>& centre, float_t radius, float_t& t)
+{
+  Vector<float_t, N> m = origin - centre;
+  float_t c = m.dot(m) - radius * radius;
+  if (c <= 0.f) {
+    t = 0.f;
+    return true;
+  }
+
+  float_t a = dir.dot(dir);
+  float_t b = m.dot(dir);
+  if (b >= 0.f || a == 0.f) {
+    return false;
+  }
+
+  float_t discriminant = b * b - a * c;
+  if (discriminant < 0.f) {
+    return false;
+  }
+
+  t = (-b - sqrt(discriminant)) / a;
+  return true;
+}
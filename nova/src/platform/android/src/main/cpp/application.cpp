@@ -13,6 +13,7 @@
 #include "units.hpp"
 #include "window_delegate.hpp"
 #include "file_system.hpp"
+#include "job_system.hpp"
 #include "units.hpp"
 #include <android/asset_manager.h>
 #include <android_native_app_glue.h>
@@ -73,6 +74,7 @@ class Application
     Logger& m_logger;
     WindowDelegatePtr m_windowDelegate;
     FileSystemPtr m_fileSystem;
+    std::unique_ptr<JobSystem> m_jobSystem;
     render::RendererPtr m_renderer;
     SpatialSystemPtr m_spatialSystem;
     RenderSystemPtr m_renderSystem;
@@ -92,10 +94,11 @@ Application::Application(WindowDelegatePtr windowDelegate, FileSystemPtr fileSys
   , m_windowDelegate(std::move(windowDelegate))
   , m_fileSystem(std::move(fileSystem))
 {
-  m_renderer = createRenderer(*m_fileSystem, *m_windowDelegate, m_logger);
-  m_spatialSystem = createSpatialSystem(m_logger);
+  m_jobSystem = std::make_unique<JobSystem>();
+  m_renderer = createRenderer(*m_fileSystem, *m_windowDelegate, m_logger, true);
+  m_spatialSystem = createSpatialSystem(m_logger, SpatialIndexType::Grid, m_jobSystem.get());
   m_renderSystem = createRenderSystem(*m_spatialSystem, *m_renderer, m_logger);
-  m_collisionSystem = createCollisionSystem(*m_spatialSystem, m_logger);
+  m_collisionSystem = createCollisionSystem(*m_spatialSystem, m_logger, m_jobSystem.get());
   m_mapParser = createMapParser(*m_fileSystem, m_logger);
   m_modelLoader = createModelLoader(*m_renderSystem, *m_fileSystem, *m_logger);
   m_entityFactory = createEntityFactory(*m_modelLoader, *m_spatialSystem, *m_renderSystem,
@@ -268,7 +271,7 @@ bool EventHandler::isWindowInitialised() const
 
 bool waitForWindow(android_app& state, EventHandler& handler)
 {
-  FrameRateLimiter frameRateLimiter{TARGET_FRAME_RATE};
+  FrameRateLimiter frameRateLimiter{SIMULATION_RATE};
 
   while (!state.destroyRequested) {
     android_poll_source* source = nullptr;
@@ -318,7 +321,8 @@ void android_main(android_app* state)
   auto application = createApplication(*state, *logger);
   handler.setApplication(application.get());
 
-  FrameRateLimiter frameRateLimiter{TARGET_FRAME_RATE};
+  // Each update is one simulation step, so updates can't come any faster than that
+  FrameRateLimiter frameRateLimiter{SIMULATION_RATE};
 
   while (!state->destroyRequested) {
     android_poll_source* source = nullptr;
@@ -13,6 +13,8 @@
 #include "units.hpp"
 #include "window_delegate.hpp"
 #include "file_system.hpp"
+#include "job_system.hpp"
+#include "system_scheduler.hpp"
 #include <iostream>
 #include <GLFW/glfw3.h>
 
@@ -79,6 +81,9 @@ class Application
     FileSystemPtr m_fileSystem;
     WindowDelegatePtr m_windowDelegate;
     LoggerPtr m_logger;
+    std::unique_ptr<JobSystem> m_jobSystem;
+    std::unique_ptr<SystemScheduler> m_stepScheduler;   // Simulation steps that aren't drawn
+    std::unique_ptr<SystemScheduler> m_frameScheduler;  // A simulation step, if due, and a frame
     render::RendererPtr m_renderer;
     SpatialSystemPtr m_spatialSystem;
     RenderSystemPtr m_renderSystem;
@@ -93,12 +98,15 @@ class Application
     ControlMode m_controlMode;
     Vec2f m_lastMousePos;
     GLFWgamepadstate m_gamepadState;
+    bool m_stepDue = false;
 
     void enterInputCapture();
     void exitInputCapture();
     void toggleFullScreen();
     Vec2i windowSize() const;
     void processGamepadInput();
+    void addSimulationStages(SystemScheduler& scheduler);
+    void scheduleSystems();
 };
 
 Application* Application::m_instance = nullptr;
@@ -153,10 +161,12 @@ Application::Application()
   m_fileSystem = createDefaultFileSystem(std::filesystem::current_path() / "data");
   m_windowDelegate = createWindowDelegate(*m_window);
   m_logger = createLogger(std::cerr, std::cerr, std::cout, std::cout);
-  m_renderer = createRenderer(*m_fileSystem, *m_windowDelegate, *m_logger);
-  m_spatialSystem = createSpatialSystem(*m_logger);
+  m_jobSystem = std::make_unique<JobSystem>();
+  m_renderer = createRenderer(*m_fileSystem, *m_windowDelegate, *m_logger,
+    FRAME_RATE_MODE == FrameRateMode::Vsync);
+  m_spatialSystem = createSpatialSystem(*m_logger, SpatialIndexType::Grid, m_jobSystem.get());
   m_renderSystem = createRenderSystem(*m_spatialSystem, *m_renderer, *m_logger);
-  m_collisionSystem = createCollisionSystem(*m_spatialSystem, *m_logger);
+  m_collisionSystem = createCollisionSystem(*m_spatialSystem, *m_logger, m_jobSystem.get());
   m_mapParser = createMapParser(*m_fileSystem, *m_logger);
   m_modelLoader = createModelLoader(*m_renderSystem, *m_fileSystem, *m_logger);
   m_entityFactory = createEntityFactory(*m_modelLoader, *m_spatialSystem, *m_renderSystem,
@@ -168,20 +178,37 @@ Application::Application()
   m_renderSystem->start();
   m_game = createGame(std::move(player), *m_renderSystem, *m_collisionSystem, *m_logger);
 
+  m_stepScheduler = std::make_unique<SystemScheduler>(*m_jobSystem);
+  m_frameScheduler = std::make_unique<SystemScheduler>(*m_jobSystem);
+  scheduleSystems();
+
   glfwSetMouseButtonCallback(m_window, onMouseClick);
 }
 
 void Application::run()
 {
-  FrameRateLimiter frameRateLimiter{TARGET_FRAME_RATE};
+  FrameRateLimiter frameRateLimiter{FRAME_RATE_MODE == FrameRateMode::Capped ? MAX_FRAME_RATE : 0};
+  FixedTimestep timestep{SIMULATION_RATE};
+  Timer frameTimer;
 
   while(!glfwWindowShouldClose(m_window)) {
     glfwPollEvents();
 
-    m_game->update();
-    m_spatialSystem->update();
-    m_renderSystem->update();
-    m_collisionSystem->update();
+    // The simulation runs at a fixed rate, and frames are drawn part way between its last two steps
+    unsigned steps = timestep.advance(frameTimer.elapsed());
+    frameTimer.reset();
+
+    // When more than one step is due, those before the last catch up on their own. The last runs
+    // alongside the frame's rendering work
+    m_stepDue = true;
+    for (unsigned i = 1; i < steps; ++i) {
+      m_stepScheduler->runFrame();
+    }
+    m_stepDue = steps > 0;
+
+    m_renderSystem->setInterpolation(static_cast<float_t>(timestep.alpha()));
+    m_frameScheduler->runFrame();
+
     if (m_controlMode == ControlMode::Gamepad) {
       processGamepadInput();
     }
@@ -190,6 +217,39 @@ void Application::run()
   }
 }
 
+// The stages of one simulation step, which do nothing if no step is due. The spatial system's
+// transform listeners update the collision system, so it writes to both
+void Application::addSimulationStages(SystemScheduler& scheduler)
+{
+  scheduler.addStage("game", { "collision" }, { "spatial", "camera" }, [this]() {
+    if (m_stepDue) {
+      m_game->update();
+    }
+  });
+  scheduler.addStage("spatial", {}, { "spatial", "collision" }, [this]() {
+    if (m_stepDue) {
+      m_spatialSystem->update();
+    }
+  });
+}
+
+// Animation doesn't depend on the simulation, so it runs alongside the step. Culling has to wait
+// for the step's transforms and camera, and drawing for both
+void Application::scheduleSystems()
+{
+  addSimulationStages(*m_stepScheduler);
+  addSimulationStages(*m_frameScheduler);
+
+  m_frameScheduler->addStage("animation", {}, { "animation" }, [this]() {
+    m_renderSystem->updateAnimations();
+  });
+  m_frameScheduler->addStage("visibility", { "spatial", "camera" }, { "visibility" }, [this]() {
+    m_renderSystem->computeVisibility();
+  });
+  m_frameScheduler->addStage("draw", { "spatial", "animation", "visibility" }, { "renderer" },
+    [this]() { m_renderSystem->draw(); }, true);
+}
+
 Vec2i Application::windowSize() const
 {
   Vec2i size;
@@ -229,6 +289,9 @@ void Application::onKeyboardInput(int code, int action)
       case KeyboardKey::F:
         m_logger->info(STR("Renderer frame rate: " << m_renderer->frameRate()));
         break;
+      case KeyboardKey::T:
+        m_logger->info(STR("Last frame:\n" << m_frameScheduler->timeline()));
+        break;
 #ifdef __APPLE__
       case KeyboardKey::F12:
 #else
@@ -328,6 +391,9 @@ void Application::exitInputCapture()
 
 Application::~Application()
 {
+  m_frameScheduler.reset();
+  m_stepScheduler.reset();
+  m_jobSystem.reset();
   m_renderer.reset();
   glfwDestroyWindow(m_window);
   glfwTerminate();
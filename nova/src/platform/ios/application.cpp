@@ -12,6 +12,7 @@
 #include "time.hpp"
 #include "window_delegate.hpp"
 #include "file_system.hpp"
+#include "job_system.hpp"
 #include <iostream>
 
 FileSystemPtr createDefaultFileSystem(const std::filesystem::path& dataRootDir);
@@ -31,6 +32,7 @@ class ApplicationImpl : public Application
     FileSystemPtr m_fileSystem;
     WindowDelegatePtr m_windowDelegate;
     LoggerPtr m_logger;
+    std::unique_ptr<JobSystem> m_jobSystem;
     render::RendererPtr m_renderer;
     SpatialSystemPtr m_spatialSystem;
     RenderSystemPtr m_renderSystem;
@@ -46,10 +48,11 @@ ApplicationImpl::ApplicationImpl(const char* bundlePath, WindowDelegatePtr windo
 {
   m_fileSystem = createDefaultFileSystem(std::filesystem::path{bundlePath} / "data");
   m_logger = createLogger(std::cerr, std::cerr, std::cout, std::cout);
-  m_renderer = createRenderer(*m_fileSystem, *m_windowDelegate, *m_logger);
-  m_spatialSystem = createSpatialSystem(*m_logger);
+  m_jobSystem = std::make_unique<JobSystem>();
+  m_renderer = createRenderer(*m_fileSystem, *m_windowDelegate, *m_logger, true);
+  m_spatialSystem = createSpatialSystem(*m_logger, SpatialIndexType::Grid, m_jobSystem.get());
   m_renderSystem = createRenderSystem(*m_spatialSystem, *m_renderer, *m_logger);
-  m_collisionSystem = createCollisionSystem(*m_spatialSystem, *m_logger);
+  m_collisionSystem = createCollisionSystem(*m_spatialSystem, *m_logger, m_jobSystem.get());
   m_mapParser = createMapParser(*m_fileSystem, *m_logger);
   m_modelLoader = createModelLoader(*m_renderSystem, *m_fileSystem, *m_logger);
   m_entityFactory = createEntityFactory(*m_modelLoader, *m_spatialSystem, *m_renderSystem,
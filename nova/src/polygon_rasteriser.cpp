@@ -0,0 +1,79 @@
+#include "polygon_rasteriser.hpp"
+#include <algorithm>
+
+namespace
+{
+
+float_t xAtY(const Vec2f& a, const Vec2f& b, float_t y)
+{
+  return a[0] + (y - a[1]) * (b[0] - a[0]) / (b[1] - a[1]);
+}
+
+} // namespace
+
+// The projection onto the x axis of each connected piece of the polygon within the slab is the
+// projection of its boundary. That boundary is made of parts of the polygon's edges and parts of
+// the lines y = y0 and y = y1 that lie inside the polygon
+void PolygonRasteriser::computeRowIntervals(const std::vector<Vec2f>& poly, float_t y0,
+  float_t y1)
+{
+  m_intervals.clear();
+
+  const size_t n = poly.size();
+  for (size_t i = 0; i < n; ++i) {
+    const Vec2f& a = poly[i];
+    const Vec2f& b = poly[(i + 1) % n];
+
+    if (std::max(a[1], b[1]) < y0 || std::min(a[1], b[1]) > y1) {
+      continue;
+    }
+
+    float_t xa = a[0];
+    float_t xb = b[0];
+    if (a[1] != b[1]) {
+      xa = xAtY(a, b, std::clamp(a[1], y0, y1));
+      xb = xAtY(a, b, std::clamp(b[1], y0, y1));
+    }
+    m_intervals.push_back(Vec2f{ std::min(xa, xb), std::max(xa, xb) });
+  }
+
+  addInteriorSpans(poly, y0);
+  addInteriorSpans(poly, y1);
+
+  std::sort(m_intervals.begin(), m_intervals.end(), [](const Vec2f& a, const Vec2f& b) {
+    return a[0] < b[0];
+  });
+
+  size_t merged = 0;
+  for (size_t i = 0; i < m_intervals.size(); ++i) {
+    if (merged > 0 && m_intervals[i][0] <= m_intervals[merged - 1][1]) {
+      m_intervals[merged - 1][1] = std::max(m_intervals[merged - 1][1], m_intervals[i][1]);
+    }
+    else {
+      m_intervals[merged++] = m_intervals[i];
+    }
+  }
+  m_intervals.resize(merged);
+}
+
+// Adds the ranges of the line at y that are inside the polygon, using the even-odd rule
+void PolygonRasteriser::addInteriorSpans(const std::vector<Vec2f>& poly, float_t y)
+{
+  m_crossings.clear();
+
+  const size_t n = poly.size();
+  for (size_t i = 0; i < n; ++i) {
+    const Vec2f& a = poly[i];
+    const Vec2f& b = poly[(i + 1) % n];
+
+    if ((a[1] <= y) != (b[1] <= y)) {
+      m_crossings.push_back(xAtY(a, b, y));
+    }
+  }
+
+  std::sort(m_crossings.begin(), m_crossings.end());
+
+  for (size_t i = 0; i + 1 < m_crossings.size(); i += 2) {
+    m_intervals.push_back(Vec2f{ m_crossings[i], m_crossings[i + 1] });
+  }
+}
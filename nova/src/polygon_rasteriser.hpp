@@ -0,0 +1,75 @@
+#pragma once
+
+#include "math.hpp"
+#include <vector>
+#include <limits>
+
+// Finds the cells of a regular grid that a polygon overlaps, one row at a time. The cost is
+// proportional to the number of rows covered times the number of vertices, plus the number of
+// spans emitted. The polygon may be concave, but mustn't intersect itself.
+//
+// Overlap is exact: a cell is emitted if the polygon, including its boundary, has any point
+// inside the cell, except where that point lies only on the cell's max edge. Scratch buffers are
+// reused between calls, so a rasteriser shouldn't be shared between threads.
+class PolygonRasteriser
+{
+  public:
+    // Calls fn(int row, int firstCol, int lastCol) for each run of overlapped cells, in order of
+    // increasing row and then column. Cell (i, j) covers [origin + (i, j) * cellSize,
+    // origin + (i + 1, j + 1) * cellSize). Only rows in [minRow, maxRow] are visited
+    template<typename F>
+    void rasterise(const std::vector<Vec2f>& poly, const Vec2f& origin, const Vec2f& cellSize,
+      F&& fn, int minRow = std::numeric_limits<int>::min(),
+      int maxRow = std::numeric_limits<int>::max());
+
+  private:
+    std::vector<Vec2f> m_intervals;
+    std::vector<float_t> m_crossings;
+
+    // Fills m_intervals with the sorted, disjoint x ranges of the polygon's intersection with the
+    // slab y0 <= y <= y1
+    void computeRowIntervals(const std::vector<Vec2f>& poly, float_t y0, float_t y1);
+    void addInteriorSpans(const std::vector<Vec2f>& poly, float_t y);
+};
+
+template<typename F>
+void PolygonRasteriser::rasterise(const std::vector<Vec2f>& poly, const Vec2f& origin,
+  const Vec2f& cellSize, F&& fn, int minRow, int maxRow)
+{
+  if (poly.empty()) {
+    return;
+  }
+
+  float_t minY = poly[0][1];
+  float_t maxY = poly[0][1];
+  for (auto& p : poly) {
+    minY = std::min(minY, p[1]);
+    maxY = std::max(maxY, p[1]);
+  }
+
+  int firstRow = static_cast<int>(floor((minY - origin[1]) / cellSize[1]));
+  int lastRow = std::max(firstRow, static_cast<int>(ceil((maxY - origin[1]) / cellSize[1])) - 1);
+  firstRow = std::max(firstRow, minRow);
+  lastRow = std::min(lastRow, maxRow);
+
+  for (int j = firstRow; j <= lastRow; ++j) {
+    float_t y0 = origin[1] + static_cast<float_t>(j) * cellSize[1];
+    computeRowIntervals(poly, y0, y0 + cellSize[1]);
+
+    int prevCol = std::numeric_limits<int>::min();
+    for (auto& interval : m_intervals) {
+      int first = static_cast<int>(floor((interval[0] - origin[0]) / cellSize[0]));
+      int last = std::max(first,
+        static_cast<int>(ceil((interval[1] - origin[0]) / cellSize[0])) - 1);
+
+      // Neighbouring intervals can share a cell
+      if (prevCol != std::numeric_limits<int>::min()) {
+        first = std::max(first, prevCol + 1);
+      }
+      if (first <= last) {
+        fn(j, first, last);
+        prevCol = last;
+      }
+    }
+  }
+}
@@ -6,9 +6,9 @@
 #include "exception.hpp"
 #include "utils.hpp"
 #include "time.hpp"
+#include "component_pool.hpp"
 #include <map>
 #include <cassert>
-#include <functional>
 
 using render::Renderer;
 using render::MeshPtr;
@@ -26,6 +26,11 @@ CRender::~CRender() {}
 namespace
 {
 
+// Indices into the views culled together each frame
+const size_t SHADOW_VIEW = 0;
+const size_t MAIN_VIEW = 1;
+const size_t NUM_VIEWS = 2;
+
 struct AnimationChannelState
 {
   bool stopped = false;
@@ -53,9 +58,11 @@ class RenderSystemImpl : public RenderSystem
 
     void start() override;
     double frameRate() const override;
+    const RenderStats& stats() const override;
 
     Camera& camera() override;
     const Camera& camera() const override;
+    void setInterpolation(float_t alpha) override;
 
     void addComponent(ComponentPtr component) override;
     void removeComponent(EntityId entityId) override;
@@ -63,6 +70,9 @@ class RenderSystemImpl : public RenderSystem
     CRender& getComponent(EntityId entityId) override;
     const CRender& getComponent(EntityId entityId) const override;
     void update() override;
+    void updateAnimations() override;
+    void computeVisibility() override;
+    void draw() override;
 
     // Animations
     //
@@ -99,26 +109,50 @@ class RenderSystemImpl : public RenderSystem
     void removeMaterial(RenderItemId id) override;
 
   private:
+    struct VisibleModel
+    {
+      CRenderModel* model;
+      const Mat4x4f* transform;
+    };
+
     Logger& m_logger;
     Camera m_camera;
+    Camera m_frameCamera;   // m_camera, interpolated for the current frame
+    float_t m_alpha = 1.f;
     const SpatialSystem& m_spatialSystem;
     Renderer& m_renderer;
-    std::map<EntityId, CRenderPtr> m_components;
-    std::set<EntityId> m_lights;
+    // One pool per type of component, so each is drawn in a tight loop without casting
+    ComponentPool<CRenderModel> m_models;
+    ComponentPool<CRenderLight> m_lights;
+    ComponentPool<CRenderSkybox> m_skyboxes;
+    ComponentPool<CRenderParticleEmitter> m_emitters;
     std::map<RenderItemId, AnimationSetPtr> m_animationSets;
-    std::map<EntityId, AnimationState> m_animationStates;
-
-    using DrawFilter = std::function<bool(const Submodel&)>;
-
-    std::vector<Vec2f> computePerspectiveFrustumPerimeter(const Vec3f& viewPos,
-      const Vec3f& viewDir, float_t hFov) const;
-    std::vector<Vec2f> computeOrthographicFrustumPerimeter(const Vec3f& viewPos,
-      const Vec3f& viewDir, float_t hFov, float_t zFar) const;
-    void drawEntities(const std::unordered_set<EntityId>& entities,
-      const DrawFilter& filter = [](const Submodel&) { return true; });
+    ComponentPool<AnimationState> m_animationStates;
+    // Reused between frames to avoid allocation
+    //
+    std::vector<ViewVolume> m_views;
+    std::vector<EntityId> m_visible;
+    std::vector<uint32_t> m_viewMasks;
+    std::vector<CullingStats> m_viewStats;
+    std::vector<std::vector<VisibleModel>> m_viewModels;
+    std::vector<Mat4x4f> m_interpolated;    // Transforms of visible entities that are moving
+    std::vector<std::vector<const CRenderSkybox*>> m_viewSkyboxes;
+
+    Vec3f m_shadowViewPos;
+    Mat4x4f m_shadowViewMatrix;
+    RenderStats m_stats;
+
+    // These write into the given vector, so its storage is reused between frames
+    void computePerspectiveFrustumPerimeter(const Vec3f& viewPos, const Vec3f& viewDir,
+      float_t hFov, std::vector<Vec2f>& perimeter) const;
+    void computeOrthographicFrustumPerimeter(const Vec3f& viewPos, const Vec3f& viewDir,
+      float_t hFov, float_t zFar, std::vector<Vec2f>& perimeter) const;
+    template<typename F>
+    void drawModels(const std::vector<VisibleModel>& models, F&& filter);
+    template<typename F>
+    void drawSkyboxes(const std::vector<const CRenderSkybox*>& skyboxes, F&& filter);
     void doShadowPass();
     void doMainPass();
-    void updateAnimations();
 };
 
 RenderSystemImpl::RenderSystemImpl(const SpatialSystem& spatialSystem, Renderer& renderer,
@@ -126,6 +160,9 @@ RenderSystemImpl::RenderSystemImpl(const SpatialSystem& spatialSystem, Renderer&
   : m_logger(logger)
   , m_spatialSystem(spatialSystem)
   , m_renderer(renderer)
+  , m_views(NUM_VIEWS)
+  , m_viewModels(NUM_VIEWS)
+  , m_viewSkyboxes(NUM_VIEWS)
 {
 }
 
@@ -135,8 +172,8 @@ void RenderSystemImpl::compileShader(const MeshFeatureSet& meshFeatures,
   m_renderer.compileShader(meshFeatures, materialFeatures);
 }
 
-std::vector<Vec2f> RenderSystemImpl::computePerspectiveFrustumPerimeter(const Vec3f& viewPos,
-  const Vec3f& viewDir, float_t hFov) const
+void RenderSystemImpl::computePerspectiveFrustumPerimeter(const Vec3f& viewPos,
+  const Vec3f& viewDir, float_t hFov, std::vector<Vec2f>& perimeter) const
 {
   auto params = m_renderer.getViewParams();
   Vec3f A{ params.nearPlane * static_cast<float_t>(tan(0.5f * hFov)), params.nearPlane, 1 };
@@ -152,11 +189,11 @@ std::vector<Vec2f> RenderSystemImpl::computePerspectiveFrustumPerimeter(const Ve
     0, 0, 1
   };
 
-  return std::vector<Vec2f>{(m * A).sub<2>(), (m * B).sub<2>(), (m * C).sub<2>(), (m * D).sub<2>()};
+  perimeter.assign({ (m * A).sub<2>(), (m * B).sub<2>(), (m * C).sub<2>(), (m * D).sub<2>() });
 }
 
-std::vector<Vec2f> RenderSystemImpl::computeOrthographicFrustumPerimeter(const Vec3f& viewPos,
-  const Vec3f& viewDir, float_t hFov, float_t zFar) const
+void RenderSystemImpl::computeOrthographicFrustumPerimeter(const Vec3f& viewPos,
+  const Vec3f& viewDir, float_t hFov, float_t zFar, std::vector<Vec2f>& perimeter) const
 {
   float_t w = zFar * tan(0.5f * hFov);
   Vec3f A{ w, 0.f, 1 };
@@ -172,7 +209,7 @@ std::vector<Vec2f> RenderSystemImpl::computeOrthographicFrustumPerimeter(const V
     0, 0, 1
   };
 
-  return std::vector<Vec2f>{(m * A).sub<2>(), (m * B).sub<2>(), (m * C).sub<2>(), (m * D).sub<2>()};
+  perimeter.assign({ (m * A).sub<2>(), (m * B).sub<2>(), (m * C).sub<2>(), (m * D).sub<2>() });
 }
 
 void RenderSystemImpl::start()
@@ -185,39 +222,69 @@ double RenderSystemImpl::frameRate() const
   return m_renderer.frameRate();
 }
 
+const RenderStats& RenderSystemImpl::stats() const
+{
+  return m_stats;
+}
+
+// The component is moved into the pool for its type, so the pointer passed in is left empty
 void RenderSystemImpl::addComponent(ComponentPtr component)
 {
-  auto renderComp = CRenderPtr(dynamic_cast<CRender*>(component.release()));
-  if (renderComp->type == CRenderType::Light) {
-    m_lights.insert(renderComp->id());
+  auto& renderComp = static_cast<CRender&>(*component);
+  EntityId id = renderComp.id();
+
+  switch (renderComp.type) {
+    case CRenderType::Model:
+      m_models.add(id, std::move(static_cast<CRenderModel&>(renderComp)));
+      break;
+    case CRenderType::Light:
+      m_lights.add(id, std::move(static_cast<CRenderLight&>(renderComp)));
+      break;
+    case CRenderType::Skybox:
+      m_skyboxes.add(id, std::move(static_cast<CRenderSkybox&>(renderComp)));
+      break;
+    case CRenderType::ParticleEmitter:
+      m_emitters.add(id, std::move(static_cast<CRenderParticleEmitter&>(renderComp)));
+      break;
   }
-  m_components[renderComp->id()] = std::move(renderComp);
 }
 
 void RenderSystemImpl::removeComponent(EntityId entityId)
 {
-  auto i = m_components.find(entityId);
-  if (i != m_components.end()) {
-    if (i->second->type == CRenderType::Light) {
-      m_lights.erase(entityId);
-    }
-    m_components.erase(i);
-  }
+  m_models.remove(entityId);
+  m_lights.remove(entityId);
+  m_skyboxes.remove(entityId);
+  m_emitters.remove(entityId);
+  m_animationStates.remove(entityId);
 }
 
 bool RenderSystemImpl::hasComponent(EntityId entityId) const
 {
-  return m_components.count(entityId) > 0;
+  return m_models.contains(entityId) || m_lights.contains(entityId) ||
+    m_skyboxes.contains(entityId) || m_emitters.contains(entityId);
 }
 
 CRender& RenderSystemImpl::getComponent(EntityId entityId)
 {
-  return *m_components.at(entityId);
+  const auto& self = *this;
+  return const_cast<CRender&>(self.getComponent(entityId));
 }
 
 const CRender& RenderSystemImpl::getComponent(EntityId entityId) const
 {
-  return *m_components.at(entityId);
+  if (auto model = m_models.find(entityId)) {
+    return *model;
+  }
+  if (auto light = m_lights.find(entityId)) {
+    return *light;
+  }
+  if (auto skybox = m_skyboxes.find(entityId)) {
+    return *skybox;
+  }
+  if (auto emitter = m_emitters.find(entityId)) {
+    return *emitter;
+  }
+  EXCEPTION("Entity " << entityId << " has no render component");
 }
 
 RenderItemId RenderSystemImpl::addTexture(TexturePtr texture)
@@ -285,16 +352,16 @@ void RenderSystemImpl::removeAnimations(RenderItemId id)
 
 void RenderSystemImpl::playAnimation(EntityId entityId, const std::string& name)
 {
-  auto& component = *m_components.at(entityId);
-  DBG_ASSERT(component.type == CRenderType::Model, "Can only play animation on models");
-  auto& model = dynamic_cast<const CRenderModel&>(component);
+  ASSERT(m_models.contains(entityId), "Can only play animation on models");
+  auto& model = m_models.get(entityId);
 
-  m_animationStates[entityId] = AnimationState{
+  m_animationStates.remove(entityId);
+  m_animationStates.add(entityId, AnimationState{
     .animationSet = model.animations,
     .animationName = name,
     .timer{},
     .channels{}
-  };
+  });
 }
 
 Camera& RenderSystemImpl::camera()
@@ -307,97 +374,145 @@ const Camera& RenderSystemImpl::camera() const
   return m_camera;
 }
 
-void RenderSystemImpl::drawEntities(const std::unordered_set<EntityId>& entities,
-  const std::function<bool(const Submodel&)>& filter)
+void RenderSystemImpl::setInterpolation(float_t alpha)
 {
-  for (EntityId id : entities) {
-    auto entry = m_components.find(id);
-    if (entry == m_components.end()) {
-      continue;
-    }
+  m_alpha = clip(alpha, 0.f, 1.f);
+}
 
-    auto& component = *entry->second;
-    const auto& spatial = m_spatialSystem.getComponent(id);
-
-    switch(component.type) {
-      case CRenderType::Model: {
-        auto& model = dynamic_cast<CRenderModel&>(component);
-        for (auto& submodel : model.submodels) {
-          if (filter(submodel)) {
-            if (model.isInstanced) {
-              m_renderer.drawInstance(submodel.mesh, submodel.material, spatial.absTransform());
-            }
-            else {
-              if (submodel.jointTransformsDirty) {
-                m_renderer.drawModel(submodel.mesh, submodel.material,
-                  spatial.absTransform() * submodel.mesh.transform, submodel.jointTransforms);
-                submodel.jointTransformsDirty = false;
-              }
-              else {
-                m_renderer.drawModel(submodel.mesh, submodel.material,
-                  spatial.absTransform() * submodel.mesh.transform);
-              }
-            }
-          }
-        }
-        break;
+template<typename F>
+void RenderSystemImpl::drawModels(const std::vector<VisibleModel>& models, F&& filter)
+{
+  for (auto& entry : models) {
+    auto& model = *entry.model;
+    const auto& transform = *entry.transform;
+
+    for (auto& submodel : model.submodels) {
+      if (!filter(submodel)) {
+        continue;
       }
-      case CRenderType::Skybox: {
-        auto& skybox = dynamic_cast<const CRenderSkybox&>(component);
-        if (filter(skybox.model)) {
-          m_renderer.drawSkybox(skybox.model.mesh, skybox.model.material);
-        }
-        break;
+      if (model.isInstanced) {
+        m_renderer.drawInstance(submodel.mesh, submodel.material, transform);
+      }
+      else if (submodel.jointTransformsDirty) {
+        m_renderer.drawModel(submodel.mesh, submodel.material,
+          transform * submodel.mesh.transform, submodel.jointTransforms);
+        submodel.jointTransformsDirty = false;
+      }
+      else {
+        m_renderer.drawModel(submodel.mesh, submodel.material, transform * submodel.mesh.transform);
       }
-      case CRenderType::Light: break;
     }
   }
 }
 
-void RenderSystemImpl::doShadowPass()
+template<typename F>
+void RenderSystemImpl::drawSkyboxes(const std::vector<const CRenderSkybox*>& skyboxes, F&& filter)
+{
+  for (auto skybox : skyboxes) {
+    if (filter(skybox->model)) {
+      m_renderer.drawSkybox(skybox->model.mesh, skybox->model.material);
+    }
+  }
+}
+
+// Culls the shadow and main views together, with one pass over the spatial index
+void RenderSystemImpl::computeVisibility()
 {
-  // TODO: Separate pass for every shadow-casting light
-  const CRenderLight& firstLight =
-    dynamic_cast<const CRenderLight&>(*m_components.at(*m_lights.begin()));
+  m_frameCamera = m_camera.interpolated(m_alpha);
+
+  // TODO: Separate view for every shadow-casting light
+  ASSERT(!m_lights.empty(), "Scene has no lights");
+  const CRenderLight& firstLight = *m_lights.begin();
   const CSpatial& firstLightSpatial = m_spatialSystem.getComponent(firstLight.id());
-  auto firstLightTransform = firstLightSpatial.absTransform();
-  auto firstLightPos = getTranslation(firstLightTransform);
+  auto firstLightTransform = firstLightSpatial.interpolatedTransform(m_alpha);
   auto firstLightDir = getDirection(firstLightTransform);
-  auto firstLightMatrix = lookAt(firstLightPos, firstLightPos + firstLightDir);
+  m_shadowViewPos = getTranslation(firstLightTransform);
+  m_shadowViewMatrix = lookAt(m_shadowViewPos, m_shadowViewPos + firstLightDir);
+
+  auto& shadowView = m_views[SHADOW_VIEW];
+  computeOrthographicFrustumPerimeter(m_shadowViewPos, firstLightDir, degreesToRadians(90.f),
+    firstLight.zFar, shadowView.footprint);
+  shadowView.frustum = computeFrustum(orthographic(PIf / 2.f, PIf / 2.f, 0.f, firstLight.zFar) *
+    m_shadowViewMatrix);
+
+  auto& params = m_renderer.getViewParams();
+  auto& mainView = m_views[MAIN_VIEW];
+  computePerspectiveFrustumPerimeter(m_frameCamera.getPosition(), m_frameCamera.getDirection(),
+    params.hFov, mainView.footprint);
+  mainView.frustum = computeFrustum(perspective(params.hFov, params.vFov, params.nearPlane,
+    params.farPlane) * m_frameCamera.getMatrix());
+
+  m_spatialSystem.getIntersecting(m_views, m_visible, m_viewMasks, m_viewStats);
+
+  // Sort the visible entities by view and by type, so each pass draws one type at a time
+  for (size_t v = 0; v < NUM_VIEWS; ++v) {
+    m_viewModels[v].clear();
+    m_viewSkyboxes[v].clear();
+  }
+  // Reserved up front, as the views point into it
+  m_interpolated.clear();
+  m_interpolated.reserve(m_visible.size());
+
+  for (size_t i = 0; i < m_visible.size(); ++i) {
+    EntityId id = m_visible[i];
+    uint32_t mask = m_viewMasks[i];
+
+    if (CRenderModel* model = m_models.find(id)) {
+      const CSpatial& spatial = m_spatialSystem.getComponent(id);
+      const Mat4x4f* transform = &spatial.absTransform();
+      if (m_alpha < 1.f && spatial.movedInLastUpdate()) {
+        m_interpolated.push_back(spatial.interpolatedTransform(m_alpha));
+        transform = &m_interpolated.back();
+      }
+      for (size_t v = 0; v < NUM_VIEWS; ++v) {
+        if (mask & (1u << v)) {
+          m_viewModels[v].push_back(VisibleModel{ model, transform });
+        }
+      }
+    }
+    else if (const CRenderSkybox* skybox = m_skyboxes.find(id)) {
+      for (size_t v = 0; v < NUM_VIEWS; ++v) {
+        if (mask & (1u << v)) {
+          m_viewSkyboxes[v].push_back(skybox);
+        }
+      }
+    }
+  }
 
-  auto frustum = computeOrthographicFrustumPerimeter(firstLightPos, firstLightDir,
-    degreesToRadians(90.f), firstLight.zFar);
-  auto visible = m_spatialSystem.getIntersecting(frustum);
+  m_stats.shadowPass = m_viewStats[SHADOW_VIEW];
+  m_stats.mainPass = m_viewStats[MAIN_VIEW];
+}
 
-  m_renderer.beginPass(RenderPass::Shadow, firstLightPos, firstLightMatrix);
+void RenderSystemImpl::doShadowPass()
+{
+  m_renderer.beginPass(RenderPass::Shadow, m_shadowViewPos, m_shadowViewMatrix);
 
-  drawEntities(visible, [](const Submodel& x) {
+  auto castsShadow = [](const Submodel& x) {
     return x.mesh.features.flags.test(MeshFeatures::CastsShadow);
-  });
+  };
+  drawModels(m_viewModels[SHADOW_VIEW], castsShadow);
+  drawSkyboxes(m_viewSkyboxes[SHADOW_VIEW], castsShadow);
 
   m_renderer.endPass();
 }
 
 void RenderSystemImpl::doMainPass()
 {
-  auto frustum = computePerspectiveFrustumPerimeter(m_camera.getPosition(), m_camera.getDirection(),
-    m_renderer.getViewParams().hFov);
-  auto visible = m_spatialSystem.getIntersecting(frustum);
-
-  m_renderer.beginPass(RenderPass::Main, m_camera.getPosition(), m_camera.getMatrix());
+  m_renderer.beginPass(RenderPass::Main, m_frameCamera.getPosition(),
+    m_frameCamera.getMatrix());
 
-  drawEntities(visible);
+  auto all = [](const Submodel&) { return true; };
+  drawModels(m_viewModels[MAIN_VIEW], all);
+  drawSkyboxes(m_viewSkyboxes[MAIN_VIEW], all);
 
-  for (EntityId id : m_lights) {
-    const CRenderLight& light = dynamic_cast<const CRenderLight&>(*m_components.at(id));
-    const auto& spatial = m_spatialSystem.getComponent(id);
-    const auto& transform = spatial.absTransform();
+  for (const CRenderLight& light : m_lights) {
+    auto transform = m_spatialSystem.getComponent(light.id()).interpolatedTransform(m_alpha);
 
     m_renderer.drawLight(light.colour, light.ambient, light.specular, light.zFar, transform);
 
     if (light.submodels.size() > 0) {
       for (auto& submodel : light.submodels) {
-        m_renderer.drawModel(submodel.mesh, submodel.material, spatial.absTransform());
+        m_renderer.drawModel(submodel.mesh, submodel.material, transform);
       }
     }
   }
@@ -566,14 +681,13 @@ std::vector<Mat4x4f> computeJointTransforms(const Skeleton& skeleton, const Skin
   return finalTransforms;
 }
 
+// Walks the pool backwards, so removing a finished animation only moves one that's been done already
 void RenderSystemImpl::updateAnimations()
 {
-  for (auto i = m_animationStates.begin(); i != m_animationStates.end();) {
-    auto& component = *m_components.at(i->first);
-    DBG_ASSERT(component.type == CRenderType::Model, "Can only play animation on models");
-
-    auto& model = dynamic_cast<CRenderModel&>(component);
-    auto& state = i->second;
+  for (size_t i = m_animationStates.size(); i-- > 0;) {
+    EntityId id = m_animationStates.ids()[i];
+    auto& model = m_models.get(id);
+    auto& state = *(m_animationStates.begin() + i);
     auto& animationSet = *m_animationSets.at(state.animationSet);
     auto& animation = *animationSet.animations.at(state.animationName); // TODO: Slow?
 
@@ -584,20 +698,14 @@ void RenderSystemImpl::updateAnimations()
     }
 
     if (state.finished()) {
-      i = m_animationStates.erase(i++);
-    }
-    else {
-      ++i;
+      m_animationStates.remove(id);
     }
   }
 }
 
-// TODO: Hot path. Optimise
-void RenderSystemImpl::update()
+void RenderSystemImpl::draw()
 {
   try {
-    updateAnimations();
-
     m_renderer.beginFrame();
 
     doShadowPass();
@@ -611,6 +719,14 @@ void RenderSystemImpl::update()
   }
 }
 
+// TODO: Hot path. Optimise
+void RenderSystemImpl::update()
+{
+  updateAnimations();
+  computeVisibility();
+  draw();
+}
+
 } // namespace
 
 RenderSystemPtr createRenderSystem(const SpatialSystem& spatialSystem, Renderer& renderer,
@@ -3,6 +3,7 @@
 #include "math.hpp"
 #include "system.hpp"
 #include "renderables.hpp"
+#include "frustum.hpp"
 #include <set>
 #include <map>
 
@@ -148,6 +149,12 @@ struct CRenderParticleEmitter : public CRender
 
 using CRenderParticleEmitterPtr = std::unique_ptr<CRenderParticleEmitter>;
 
+struct RenderStats
+{
+  CullingStats shadowPass;
+  CullingStats mainPass;
+};
+
 class Camera;
 
 class RenderSystem : public System
@@ -155,10 +162,27 @@ class RenderSystem : public System
   public:
     virtual void start() = 0;
     virtual double frameRate() const = 0;
+    // From the most recent frame
+    virtual const RenderStats& stats() const = 0;
 
     virtual Camera& camera() = 0;
     virtual const Camera& camera() const = 0;
 
+    // How far the next frame is between the last two simulation steps, from 0 to 1. Transforms and
+    // the camera are blended accordingly when drawing. Defaults to 1, the latest state
+    virtual void setInterpolation(float_t alpha) = 0;
+
+    // update() does these three in turn. They're separate so that a scheduler can run the first two
+    // on other threads, alongside other systems' work
+    //
+    // Advances playing animations and re-poses their models
+    virtual void updateAnimations() = 0;
+    // Culls against the interpolated camera and lights. Reads the spatial system, so it mustn't
+    // overlap with its update
+    virtual void computeVisibility() = 0;
+    // Submits the visible entities to the renderer, on the thread that owns it
+    virtual void draw() = 0;
+
     CRender& getComponent(EntityId entityId) override = 0;
     const CRender& getComponent(EntityId entityId) const override = 0;
 
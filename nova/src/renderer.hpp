@@ -81,5 +81,7 @@ class FileSystem;
 class WindowDelegate;
 class Logger;
 
+// With vsync, frames are presented once per display refresh, and drawing blocks until there's an
+// image free. Without, the renderer draws as fast as it can, and never tears if the display allows
 render::RendererPtr createRenderer(const FileSystem& fileSystem, WindowDelegate& window,
-  Logger& logger);
+  Logger& logger, bool vsync);
@@ -87,6 +87,7 @@ PlayerPtr SceneBuilder::createScene()
 
   m_logger.info(STR("Map boundary: (" << bounds.first << ") to (" << bounds.second << ")"));
 
+  m_spatialSystem.initialise(bounds.first, bounds.second);
   m_collisionSystem.initialise(bounds.first, bounds.second);
 
   constructInstances(objectData);
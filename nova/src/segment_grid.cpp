@@ -0,0 +1,301 @@
+#include "segment_grid.hpp"
+#include "exception.hpp"
+#include <algorithm>
+#include <bit>
+#include <functional>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define NOVA_SEGMENT_GRID_SSE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define NOVA_SEGMENT_GRID_NEON
+#endif
+
+namespace
+{
+
+// Calls visit(size_t i) for each of the first n segments that comes within radius of pos
+template<typename F>
+void forEachNearSegment(const float_t* ax, const float_t* ay, const float_t* bx,
+  const float_t* by, const float_t* invLengthSq, size_t n, const Vec2f& pos, float_t radius,
+  F&& visit)
+{
+  float_t radiusSq = radius * radius;
+  size_t i = 0;
+
+#if defined(NOVA_SEGMENT_GRID_SSE)
+  const __m128 px = _mm_set1_ps(pos[0]);
+  const __m128 py = _mm_set1_ps(pos[1]);
+  const __m128 r2 = _mm_set1_ps(radiusSq);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.f);
+
+  for (; i + 4 <= n; i += 4) {
+    __m128 x0 = _mm_loadu_ps(ax + i);
+    __m128 y0 = _mm_loadu_ps(ay + i);
+    __m128 dx = _mm_sub_ps(_mm_loadu_ps(bx + i), x0);
+    __m128 dy = _mm_sub_ps(_mm_loadu_ps(by + i), y0);
+    __m128 wx = _mm_sub_ps(px, x0);
+    __m128 wy = _mm_sub_ps(py, y0);
+
+    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(wx, dx), _mm_mul_ps(wy, dy)),
+      _mm_loadu_ps(invLengthSq + i));
+    t = _mm_min_ps(_mm_max_ps(t, zero), one);
+
+    __m128 ex = _mm_sub_ps(wx, _mm_mul_ps(t, dx));
+    __m128 ey = _mm_sub_ps(wy, _mm_mul_ps(t, dy));
+    __m128 distSq = _mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey));
+
+    unsigned mask = static_cast<unsigned>(_mm_movemask_ps(_mm_cmple_ps(distSq, r2)));
+    while (mask != 0) {
+      visit(i + std::countr_zero(mask));
+      mask &= mask - 1;
+    }
+  }
+#elif defined(NOVA_SEGMENT_GRID_NEON)
+  const float32x4_t px = vdupq_n_f32(pos[0]);
+  const float32x4_t py = vdupq_n_f32(pos[1]);
+  const float32x4_t r2 = vdupq_n_f32(radiusSq);
+  const float32x4_t zero = vdupq_n_f32(0.f);
+  const float32x4_t one = vdupq_n_f32(1.f);
+
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t x0 = vld1q_f32(ax + i);
+    float32x4_t y0 = vld1q_f32(ay + i);
+    float32x4_t dx = vsubq_f32(vld1q_f32(bx + i), x0);
+    float32x4_t dy = vsubq_f32(vld1q_f32(by + i), y0);
+    float32x4_t wx = vsubq_f32(px, x0);
+    float32x4_t wy = vsubq_f32(py, y0);
+
+    float32x4_t t = vmulq_f32(vaddq_f32(vmulq_f32(wx, dx), vmulq_f32(wy, dy)),
+      vld1q_f32(invLengthSq + i));
+    t = vminq_f32(vmaxq_f32(t, zero), one);
+
+    float32x4_t ex = vsubq_f32(wx, vmulq_f32(t, dx));
+    float32x4_t ey = vsubq_f32(wy, vmulq_f32(t, dy));
+    float32x4_t distSq = vaddq_f32(vmulq_f32(ex, ex), vmulq_f32(ey, ey));
+
+    uint32x4_t near = vcleq_f32(distSq, r2);
+    if (vgetq_lane_u32(near, 0)) visit(i);
+    if (vgetq_lane_u32(near, 1)) visit(i + 1);
+    if (vgetq_lane_u32(near, 2)) visit(i + 2);
+    if (vgetq_lane_u32(near, 3)) visit(i + 3);
+  }
+#endif
+
+  for (; i < n; ++i) {
+    float_t dx = bx[i] - ax[i];
+    float_t dy = by[i] - ay[i];
+    float_t wx = pos[0] - ax[i];
+    float_t wy = pos[1] - ay[i];
+
+    float_t t = clip((wx * dx + wy * dy) * invLengthSq[i], 0.f, 1.f);
+
+    float_t ex = wx - t * dx;
+    float_t ey = wy - t * dy;
+    if (ex * ex + ey * ey <= radiusSq) {
+      visit(i);
+    }
+  }
+}
+
+} // namespace
+
+SegmentGrid::SegmentGrid(const Vec2f& worldMin, const Vec2f& worldMax, size_t gridW,
+  size_t gridH)
+  : m_worldMin(worldMin)
+  , m_cellSize{ (worldMax[0] - worldMin[0]) / gridW, (worldMax[1] - worldMin[1]) / gridH }
+  , m_gridW(static_cast<int>(gridW))
+  , m_gridH(static_cast<int>(gridH))
+  , m_cells(gridW * gridH)
+{
+}
+
+size_t SegmentGrid::numSegments() const
+{
+  return m_segmentCells.size() - m_freeIds.size();
+}
+
+uint32_t SegmentGrid::cellIndex(const Vec2f& pos) const
+{
+  int i = clip(column(pos[0]), 0, m_gridW - 1);
+  int j = clip(row(pos[1]), 0, m_gridH - 1);
+  return static_cast<uint32_t>(j * m_gridW + i);
+}
+
+int SegmentGrid::column(float_t x) const
+{
+  return static_cast<int>(floor((x - m_worldMin[0]) / m_cellSize[0]));
+}
+
+int SegmentGrid::row(float_t y) const
+{
+  return static_cast<int>(floor((y - m_worldMin[1]) / m_cellSize[1]));
+}
+
+// Moves the scratch on to a new generation, making room for segments added since it was last used
+void SegmentGrid::beginQuery(QueryScratch& scratch) const
+{
+  scratch.stamps.resize(m_segmentCells.size(), 0);
+
+  if (++scratch.generation == 0) {
+    std::fill(scratch.stamps.begin(), scratch.stamps.end(), 0);
+    scratch.generation = 1;
+  }
+}
+
+// Inserts the segment into each cell it passes through, working out the part of the segment within
+// each row of cells it spans
+uint32_t SegmentGrid::addSegment(const LineSegment& lseg, float_t height)
+{
+  uint32_t id;
+  if (m_freeIds.empty()) {
+    id = static_cast<uint32_t>(m_segmentCells.size());
+    m_segmentCells.emplace_back();
+  }
+  else {
+    id = m_freeIds.back();
+    m_freeIds.pop_back();
+  }
+
+  auto& segmentCells = m_segmentCells[id];
+  segmentCells.clear();
+
+  const Vec2f& A = lseg.A;
+  const Vec2f& B = lseg.B;
+
+  int firstRow = std::max(0, row(std::min(A[1], B[1])));
+  int lastRow = std::min(m_gridH - 1, row(std::max(A[1], B[1])));
+
+  for (int j = firstRow; j <= lastRow; ++j) {
+    float_t x0 = A[0];
+    float_t x1 = B[0];
+
+    if (A[1] != B[1]) {
+      float_t y0 = m_worldMin[1] + static_cast<float_t>(j) * m_cellSize[1];
+      float_t y1 = y0 + m_cellSize[1];
+      float_t t0 = clip((y0 - A[1]) / (B[1] - A[1]), 0.f, 1.f);
+      float_t t1 = clip((y1 - A[1]) / (B[1] - A[1]), 0.f, 1.f);
+      x0 = A[0] + t0 * (B[0] - A[0]);
+      x1 = A[0] + t1 * (B[0] - A[0]);
+    }
+
+    int first = std::max(0, column(std::min(x0, x1)));
+    int last = std::min(m_gridW - 1, column(std::max(x0, x1)));
+
+    for (int i = first; i <= last; ++i) {
+      uint32_t cellIndex = static_cast<uint32_t>(j * m_gridW + i);
+      insertIntoCell(m_cells[cellIndex], lseg, height, id);
+      segmentCells.push_back(cellIndex);
+    }
+  }
+
+  return id;
+}
+
+void SegmentGrid::removeSegment(uint32_t id)
+{
+  ASSERT(id < m_segmentCells.size(), "No segment with id " << id);
+
+  for (uint32_t cellIndex : m_segmentCells[id]) {
+    eraseFromCell(m_cells[cellIndex], id);
+  }
+  m_segmentCells[id].clear();
+  m_freeIds.push_back(id);
+}
+
+void SegmentGrid::insertIntoCell(Cell& cell, const LineSegment& lseg, float_t height,
+  uint32_t id)
+{
+  // Keep the tallest first
+  size_t i = std::upper_bound(cell.height.begin(), cell.height.end(), height,
+    std::greater<float_t>{}) - cell.height.begin();
+
+  Vec2f D = lseg.B - lseg.A;
+  float_t lengthSq = D.dot(D);
+
+  cell.ax.insert(cell.ax.begin() + i, lseg.A[0]);
+  cell.ay.insert(cell.ay.begin() + i, lseg.A[1]);
+  cell.bx.insert(cell.bx.begin() + i, lseg.B[0]);
+  cell.by.insert(cell.by.begin() + i, lseg.B[1]);
+  cell.invLengthSq.insert(cell.invLengthSq.begin() + i, lengthSq > 0.f ? 1.f / lengthSq : 0.f);
+  cell.height.insert(cell.height.begin() + i, height);
+  cell.ids.insert(cell.ids.begin() + i, id);
+}
+
+void SegmentGrid::eraseFromCell(Cell& cell, uint32_t id)
+{
+  auto it = std::find(cell.ids.begin(), cell.ids.end(), id);
+  ASSERT(it != cell.ids.end(), "Segment " << id << " missing from cell");
+
+  auto i = it - cell.ids.begin();
+  cell.ax.erase(cell.ax.begin() + i);
+  cell.ay.erase(cell.ay.begin() + i);
+  cell.bx.erase(cell.bx.begin() + i);
+  cell.by.erase(cell.by.begin() + i);
+  cell.invLengthSq.erase(cell.invLengthSq.begin() + i);
+  cell.height.erase(cell.height.begin() + i);
+  cell.ids.erase(cell.ids.begin() + i);
+}
+
+void SegmentGrid::appendSegment(const Cell& cell, size_t i, QueryScratch& scratch,
+  std::vector<LineSegment>& segments) const
+{
+  uint32_t& stamp = scratch.stamps[cell.ids[i]];
+  if (stamp != scratch.generation) {
+    stamp = scratch.generation;
+    segments.push_back({ { cell.ax[i], cell.ay[i] }, { cell.bx[i], cell.by[i] } });
+  }
+}
+
+void SegmentGrid::getSegments(const Vec2f& pos, float_t radius, float_t minHeight,
+  std::vector<LineSegment>& segments) const
+{
+  getSegments(pos, radius, minHeight, segments, m_scratch);
+}
+
+void SegmentGrid::getSegments(const Vec2f& pos, float_t radius, float_t minHeight,
+  std::vector<LineSegment>& segments, QueryScratch& scratch) const
+{
+  beginQuery(scratch);
+
+  int firstCol = std::max(0, column(pos[0] - radius));
+  int lastCol = std::min(m_gridW - 1, column(pos[0] + radius));
+  int firstRow = std::max(0, row(pos[1] - radius));
+  int lastRow = std::min(m_gridH - 1, row(pos[1] + radius));
+
+  for (int j = firstRow; j <= lastRow; ++j) {
+    for (int i = firstCol; i <= lastCol; ++i) {
+      const Cell& cell = m_cells[j * m_gridW + i];
+      size_t n = std::partition_point(cell.height.begin(), cell.height.end(),
+        [minHeight](float_t h) { return h > minHeight; }) - cell.height.begin();
+
+      forEachNearSegment(cell.ax.data(), cell.ay.data(), cell.bx.data(), cell.by.data(),
+        cell.invLengthSq.data(), n, pos, radius, [&](size_t k) {
+
+        appendSegment(cell, k, scratch, segments);
+      });
+    }
+  }
+}
+
+void SegmentGrid::getSegments(const std::vector<Vec2f>& poly, float_t minHeight,
+  std::vector<LineSegment>& segments) const
+{
+  getSegments(poly, minHeight, segments, m_scratch);
+}
+
+void SegmentGrid::getSegments(const std::vector<Vec2f>& poly, float_t minHeight,
+  std::vector<LineSegment>& segments, QueryScratch& scratch) const
+{
+  beginQuery(scratch);
+
+  scratch.rasteriser.rasterise(poly, m_worldMin, m_cellSize, [&](int j, int first, int last) {
+    for (int i = std::max(first, 0); i <= std::min(last, m_gridW - 1); ++i) {
+      const Cell& cell = m_cells[j * m_gridW + i];
+      for (size_t k = 0; k < cell.height.size() && cell.height[k] > minHeight; ++k) {
+        appendSegment(cell, k, scratch, segments);
+      }
+    }
+  }, 0, m_gridH - 1);
+}
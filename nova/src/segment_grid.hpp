@@ -0,0 +1,78 @@
+#pragma once
+
+#include "math.hpp"
+#include "polygon_rasteriser.hpp"
+#include <vector>
+#include <cstdint>
+
+// Wall segments binned into a regular grid, for the collision system's narrowphase. Each cell keeps
+// its segments in packed arrays, one per coordinate, sorted by height with the tallest first. A
+// query for a mover that can step over walls up to some height then only visits the prefix of each
+// cell that blocks it, and the distance test runs over several segments at a time using SIMD, where
+// available.
+//
+// Segments spanning several cells are deduplicated by stamping them with the current query
+// generation. The stamps live in a QueryScratch, so threads may query a grid concurrently as long
+// as each passes its own. The overloads without one share the grid's, and aren't thread safe.
+//
+// Each segment remembers the cells it was inserted into, so removing it only touches those cells.
+// Ids of removed segments are reused.
+class SegmentGrid
+{
+  public:
+    struct QueryScratch
+    {
+      std::vector<uint32_t> stamps;  // Per segment
+      uint32_t generation = 0;
+      PolygonRasteriser rasteriser;
+    };
+
+    SegmentGrid(const Vec2f& worldMin, const Vec2f& worldMax, size_t gridW, size_t gridH);
+
+    uint32_t addSegment(const LineSegment& lseg, float_t height);
+    void removeSegment(uint32_t id);
+    size_t numSegments() const;
+    // Index of the cell containing pos, clamped to the grid. Useful for ordering queries so that
+    // neighbouring ones touch the same memory
+    uint32_t cellIndex(const Vec2f& pos) const;
+
+    // Append each distinct segment taller than minHeight that comes within radius of pos
+    void getSegments(const Vec2f& pos, float_t radius, float_t minHeight,
+      std::vector<LineSegment>& segments) const;
+    void getSegments(const Vec2f& pos, float_t radius, float_t minHeight,
+      std::vector<LineSegment>& segments, QueryScratch& scratch) const;
+    // Append each distinct segment taller than minHeight in any cell the polygon overlaps
+    void getSegments(const std::vector<Vec2f>& poly, float_t minHeight,
+      std::vector<LineSegment>& segments) const;
+    void getSegments(const std::vector<Vec2f>& poly, float_t minHeight,
+      std::vector<LineSegment>& segments, QueryScratch& scratch) const;
+
+  private:
+    struct Cell
+    {
+      std::vector<float_t> ax;
+      std::vector<float_t> ay;
+      std::vector<float_t> bx;
+      std::vector<float_t> by;
+      std::vector<float_t> invLengthSq; // Zero for degenerate segments
+      std::vector<float_t> height;
+      std::vector<uint32_t> ids;
+    };
+
+    Vec2f m_worldMin;
+    Vec2f m_cellSize;
+    int m_gridW;
+    int m_gridH;
+    std::vector<Cell> m_cells;
+    std::vector<std::vector<uint32_t>> m_segmentCells;  // Indexed by segment id
+    std::vector<uint32_t> m_freeIds;
+    mutable QueryScratch m_scratch;
+
+    void insertIntoCell(Cell& cell, const LineSegment& lseg, float_t height, uint32_t id);
+    void eraseFromCell(Cell& cell, uint32_t id);
+    int column(float_t x) const;
+    int row(float_t y) const;
+    void beginQuery(QueryScratch& scratch) const;
+    void appendSegment(const Cell& cell, size_t i, QueryScratch& scratch,
+      std::vector<LineSegment>& segments) const;
+};
@@ -0,0 +1,844 @@
+#pragma once
+
+#include "math.hpp"
+#include "polygon_rasteriser.hpp"
+#include <unordered_set>
+#include <unordered_map>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <cmath>
+#include <algorithm>
+
+// Unbounded grid of square cells, where only occupied cells are stored. Cells are found by hashing
+// their coordinates, so memory is proportional to the number of occupied cells rather than the
+// size of the world. Items are deduplicated the same way as in Grid, so the same threading
+// restrictions apply.
+//
+// Items that would cover more than MAX_ITEM_CELLS cells (e.g. the skybox) aren't binned. They're
+// kept in a separate list and returned by every query.
+template<typename T>
+class SparseGrid
+{
+  public:
+    static constexpr int64_t MAX_ITEM_CELLS = 1024;
+
+    explicit SparseGrid(float_t cellSize);
+
+    float_t cellSize() const;
+    // Re-bins every item
+    void setCellSize(float_t cellSize);
+
+    void addItemByRadius(const Vec2f& pos, float_t radius, const T& item);
+    // Only cells the item enters or leaves are touched
+    void moveItemByRadius(const Vec2f& pos, float_t radius, const T& item);
+    void removeItem(const T& item);
+    bool hasItem(const T& item) const;
+
+    size_t numItems() const;
+    size_t numOccupiedCells() const;
+    // Approximate heap usage in bytes, including hash table nodes
+    size_t memoryUsage() const;
+
+    // These allocate a new set on every call. Prefer the overloads below on hot paths
+    //
+    std::unordered_set<T> getItems(const Vec2f& pos, float_t radius) const;
+    std::unordered_set<T> getItems(const Vec2f& pos) const;
+    std::unordered_set<T> getItems(const std::vector<Vec2f>& poly) const;
+
+    // Clear the buffer and fill it with distinct items. Doesn't allocate once the buffer has grown
+    // large enough
+    //
+    void getItems(const Vec2f& pos, float_t radius, std::vector<T>& items) const;
+    void getItems(const Vec2f& pos, std::vector<T>& items) const;
+    void getItems(const std::vector<Vec2f>& poly, std::vector<T>& items) const;
+
+    // Call visitor(const T&) once for each distinct item
+    //
+    template<typename F>
+    void forEachItem(const Vec2f& pos, float_t radius, F&& visitor) const;
+    template<typename F>
+    void forEachItem(const Vec2f& pos, F&& visitor) const;
+    template<typename F>
+    void forEachItem(const std::vector<Vec2f>& poly, F&& visitor) const;
+
+    // Query several polygons in one pass. getPoly(i) should return the i'th of n polygons, where n
+    // is at most 32. Calls visitor(const T&, uint32_t mask) once for each distinct item in any of
+    // them, with bit i of mask set if the item is in polygon i
+    template<typename P, typename F>
+    void forEachItemInPolys(size_t n, P&& getPoly, F&& visitor) const;
+
+    // Walk the cells along the ray origin + t * dir, 0 <= t <= maxT, calling visitor(const T&)
+    // once for each distinct item whose circle the ray enters. Items are visited a cell at a time,
+    // so only roughly in order of t. The visitor returns the t beyond which it's no longer
+    // interested, so the walk can end early. maxT must be finite
+    template<typename F>
+    void forEachItemOnRay(const Vec2f& origin, const Vec2f& dir, float_t maxT,
+      F&& visitor) const;
+    // Search outwards from pos in rings of cells, calling visitor(const T&) once for each distinct
+    // item. The visitor returns the distance beyond which it's no longer interested, so the search
+    // can end early. Items further than that from pos aren't visited
+    template<typename F>
+    void forEachItemByDistance(const Vec2f& pos, F&& visitor) const;
+
+  private:
+    using ItemIndex = uint32_t;
+    using CellIndex = uint32_t;
+    using Cell = std::vector<ItemIndex>;
+
+    struct Item
+    {
+      T value;
+      Vec2f pos;
+      float_t radius;
+      bool oversized;
+      std::vector<CellIndex> cells;
+    };
+
+    struct Span
+    {
+      int row;
+      int first;
+      int last;
+    };
+
+    // Inclusive range of cell coordinates
+    struct CellRange
+    {
+      Vec2i min;
+      Vec2i max;
+
+      int64_t size() const;
+      bool contains(const Vec2i& cell) const;
+    };
+
+    float_t m_cellSize;
+    std::vector<Cell> m_cells;            // Empty cells are unoccupied and may be reused
+    std::vector<Vec2i> m_cellCoords;
+    std::vector<uint32_t> m_cellStamps;
+    std::vector<CellIndex> m_freeCells;
+    std::unordered_map<uint64_t, CellIndex> m_cellIndices;
+    std::vector<Item> m_items;
+    std::vector<ItemIndex> m_freeItems;
+    std::unordered_map<T, ItemIndex> m_itemIndices;
+    std::vector<ItemIndex> m_oversized;
+    uint32_t m_cellGeneration = 0;
+    mutable std::vector<uint32_t> m_stamps;
+    mutable uint32_t m_generation = 0;
+    mutable PolygonRasteriser m_rasteriser;
+    mutable std::vector<Span> m_spans;
+    mutable std::vector<uint32_t> m_cellQueryStamps;
+    mutable std::vector<uint32_t> m_cellMasks;
+    mutable std::vector<uint32_t> m_itemMasks;
+    mutable std::vector<CellIndex> m_touchedCells;
+    mutable std::vector<ItemIndex> m_touchedItems;
+
+    static uint64_t cellKey(const Vec2i& cell);
+    Vec2i worldToGridCoords(const Vec2f& p) const;
+    CellRange cellsInRadius(const Vec2f& pos, float_t radius) const;
+    const Cell* findCell(const Vec2i& cell) const;
+    CellIndex findCellIndex(const Vec2i& cell) const;
+    CellIndex acquireCell(const Vec2i& cell);
+    void eraseFromCell(CellIndex cellIndex, ItemIndex index);
+    void clearItemCells(ItemIndex index);
+    void binItem(ItemIndex index);
+    ItemIndex internItem(const T& item);
+    uint32_t nextGeneration() const;
+    template<typename F>
+    void visitCell(const Cell& cell, uint32_t generation, F&& visitor) const;
+    template<typename F>
+    void visitOversized(F&& visitor) const;
+    bool spansContain(const Vec2i& cell) const;
+};
+
+template<typename T>
+int64_t SparseGrid<T>::CellRange::size() const
+{
+  return static_cast<int64_t>(max[0] - min[0] + 1) * static_cast<int64_t>(max[1] - min[1] + 1);
+}
+
+template<typename T>
+bool SparseGrid<T>::CellRange::contains(const Vec2i& cell) const
+{
+  return cell[0] >= min[0] && cell[0] <= max[0] && cell[1] >= min[1] && cell[1] <= max[1];
+}
+
+template<typename T>
+SparseGrid<T>::SparseGrid(float_t cellSize)
+  : m_cellSize(cellSize)
+{
+  ASSERT(cellSize > 0.f, "Cell size must be greater than 0");
+}
+
+template<typename T>
+float_t SparseGrid<T>::cellSize() const
+{
+  return m_cellSize;
+}
+
+template<typename T>
+void SparseGrid<T>::setCellSize(float_t cellSize)
+{
+  ASSERT(cellSize > 0.f, "Cell size must be greater than 0");
+
+  m_cellSize = cellSize;
+
+  m_cells.clear();
+  m_cellCoords.clear();
+  m_cellStamps.clear();
+  m_freeCells.clear();
+  m_cellIndices.clear();
+  m_oversized.clear();
+
+  for (auto& entry : m_itemIndices) {
+    m_items[entry.second].cells.clear();
+    binItem(entry.second);
+  }
+}
+
+template<typename T>
+size_t SparseGrid<T>::numItems() const
+{
+  return m_itemIndices.size();
+}
+
+template<typename T>
+size_t SparseGrid<T>::numOccupiedCells() const
+{
+  return m_cellIndices.size();
+}
+
+template<typename T>
+size_t SparseGrid<T>::memoryUsage() const
+{
+  // Assume each hash node holds its value and a next pointer
+  auto mapBytes = [](const auto& map) {
+    using Value = typename std::decay_t<decltype(map)>::value_type;
+    return map.bucket_count() * sizeof(void*) + map.size() * (sizeof(Value) + sizeof(void*));
+  };
+
+  size_t bytes = m_cells.capacity() * sizeof(Cell)
+    + m_cellCoords.capacity() * sizeof(Vec2i)
+    + m_cellStamps.capacity() * sizeof(uint32_t)
+    + m_freeCells.capacity() * sizeof(CellIndex)
+    + m_items.capacity() * sizeof(Item)
+    + m_freeItems.capacity() * sizeof(ItemIndex)
+    + m_oversized.capacity() * sizeof(ItemIndex)
+    + m_stamps.capacity() * sizeof(uint32_t)
+    + mapBytes(m_cellIndices)
+    + mapBytes(m_itemIndices);
+
+  for (const Cell& cell : m_cells) {
+    bytes += cell.capacity() * sizeof(ItemIndex);
+  }
+  for (const Item& item : m_items) {
+    bytes += item.cells.capacity() * sizeof(CellIndex);
+  }
+
+  return bytes;
+}
+
+template<typename T>
+uint64_t SparseGrid<T>::cellKey(const Vec2i& cell)
+{
+  return static_cast<uint64_t>(static_cast<uint32_t>(cell[0])) << 32 |
+    static_cast<uint64_t>(static_cast<uint32_t>(cell[1]));
+}
+
+template<typename T>
+Vec2i SparseGrid<T>::worldToGridCoords(const Vec2f& p) const
+{
+  return {
+    static_cast<int>(floor(p[0] / m_cellSize)),
+    static_cast<int>(floor(p[1] / m_cellSize))
+  };
+}
+
+template<typename T>
+typename SparseGrid<T>::CellRange SparseGrid<T>::cellsInRadius(const Vec2f& pos,
+  float_t radius) const
+{
+  return CellRange{
+    worldToGridCoords(Vec2f{ pos[0] - radius, pos[1] - radius }),
+    worldToGridCoords(Vec2f{ pos[0] + radius, pos[1] + radius })
+  };
+}
+
+template<typename T>
+typename SparseGrid<T>::CellIndex SparseGrid<T>::findCellIndex(const Vec2i& cell) const
+{
+  auto i = m_cellIndices.find(cellKey(cell));
+  return i == m_cellIndices.end() ? std::numeric_limits<CellIndex>::max() : i->second;
+}
+
+template<typename T>
+const typename SparseGrid<T>::Cell* SparseGrid<T>::findCell(const Vec2i& cell) const
+{
+  CellIndex c = findCellIndex(cell);
+  return c == std::numeric_limits<CellIndex>::max() ? nullptr : &m_cells[c];
+}
+
+template<typename T>
+typename SparseGrid<T>::CellIndex SparseGrid<T>::acquireCell(const Vec2i& cell)
+{
+  auto entry = m_cellIndices.find(cellKey(cell));
+  if (entry != m_cellIndices.end()) {
+    return entry->second;
+  }
+
+  CellIndex c;
+  if (!m_freeCells.empty()) {
+    c = m_freeCells.back();
+    m_freeCells.pop_back();
+    m_cellCoords[c] = cell;
+  }
+  else {
+    c = static_cast<CellIndex>(m_cells.size());
+    m_cells.emplace_back();
+    m_cellCoords.push_back(cell);
+    m_cellStamps.push_back(0);
+  }
+  m_cellIndices.insert({ cellKey(cell), c });
+
+  return c;
+}
+
+template<typename T>
+void SparseGrid<T>::eraseFromCell(CellIndex cellIndex, ItemIndex index)
+{
+  auto& list = m_cells[cellIndex];
+  auto i = std::find(list.begin(), list.end(), index);
+  assert(i != list.end());
+  *i = list.back();
+  list.pop_back();
+
+  if (list.empty()) {
+    m_cellIndices.erase(cellKey(m_cellCoords[cellIndex]));
+    m_freeCells.push_back(cellIndex);
+  }
+}
+
+template<typename T>
+void SparseGrid<T>::clearItemCells(ItemIndex index)
+{
+  auto& item = m_items[index];
+
+  if (item.oversized) {
+    auto i = std::find(m_oversized.begin(), m_oversized.end(), index);
+    assert(i != m_oversized.end());
+    *i = m_oversized.back();
+    m_oversized.pop_back();
+    item.oversized = false;
+  }
+
+  for (CellIndex c : item.cells) {
+    eraseFromCell(c, index);
+  }
+  item.cells.clear();
+}
+
+// Bins an item that currently occupies no cells
+template<typename T>
+void SparseGrid<T>::binItem(ItemIndex index)
+{
+  auto& item = m_items[index];
+  CellRange range = cellsInRadius(item.pos, item.radius);
+
+  if (range.size() > MAX_ITEM_CELLS) {
+    item.oversized = true;
+    m_oversized.push_back(index);
+    return;
+  }
+
+  item.oversized = false;
+  for (int i = range.min[0]; i <= range.max[0]; ++i) {
+    for (int j = range.min[1]; j <= range.max[1]; ++j) {
+      CellIndex c = acquireCell(Vec2i{ i, j });
+      m_cells[c].push_back(index);
+      item.cells.push_back(c);
+    }
+  }
+}
+
+template<typename T>
+typename SparseGrid<T>::ItemIndex SparseGrid<T>::internItem(const T& item)
+{
+  auto i = m_itemIndices.find(item);
+  if (i != m_itemIndices.end()) {
+    return i->second;
+  }
+
+  ItemIndex index;
+  if (!m_freeItems.empty()) {
+    index = m_freeItems.back();
+    m_freeItems.pop_back();
+    m_items[index].value = item;
+  }
+  else {
+    index = static_cast<ItemIndex>(m_items.size());
+    m_items.push_back(Item{ item, Vec2f{}, 0.f, false, {} });
+    m_stamps.push_back(0);
+  }
+  m_itemIndices.insert({ item, index });
+
+  return index;
+}
+
+template<typename T>
+void SparseGrid<T>::addItemByRadius(const Vec2f& pos, float_t radius, const T& item)
+{
+  ItemIndex index = internItem(item);
+  clearItemCells(index);
+
+  m_items[index].pos = pos;
+  m_items[index].radius = radius;
+  binItem(index);
+}
+
+template<typename T>
+void SparseGrid<T>::moveItemByRadius(const Vec2f& pos, float_t radius, const T& item)
+{
+  auto entry = m_itemIndices.find(item);
+  if (entry == m_itemIndices.end()) {
+    addItemByRadius(pos, radius, item);
+    return;
+  }
+
+  ItemIndex index = entry->second;
+  auto& data = m_items[index];
+  CellRange range = cellsInRadius(pos, radius);
+
+  data.pos = pos;
+  data.radius = radius;
+
+  if (data.oversized || range.size() > MAX_ITEM_CELLS) {
+    clearItemCells(index);
+    binItem(index);
+    return;
+  }
+
+  if (++m_cellGeneration == 0) {
+    std::fill(m_cellStamps.begin(), m_cellStamps.end(), 0);
+    m_cellGeneration = 1;
+  }
+
+  // Leave cells outside the new range, and stamp the ones we stay in
+  for (size_t k = 0; k < data.cells.size();) {
+    CellIndex c = data.cells[k];
+
+    if (!range.contains(m_cellCoords[c])) {
+      eraseFromCell(c, index);
+      data.cells[k] = data.cells.back();
+      data.cells.pop_back();
+    }
+    else {
+      m_cellStamps[c] = m_cellGeneration;
+      ++k;
+    }
+  }
+
+  // Enter the cells we weren't already in
+  for (int i = range.min[0]; i <= range.max[0]; ++i) {
+    for (int j = range.min[1]; j <= range.max[1]; ++j) {
+      CellIndex c = acquireCell(Vec2i{ i, j });
+      if (m_cellStamps[c] != m_cellGeneration) {
+        m_cells[c].push_back(index);
+        data.cells.push_back(c);
+      }
+    }
+  }
+}
+
+template<typename T>
+void SparseGrid<T>::removeItem(const T& item)
+{
+  auto entry = m_itemIndices.find(item);
+  if (entry == m_itemIndices.end()) {
+    return;
+  }
+
+  ItemIndex index = entry->second;
+  clearItemCells(index);
+  m_items[index].value = T{};
+  m_freeItems.push_back(index);
+  m_itemIndices.erase(entry);
+}
+
+template<typename T>
+bool SparseGrid<T>::hasItem(const T& item) const
+{
+  return m_itemIndices.contains(item);
+}
+
+template<typename T>
+uint32_t SparseGrid<T>::nextGeneration() const
+{
+  if (++m_generation == 0) {
+    std::fill(m_stamps.begin(), m_stamps.end(), 0);
+    std::fill(m_cellQueryStamps.begin(), m_cellQueryStamps.end(), 0);
+    m_generation = 1;
+  }
+  return m_generation;
+}
+
+template<typename T>
+template<typename F>
+void SparseGrid<T>::visitCell(const Cell& cell, uint32_t generation, F&& visitor) const
+{
+  for (ItemIndex index : cell) {
+    if (m_stamps[index] != generation) {
+      m_stamps[index] = generation;
+      visitor(m_items[index].value);
+    }
+  }
+}
+
+// Oversized items are never in a cell, so they don't need deduplicating
+template<typename T>
+template<typename F>
+void SparseGrid<T>::visitOversized(F&& visitor) const
+{
+  for (ItemIndex index : m_oversized) {
+    visitor(m_items[index].value);
+  }
+}
+
+template<typename T>
+template<typename F>
+void SparseGrid<T>::forEachItem(const Vec2f& pos, float_t radius, F&& visitor) const
+{
+  uint32_t generation = nextGeneration();
+  CellRange range = cellsInRadius(pos, radius);
+
+  // For very large queries it's cheaper to scan the occupied cells than to look up every cell in
+  // range
+  if (range.size() > static_cast<int64_t>(m_cellIndices.size())) {
+    for (CellIndex c = 0; c < m_cells.size(); ++c) {
+      if (!m_cells[c].empty() && range.contains(m_cellCoords[c])) {
+        visitCell(m_cells[c], generation, visitor);
+      }
+    }
+  }
+  else {
+    for (int i = range.min[0]; i <= range.max[0]; ++i) {
+      for (int j = range.min[1]; j <= range.max[1]; ++j) {
+        if (const Cell* cell = findCell(Vec2i{ i, j })) {
+          visitCell(*cell, generation, visitor);
+        }
+      }
+    }
+  }
+
+  visitOversized(visitor);
+}
+
+template<typename T>
+template<typename F>
+void SparseGrid<T>::forEachItem(const Vec2f& pos, F&& visitor) const
+{
+  // Items are never stored twice in the same cell, so no need to deduplicate
+  if (const Cell* cell = findCell(worldToGridCoords(pos))) {
+    for (ItemIndex index : *cell) {
+      visitor(m_items[index].value);
+    }
+  }
+
+  visitOversized(visitor);
+}
+
+template<typename T>
+template<typename F>
+void SparseGrid<T>::forEachItem(const std::vector<Vec2f>& poly, F&& visitor) const
+{
+  if (poly.size() == 0) {
+    return;
+  }
+
+  uint32_t generation = nextGeneration();
+
+  m_spans.clear();
+  int64_t numCovered = 0;
+  m_rasteriser.rasterise(poly, Vec2f{ 0.f, 0.f }, Vec2f{ m_cellSize, m_cellSize },
+    [&](int row, int first, int last) {
+      m_spans.push_back(Span{ row, first, last });
+      numCovered += last - first + 1;
+    });
+
+  // For very large queries it's cheaper to scan the occupied cells than to look up every cell
+  // covered
+  if (numCovered > static_cast<int64_t>(m_cellIndices.size())) {
+    for (CellIndex c = 0; c < m_cells.size(); ++c) {
+      if (!m_cells[c].empty() && spansContain(m_cellCoords[c])) {
+        visitCell(m_cells[c], generation, visitor);
+      }
+    }
+  }
+  else {
+    for (auto& span : m_spans) {
+      for (int i = span.first; i <= span.last; ++i) {
+        if (const Cell* cell = findCell(Vec2i{ i, span.row })) {
+          visitCell(*cell, generation, visitor);
+        }
+      }
+    }
+  }
+
+  visitOversized(visitor);
+}
+
+template<typename T>
+template<typename F>
+void SparseGrid<T>::forEachItemOnRay(const Vec2f& origin, const Vec2f& dir, float_t maxT,
+  F&& visitor) const
+{
+  ASSERT(std::isfinite(maxT), "Ray length must be finite");
+
+  float_t limit = maxT;
+  auto visit = [&](ItemIndex index) {
+    const Item& item = m_items[index];
+    float_t t = 0.f;
+    if (raySphereIntersect(origin, dir, item.pos, item.radius, t) && t <= limit) {
+      limit = std::min(limit, visitor(item.value));
+    }
+  };
+
+  for (ItemIndex index : m_oversized) {
+    visit(index);
+  }
+
+  uint32_t generation = nextGeneration();
+  const float_t inf = std::numeric_limits<float_t>::infinity();
+
+  // Amanatides-Woo traversal. tNext is the t at which the ray crosses into the next column or row
+  Vec2i cell = worldToGridCoords(origin);
+  Vec2i step;
+  Vec2f tNext;
+  Vec2f tDelta;
+  for (size_t k = 0; k < 2; ++k) {
+    if (dir[k] > 0.f) {
+      step[k] = 1;
+      tNext[k] = ((cell[k] + 1) * m_cellSize - origin[k]) / dir[k];
+      tDelta[k] = m_cellSize / dir[k];
+    }
+    else if (dir[k] < 0.f) {
+      step[k] = -1;
+      tNext[k] = (cell[k] * m_cellSize - origin[k]) / dir[k];
+      tDelta[k] = -m_cellSize / dir[k];
+    }
+    else {
+      step[k] = 0;
+      tNext[k] = inf;
+      tDelta[k] = inf;
+    }
+  }
+
+  float_t tEntry = 0.f;
+  while (tEntry <= limit) {
+    if (const Cell* c = findCell(cell)) {
+      for (ItemIndex index : *c) {
+        if (m_stamps[index] != generation) {
+          m_stamps[index] = generation;
+          visit(index);
+        }
+      }
+    }
+
+    size_t k = tNext[0] < tNext[1] ? 0 : 1;
+    tEntry = tNext[k];
+    tNext[k] += tDelta[k];
+    cell[k] += step[k];
+  }
+}
+
+template<typename T>
+template<typename F>
+void SparseGrid<T>::forEachItemByDistance(const Vec2f& pos, F&& visitor) const
+{
+  float_t limit = std::numeric_limits<float_t>::infinity();
+  auto visit = [&](ItemIndex index) {
+    const Item& item = m_items[index];
+    Vec2f d = item.pos - pos;
+    float_t distance = std::max(0.f, d.magnitude() - item.radius);
+    if (distance <= limit) {
+      limit = std::min(limit, visitor(item.value));
+    }
+  };
+
+  for (ItemIndex index : m_oversized) {
+    visit(index);
+  }
+
+  uint32_t generation = nextGeneration();
+  auto visitCellItems = [&](const Cell& cell) {
+    for (ItemIndex index : cell) {
+      if (m_stamps[index] != generation) {
+        m_stamps[index] = generation;
+        visit(index);
+      }
+    }
+  };
+
+  Vec2i centre = worldToGridCoords(pos);
+
+  // Ring r is the boundary of the square of cells r cells out from pos's cell. It's at least as far
+  // from pos as the nearest edge of pos's cell, plus r - 1 cells
+  float_t x = pos[0] - centre[0] * m_cellSize;
+  float_t y = pos[1] - centre[1] * m_cellSize;
+  float_t edge = std::min({ x, y, m_cellSize - x, m_cellSize - y });
+  auto ringDistance = [this, edge](int r) {
+    return r == 0 ? 0.f : std::max(edge, 0.f) + (r - 1) * m_cellSize;
+  };
+  for (int r = 0; ringDistance(r) <= limit; ++r) {
+    // Once a ring has more cells than there are occupied, it's cheaper to scan the occupied cells
+    // for those that remain
+    int64_t ringSize = r == 0 ? 1 : 8 * static_cast<int64_t>(r);
+    if (ringSize > static_cast<int64_t>(m_cellIndices.size())) {
+      for (CellIndex c = 0; c < m_cells.size(); ++c) {
+        if (m_cells[c].empty()) {
+          continue;
+        }
+        Vec2i d = m_cellCoords[c] - centre;
+        int ring = std::max(std::abs(d[0]), std::abs(d[1]));
+        if (ring >= r && ringDistance(ring) <= limit) {
+          visitCellItems(m_cells[c]);
+        }
+      }
+      break;
+    }
+
+    auto visitAt = [&](int i, int j) {
+      if (const Cell* cell = findCell(Vec2i{ centre[0] + i, centre[1] + j })) {
+        visitCellItems(*cell);
+      }
+    };
+
+    if (r == 0) {
+      visitAt(0, 0);
+      continue;
+    }
+    for (int i = -r; i <= r; ++i) {
+      visitAt(i, -r);
+      visitAt(i, r);
+    }
+    for (int j = -r + 1; j < r; ++j) {
+      visitAt(-r, j);
+      visitAt(r, j);
+    }
+  }
+}
+
+// Each occupied cell's items are visited once, however many of the polygons cover it
+template<typename T>
+template<typename P, typename F>
+void SparseGrid<T>::forEachItemInPolys(size_t n, P&& getPoly, F&& visitor) const
+{
+  ASSERT(n <= 32, "Too many polygons in query");
+
+  uint32_t generation = nextGeneration();
+
+  m_cellQueryStamps.resize(m_cells.size(), 0);
+  m_cellMasks.resize(m_cells.size(), 0);
+  m_itemMasks.resize(m_items.size(), 0);
+  m_touchedCells.clear();
+  m_touchedItems.clear();
+
+  for (size_t k = 0; k < n; ++k) {
+    uint32_t bit = 1u << k;
+    m_rasteriser.rasterise(getPoly(k), Vec2f{ 0.f, 0.f }, Vec2f{ m_cellSize, m_cellSize },
+      [&](int row, int first, int last) {
+        for (int i = first; i <= last; ++i) {
+          CellIndex c = findCellIndex(Vec2i{ i, row });
+          if (c == std::numeric_limits<CellIndex>::max()) {
+            continue;
+          }
+          if (m_cellQueryStamps[c] != generation) {
+            m_cellQueryStamps[c] = generation;
+            m_cellMasks[c] = 0;
+            m_touchedCells.push_back(c);
+          }
+          m_cellMasks[c] |= bit;
+        }
+      });
+  }
+
+  for (CellIndex c : m_touchedCells) {
+    for (ItemIndex index : m_cells[c]) {
+      if (m_stamps[index] != generation) {
+        m_stamps[index] = generation;
+        m_itemMasks[index] = 0;
+        m_touchedItems.push_back(index);
+      }
+      m_itemMasks[index] |= m_cellMasks[c];
+    }
+  }
+
+  for (ItemIndex index : m_touchedItems) {
+    visitor(m_items[index].value, m_itemMasks[index]);
+  }
+
+  if (n > 0) {
+    uint32_t allPolys = n == 32 ? ~0u : (1u << n) - 1;
+    for (ItemIndex index : m_oversized) {
+      visitor(m_items[index].value, allPolys);
+    }
+  }
+}
+
+// Spans are sorted by row, then column
+template<typename T>
+bool SparseGrid<T>::spansContain(const Vec2i& cell) const
+{
+  auto i = std::lower_bound(m_spans.begin(), m_spans.end(), cell,
+    [](const Span& span, const Vec2i& c) {
+      return span.row < c[1] || (span.row == c[1] && span.last < c[0]);
+    });
+
+  return i != m_spans.end() && i->row == cell[1] && i->first <= cell[0];
+}
+
+template<typename T>
+void SparseGrid<T>::getItems(const Vec2f& pos, float_t radius, std::vector<T>& items) const
+{
+  items.clear();
+  forEachItem(pos, radius, [&items](const T& item) { items.push_back(item); });
+}
+
+template<typename T>
+void SparseGrid<T>::getItems(const Vec2f& pos, std::vector<T>& items) const
+{
+  items.clear();
+  forEachItem(pos, [&items](const T& item) { items.push_back(item); });
+}
+
+template<typename T>
+void SparseGrid<T>::getItems(const std::vector<Vec2f>& poly, std::vector<T>& items) const
+{
+  items.clear();
+  forEachItem(poly, [&items](const T& item) { items.push_back(item); });
+}
+
+template<typename T>
+std::unordered_set<T> SparseGrid<T>::getItems(const Vec2f& pos, float_t radius) const
+{
+  std::unordered_set<T> items;
+  forEachItem(pos, radius, [&items](const T& item) { items.insert(item); });
+  return items;
+}
+
+template<typename T>
+std::unordered_set<T> SparseGrid<T>::getItems(const Vec2f& pos) const
+{
+  std::unordered_set<T> items;
+  forEachItem(pos, [&items](const T& item) { items.insert(item); });
+  return items;
+}
+
+template<typename T>
+std::unordered_set<T> SparseGrid<T>::getItems(const std::vector<Vec2f>& poly) const
+{
+  std::unordered_set<T> items;
+  forEachItem(poly, [&items](const T& item) { items.insert(item); });
+  return items;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "spatial_system.hpp"
+#include <functional>
+
+// The broadphase behind SpatialSystem. Entities are bounded by circles on the XZ plane. Queries
+// may return entities that don't quite overlap the polygon, but never miss one that does
+class SpatialIndex
+{
+  public:
+    virtual void initialise(const Vec2f& worldMin, const Vec2f& worldMax) = 0;
+    virtual void addItem(EntityId entityId, const Vec2f& pos, float_t radius) = 0;
+    virtual void moveItem(EntityId entityId, const Vec2f& pos, float_t radius) = 0;
+    virtual void removeItem(EntityId entityId) = 0;
+    // Called once per frame, after moves, to do any deferred maintenance
+    virtual void update() = 0;
+
+    // Clears and fills the buffer with distinct entities
+    virtual void getItems(const std::vector<Vec2f>& poly,
+      std::vector<EntityId>& entities) const = 0;
+    // As above, for the footprints of up to 32 views. Bit i of an entity's mask is set if it
+    // overlaps the footprint of views[i]
+    virtual void getItems(const std::vector<ViewVolume>& views, std::vector<EntityId>& entities,
+      std::vector<uint32_t>& viewMasks) const = 0;
+
+    // Clears and fills the buffer with distinct entities within radius of pos
+    virtual void getItems(const Vec2f& pos, float_t radius,
+      std::vector<EntityId>& entities) const = 0;
+
+    // Calls visitor(id) for entities whose circle the ray origin + t * dir, 0 <= t <= maxT,
+    // enters, roughly in order of t. The visitor returns the t beyond which it's no longer
+    // interested, so the search can end early
+    virtual void castRay(const Vec2f& origin, const Vec2f& dir, float_t maxT,
+      const std::function<float_t(EntityId)>& visitor) const = 0;
+    // Calls visitor(id) for entities roughly in order of distance from pos. The visitor returns the
+    // distance beyond which it's no longer interested, so the search can end early
+    virtual void searchOutwards(const Vec2f& pos,
+      const std::function<float_t(EntityId)>& visitor) const = 0;
+
+    // Approximate, in bytes
+    virtual size_t memoryUsage() const = 0;
+
+    virtual ~SpatialIndex() {}
+};
+
+using SpatialIndexPtr = std::unique_ptr<SpatialIndex>;
+
+// Cell size for grids before the world bounds are known, and after
+float_t gridCellSize();
+float_t gridCellSize(const Vec2f& worldMin, const Vec2f& worldMax);
+
+SpatialIndexPtr createGridIndex();
+SpatialIndexPtr createBvhIndex();
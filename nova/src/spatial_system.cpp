@@ -1,10 +1,15 @@
 #include "spatial_system.hpp"
 #include "logger.hpp"
-#include "grid.hpp"
+#include "spatial_index.hpp"
+#include "job_system.hpp"
+#include "exception.hpp"
+#include "component_pool.hpp"
 #include <map>
+#include <algorithm>
 
-CSpatial::CSpatial(EntityId entityId, const Mat4x4f& transform, float_t radius)
+CSpatial::CSpatial(EntityId entityId, const Mat4x4f& transform, float_t radius, EntityId parent)
   : Component(entityId)
+  , m_parent(parent)
   , m_transform(transform)
   , m_radius(radius)
 {
@@ -12,13 +17,28 @@ CSpatial::CSpatial(EntityId entityId, const Mat4x4f& transform, float_t radius)
 
 const Mat4x4f& CSpatial::relTransform() const
 {
-  return m_transform;
+  return m_hierarchy != nullptr ? m_hierarchy->local(m_node) : m_transform;
 }
 
 const Mat4x4f& CSpatial::absTransform() const
 {
-  // TODO
-  return m_transform;
+  return m_hierarchy != nullptr ? m_hierarchy->world(m_node) : m_transform;
+}
+
+Mat4x4f CSpatial::interpolatedTransform(float_t alpha) const
+{
+  if (alpha >= 1.f || !movedInLastUpdate()) {
+    return absTransform();
+  }
+
+  const Mat4x4f& current = m_hierarchy->world(m_node);
+  const Mat4x4f& previous = m_hierarchy->previousWorld(m_node);
+  return previous * (1.f - alpha) + current * alpha;
+}
+
+bool CSpatial::movedInLastUpdate() const
+{
+  return m_hierarchy != nullptr && m_hierarchy->changedInLastUpdate(m_node);
 }
 
 float_t CSpatial::radius() const
@@ -26,14 +46,33 @@ float_t CSpatial::radius() const
   return m_radius;
 }
 
+EntityId SpatialSystem::componentParent(const CSpatial& component)
+{
+  return component.m_parent;
+}
+
+void SpatialSystem::attachComponent(CSpatial& component, EntityId parent,
+  const TransformHierarchy& hierarchy, TransformHierarchy::NodeId node)
+{
+  component.m_parent = parent;
+  component.m_hierarchy = &hierarchy;
+  component.m_node = node;
+}
+
+TransformHierarchy::NodeId SpatialSystem::componentNode(const CSpatial& component)
+{
+  return component.m_node;
+}
+
 namespace
 {
 
 class SpatialSystemImpl : public SpatialSystem
 {
   public:
-    SpatialSystemImpl(Logger& logger);
+    SpatialSystemImpl(Logger& logger, SpatialIndexType indexType, JobSystem* jobs);
 
+    void initialise(const Vec2f& worldMin, const Vec2f& worldMax) override;
     void addComponent(ComponentPtr component) override;
     void removeComponent(EntityId entityId) override;
     bool hasComponent(EntityId entityId) const override;
@@ -42,60 +81,399 @@ class SpatialSystemImpl : public SpatialSystem
     void update() override;
 
     std::unordered_set<EntityId> getIntersecting(const std::vector<Vec2f>& poly) const override;
+    void getIntersecting(const std::vector<Vec2f>& poly,
+      std::vector<EntityId>& entities) const override;
+    CullingStats getIntersecting(const std::vector<Vec2f>& poly, const Frustum& frustum,
+      std::vector<EntityId>& entities) const override;
+    void getIntersecting(const std::vector<ViewVolume>& views, std::vector<EntityId>& entities,
+      std::vector<uint32_t>& viewMasks, std::vector<CullingStats>& stats) const override;
+    bool raycast(const Vec3f& origin, const Vec3f& dir, float_t maxDistance, RaycastHit& hit,
+      const EntityFilter& filter) const override;
+    void nearest(const Vec3f& pos, size_t k, std::vector<EntityId>& entities,
+      const EntityFilter& filter) const override;
+    void withinRadius(const Vec3f& pos, float_t radius,
+      std::vector<EntityId>& entities) const override;
+    void setTransform(EntityId entityId, const Mat4x4f& transform) override;
+    void setParent(EntityId entityId, EntityId parentId) override;
+    TransformListenerId addTransformListener(TransformListener listener) override;
+    void removeTransformListener(TransformListenerId id) override;
 
   private:
     Logger& m_logger;
-    std::map<EntityId, CSpatialPtr> m_components;
-    Grid<EntityId, 50, 50> m_grid;
+    ComponentPool<CSpatial> m_components;
+    SpatialIndexPtr m_index;
+    TransformHierarchy m_hierarchy;
+    std::vector<EntityId> m_nodeEntities; // Indexed by node id
+    std::vector<TransformHierarchy::NodeId> m_changed;
+    std::vector<EntityId> m_changedEntities;
+    std::map<TransformListenerId, TransformListener> m_transformListeners;
+    TransformListenerId m_nextListenerId = 0;
+    JobSystem* m_jobs;
+
+    // Bounding spheres of frustum culling candidates. Reused between queries to avoid allocation
+    mutable std::vector<float_t> m_cullX;
+    mutable std::vector<float_t> m_cullY;
+    mutable std::vector<float_t> m_cullZ;
+    mutable std::vector<float_t> m_cullR;
+    mutable std::vector<uint8_t> m_cullVisible;
+    // Max-heap of the best candidates in nearest(), by distance
+    mutable std::vector<std::pair<float_t, EntityId>> m_nearest;
+
+    TransformHierarchy::NodeId nodeForEntity(EntityId entityId) const;
+    void rebin(const CSpatial& spatial);
+    void gatherBounds(const std::vector<EntityId>& entities) const;
 };
 
 } // namespace
 
-SpatialSystemImpl::SpatialSystemImpl(Logger& logger)
+SpatialSystemImpl::SpatialSystemImpl(Logger& logger, SpatialIndexType indexType, JobSystem* jobs)
   : m_logger(logger)
-  , m_grid(Vec2f{-400.f, -400.f}, Vec2f{1600.f, 1600.f}) // TODO
+  , m_jobs(jobs)
+{
+  switch (indexType) {
+    case SpatialIndexType::Grid: m_index = createGridIndex(); break;
+    case SpatialIndexType::Bvh: m_index = createBvhIndex(); break;
+    default: EXCEPTION("Unrecognised spatial index type");
+  }
+}
+
+void SpatialSystemImpl::initialise(const Vec2f& worldMin, const Vec2f& worldMax)
+{
+  m_index->initialise(worldMin, worldMax);
+}
+
+TransformHierarchy::NodeId SpatialSystemImpl::nodeForEntity(EntityId entityId) const
 {
+  return entityId == NULL_ENTITY_ID ?
+    TransformHierarchy::NULL_NODE :
+    componentNode(m_components.get(entityId));
 }
 
 void SpatialSystemImpl::addComponent(ComponentPtr component)
 {
   auto spatial = CSpatialPtr(dynamic_cast<CSpatial*>(component.release()));
+
+  EntityId parent = componentParent(*spatial);
+  auto node = m_hierarchy.add(spatial->relTransform(), nodeForEntity(parent));
+  attachComponent(*spatial, parent, m_hierarchy, node);
+
+  if (m_nodeEntities.size() <= node) {
+    m_nodeEntities.resize(node + 1, NULL_ENTITY_ID);
+  }
+  m_nodeEntities[node] = spatial->id();
+
   Vec3f pos = getTranslation(spatial->absTransform());
-  m_grid.addItemByRadius(Vec2f{ pos[0], pos[2] }, spatial->radius(), spatial->id()); 
-  m_components[spatial->id()] = std::move(spatial);
+  m_index->addItem(spatial->id(), Vec2f{ pos[0], pos[2] }, spatial->radius());
+  m_components.add(spatial->id(), std::move(*spatial));
 }
 
 void SpatialSystemImpl::removeComponent(EntityId entityId)
 {
-  m_components.erase(entityId);
+  const CSpatial* spatial = m_components.find(entityId);
+  if (spatial == nullptr) {
+    return;
+  }
+
+  // Children are attached to the removed entity's parent and re-binned on the next update
+  auto node = componentNode(*spatial);
+  m_hierarchy.remove(node);
+  m_nodeEntities[node] = NULL_ENTITY_ID;
+
+  m_index->removeItem(entityId);
+  m_components.remove(entityId);
 }
 
 bool SpatialSystemImpl::hasComponent(EntityId entityId) const
 {
-  return m_components.count(entityId) > 0;
+  return m_components.contains(entityId);
 }
 
 CSpatial& SpatialSystemImpl::getComponent(EntityId entityId)
 {
-  return *m_components.at(entityId);
+  return m_components.get(entityId);
 }
 
 const CSpatial& SpatialSystemImpl::getComponent(EntityId entityId) const
 {
-  return *m_components.at(entityId);
+  return m_components.get(entityId);
+}
+
+void SpatialSystemImpl::setTransform(EntityId entityId, const Mat4x4f& transform)
+{
+  m_hierarchy.setLocal(nodeForEntity(entityId), transform);
+}
+
+void SpatialSystemImpl::setParent(EntityId entityId, EntityId parentId)
+{
+  auto& spatial = m_components.get(entityId);
+  auto node = componentNode(spatial);
+  m_hierarchy.setParent(node, nodeForEntity(parentId));
+  attachComponent(spatial, parentId, m_hierarchy, node);
+}
+
+void SpatialSystemImpl::rebin(const CSpatial& spatial)
+{
+  Vec3f pos = getTranslation(spatial.absTransform());
+  m_index->moveItem(spatial.id(), Vec2f{ pos[0], pos[2] }, spatial.radius());
 }
 
 void SpatialSystemImpl::update()
 {
+  m_changed.clear();
+  if (m_jobs != nullptr) {
+    m_hierarchy.update(m_changed, [this](size_t n, const std::function<void(size_t, size_t)>& fn) {
+      m_jobs->parallelFor(n, fn);
+    });
+  }
+  else {
+    m_hierarchy.update(m_changed);
+  }
+
+  for (auto node : m_changed) {
+    rebin(m_components.get(m_nodeEntities[node]));
+  }
+
+  m_index->update();
+
+  if (m_changed.empty() || m_transformListeners.empty()) {
+    return;
+  }
+
+  m_changedEntities.clear();
+  for (auto node : m_changed) {
+    m_changedEntities.push_back(m_nodeEntities[node]);
+  }
+
+  for (auto& entry : m_transformListeners) {
+    entry.second(m_changedEntities);
+  }
+}
+
+TransformListenerId SpatialSystemImpl::addTransformListener(TransformListener listener)
+{
+  TransformListenerId id = m_nextListenerId++;
+  m_transformListeners[id] = std::move(listener);
+  return id;
+}
+
+void SpatialSystemImpl::removeTransformListener(TransformListenerId id)
+{
+  m_transformListeners.erase(id);
 }
 
 std::unordered_set<EntityId>
 SpatialSystemImpl::getIntersecting(const std::vector<Vec2f>& poly) const
 {
-  return m_grid.getItems(poly);
+  std::vector<EntityId> entities;
+  m_index->getItems(poly, entities);
+  return std::unordered_set<EntityId>(entities.begin(), entities.end());
+}
+
+void SpatialSystemImpl::getIntersecting(const std::vector<Vec2f>& poly,
+  std::vector<EntityId>& entities) const
+{
+  m_index->getItems(poly, entities);
+}
+
+CullingStats SpatialSystemImpl::getIntersecting(const std::vector<Vec2f>& poly,
+  const Frustum& frustum, std::vector<EntityId>& entities) const
+{
+  m_index->getItems(poly, entities);
+
+  const size_t n = entities.size();
+  gatherBounds(entities);
+
+  cullSpheres(frustum, m_cullX.data(), m_cullY.data(), m_cullZ.data(), m_cullR.data(), n,
+    m_cullVisible.data());
+
+  size_t survived = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (m_cullVisible[i]) {
+      entities[survived++] = entities[i];
+    }
+  }
+  entities.resize(survived);
+
+  return CullingStats{
+    .broadphase = n,
+    .survived = survived
+  };
+}
+
+void SpatialSystemImpl::getIntersecting(const std::vector<ViewVolume>& views,
+  std::vector<EntityId>& entities, std::vector<uint32_t>& viewMasks,
+  std::vector<CullingStats>& stats) const
+{
+  stats.assign(views.size(), CullingStats{});
+
+  m_index->getItems(views, entities, viewMasks);
+
+  const size_t n = entities.size();
+  gatherBounds(entities);
+
+  for (size_t v = 0; v < views.size(); ++v) {
+    uint32_t bit = 1u << v;
+
+    cullSpheres(views[v].frustum, m_cullX.data(), m_cullY.data(), m_cullZ.data(), m_cullR.data(),
+      n, m_cullVisible.data());
+
+    for (size_t i = 0; i < n; ++i) {
+      if (viewMasks[i] & bit) {
+        ++stats[v].broadphase;
+        if (m_cullVisible[i]) {
+          ++stats[v].survived;
+        }
+        else {
+          viewMasks[i] &= ~bit;
+        }
+      }
+    }
+  }
+
+  size_t survived = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (viewMasks[i] != 0) {
+      entities[survived] = entities[i];
+      viewMasks[survived] = viewMasks[i];
+      ++survived;
+    }
+  }
+  entities.resize(survived);
+  viewMasks.resize(survived);
+}
+
+// The index visitors below capture a single reference, so std::function stores them without
+// allocating
+bool SpatialSystemImpl::raycast(const Vec3f& origin, const Vec3f& dir, float_t maxDistance,
+  RaycastHit& hit, const EntityFilter& filter) const
+{
+  float_t length = dir.magnitude();
+  if (length == 0.f) {
+    return false;
+  }
+
+  struct
+  {
+    const SpatialSystemImpl& system;
+    const EntityFilter& filter;
+    Vec3f origin;
+    Vec3f dir;
+    RaycastHit hit;
+    float_t limit;
+  } ray{ *this, filter, origin, dir / length, RaycastHit{}, maxDistance };
+
+  m_index->castRay(Vec2f{ origin[0], origin[2] }, Vec2f{ ray.dir[0], ray.dir[2] }, maxDistance,
+    [&ray](EntityId id) {
+      if (ray.filter && !ray.filter(id)) {
+        return ray.limit;
+      }
+
+      const CSpatial& spatial = ray.system.getComponent(id);
+      float_t t = 0.f;
+      if (raySphereIntersect(ray.origin, ray.dir, getTranslation(spatial.absTransform()),
+        spatial.radius(), t) && t <= ray.limit) {
+
+        // On a tie, prefer the entity found first
+        if (ray.hit.entityId == NULL_ENTITY_ID || t < ray.hit.distance) {
+          ray.hit = RaycastHit{ id, t };
+          ray.limit = t;
+        }
+      }
+      return ray.limit;
+    });
+
+  if (ray.hit.entityId == NULL_ENTITY_ID) {
+    return false;
+  }
+
+  hit = ray.hit;
+  return true;
+}
+
+void SpatialSystemImpl::nearest(const Vec3f& pos, size_t k, std::vector<EntityId>& entities,
+  const EntityFilter& filter) const
+{
+  entities.clear();
+  m_nearest.clear();
+
+  if (k == 0) {
+    return;
+  }
+
+  struct
+  {
+    const SpatialSystemImpl& system;
+    const EntityFilter& filter;
+    Vec3f pos;
+    size_t k;
+  } search{ *this, filter, pos, k };
+
+  m_index->searchOutwards(Vec2f{ pos[0], pos[2] }, [&search](EntityId id) {
+    auto& best = search.system.m_nearest;
+    const float_t inf = std::numeric_limits<float_t>::infinity();
+
+    if (!search.filter || search.filter(id)) {
+      const CSpatial& spatial = search.system.getComponent(id);
+      Vec3f d = getTranslation(spatial.absTransform()) - search.pos;
+      float_t distance = std::max(0.f, d.magnitude() - spatial.radius());
+
+      if (best.size() < search.k) {
+        best.push_back({ distance, id });
+        std::push_heap(best.begin(), best.end());
+      }
+      else if (distance < best.front().first) {
+        std::pop_heap(best.begin(), best.end());
+        best.back() = { distance, id };
+        std::push_heap(best.begin(), best.end());
+      }
+    }
+
+    return best.size() < search.k ? inf : best.front().first;
+  });
+
+  std::sort_heap(m_nearest.begin(), m_nearest.end());
+  for (auto& entry : m_nearest) {
+    entities.push_back(entry.second);
+  }
+}
+
+void SpatialSystemImpl::withinRadius(const Vec3f& pos, float_t radius,
+  std::vector<EntityId>& entities) const
+{
+  m_index->getItems(Vec2f{ pos[0], pos[2] }, radius, entities);
+
+  // The index only knows about the XZ plane
+  size_t n = 0;
+  for (EntityId id : entities) {
+    const CSpatial& spatial = m_components.get(id);
+    Vec3f d = getTranslation(spatial.absTransform()) - pos;
+    if (d.dot(d) <= square(radius + spatial.radius())) {
+      entities[n++] = id;
+    }
+  }
+  entities.resize(n);
+}
+
+void SpatialSystemImpl::gatherBounds(const std::vector<EntityId>& entities) const
+{
+  const size_t n = entities.size();
+  m_cullX.resize(n);
+  m_cullY.resize(n);
+  m_cullZ.resize(n);
+  m_cullR.resize(n);
+  m_cullVisible.resize(n);
+
+  for (size_t i = 0; i < n; ++i) {
+    const CSpatial& spatial = m_components.get(entities[i]);
+    const Mat4x4f& m = spatial.absTransform();
+    m_cullX[i] = m.at(0, 3);
+    m_cullY[i] = m.at(1, 3);
+    m_cullZ[i] = m.at(2, 3);
+    m_cullR[i] = spatial.radius();
+  }
 }
 
-SpatialSystemPtr createSpatialSystem(Logger& logger)
+SpatialSystemPtr createSpatialSystem(Logger& logger, SpatialIndexType indexType, JobSystem* jobs)
 {
-  return std::make_unique<SpatialSystemImpl>(logger);
+  return std::make_unique<SpatialSystemImpl>(logger, indexType, jobs);
 }
@@ -2,42 +2,129 @@
 
 #include "system.hpp"
 #include "math.hpp"
+#include "transform_hierarchy.hpp"
+#include "frustum.hpp"
 #include <unordered_set>
+#include <functional>
 #include <memory>
 
 class CSpatial : public Component
 {
   public:
-    CSpatial(EntityId entityId, const Mat4x4f& transform, float_t radius);
+    CSpatial(EntityId entityId, const Mat4x4f& transform, float_t radius,
+      EntityId parent = NULL_ENTITY_ID);
 
     const Mat4x4f& relTransform() const;
+    // Computed by SpatialSystem::update() from the ancestors' transforms
     const Mat4x4f& absTransform() const;
+    // Blends the absolute transforms from before and after the last update, where alpha is 0 and
+    // 1 respectively. Element-wise, which is close enough for the movement in one simulation step
+    Mat4x4f interpolatedTransform(float_t alpha) const;
+    // False if interpolatedTransform() would return absTransform() whatever alpha is
+    bool movedInLastUpdate() const;
     float_t radius() const;
 
   private:
+    friend class SpatialSystem;
+
     EntityId m_parent;
-    Mat4x4f m_transform;
+    Mat4x4f m_transform; // Only used until the component is added to a system
     float_t m_radius;
-    std::unordered_set<EntityId> m_children;
+    const TransformHierarchy* m_hierarchy = nullptr;
+    TransformHierarchy::NodeId m_node = TransformHierarchy::NULL_NODE;
 };
 
 using CSpatialPtr = std::unique_ptr<CSpatial>;
 
-// TODO: Provide efficient way to traverse visible entities, computing absolute transforms during
-// traversal
+struct ViewVolume
+{
+  std::vector<Vec2f> footprint; // Projection of the frustum onto the XZ plane
+  Frustum frustum;
+};
+
+struct RaycastHit
+{
+  EntityId entityId = NULL_ENTITY_ID;
+  float_t distance = 0.f;
+};
+
+// Return false to exclude the entity from a query
+using EntityFilter = std::function<bool(EntityId)>;
+
+// Receives the entities whose absolute transforms changed during an update
+using TransformListener = std::function<void(const std::vector<EntityId>&)>;
+using TransformListenerId = uint32_t;
+
 class SpatialSystem : public System
 {
   public:
     CSpatial& getComponent(EntityId id) override = 0;
     const CSpatial& getComponent(EntityId id) const override = 0;
 
+    // Sizes the spatial index from the extent of the world. Entities outside these bounds are
+    // still indexed. Entities already added are re-indexed
+    virtual void initialise(const Vec2f& worldMin, const Vec2f& worldMax) = 0;
+
     virtual std::unordered_set<EntityId> getIntersecting(const std::vector<Vec2f>& poly) const = 0;
+    // Clears and fills the caller's buffer. Doesn't allocate once the buffer is large enough
+    virtual void getIntersecting(const std::vector<Vec2f>& poly,
+      std::vector<EntityId>& entities) const = 0;
+    // Uses poly, the frustum's footprint on the XZ plane, as a broadphase, then tests each
+    // candidate's bounding sphere against the frustum planes
+    virtual CullingStats getIntersecting(const std::vector<Vec2f>& poly, const Frustum& frustum,
+      std::vector<EntityId>& entities) const = 0;
+    // Culls against up to 32 views in one pass over the index. Clears and fills entities with
+    // those visible in at least one view, and viewMasks with the matching masks, where bit i is set
+    // if the entity is visible in views[i]. Writes one CullingStats per view to stats
+    virtual void getIntersecting(const std::vector<ViewVolume>& views,
+      std::vector<EntityId>& entities, std::vector<uint32_t>& viewMasks,
+      std::vector<CullingStats>& stats) const = 0;
+
+    // Finds the nearest entity whose bounding sphere the ray hits within maxDistance. dir needn't
+    // be normalised. Cells and tree nodes beyond the nearest hit so far aren't searched
+    virtual bool raycast(const Vec3f& origin, const Vec3f& dir, float_t maxDistance,
+      RaycastHit& hit, const EntityFilter& filter = nullptr) const = 0;
+    // Clears and fills the buffer with up to k entities nearest to pos, nearest first, measured to
+    // the surfaces of their bounding spheres. The search stops once nothing nearer can be found
+    virtual void nearest(const Vec3f& pos, size_t k, std::vector<EntityId>& entities,
+      const EntityFilter& filter = nullptr) const = 0;
+    // Clears and fills the buffer with entities whose bounding spheres are within radius of pos
+    virtual void withinRadius(const Vec3f& pos, float_t radius,
+      std::vector<EntityId>& entities) const = 0;
+
+    // Sets the transform relative to the parent. The entity and its descendants have their
+    // absolute transforms recomputed and are re-binned together on the next call to update()
+    virtual void setTransform(EntityId entityId, const Mat4x4f& transform) = 0;
+    // Pass NULL_ENTITY_ID to detach from the current parent
+    virtual void setParent(EntityId entityId, EntityId parentId) = 0;
+
+    // Listeners are called at the end of update(), once all changed entities have been re-binned,
+    // and only if something changed
+    virtual TransformListenerId addTransformListener(TransformListener listener) = 0;
+    virtual void removeTransformListener(TransformListenerId id) = 0;
 
     virtual ~SpatialSystem() {}
+
+  protected:
+    static EntityId componentParent(const CSpatial& component);
+    static void attachComponent(CSpatial& component, EntityId parent,
+      const TransformHierarchy& hierarchy, TransformHierarchy::NodeId node);
+    static TransformHierarchy::NodeId componentNode(const CSpatial& component);
 };
 
 using SpatialSystemPtr = std::unique_ptr<SpatialSystem>;
 
+// Grid suits maps where most entities move or are evenly spread. Bvh builds a tree over entities
+// that stay put and keeps movers in a small grid, which suits large, dense or clustered maps
+enum class SpatialIndexType
+{
+  Grid,
+  Bvh
+};
+
 class Logger;
+class JobSystem;
 
-SpatialSystemPtr createSpatialSystem(Logger& logger);
+// Transform updates are spread over the job system's threads if one is given
+SpatialSystemPtr createSpatialSystem(Logger& logger,
+  SpatialIndexType indexType = SpatialIndexType::Grid, JobSystem* jobs = nullptr);
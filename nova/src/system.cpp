@@ -1,23 +1,96 @@
 #include "system.hpp"
+#include "exception.hpp"
 
-EntityId System::m_nextId = 0;
-std::set<EntityId> System::m_reservedIds;
+namespace
+{
 
-EntityId System::nextId()
+// Released slots aren't reused until this many have queued up
+const size_t MIN_FREE_SLOTS = 1024;
+
+} // namespace
+
+EntityId EntityIdAllocator::allocate()
+{
+  ++m_numAlive;
+
+  if (m_freeSlots.size() > MIN_FREE_SLOTS) {
+    uint32_t index = m_freeSlots.front();
+    m_freeSlots.pop_front();
+    return makeEntityId(index, m_generations[index]);
+  }
+
+  ASSERT(m_generations.size() <= ENTITY_INDEX_MASK, "Out of entity ids");
+
+  uint32_t index = static_cast<uint32_t>(m_generations.size());
+  m_generations.push_back(0);
+  return makeEntityId(index, 0);
+}
+
+void EntityIdAllocator::release(EntityId id)
 {
-  while (m_reservedIds.contains(m_nextId)) {
-    ++m_nextId;
+  ASSERT(isAlive(id), "Entity id " << id << " is stale or was never allocated");
+
+  --m_numAlive;
+
+  uint32_t index = entityIndex(id);
+  uint32_t generation = ++m_generations[index];
+
+  // Slots that have used every generation are retired, so ids never wrap around
+  if (generation < MAX_ENTITY_GENERATION) {
+    m_freeSlots.push_back(index);
   }
-  return m_nextId++;
+}
+
+bool EntityIdAllocator::isAlive(EntityId id) const
+{
+  uint32_t index = entityIndex(id);
+  return id != NULL_ENTITY_ID && index < m_generations.size() &&
+    m_generations[index] == entityGeneration(id);
+}
+
+size_t EntityIdAllocator::numAlive() const
+{
+  return m_numAlive;
+}
+
+EntityIdAllocator System::m_ids;
+std::unordered_map<std::string, EntityId> System::m_names;
+std::unordered_map<EntityId, std::string> System::m_idNames;
+
+EntityId System::nextId()
+{
+  return m_ids.allocate();
 }
 
 EntityId System::idFromString(const std::string& name)
 {
-  EntityId id = std::hash<std::string>{}(name);
-  m_reservedIds.insert(id);
+  auto i = m_names.find(name);
+  if (i != m_names.end()) {
+    return i->second;
+  }
+
+  EntityId id = m_ids.allocate();
+  m_names[name] = id;
+  m_idNames[id] = name;
   return id;
 }
 
+void System::releaseId(EntityId id)
+{
+  m_ids.release(id);
+
+  auto i = m_idNames.find(id);
+  if (i != m_idNames.end()) {
+    m_names.erase(i->second);
+    m_idNames.erase(i);
+  }
+}
+
+bool System::isAlive(EntityId id)
+{
+  return m_ids.isAlive(id);
+}
+
 Component::Component(EntityId entityId)
   : m_id(entityId)
 {
@@ -1,10 +1,57 @@
 #pragma once
 
 #include <memory>
-#include <set>
 #include <string>
+#include <limits>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <cstdint>
 
-using EntityId = size_t;
+// An entity id packs a slot index into its low bits and the slot's generation into its high bits.
+// The generation is bumped each time the slot is released, so an id held on to after its entity
+// was destroyed can be told apart from the entity that reuses the slot
+using EntityId = uint32_t;
+
+const uint32_t ENTITY_INDEX_BITS = 22;
+const uint32_t ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+const uint32_t MAX_ENTITY_GENERATION = (1u << (32 - ENTITY_INDEX_BITS)) - 1;
+
+// Never handed out, as slots are retired before reaching the last generation
+const EntityId NULL_ENTITY_ID = std::numeric_limits<EntityId>::max();
+
+inline uint32_t entityIndex(EntityId id)
+{
+  return id & ENTITY_INDEX_MASK;
+}
+
+inline uint32_t entityGeneration(EntityId id)
+{
+  return id >> ENTITY_INDEX_BITS;
+}
+
+inline EntityId makeEntityId(uint32_t index, uint32_t generation)
+{
+  return generation << ENTITY_INDEX_BITS | index;
+}
+
+// Hands out entity ids, reusing the slots of released ones. Released slots wait in a queue until
+// enough have built up, so a slot's generation advances slowly and a stale id would have to be held
+// for a long time before it could match again
+class EntityIdAllocator
+{
+  public:
+    EntityId allocate();
+    // Throws if the id is stale or was never allocated
+    void release(EntityId id);
+    bool isAlive(EntityId id) const;
+    size_t numAlive() const;
+
+  private:
+    std::vector<uint32_t> m_generations;  // Indexed by slot
+    std::deque<uint32_t> m_freeSlots;
+    size_t m_numAlive = 0;
+};
 
 class Component
 {
@@ -33,12 +80,18 @@ class System
 
     virtual ~System() {}
 
+    // Returns the id given to the name, allocating one the first time the name is seen
     static EntityId idFromString(const std::string& name);
     static EntityId nextId();
+    // Frees the id for reuse, along with any name given to it. Components must be removed from
+    // every system first
+    static void releaseId(EntityId id);
+    static bool isAlive(EntityId id);
 
   private:
-    static EntityId m_nextId;
-    static std::set<EntityId> m_reservedIds;
+    static EntityIdAllocator m_ids;
+    static std::unordered_map<std::string, EntityId> m_names;
+    static std::unordered_map<EntityId, std::string> m_idNames;
 };
 
 using SystemPtr = std::unique_ptr<System>;
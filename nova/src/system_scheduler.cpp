@@ -0,0 +1,209 @@
+#include "system_scheduler.hpp"
+#include "job_system.hpp"
+#include "exception.hpp"
+#include <algorithm>
+#include <iomanip>
+
+namespace
+{
+
+const int TIMELINE_WIDTH = 60;
+
+} // namespace
+
+double FrameTimeline::parallelism() const
+{
+  if (duration <= 0.0) {
+    return 0.0;
+  }
+
+  double busy = 0.0;
+  for (auto& stage : stages) {
+    busy += stage.end - stage.start;
+  }
+  return busy / duration;
+}
+
+std::ostream& operator<<(std::ostream& stream, const FrameTimeline& timeline)
+{
+  size_t nameWidth = 0;
+  for (auto& stage : timeline.stages) {
+    nameWidth = std::max(nameWidth, stage.name.size());
+  }
+
+  auto column = [&](double t) {
+    return timeline.duration > 0.0 ?
+      std::clamp(static_cast<int>(t / timeline.duration * TIMELINE_WIDTH), 0, TIMELINE_WIDTH) : 0;
+  };
+
+  for (auto& stage : timeline.stages) {
+    int begin = column(stage.start);
+    int end = std::max(column(stage.end), begin + 1);
+
+    stream << std::left << std::setw(static_cast<int>(nameWidth)) << stage.name << std::right
+      << " [" << std::string(begin, ' ') << std::string(end - begin, '#')
+      << std::string(std::max(TIMELINE_WIDTH - end, 0), ' ') << "] thread " << stage.thread
+      << ", " << std::fixed << std::setprecision(3) << (stage.end - stage.start) * 1000.0
+      << " ms\n";
+  }
+  stream << "Frame: " << std::fixed << std::setprecision(3) << timeline.duration * 1000.0
+    << " ms, parallelism: " << std::setprecision(2) << timeline.parallelism() << "\n";
+
+  return stream;
+}
+
+SystemScheduler::SystemScheduler(JobSystem& jobs)
+  : m_jobs(jobs)
+{
+}
+
+void SystemScheduler::addStage(const std::string& name, const std::vector<std::string>& reads,
+  const std::vector<std::string>& writes, StageFn fn, bool mainThread)
+{
+  uint32_t index = static_cast<uint32_t>(m_stages.size());
+  std::vector<uint32_t> dependencies;
+
+  for (auto& store : reads) {
+    if (std::find(writes.begin(), writes.end(), store) != writes.end()) {
+      continue;
+    }
+    auto& access = m_stores[store];
+    if (access.lastWriter >= 0) {
+      dependencies.push_back(static_cast<uint32_t>(access.lastWriter));
+    }
+    access.readers.push_back(index);
+  }
+
+  for (auto& store : writes) {
+    auto& access = m_stores[store];
+    if (access.lastWriter >= 0) {
+      dependencies.push_back(static_cast<uint32_t>(access.lastWriter));
+    }
+    dependencies.insert(dependencies.end(), access.readers.begin(), access.readers.end());
+    access.lastWriter = index;
+    access.readers.clear();
+  }
+
+  std::sort(dependencies.begin(), dependencies.end());
+  dependencies.erase(std::unique(dependencies.begin(), dependencies.end()), dependencies.end());
+
+  for (uint32_t i : dependencies) {
+    m_stages[i].dependents.push_back(index);
+  }
+
+  m_stages.push_back(Stage{
+    .fn = std::move(fn),
+    .mainThread = mainThread,
+    .dependencies = std::move(dependencies),
+    .dependents{}
+  });
+  m_timeline.stages.push_back(StageTiming{
+    .name = name,
+    .thread = 0,
+    .start = 0.0,
+    .end = 0.0
+  });
+}
+
+size_t SystemScheduler::numStages() const
+{
+  return m_stages.size();
+}
+
+const std::vector<uint32_t>& SystemScheduler::dependencies(size_t stage) const
+{
+  return m_stages.at(stage).dependencies;
+}
+
+const FrameTimeline& SystemScheduler::timeline() const
+{
+  return m_timeline;
+}
+
+void SystemScheduler::runStage(uint32_t index)
+{
+  auto& timing = m_timeline.stages[index];
+  timing.thread = m_jobs.threadIndex();
+  timing.start = m_frameTimer.elapsed();
+
+  try {
+    m_stages[index].fn();
+  }
+  catch (...) {
+    std::lock_guard lock(m_errorMutex);
+    if (!m_error) {
+      m_error = std::current_exception();
+    }
+  }
+
+  timing.end = m_frameTimer.elapsed();
+}
+
+// A job can only hold a few continuations, so larger fan-outs go through empty relay jobs
+void SystemScheduler::addDependents(Job* job, Job* root, std::span<Job* const> dependents)
+{
+  if (dependents.size() <= Job::MAX_CONTINUATIONS) {
+    for (Job* dependent : dependents) {
+      m_jobs.addDependency(dependent, job);
+    }
+    return;
+  }
+
+  size_t groupSize = (dependents.size() + Job::MAX_CONTINUATIONS - 1) / Job::MAX_CONTINUATIONS;
+  for (size_t i = 0; i < dependents.size(); i += groupSize) {
+    Job* relay = m_jobs.create([]() {}, root);
+    m_jobs.addDependency(relay, job);
+    addDependents(relay, root, dependents.subspan(i, std::min(groupSize, dependents.size() - i)));
+    m_jobs.run(relay);
+  }
+}
+
+void SystemScheduler::runFrame()
+{
+  m_frameTimer.reset();
+
+  // Stages on the main thread are represented by empty jobs, run once the stage is done
+  Job* root = m_jobs.create([]() {});
+  m_stageJobs.resize(m_stages.size());
+  for (uint32_t i = 0; i < m_stages.size(); ++i) {
+    m_stageJobs[i] = m_stages[i].mainThread ?
+      m_jobs.create([]() {}, root) :
+      m_jobs.create([this, i]() { runStage(i); }, root);
+  }
+
+  for (uint32_t i = 0; i < m_stages.size(); ++i) {
+    m_dependentJobs.clear();
+    for (uint32_t dependent : m_stages[i].dependents) {
+      m_dependentJobs.push_back(m_stageJobs[dependent]);
+    }
+    addDependents(m_stageJobs[i], root, m_dependentJobs);
+  }
+
+  for (uint32_t i = 0; i < m_stages.size(); ++i) {
+    if (!m_stages[i].mainThread) {
+      m_jobs.run(m_stageJobs[i]);
+    }
+  }
+
+  // Stages only depend on earlier ones, so taking these in order can't deadlock
+  for (uint32_t i = 0; i < m_stages.size(); ++i) {
+    if (m_stages[i].mainThread) {
+      for (uint32_t dependency : m_stages[i].dependencies) {
+        m_jobs.wait(m_stageJobs[dependency]);
+      }
+      runStage(i);
+      m_jobs.run(m_stageJobs[i]);
+    }
+  }
+
+  m_jobs.run(root);
+  m_jobs.wait(root);
+
+  m_timeline.duration = m_frameTimer.elapsed();
+
+  std::exception_ptr error;
+  std::swap(error, m_error);
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
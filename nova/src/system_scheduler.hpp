@@ -0,0 +1,94 @@
+#pragma once
+
+#include "time.hpp"
+#include <string>
+#include <vector>
+#include <span>
+#include <map>
+#include <functional>
+#include <mutex>
+#include <exception>
+#include <ostream>
+#include <cstdint>
+
+class JobSystem;
+class Job;
+
+// When a stage ran in the last frame, in seconds from the start of the frame
+struct StageTiming
+{
+  std::string name;
+  uint32_t thread;    // Job system thread index, 0 being the one that called runFrame()
+  double start;
+  double end;
+};
+
+struct FrameTimeline
+{
+  std::vector<StageTiming> stages;    // In the order they were added
+  double duration = 0.0;
+
+  // Time spent in stages over the length of the frame. 1 if they all ran one after another
+  double parallelism() const;
+};
+
+// One row per stage, with a bar showing when in the frame it ran
+std::ostream& operator<<(std::ostream& stream, const FrameTimeline& timeline);
+
+// Runs a frame's worth of system updates, or phases of them, on the job system. Each stage
+// declares the component stores it reads and writes, by name. A stage waits for every earlier
+// stage that writes a store it uses, or reads one it writes, so the result is the same as running
+// the stages one after another in the order they were added, but stages that don't conflict can
+// run at the same time.
+class SystemScheduler
+{
+  public:
+    using StageFn = std::function<void()>;
+
+    SystemScheduler(JobSystem& jobs);
+
+    // Stages on the main thread always run on the thread that calls runFrame(), e.g. those that
+    // talk to the window system or submit to the GPU
+    void addStage(const std::string& name, const std::vector<std::string>& reads,
+      const std::vector<std::string>& writes, StageFn fn, bool mainThread = false);
+
+    // Runs every stage once and waits for them all. Rethrows the first exception thrown by a
+    // stage, once the others have finished
+    void runFrame();
+
+    size_t numStages() const;
+    // Indices of the earlier stages that the given stage waits for
+    const std::vector<uint32_t>& dependencies(size_t stage) const;
+    const FrameTimeline& timeline() const;
+
+  private:
+    struct Stage
+    {
+      StageFn fn;
+      bool mainThread;
+      std::vector<uint32_t> dependencies;
+      std::vector<uint32_t> dependents;
+    };
+
+    // Who last touched each store, to work out what a new stage has to wait for
+    struct StoreAccess
+    {
+      int64_t lastWriter = -1;
+      std::vector<uint32_t> readers;      // Since the last write
+    };
+
+    JobSystem& m_jobs;
+    std::vector<Stage> m_stages;
+    std::map<std::string, StoreAccess> m_stores;
+    FrameTimeline m_timeline;
+    Timer m_frameTimer;
+    std::mutex m_errorMutex;
+    std::exception_ptr m_error;
+
+    // Reused between frames to avoid allocation
+    std::vector<Job*> m_stageJobs;
+    std::vector<Job*> m_dependentJobs;
+
+    void runStage(uint32_t index);
+    void addDependents(Job* job, Job* root, std::span<Job* const> dependents);
+};
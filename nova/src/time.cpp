@@ -1,5 +1,6 @@
 #include "time.hpp"
 #include <thread>
+#include <algorithm>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -14,7 +15,7 @@ using namespace std::chrono_literals;
 const double SLEEP_RATIO = 0.9;
 
 FrameRateLimiter::FrameRateLimiter(unsigned frameRate)
-  : m_frameDuration(1000000us / frameRate)
+  : m_frameDuration(frameRate == 0 ? 0us : 1000000us / frameRate)
 {
 }
 
@@ -39,6 +40,38 @@ void FrameRateLimiter::wait()
   m_lastFrameTime = std::chrono::high_resolution_clock::now();
 }
 
+FixedTimestep::FixedTimestep(unsigned stepRate, unsigned maxSteps)
+  : m_timestep(1.0 / stepRate)
+  , m_maxSteps(maxSteps)
+{
+}
+
+unsigned FixedTimestep::advance(double elapsed)
+{
+  m_accumulator += elapsed;
+
+  unsigned steps = 0;
+  while (m_accumulator >= m_timestep && steps < m_maxSteps) {
+    m_accumulator -= m_timestep;
+    ++steps;
+  }
+  if (steps == m_maxSteps) {
+    m_accumulator = std::min(m_accumulator, m_timestep);
+  }
+
+  return steps;
+}
+
+double FixedTimestep::alpha() const
+{
+  return std::min(m_accumulator / m_timestep, 1.0);
+}
+
+double FixedTimestep::timestep() const
+{
+  return m_timestep;
+}
+
 Timer::Timer()
   : m_start(std::chrono::high_resolution_clock::now())
 {
@@ -2,6 +2,7 @@
 
 #include <chrono>
 
+// A frame rate of 0 means no limit, so wait() returns straight away
 class FrameRateLimiter
 {
   public:
@@ -14,6 +15,26 @@ class FrameRateLimiter
     std::chrono::microseconds m_frameDuration;
 };
 
+// Turns real time into a whole number of fixed simulation steps. Time left over is carried into
+// the next frame, and alpha() is how far that leaves us into the next step, for drawing between
+// the last two states. After a stall, at most maxSteps are taken and the rest of the time is
+// dropped, so a slow frame can't snowball into slower ones
+class FixedTimestep
+{
+  public:
+    FixedTimestep(unsigned stepRate, unsigned maxSteps = 8);
+
+    // Adds the real time in seconds since the last call and returns the number of steps to run
+    unsigned advance(double elapsed);
+    double alpha() const;
+    double timestep() const;
+
+  private:
+    double m_timestep;
+    unsigned m_maxSteps;
+    double m_accumulator = 0.0;
+};
+
 class Timer
 {
   public:
@@ -0,0 +1,315 @@
+#include "transform_hierarchy.hpp"
+#include "exception.hpp"
+#include <cassert>
+
+namespace
+{
+
+const size_t PARALLEL_THRESHOLD = 1024;
+
+} // namespace
+
+uint32_t TransformHierarchy::position(NodeId node) const
+{
+  DBG_ASSERT(contains(node), "No such node in transform hierarchy");
+  return m_positions[node];
+}
+
+bool TransformHierarchy::isRemoved(uint32_t pos) const
+{
+  return pos != NULL_NODE && m_nodeIds[pos] == NULL_NODE;
+}
+
+// The given position if it's live, or else the nearest live ancestor of the removed node there
+uint32_t TransformHierarchy::liveAncestor(uint32_t pos) const
+{
+  while (isRemoved(pos)) {
+    pos = m_parents[pos];
+  }
+  return pos;
+}
+
+bool TransformHierarchy::contains(NodeId node) const
+{
+  return node < m_positions.size() && m_positions[node] != NULL_NODE;
+}
+
+size_t TransformHierarchy::size() const
+{
+  return m_size;
+}
+
+TransformHierarchy::NodeId TransformHierarchy::add(const Mat4x4f& local, NodeId parent)
+{
+  NodeId id;
+  if (!m_freeIds.empty()) {
+    id = m_freeIds.back();
+    m_freeIds.pop_back();
+  }
+  else {
+    id = static_cast<NodeId>(m_positions.size());
+    m_positions.push_back(NULL_NODE);
+  }
+
+  uint32_t parentPos = parent == NULL_NODE ? NULL_NODE : position(parent);
+  uint32_t pos = static_cast<uint32_t>(m_nodeIds.size());
+  uint32_t depth = parentPos == NULL_NODE ? 0 : m_depths[parentPos] + 1;
+
+  // The parent is already in the arrays, so depth is at most one more than the last node's.
+  // Appending keeps the arrays sorted unless depth is less than the last node's
+  if (!m_needsRebuild) {
+    if (!m_depths.empty() && depth < m_depths.back()) {
+      m_needsRebuild = true;
+    }
+    else if (depth + 1 == m_levelOffsets.size()) {
+      m_levelOffsets.push_back(pos + 1);
+    }
+    else {
+      m_levelOffsets.back() = pos + 1;
+    }
+  }
+
+  m_parents.push_back(parentPos);
+  m_locals.push_back(local);
+  m_worlds.push_back(parentPos == NULL_NODE ? local : m_worlds[parentPos] * local);
+  m_previousWorlds.push_back(m_worlds.back());
+  m_updatedIn.push_back(0);
+  m_dirty.push_back(0);
+  m_nodeIds.push_back(id);
+  m_depths.push_back(depth);
+  m_positions[id] = pos;
+
+  ++m_size;
+
+  return id;
+}
+
+void TransformHierarchy::remove(NodeId node)
+{
+  uint32_t pos = position(node);
+
+  // The children are left pointing here until the rebuild
+  m_nodeIds[pos] = NULL_NODE;
+  m_dirty[pos] = 0;
+  m_positions[node] = NULL_NODE;
+  m_freeIds.push_back(node);
+  m_needsRebuild = true;
+
+  --m_size;
+}
+
+void TransformHierarchy::setParent(NodeId node, NodeId parent)
+{
+  uint32_t pos = position(node);
+  uint32_t parentPos = parent == NULL_NODE ? NULL_NODE : position(parent);
+
+  for (uint32_t p = parentPos; p != NULL_NODE; p = m_parents[p]) {
+    ASSERT(p != pos, "Cannot make a node a descendant of itself");
+  }
+
+  m_parents[pos] = parentPos;
+  markDirty(pos);
+  m_needsRebuild = true;
+}
+
+void TransformHierarchy::setLocal(NodeId node, const Mat4x4f& local)
+{
+  uint32_t pos = position(node);
+  m_locals[pos] = local;
+  markDirty(pos);
+}
+
+const Mat4x4f& TransformHierarchy::local(NodeId node) const
+{
+  return m_locals[position(node)];
+}
+
+const Mat4x4f& TransformHierarchy::world(NodeId node) const
+{
+  return m_worlds[position(node)];
+}
+
+const Mat4x4f& TransformHierarchy::previousWorld(NodeId node) const
+{
+  uint32_t pos = position(node);
+  return changedInLastUpdate(node) ? m_previousWorlds[pos] : m_worlds[pos];
+}
+
+bool TransformHierarchy::changedInLastUpdate(NodeId node) const
+{
+  return m_updatedIn[position(node)] == m_updateCount && m_updateCount != 0;
+}
+
+TransformHierarchy::NodeId TransformHierarchy::parent(NodeId node) const
+{
+  uint32_t parentPos = liveAncestor(m_parents[position(node)]);
+  return parentPos == NULL_NODE ? NULL_NODE : m_nodeIds[parentPos];
+}
+
+void TransformHierarchy::markDirty(uint32_t pos)
+{
+  m_dirty[pos] = 1;
+  // Depth may be stale after reparenting, but the rebuild that follows resets this anyway
+  m_minDirtyDepth = std::min(m_minDirtyDepth, m_depths[pos]);
+}
+
+void TransformHierarchy::rebuild()
+{
+  const size_t n = m_nodeIds.size();
+
+  // Attach children of removed nodes to their nearest live ancestors. The removed nodes on the way
+  // are pointed straight at the ancestor, so their other children don't walk the chain again
+  for (uint32_t i = 0; i < n; ++i) {
+    if (m_nodeIds[i] == NULL_NODE || !isRemoved(m_parents[i])) {
+      continue;
+    }
+
+    uint32_t ancestor = liveAncestor(m_parents[i]);
+    for (uint32_t p = m_parents[i]; isRemoved(p);) {
+      uint32_t next = m_parents[p];
+      m_parents[p] = ancestor;
+      p = next;
+    }
+    m_parents[i] = ancestor;
+    m_dirty[i] = 1;
+  }
+
+  // Compute depths by walking up to the nearest ancestor with a known depth
+  const uint32_t UNKNOWN = NULL_NODE;
+  std::vector<uint32_t> depths(n, UNKNOWN);
+  std::vector<uint32_t> chain;
+  uint32_t maxDepth = 0;
+
+  for (uint32_t i = 0; i < n; ++i) {
+    if (m_nodeIds[i] == NULL_NODE || depths[i] != UNKNOWN) {
+      continue;
+    }
+
+    uint32_t p = i;
+    while (p != NULL_NODE && depths[p] == UNKNOWN) {
+      chain.push_back(p);
+      p = m_parents[p];
+    }
+
+    uint32_t depth = p == NULL_NODE ? 0 : depths[p] + 1;
+    for (auto j = chain.rbegin(); j != chain.rend(); ++j) {
+      depths[*j] = depth++;
+    }
+    maxDepth = std::max(maxDepth, depth - 1);
+    chain.clear();
+  }
+
+  // Counting sort by depth. Stable, so siblings keep their relative order
+  std::vector<uint32_t> offsets(maxDepth + 2, 0);
+  for (uint32_t i = 0; i < n; ++i) {
+    if (m_nodeIds[i] != NULL_NODE) {
+      ++offsets[depths[i] + 1];
+    }
+  }
+  for (size_t d = 1; d < offsets.size(); ++d) {
+    offsets[d] += offsets[d - 1];
+  }
+  m_levelOffsets = offsets;
+
+  std::vector<uint32_t> newPositions(n, NULL_NODE);
+  for (uint32_t i = 0; i < n; ++i) {
+    if (m_nodeIds[i] != NULL_NODE) {
+      newPositions[i] = offsets[depths[i]]++;
+    }
+  }
+
+  const size_t size = m_levelOffsets.back();
+  std::vector<uint32_t> parents(size);
+  std::vector<Mat4x4f> locals(size);
+  std::vector<Mat4x4f> worlds(size);
+  std::vector<Mat4x4f> previousWorlds(size);
+  std::vector<uint32_t> updatedIn(size);
+  std::vector<uint8_t> dirty(size);
+  std::vector<NodeId> nodeIds(size);
+  std::vector<uint32_t> newDepths(size);
+
+  m_minDirtyDepth = std::numeric_limits<uint32_t>::max();
+
+  for (uint32_t i = 0; i < n; ++i) {
+    uint32_t pos = newPositions[i];
+    if (pos == NULL_NODE) {
+      continue;
+    }
+
+    parents[pos] = m_parents[i] == NULL_NODE ? NULL_NODE : newPositions[m_parents[i]];
+    locals[pos] = m_locals[i];
+    worlds[pos] = m_worlds[i];
+    previousWorlds[pos] = m_previousWorlds[i];
+    updatedIn[pos] = m_updatedIn[i];
+    dirty[pos] = m_dirty[i];
+    nodeIds[pos] = m_nodeIds[i];
+    newDepths[pos] = depths[i];
+    m_positions[m_nodeIds[i]] = pos;
+
+    if (dirty[pos]) {
+      m_minDirtyDepth = std::min(m_minDirtyDepth, depths[i]);
+    }
+  }
+
+  m_parents = std::move(parents);
+  m_locals = std::move(locals);
+  m_worlds = std::move(worlds);
+  m_previousWorlds = std::move(previousWorlds);
+  m_updatedIn = std::move(updatedIn);
+  m_dirty = std::move(dirty);
+  m_nodeIds = std::move(nodeIds);
+  m_depths = std::move(newDepths);
+
+  m_needsRebuild = false;
+}
+
+void TransformHierarchy::updateRange(size_t begin, size_t end)
+{
+  for (size_t i = begin; i < end; ++i) {
+    uint32_t p = m_parents[i];
+    if (m_dirty[i] || (p != NULL_NODE && m_dirty[p])) {
+      m_previousWorlds[i] = m_worlds[i];
+      m_worlds[i] = p == NULL_NODE ? m_locals[i] : m_worlds[p] * m_locals[i];
+      m_dirty[i] = 1;
+    }
+  }
+}
+
+void TransformHierarchy::update(std::vector<NodeId>& changed, const ParallelFor& parallelFor)
+{
+  ++m_updateCount;
+
+  if (m_needsRebuild) {
+    rebuild();
+  }
+
+  const size_t numLevels = m_levelOffsets.size() - 1;
+  if (m_minDirtyDepth >= numLevels) {
+    m_minDirtyDepth = std::numeric_limits<uint32_t>::max();
+    return;
+  }
+
+  for (size_t d = m_minDirtyDepth; d < numLevels; ++d) {
+    size_t begin = m_levelOffsets[d];
+    size_t end = m_levelOffsets[d + 1];
+
+    if (parallelFor && end - begin >= PARALLEL_THRESHOLD) {
+      parallelFor(end - begin, [this, begin](size_t b, size_t e) {
+        updateRange(begin + b, begin + e);
+      });
+    }
+    else {
+      updateRange(begin, end);
+    }
+  }
+
+  for (size_t i = m_levelOffsets[m_minDirtyDepth]; i < m_nodeIds.size(); ++i) {
+    if (m_dirty[i]) {
+      changed.push_back(m_nodeIds[i]);
+      m_updatedIn[i] = m_updateCount;
+      m_dirty[i] = 0;
+    }
+  }
+
+  m_minDirtyDepth = std::numeric_limits<uint32_t>::max();
+}
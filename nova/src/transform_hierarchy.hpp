@@ -0,0 +1,75 @@
+#pragma once
+
+#include "math.hpp"
+#include <vector>
+#include <functional>
+#include <limits>
+#include <cstdint>
+
+// Stores local and world transforms as structure-of-arrays, sorted by depth in the hierarchy, so
+// world transforms can be computed one level at a time with every parent finished before its
+// children. Structural changes (add, remove, reparent) are cheap; the arrays are re-sorted lazily
+// on the next update.
+class TransformHierarchy
+{
+  public:
+    using NodeId = uint32_t;
+    static constexpr NodeId NULL_NODE = std::numeric_limits<NodeId>::max();
+
+    // Should call fn(begin, end) over sub-ranges that together cover [0, n). Sub-ranges may run
+    // concurrently
+    using ParallelFor = std::function<void(size_t n, const std::function<void(size_t, size_t)>& fn)>;
+
+    // The world transform of the new node is computed immediately
+    NodeId add(const Mat4x4f& local, NodeId parent = NULL_NODE);
+    // Children of the removed node are attached to its parent. Takes constant time, as they're
+    // only found and reattached by the rebuild on the next update
+    void remove(NodeId node);
+    void setParent(NodeId node, NodeId parent);
+    void setLocal(NodeId node, const Mat4x4f& local);
+
+    const Mat4x4f& local(NodeId node) const;
+    const Mat4x4f& world(NodeId node) const;
+    // The world transform from before the most recent update, if that update changed it, and the
+    // current one otherwise. For drawing between the last two states of a fixed-step simulation
+    const Mat4x4f& previousWorld(NodeId node) const;
+    bool changedInLastUpdate(NodeId node) const;
+    NodeId parent(NodeId node) const;
+    bool contains(NodeId node) const;
+    size_t size() const;
+
+    // Recomputes world transforms of dirty nodes and their descendants, appending the ids of every
+    // node whose world transform was recomputed. Levels with enough nodes are split using
+    // parallelFor, if provided
+    void update(std::vector<NodeId>& changed, const ParallelFor& parallelFor = nullptr);
+
+  private:
+    // Indexed by position in depth order. Positions of removed nodes hold NULL_NODE in m_nodeIds
+    // until the next rebuild, but keep their parents so that their children can find the nearest
+    // live ancestor
+    std::vector<uint32_t> m_parents;
+    std::vector<Mat4x4f> m_locals;
+    std::vector<Mat4x4f> m_worlds;
+    std::vector<Mat4x4f> m_previousWorlds;
+    std::vector<uint32_t> m_updatedIn;   // The update that last changed the world transform
+    std::vector<uint8_t> m_dirty;
+    std::vector<NodeId> m_nodeIds;
+    std::vector<uint32_t> m_depths;
+    std::vector<uint32_t> m_levelOffsets{ 0 }; // Start of each level, plus the end
+
+    // Indexed by NodeId
+    std::vector<uint32_t> m_positions;
+    std::vector<NodeId> m_freeIds;
+
+    size_t m_size = 0;
+    uint32_t m_updateCount = 0;
+    uint32_t m_minDirtyDepth = std::numeric_limits<uint32_t>::max();
+    bool m_needsRebuild = false;
+
+    uint32_t position(NodeId node) const;
+    bool isRemoved(uint32_t pos) const;
+    uint32_t liveAncestor(uint32_t pos) const;
+    void markDirty(uint32_t pos);
+    void rebuild();
+    void updateRange(size_t begin, size_t end);
+};
@@ -2,9 +2,14 @@
 
 #include "utils.hpp"
 #include <array>
+#include <atomic>
 #include <cassert>
-#include <mutex>
+#include <cstdint>
 
+// Hands frames from one writer thread to one reader thread without either waiting for the other.
+// The writer and reader each own a buffer, and the third is shared. A single atomic word holds the
+// index of the shared buffer and a flag saying whether it's newer than the reader's, so each
+// handoff is one atomic exchange.
 template<typename T>
 class TripleBuffer
 {
@@ -13,16 +18,15 @@ class TripleBuffer
     //
     T& writeComplete()
     {
-      std::lock_guard lock(m_mutex);
-      m_timestamps[m_writeIndex] = ++m_frameCount;
-      std::swap(m_writeIndex, m_freeIndex);
-      assert(inRange<size_t>(m_writeIndex, 0u, 2u));
+      uint8_t shared = m_shared.exchange(m_writeIndex | NEW_DATA, std::memory_order_acq_rel);
+      m_writeIndex = shared & INDEX_MASK;
+      assert(inRange<uint8_t>(m_writeIndex, 0u, 2u));
       return m_items[m_writeIndex];
     }
 
     T& getWritable()
     {
-      assert(inRange<size_t>(m_writeIndex, 0u, 2u));
+      assert(inRange<uint8_t>(m_writeIndex, 0u, 2u));
       return m_items[m_writeIndex];
     }
 
@@ -30,27 +34,30 @@ class TripleBuffer
     //
     T& readComplete()
     {
-      std::lock_guard lock(m_mutex);
-      if (m_timestamps[m_freeIndex] > m_timestamps[m_readIndex]) {
-        std::swap(m_readIndex, m_freeIndex);
+      // Only the writer can change the shared word, and it always sets the flag, so the flag can't
+      // be cleared between the load and the exchange
+      if (m_shared.load(std::memory_order_relaxed) & NEW_DATA) {
+        uint8_t shared = m_shared.exchange(m_readIndex, std::memory_order_acq_rel);
+        m_readIndex = shared & INDEX_MASK;
       }
-      assert(inRange<size_t>(m_readIndex, 0u, 2u));
+      assert(inRange<uint8_t>(m_readIndex, 0u, 2u));
       return m_items[m_readIndex];
     }
 
     T& getReadable()
     {
-      assert(inRange<size_t>(m_readIndex, 0u, 2u));
+      assert(inRange<uint8_t>(m_readIndex, 0u, 2u));
       return m_items[m_readIndex];
     }
 
   private:
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t NEW_DATA = 0x4;
+
     std::array<T, 3> m_items{};
-    std::array<size_t, 3> m_timestamps{};
 
-    std::mutex m_mutex;
-    size_t m_writeIndex = 0;
-    size_t m_readIndex = 1;
-    size_t m_freeIndex = 2;
-    size_t m_frameCount = 0;
+    // Kept apart, as each is written by a different thread
+    alignas(64) uint8_t m_writeIndex = 0;
+    alignas(64) uint8_t m_readIndex = 1;
+    alignas(64) std::atomic<uint8_t> m_shared = 2;
 };
@@ -2,7 +2,19 @@
 
 #include "math.hpp"
 
-const size_t TARGET_FRAME_RATE = 60;
+// How often frames are drawn. This is separate from SIMULATION_RATE, as frames are drawn part way
+// between simulation steps
+enum class FrameRateMode
+{
+  Uncapped,
+  Vsync,    // Once per display refresh
+  Capped    // No more than MAX_FRAME_RATE
+};
+const FrameRateMode FRAME_RATE_MODE = FrameRateMode::Vsync;
+const size_t MAX_FRAME_RATE = 144;
+// Simulation steps per second, whatever the frame rate. Speeds and accelerations in gameplay code
+// are per step
+const size_t SIMULATION_RATE = 60;
 const float_t WORLD_UNITS_PER_METRE = 10;
 
 inline float_t metresToWorldUnits(float_t x)
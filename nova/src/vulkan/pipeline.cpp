@@ -7,6 +7,7 @@
 #include <shaderc/shaderc.hpp>
 #include <array>
 #include <numeric>
+#include <algorithm>
 #include <cstring>
 
 namespace render
@@ -532,32 +533,31 @@ void PipelineImpl::recordCommandBuffer(VkCommandBuffer commandBuffer, const Rend
   if (m_pipeline != bindState.pipeline) {
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
   }
-  std::vector<VkBuffer> vertexBuffers{ buffers.vertexBuffer };
-  if (node.mesh.features.flags.test(MeshFeatures::IsInstanced)) {
-    vertexBuffers.push_back(buffers.instanceBuffer);
-  }
-  std::vector<VkDeviceSize> offsets(vertexBuffers.size(), 0);
-  vkCmdBindVertexBuffers(commandBuffer, 0, static_cast<uint32_t>(vertexBuffers.size()),
-    vertexBuffers.data(), offsets.data());
+  std::array<VkBuffer, 2> vertexBuffers{ buffers.vertexBuffer, buffers.instanceBuffer };
+  std::array<VkDeviceSize, 2> offsets{ 0, 0 };
+  uint32_t numVertexBuffers = node.mesh.features.flags.test(MeshFeatures::IsInstanced) ? 2 : 1;
+  vkCmdBindVertexBuffers(commandBuffer, 0, numVertexBuffers, vertexBuffers.data(), offsets.data());
   vkCmdBindIndexBuffer(commandBuffer, buffers.indexBuffer, 0, VK_INDEX_TYPE_UINT16);
 
-  std::vector<VkDescriptorSet> descriptorSets{
+  std::array<VkDescriptorSet, BindState::MAX_DESCRIPTOR_SETS> descriptorSets{
     globalDescriptorSet,
     renderPassDescriptorSet,
-    materialDescriptorSet
+    materialDescriptorSet,
+    objectDescriptorSet
   };
-  if (objectDescriptorSet != VK_NULL_HANDLE) {
-    descriptorSets.push_back(objectDescriptorSet);
-  }
+  uint32_t numDescriptorSets = objectDescriptorSet != VK_NULL_HANDLE ? 4 : 3;
+
+  if (numDescriptorSets != bindState.numDescriptorSets
+    || !std::equal(descriptorSets.begin(), descriptorSets.begin() + numDescriptorSets,
+      bindState.descriptorSets.begin())) {
 
-  if (descriptorSets != bindState.descriptorSets) {
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_layout, 0,
-      static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr);
+      numDescriptorSets, descriptorSets.data(), 0, nullptr);
   }
   if (!node.mesh.features.flags.test(MeshFeatures::IsInstanced)
     && !node.mesh.features.flags.test(MeshFeatures::IsSkybox)) {
 
-    auto& defaultNode = dynamic_cast<const DefaultModelNode&>(node);
+    auto& defaultNode = static_cast<const DefaultModelNode&>(node);
 
     vkCmdPushConstants(commandBuffer, m_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Mat4x4f),
       &defaultNode.modelMatrix);
@@ -571,6 +571,7 @@ void PipelineImpl::recordCommandBuffer(VkCommandBuffer commandBuffer, const Rend
 
   bindState.pipeline = m_pipeline;
   bindState.descriptorSets = descriptorSets;
+  bindState.numDescriptorSets = numDescriptorSets;
 }
 
 ShaderProgram PipelineImpl::compileShaderProgram(RenderPass renderPass,
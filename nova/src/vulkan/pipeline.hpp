@@ -1,10 +1,12 @@
 #pragma once
 
-#include "tree_set.hpp"
+#include "frame_arena.hpp"
 #include "renderer.hpp"
 #include "vulkan/render_resources.hpp"
 #include <vulkan/vulkan.h>
 #include <optional>
+#include <array>
+#include <span>
 
 class Logger;
 class FileSystem;
@@ -19,6 +21,9 @@ enum class RenderNodeType
   Skybox
 };
 
+// Nodes live in the frame's arena and are never destroyed, so they hold only plain data, and are
+// told apart by type rather than with dynamic_cast. Each frame's nodes are drawn in the order of
+// a sorted DrawList
 struct RenderNode
 {
   RenderNode(RenderNodeType type)
@@ -27,14 +32,8 @@ struct RenderNode
   RenderNodeType type;
   MeshHandle mesh;
   MaterialHandle material;
-
-  virtual ~RenderNode() = default;
 };
 
-using RenderGraphKey = long;
-using RenderNodePtr = std::unique_ptr<RenderNode>;
-using RenderGraph = TreeSet<RenderGraphKey, RenderNodePtr>;
-
 struct PipelineKey
 {
   RenderPass renderPass;
@@ -51,7 +50,7 @@ struct DefaultModelNode : public RenderNode
   {}
 
   Mat4x4f modelMatrix;
-  std::optional<std::vector<Mat4x4f>> jointTransforms;
+  std::span<const Mat4x4f> jointTransforms;   // Empty if not animated
 };
 
 struct InstancedModelNode : public RenderNode
@@ -60,7 +59,7 @@ struct InstancedModelNode : public RenderNode
     : RenderNode(RenderNodeType::InstancedModel)
   {}
 
-  std::vector<MeshInstance> instances;
+  ArenaVector<MeshInstance> instances;
 };
 
 struct SkyboxNode : public RenderNode
@@ -72,8 +71,11 @@ struct SkyboxNode : public RenderNode
 
 struct BindState
 {
+  static constexpr size_t MAX_DESCRIPTOR_SETS = 4;
+
   VkPipeline pipeline;
-  std::vector<VkDescriptorSet> descriptorSets;
+  std::array<VkDescriptorSet, MAX_DESCRIPTOR_SETS> descriptorSets;
+  uint32_t numDescriptorSets;
 };
 
 class Pipeline
@@ -112,10 +112,10 @@ class RenderResourcesImpl : public RenderResources
     //
     MeshHandle addMesh(MeshPtr mesh) override;
     void removeMesh(RenderItemId id) override;
-    void updateJointTransforms(RenderItemId meshId, const std::vector<Mat4x4f>& joints,
+    void updateJointTransforms(RenderItemId meshId, std::span<const Mat4x4f> joints,
       size_t currentFrame) override;
     MeshBuffers getMeshBuffers(RenderItemId id) const override;
-    void updateMeshInstances(RenderItemId id, const std::vector<MeshInstance>& instances) override;
+    void updateMeshInstances(RenderItemId id, std::span<const MeshInstance> instances) override;
     const MeshFeatureSet& getMeshFeatures(RenderItemId id) const override;
 
     // Materials
@@ -186,7 +186,7 @@ class RenderResourcesImpl : public RenderResources
       VkBuffer& buffer, VkDeviceMemory& bufferMemory);
     VkBuffer createVertexBuffer(const Mesh& mesh, VkDeviceMemory& vertexBufferMemory);
     VkBuffer createInstanceBuffer(size_t maxInstances, VkDeviceMemory& instanceBufferMemory);
-    void updateInstanceBuffer(const std::vector<MeshInstance>& instanceData, VkBuffer buffer);
+    void updateInstanceBuffer(std::span<const MeshInstance> instanceData, VkBuffer buffer);
     void createTextureSampler();
     void createNormalMapSampler();
     void createCubeMapSampler();
@@ -480,7 +480,7 @@ MeshBuffers RenderResourcesImpl::getMeshBuffers(RenderItemId id) const
 
 // TODO: This is far too slow
 void RenderResourcesImpl::updateMeshInstances(RenderItemId id,
-  const std::vector<MeshInstance>& instances)
+  std::span<const MeshInstance> instances)
 {
   DBG_TRACE(m_logger);
 
@@ -493,7 +493,7 @@ void RenderResourcesImpl::updateMeshInstances(RenderItemId id,
   updateInstanceBuffer(instances, mesh->instanceBuffer);
 }
 
-void RenderResourcesImpl::updateJointTransforms(RenderItemId id, const std::vector<Mat4x4f>& joints,
+void RenderResourcesImpl::updateJointTransforms(RenderItemId id, std::span<const Mat4x4f> joints,
   size_t currentFrame)
 {
   DBG_ASSERT(joints.size() <= MAX_JOINTS, "Max number of joints exceeded");
@@ -875,7 +875,7 @@ VkBuffer RenderResourcesImpl::createInstanceBuffer(size_t maxInstances,
   return buffer;
 }
 
-void RenderResourcesImpl::updateInstanceBuffer(const std::vector<MeshInstance>& instances,
+void RenderResourcesImpl::updateInstanceBuffer(std::span<const MeshInstance> instances,
   VkBuffer buffer)
 {
   DBG_TRACE(m_logger);
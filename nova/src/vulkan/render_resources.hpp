@@ -2,6 +2,7 @@
 
 #include "renderer.hpp"
 #include <vulkan/vulkan.h>
+#include <span>
 
 class Logger;
 
@@ -102,11 +103,11 @@ class RenderResources
     //
     virtual MeshHandle addMesh(MeshPtr mesh) = 0;
     virtual void removeMesh(RenderItemId id) = 0;
-    virtual void updateJointTransforms(RenderItemId meshId, const std::vector<Mat4x4f>& joints,
+    virtual void updateJointTransforms(RenderItemId meshId, std::span<const Mat4x4f> joints,
       size_t currentFrame) = 0;
     virtual MeshBuffers getMeshBuffers(RenderItemId id) const = 0;
     virtual void updateMeshInstances(RenderItemId id,
-      const std::vector<MeshInstance>& instances) = 0;
+      std::span<const MeshInstance> instances) = 0;
     virtual const MeshFeatureSet& getMeshFeatures(RenderItemId id) const = 0;
 
     // Materials
@@ -11,6 +11,8 @@
 #include "time.hpp"
 #include "thread.hpp"
 #include "triple_buffer.hpp"
+#include "frame_arena.hpp"
+#include "draw_list.hpp"
 #include "trace.hpp"
 #include <array>
 #include <vector>
@@ -62,7 +64,8 @@ struct SwapChainSupportDetails
 class RendererImpl : public Renderer
 {
   public:
-    RendererImpl(const FileSystem& fileSystem, VulkanWindowDelegate& window, Logger& logger);
+    RendererImpl(const FileSystem& fileSystem, VulkanWindowDelegate& window, Logger& logger,
+      bool vsync);
 
     void start() override;
     void onResize() override;
@@ -149,17 +152,19 @@ class RendererImpl : public Renderer
     void createSyncObjects();
     void renderLoop();
     void cleanUp();
-    void recordCommandBuffer(RenderPass renderPass, const RenderGraph& renderGraph,
-      VkCommandBuffer commandBuffer);
-    RenderGraph::Key generateRenderGraphKey(MeshHandle mesh, MaterialHandle material) const;
+    void recordCommandBuffer(RenderPass renderPass,
+      std::span<const DrawList<RenderNode>::Entry> draws, VkCommandBuffer commandBuffer);
+    uint64_t generateDrawKey(RenderPass renderPass, const MeshHandle& mesh,
+      const MaterialHandle& material, float_t depth) const;
     Pipeline& choosePipeline(RenderPass renderPass, const RenderNode& node);
     void drawModelInternal(MeshHandle mesh, MaterialHandle material, const Mat4x4f& transform,
-      const std::optional<std::vector<Mat4x4f>>& jointTransforms);
+      std::span<const Mat4x4f> jointTransforms);
 
     ViewParams m_viewParams;
     const FileSystem& m_fileSystem;
     VulkanWindowDelegate& m_window;
     Logger& m_logger;
+    bool m_vsync;
     VkInstance m_instance;
     VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
     VkPhysicalDeviceLimits m_deviceLimits;
@@ -188,10 +193,19 @@ class RendererImpl : public Renderer
     std::vector<VkSemaphore> m_renderFinishedSemaphores;
     std::vector<VkFence> m_inFlightFences;
 
+    struct InstancedNodeEntry
+    {
+      std::pair<RenderItemId, RenderItemId> key;    // Mesh and material
+      InstancedModelNode* node;
+    };
+
     struct RenderPassState
     {
-      RenderGraph graph;
-      std::map<RenderGraph::Key, RenderNode*> lookup;
+      bool active = false;
+      // One node per instanced mesh and material, sorted by key for binary search. Nodes are only
+      // inserted the first time a mesh and material are drawn in a frame, and the vector keeps
+      // its capacity when cleared
+      std::vector<InstancedNodeEntry> instancedNodes;
       Vec3f viewPos;
       Mat4x4f viewMatrix;
     };
@@ -212,11 +226,27 @@ class RendererImpl : public Renderer
       LightState lights[MAX_LIGHTS];
     };
 
+    static constexpr size_t NUM_RENDER_PASSES = static_cast<size_t>(RenderPass::Ssr) + 1;
+
+    // Each slot of the triple buffer keeps its passes, draw list, and arena from one frame to the
+    // next, so once they've grown to fit a frame, recording one doesn't allocate
     struct FrameState
     {
-      std::map<RenderPass, RenderPassState> renderPasses;
+      FrameArena arena;
+      DrawList<RenderNode> drawList;    // Every pass's draws, sorted by endFrame()
+      std::array<RenderPassState, NUM_RENDER_PASSES> renderPasses;
       LightingState lighting;
       std::optional<RenderPass> currentRenderPass;
+
+      RenderPassState& pass(RenderPass renderPass)
+      {
+        return renderPasses[static_cast<size_t>(renderPass)];
+      }
+
+      std::span<const DrawList<RenderNode>::Entry> draws(RenderPass renderPass) const
+      {
+        return drawList.range(firstDrawKey(renderPass), lastDrawKey(renderPass));
+      }
     };
 
     TripleBuffer<FrameState> m_frameStates;
@@ -235,10 +265,11 @@ class RendererImpl : public Renderer
 };
 
 RendererImpl::RendererImpl(const FileSystem& fileSystem, VulkanWindowDelegate& window,
-  Logger& logger)
+  Logger& logger, bool vsync)
   : m_fileSystem(fileSystem)
   , m_window(window)
   , m_logger(logger)
+  , m_vsync(vsync)
 {
   DBG_TRACE(m_logger);
 
@@ -250,7 +281,7 @@ RendererImpl::RendererImpl(const FileSystem& fileSystem, VulkanWindowDelegate& w
     .farPlane = 10000.f
   };
 
-  m_frameStates.getReadable().renderPasses[RenderPass::Main] = RenderPassState{};
+  m_frameStates.getReadable().pass(RenderPass::Main).active = true;
 
   m_thread.run<void>([this]() {
     createInstance();
@@ -346,41 +377,31 @@ const ViewParams& RendererImpl::getViewParams() const
   return m_viewParams;
 }
 
-RenderGraph::Key RendererImpl::generateRenderGraphKey(MeshHandle mesh,
-  MaterialHandle material) const
+uint64_t RendererImpl::generateDrawKey(RenderPass renderPass, const MeshHandle& mesh,
+  const MaterialHandle& material, float_t depth) const
 {
   PipelineKey pipelineKey{
-    .renderPass = RenderPass::Main,
+    .renderPass = renderPass,
     .meshFeatures = mesh.features,
     .materialFeatures = material.features
   };
-  auto pipelineHash = std::hash<PipelineKey>{}(pipelineKey);
-
-  if (mesh.features.flags.test(MeshFeatures::IsInstanced)) {
-    return RenderGraph::Key{
-      static_cast<RenderGraphKey>(material.features.flags.test(MaterialFeatures::HasTransparency)),
-      static_cast<RenderGraphKey>(pipelineHash),
-      static_cast<RenderGraphKey>(mesh.id),
-      static_cast<RenderGraphKey>(material.id)
-    };
-  }
-  else if (mesh.features.flags.test(MeshFeatures::IsSkybox)) {
-    return RenderGraph::Key{
-      static_cast<RenderGraphKey>(material.features.flags.test(MaterialFeatures::HasTransparency)),
-      static_cast<RenderGraphKey>(pipelineHash)
-    };
+
+  DrawLayer layer = DrawLayer::Opaque;
+  if (mesh.features.flags.test(MeshFeatures::IsSkybox)) {
+    layer = DrawLayer::Background;
   }
-  else {
-    static RenderGraphKey nextId = 0;
-
-    return RenderGraph::Key{
-      static_cast<RenderGraphKey>(material.features.flags.test(MaterialFeatures::HasTransparency)),
-      static_cast<RenderGraphKey>(pipelineHash),
-      static_cast<RenderGraphKey>(mesh.id),
-      static_cast<RenderGraphKey>(material.id),
-      nextId++
-    };
+  else if (material.features.flags.test(MaterialFeatures::HasTransparency)) {
+    layer = DrawLayer::Transparent;
   }
+
+  return packDrawKey(DrawKey{
+    .pass = renderPass,
+    .layer = layer,
+    .pipeline = std::hash<PipelineKey>{}(pipelineKey),
+    .material = material.id,
+    .mesh = mesh.id,
+    .depth = depth
+  });
 }
 
 void RendererImpl::drawInstance(MeshHandle mesh, MaterialHandle material, const Mat4x4f& transform)
@@ -388,24 +409,25 @@ void RendererImpl::drawInstance(MeshHandle mesh, MaterialHandle material, const
   //DBG_TRACE(m_logger);
 
   FrameState& frameState = m_frameStates.getWritable();
-  RenderPassState& state = frameState.renderPasses.at(frameState.currentRenderPass.value());
-  RenderGraph& renderGraph = state.graph;
+  RenderPass renderPass = frameState.currentRenderPass.value();
+  RenderPassState& state = frameState.pass(renderPass);
+
+  std::pair<RenderItemId, RenderItemId> key{ mesh.id, material.id };
+  auto i = std::lower_bound(state.instancedNodes.begin(), state.instancedNodes.end(), key,
+    [](const InstancedNodeEntry& entry, const auto& k) { return entry.key < k; });
 
-  auto key = generateRenderGraphKey(mesh, material);
   InstancedModelNode* node = nullptr;
-  auto i = state.lookup.find(key);
-  if (i != state.lookup.end()) {
-    node = dynamic_cast<InstancedModelNode*>(i->second);
+  if (i != state.instancedNodes.end() && i->key == key) {
+    node = i->node;
   }
   else {
-    auto newNode = std::make_unique<InstancedModelNode>();
-    newNode->mesh = mesh;
-    newNode->material = material;
-    node = newNode.get();
-    renderGraph.insert(key, std::move(newNode));
-    state.lookup.insert({ key, node });
+    node = frameState.arena.create<InstancedModelNode>();
+    node->mesh = mesh;
+    node->material = material;
+    frameState.drawList.add(generateDrawKey(renderPass, mesh, material, 0.f), node);
+    state.instancedNodes.insert(i, InstancedNodeEntry{ key, node });
   }
-  node->instances.push_back(MeshInstance{transform * mesh.transform});
+  node->instances.push_back(frameState.arena, MeshInstance{transform * mesh.transform});
 }
 
 void RendererImpl::drawModel(MeshHandle mesh, MaterialHandle material, const Mat4x4f& transform,
@@ -418,28 +440,28 @@ void RendererImpl::drawModel(MeshHandle mesh, MaterialHandle material, const Mat
 {
   //DBG_TRACE(m_logger);
 
-  drawModelInternal(mesh, material, transform, std::nullopt);
+  drawModelInternal(mesh, material, transform, {});
 }
 
 void RendererImpl::drawModelInternal(MeshHandle mesh, MaterialHandle material,
-  const Mat4x4f& transform, const std::optional<std::vector<Mat4x4f>>& jointTransforms)
+  const Mat4x4f& transform, std::span<const Mat4x4f> jointTransforms)
 {
   //DBG_TRACE(m_logger);
 
   FrameState& frameState = m_frameStates.getWritable();
-  RenderPassState& state = frameState.renderPasses.at(frameState.currentRenderPass.value());
-  RenderGraph& renderGraph = state.graph;
+  RenderPass renderPass = frameState.currentRenderPass.value();
+  RenderPassState& state = frameState.pass(renderPass);
 
-  auto node = std::make_unique<DefaultModelNode>();
+  auto node = frameState.arena.create<DefaultModelNode>();
   node->mesh = mesh;
   node->material = material;
   node->modelMatrix = transform;
-  node->jointTransforms = jointTransforms;
+  node->jointTransforms = frameState.arena.copy(jointTransforms);
 
-  auto key = generateRenderGraphKey(mesh, material);
+  float_t distance = (getTranslation(transform) - state.viewPos).magnitude();
+  float_t depth = distance / m_viewParams.farPlane;
 
-  state.lookup.insert({ key, node.get() });
-  renderGraph.insert(key, std::move(node));
+  frameState.drawList.add(generateDrawKey(renderPass, mesh, material, depth), node);
 }
 
 void RendererImpl::drawLight(const Vec3f& colour, float_t ambient, float_t specular,
@@ -462,17 +484,14 @@ void RendererImpl::drawSkybox(MeshHandle mesh, MaterialHandle material)
   //DBG_TRACE(m_logger);
 
   FrameState& frameState = m_frameStates.getWritable();
-  RenderPassState& state = frameState.renderPasses.at(frameState.currentRenderPass.value());
-  RenderGraph& renderGraph = state.graph;
+  RenderPass renderPass = frameState.currentRenderPass.value();
 
-  auto node = std::make_unique<SkyboxNode>();
+  auto node = frameState.arena.create<SkyboxNode>();
   node->mesh = mesh;
   node->material = material;
 
-  auto key = generateRenderGraphKey(mesh, material);
-
-  state.lookup.insert({ key, node.get() });
-  renderGraph.insert(key, std::move(node));
+  // The mesh is flagged as a skybox, so the key puts it after the pass's opaque draws
+  frameState.drawList.add(generateDrawKey(renderPass, mesh, material, 1.f), node);
 }
 
 void RendererImpl::beginFrame()
@@ -482,7 +501,13 @@ void RendererImpl::beginFrame()
   auto& state = m_frameStates.getWritable();
   state.lighting = LightingState{};
   state.currentRenderPass = std::nullopt;
-  state.renderPasses.clear();
+  for (auto& renderPass : state.renderPasses) {
+    renderPass.active = false;
+    renderPass.instancedNodes.clear();
+  }
+  // The render thread is done with this slot, so the nodes in the draw list can go
+  state.drawList.clear();
+  state.arena.reset();
 }
 
 void RendererImpl::beginPass(RenderPass renderPass, const Vec3f& viewPos, const Mat4x4f& viewMatrix)
@@ -492,7 +517,8 @@ void RendererImpl::beginPass(RenderPass renderPass, const Vec3f& viewPos, const
   auto& state = m_frameStates.getWritable();
   state.currentRenderPass = renderPass;
 
-  auto& renderPassState = state.renderPasses[renderPass];
+  auto& renderPassState = state.pass(renderPass);
+  renderPassState.active = true;
   renderPassState.viewPos = viewPos;
   renderPassState.viewMatrix = viewMatrix;
 }
@@ -533,7 +559,7 @@ void RendererImpl::renderLoop()
         "Failed to begin recording command buffer");
 
       auto& frameState = m_frameStates.getReadable();
-      if (frameState.renderPasses.contains(RenderPass::Shadow)) {
+      if (frameState.pass(RenderPass::Shadow).active) {
         doShadowRenderPass(commandBuffer);
       }
       doMainRenderPass(commandBuffer, m_imageIndex);
@@ -563,7 +589,7 @@ void RendererImpl::renderLoop()
 void RendererImpl::updateCameraTransformsUbo()
 {
   auto& frameState = m_frameStates.getReadable();
-  auto& renderPassState = frameState.renderPasses.at(RenderPass::Main);
+  auto& renderPassState = frameState.pass(RenderPass::Main);
 
   CameraTransformsUbo cameraTransformsUbo{
     .viewMatrix = renderPassState.viewMatrix,
@@ -588,7 +614,7 @@ void RendererImpl::updateLightTransformsUbo()
 void RendererImpl::updateLightingUbo()
 {
   auto& frameState = m_frameStates.getReadable();
-  auto& renderPassState = frameState.renderPasses.at(RenderPass::Main);
+  auto& renderPassState = frameState.pass(RenderPass::Main);
 
   LightingUbo lightingUbo{
     .viewPos = renderPassState.viewPos,
@@ -618,6 +644,8 @@ void RendererImpl::endFrame()
 {
   DBG_TRACE(m_logger);
 
+  // Sorted here so the render thread only has to walk the list
+  m_frameStates.getWritable().drawList.sort();
   m_frameStates.writeComplete();
 }
 
@@ -724,10 +752,20 @@ VkExtent2D RendererImpl::chooseSwapChainExtent(
 VkPresentModeKHR RendererImpl::chooseSwapChainPresentMode(
   const std::vector<VkPresentModeKHR>& availableModes) const
 {
-  for (auto& mode : availableModes) {
-    if (mode == VK_PRESENT_MODE_MAILBOX_KHR) {
-      return mode;
-    }
+  // FIFO is always available, and waits for vertical blank
+  if (m_vsync) {
+    return VK_PRESENT_MODE_FIFO_KHR;
+  }
+
+  auto available = [&](VkPresentModeKHR mode) {
+    return std::find(availableModes.begin(), availableModes.end(), mode) != availableModes.end();
+  };
+
+  if (available(VK_PRESENT_MODE_MAILBOX_KHR)) {
+    return VK_PRESENT_MODE_MAILBOX_KHR;
+  }
+  if (available(VK_PRESENT_MODE_IMMEDIATE_KHR)) {
+    return VK_PRESENT_MODE_IMMEDIATE_KHR;
   }
 
   return VK_PRESENT_MODE_FIFO_KHR;
@@ -1130,22 +1168,24 @@ Pipeline& RendererImpl::choosePipeline(RenderPass renderPass, const RenderNode&
   return *i->second;
 };
 
-void RendererImpl::recordCommandBuffer(RenderPass renderPass, const RenderGraph& renderGraph,
-  VkCommandBuffer commandBuffer)
+void RendererImpl::recordCommandBuffer(RenderPass renderPass,
+  std::span<const DrawList<RenderNode>::Entry> draws, VkCommandBuffer commandBuffer)
 {
   BindState bindState{};
-  for (auto& node : renderGraph) {
+  for (auto& draw : draws) {
+    const RenderNode* node = draw.item;
+
     switch (node->type) {
       case RenderNodeType::DefaultModel: {
-        auto& modelNode = dynamic_cast<const DefaultModelNode&>(*node);
-        if (modelNode.jointTransforms.has_value()) {
-          auto& joints = modelNode.jointTransforms.value();
-          m_resources->updateJointTransforms(modelNode.mesh.id, joints, m_currentFrame);
+        auto& modelNode = static_cast<const DefaultModelNode&>(*node);
+        if (!modelNode.jointTransforms.empty()) {
+          m_resources->updateJointTransforms(modelNode.mesh.id, modelNode.jointTransforms,
+            m_currentFrame);
         }
         break;
       }
       case RenderNodeType::InstancedModel: {
-        auto& instancedNode = dynamic_cast<const InstancedModelNode&>(*node);
+        auto& instancedNode = static_cast<const InstancedModelNode&>(*node);
         m_resources->updateMeshInstances(instancedNode.mesh.id, instancedNode.instances);
         break;
       }
@@ -1216,10 +1256,7 @@ void RendererImpl::doShadowRenderPass(VkCommandBuffer commandBuffer)
   vkCmdBeginRenderingFn(commandBuffer, &renderingInfo);
 
   auto& frameState = m_frameStates.getReadable();
-  auto& renderPassState = frameState.renderPasses.at(RenderPass::Shadow);
-  const auto& renderGraph = renderPassState.graph;
-
-  recordCommandBuffer(RenderPass::Shadow, renderGraph, commandBuffer);
+  recordCommandBuffer(RenderPass::Shadow, frameState.draws(RenderPass::Shadow), commandBuffer);
 
   vkCmdEndRenderingFn(commandBuffer);
 
@@ -1322,10 +1359,7 @@ void RendererImpl::doMainRenderPass(VkCommandBuffer commandBuffer, uint32_t imag
   vkCmdBeginRenderingFn(commandBuffer, &renderingInfo);
 
   auto& frameState = m_frameStates.getReadable();
-  auto& renderPassState = frameState.renderPasses.at(RenderPass::Main);
-  const auto& renderGraph = renderPassState.graph;
-
-  recordCommandBuffer(RenderPass::Main, renderGraph, commandBuffer);
+  recordCommandBuffer(RenderPass::Main, frameState.draws(RenderPass::Main), commandBuffer);
 
   vkCmdEndRenderingFn(commandBuffer);
 
@@ -1651,8 +1685,8 @@ RendererImpl::~RendererImpl()
 } // namespace render
 
 render::RendererPtr createRenderer(const FileSystem& fileSystem, WindowDelegate& window,
-  Logger& logger)
+  Logger& logger, bool vsync)
 {
   return std::make_unique<render::RendererImpl>(fileSystem,
-    dynamic_cast<VulkanWindowDelegate&>(window), logger);
+    dynamic_cast<VulkanWindowDelegate&>(window), logger, vsync);
 }
@@ -0,0 +1,172 @@
+#include <agent_broadphase.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+
+namespace
+{
+
+using Pair = AgentBroadphase::Pair;
+
+std::vector<Pair> sortedPairs(std::vector<Pair> pairs)
+{
+  std::sort(pairs.begin(), pairs.end(), [](const Pair& p, const Pair& q) {
+    return p.a < q.a || (p.a == q.a && p.b < q.b);
+  });
+  return pairs;
+}
+
+std::vector<Pair> bruteForcePairs(const std::vector<Vec2f>& positions,
+  const std::vector<float_t>& radii, const std::vector<bool>& alive)
+{
+  std::vector<Pair> pairs;
+  for (uint32_t a = 0; a < positions.size(); ++a) {
+    for (uint32_t b = a + 1; b < positions.size(); ++b) {
+      if (!alive[a] || !alive[b]) {
+        continue;
+      }
+      float_t r = radii[a] + radii[b];
+      Vec2f d = positions[b] - positions[a];
+      if (d.dot(d) < r * r) {
+        pairs.push_back({ a, b });
+      }
+    }
+  }
+  return pairs;
+}
+
+bool pairsEqual(const std::vector<Pair>& p, const std::vector<Pair>& q)
+{
+  return p.size() == q.size() && std::equal(p.begin(), p.end(), q.begin(),
+    [](const Pair& x, const Pair& y) { return x.a == y.a && x.b == y.b; });
+}
+
+} // namespace
+
+class AgentBroadphaseTest : public testing::Test
+{
+  public:
+    virtual void SetUp() override {}
+
+    virtual void TearDown() override {}
+};
+
+TEST_F(AgentBroadphaseTest, finds_only_overlapping_pairs)
+{
+  AgentBroadphase broadphase;
+  uint32_t a = broadphase.addAgent({ 0.f, 0.f }, 0.5f);
+  uint32_t b = broadphase.addAgent({ 0.9f, 0.f }, 0.5f);
+  broadphase.addAgent({ 0.f, 1.1f }, 0.5f);
+  // Bounding boxes overlap, but the circles don't
+  broadphase.addAgent({ 2.75f, 0.75f }, 0.5f);
+  broadphase.addAgent({ 2.f, 0.f }, 0.5f);
+
+  auto& pairs = broadphase.findPairs();
+
+  ASSERT_EQ(1, pairs.size());
+  EXPECT_EQ(a, pairs[0].a);
+  EXPECT_EQ(b, pairs[0].b);
+}
+
+TEST_F(AgentBroadphaseTest, matches_brute_force_as_agents_move)
+{
+  AgentBroadphase broadphase;
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> p(0.f, 50.f);
+  std::uniform_real_distribution<float_t> r(0.2f, 0.8f);
+  std::uniform_real_distribution<float_t> step(-0.3f, 0.3f);
+
+  std::vector<Vec2f> positions;
+  std::vector<float_t> radii;
+  std::vector<bool> alive;
+  for (int i = 0; i < 1000; ++i) {
+    positions.push_back({ p(gen), p(gen) });
+    radii.push_back(r(gen));
+    alive.push_back(true);
+    ASSERT_EQ(i, broadphase.addAgent(positions.back(), radii.back()));
+  }
+
+  for (int frame = 0; frame < 20; ++frame) {
+    for (uint32_t i = 0; i < positions.size(); ++i) {
+      if (alive[i]) {
+        positions[i] += Vec2f{ step(gen), step(gen) };
+        broadphase.setPosition(i, positions[i]);
+      }
+    }
+
+    // Churn some agents
+    uint32_t removed = static_cast<uint32_t>(frame * 37 % positions.size());
+    if (alive[removed]) {
+      broadphase.removeAgent(removed);
+      alive[removed] = false;
+    }
+
+    auto pairs = sortedPairs(broadphase.findPairs());
+    ASSERT_TRUE(pairsEqual(bruteForcePairs(positions, radii, alive), pairs)) << "Frame " << frame;
+  }
+}
+
+TEST_F(AgentBroadphaseTest, separation_pushes_pair_apart_equally)
+{
+  AgentBroadphase broadphase;
+  uint32_t a = broadphase.addAgent({ 0.f, 0.f }, 0.5f);
+  uint32_t b = broadphase.addAgent({ 0.6f, 0.f }, 0.5f);
+  uint32_t c = broadphase.addAgent({ 5.f, 0.f }, 0.5f);
+
+  broadphase.findPairs();
+
+  std::vector<Vec2f> displacements(broadphase.capacity());
+  broadphase.separation(displacements);
+
+  EXPECT_FLOAT_EQ(-0.2f, displacements[a][0]);
+  EXPECT_FLOAT_EQ(0.2f, displacements[b][0]);
+  EXPECT_FLOAT_EQ(0.f, displacements[a][1]);
+  EXPECT_FLOAT_EQ(0.f, displacements[c][0]);
+}
+
+TEST_F(AgentBroadphaseTest, repeated_separation_spreads_out_a_crowd)
+{
+  AgentBroadphase broadphase;
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> p(0.f, 20.f);
+  for (int i = 0; i < 200; ++i) {
+    broadphase.addAgent({ p(gen), p(gen) }, 0.3f);
+  }
+
+  size_t initialPairs = broadphase.findPairs().size();
+  ASSERT_GT(initialPairs, 0);
+
+  std::vector<Vec2f> displacements(broadphase.capacity());
+  for (int i = 0; i < 50; ++i) {
+    broadphase.findPairs();
+    broadphase.separation(displacements);
+    for (uint32_t id = 0; id < broadphase.capacity(); ++id) {
+      broadphase.setPosition(id, broadphase.position(id) + displacements[id]);
+    }
+  }
+
+  // Pairs left touching may still count as overlapping, but only just
+  float_t deepest = 0.f;
+  for (auto& pair : broadphase.findPairs()) {
+    float_t distance = (broadphase.position(pair.b) - broadphase.position(pair.a)).magnitude();
+    deepest = std::max(deepest, 0.6f - distance);
+  }
+  EXPECT_LT(deepest, 0.01f);
+}
+
+TEST_F(AgentBroadphaseTest, removed_ids_are_reused)
+{
+  AgentBroadphase broadphase;
+  broadphase.addAgent({ 0.f, 0.f }, 0.5f);
+  uint32_t id = broadphase.addAgent({ 0.5f, 0.f }, 0.5f);
+  broadphase.removeAgent(id);
+
+  EXPECT_EQ(1, broadphase.numAgents());
+  EXPECT_TRUE(broadphase.findPairs().empty());
+  EXPECT_THROW(broadphase.removeAgent(id), std::exception);
+
+  EXPECT_EQ(id, broadphase.addAgent({ 10.f, 0.f }, 0.5f));
+  EXPECT_EQ(2, broadphase.capacity());
+}
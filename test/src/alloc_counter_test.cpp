@@ -0,0 +1,43 @@
+#include "alloc_counter.hpp"
+#include <gtest/gtest.h>
+#include <new>
+
+class AllocCounterTest : public testing::Test
+{
+  public:
+    virtual void SetUp() override {}
+
+    virtual void TearDown() override {}
+};
+
+struct alignas(64) OverAligned
+{
+  char data[64];
+};
+
+TEST_F(AllocCounterTest, counts_every_form_of_new)
+{
+  size_t before = allocationCount();
+
+  // Through volatile pointers, so the compiler can't leave out the allocations
+  int* volatile p = new int;
+  delete p;
+  p = new int[4];
+  delete[] p;
+  p = new (std::nothrow) int;
+  delete p;
+  p = new (std::nothrow) int[4];
+  delete[] p;
+
+  OverAligned* volatile q = new OverAligned;
+  ASSERT_EQ(0, reinterpret_cast<uintptr_t>(q) % 64);
+  delete q;
+  q = new OverAligned[3];
+  ASSERT_EQ(0, reinterpret_cast<uintptr_t>(q) % 64);
+  delete[] q;
+  q = new (std::nothrow) OverAligned;
+  ASSERT_EQ(0, reinterpret_cast<uintptr_t>(q) % 64);
+  delete q;
+
+  ASSERT_EQ(7, allocationCount() - before);
+}
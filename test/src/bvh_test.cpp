@@ -0,0 +1,252 @@
+#include <bvh.hpp>
+#include <spatial_index.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+
+class BvhTest : public testing::Test
+{
+  public:
+    virtual void SetUp() override {}
+
+    virtual void TearDown() override {}
+
+    std::set<EntityId> query(const std::vector<Vec2f>& poly)
+    {
+      std::set<EntityId> result;
+      bvh.forEachItem(poly, [&](EntityId id) {
+        bool inserted = result.insert(id).second;
+        EXPECT_TRUE(inserted) << "Item " << id << " visited twice";
+      });
+      return result;
+    }
+
+    Bvh bvh;
+};
+
+namespace
+{
+
+bool circleOverlapsPoly(const Bvh::Item& item, const std::vector<Vec2f>& poly)
+{
+  if (pointIsInsidePoly(item.pos, poly)) {
+    return true;
+  }
+  for (size_t i = 0; i < poly.size(); ++i) {
+    Vec2f A = poly[i];
+    Vec2f B = poly[(i + 1) % poly.size()];
+    Vec2f AB = B - A;
+    float_t t = std::clamp((item.pos - A).dot(AB) / AB.dot(AB), 0.f, 1.f);
+    Vec2f d = item.pos - (A + AB * t);
+    if (d.dot(d) <= item.radius * item.radius) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::set<EntityId> bruteForce(const std::vector<Bvh::Item>& items,
+  const std::vector<Vec2f>& poly)
+{
+  std::set<EntityId> result;
+  for (auto& item : items) {
+    if (circleOverlapsPoly(item, poly)) {
+      result.insert(item.id);
+    }
+  }
+  return result;
+}
+
+std::vector<Bvh::Item> randomItems(std::mt19937& gen, size_t n)
+{
+  std::uniform_real_distribution<float_t> p(0.f, 1000.f);
+  std::uniform_real_distribution<float_t> r(0.5f, 20.f);
+
+  std::vector<Bvh::Item> items;
+  for (EntityId id = 0; id < n; ++id) {
+    items.push_back(Bvh::Item{ id, Vec2f{ p(gen), p(gen) }, r(gen) });
+  }
+  return items;
+}
+
+// Star shaped, so simple but usually concave
+std::vector<Vec2f> randomPolygon(std::mt19937& gen)
+{
+  std::uniform_real_distribution<float_t> centre(0.f, 1000.f);
+  std::uniform_real_distribution<float_t> radius(5.f, 200.f);
+
+  const size_t numVertices = 7;
+  Vec2f c{ centre(gen), centre(gen) };
+  std::vector<Vec2f> poly;
+  for (size_t i = 0; i < numVertices; ++i) {
+    float_t a = 2.f * PIf * static_cast<float_t>(i) / static_cast<float_t>(numVertices);
+    float_t r = radius(gen);
+    poly.push_back(c + Vec2f{ r * cosine(a), r * sine(a) });
+  }
+  return poly;
+}
+
+} // namespace
+
+TEST_F(BvhTest, empty_tree_returns_nothing)
+{
+  bvh.build({});
+
+  EXPECT_TRUE(query({ { 0.f, 0.f }, { 10.f, 0.f }, { 10.f, 10.f } }).empty());
+}
+
+TEST_F(BvhTest, circle_touching_polygon_edge_is_returned)
+{
+  bvh.build({
+    Bvh::Item{ 1, Vec2f{ 5.f, 12.f }, 2.5f },
+    Bvh::Item{ 2, Vec2f{ 5.f, 14.f }, 2.5f }
+  });
+
+  std::set<EntityId> expected{ 1 };
+
+  EXPECT_EQ(expected, query({ { 0.f, 0.f }, { 10.f, 0.f }, { 10.f, 10.f }, { 0.f, 10.f } }));
+}
+
+TEST_F(BvhTest, polygon_inside_circle_returns_circle)
+{
+  bvh.build({ Bvh::Item{ 7, Vec2f{ 0.f, 0.f }, 100.f } });
+
+  std::set<EntityId> expected{ 7 };
+
+  EXPECT_EQ(expected, query({ { 1.f, 1.f }, { 2.f, 1.f }, { 2.f, 2.f } }));
+}
+
+TEST_F(BvhTest, random_queries_match_brute_force)
+{
+  std::mt19937 gen{ 1234 };
+  auto items = randomItems(gen, 2000);
+  bvh.build(items);
+
+  EXPECT_EQ(2000, bvh.numItems());
+
+  for (int i = 0; i < 100; ++i) {
+    auto poly = randomPolygon(gen);
+    ASSERT_EQ(bruteForce(items, poly), query(poly)) << "Polygon " << i;
+  }
+}
+
+TEST_F(BvhTest, coincident_items_are_split)
+{
+  std::vector<Bvh::Item> items;
+  for (EntityId id = 0; id < 100; ++id) {
+    items.push_back(Bvh::Item{ id, Vec2f{ 50.f, 50.f }, 1.f });
+  }
+  bvh.build(items);
+
+  EXPECT_GT(bvh.numNodes(), 1);
+  EXPECT_EQ(100, query({ { 0.f, 0.f }, { 100.f, 0.f }, { 100.f, 100.f } }).size());
+}
+
+TEST_F(BvhTest, removed_items_are_not_returned)
+{
+  std::mt19937 gen{ 1234 };
+  auto items = randomItems(gen, 500);
+  bvh.build(items);
+
+  for (EntityId id = 0; id < 500; id += 2) {
+    EXPECT_TRUE(bvh.removeItem(id));
+  }
+  EXPECT_FALSE(bvh.removeItem(0));
+
+  EXPECT_EQ(250, bvh.numItems());
+  EXPECT_EQ(250, bvh.numRemoved());
+  EXPECT_FALSE(bvh.hasItem(10));
+  EXPECT_TRUE(bvh.hasItem(11));
+
+  std::vector<Bvh::Item> remaining;
+  bvh.getItems(remaining);
+  EXPECT_EQ(250, remaining.size());
+
+  std::vector<Vec2f> everything{ { -50.f, -50.f }, { 1050.f, -50.f }, { 1050.f, 1050.f },
+    { -50.f, 1050.f } };
+  auto result = query(everything);
+
+  EXPECT_EQ(250, result.size());
+  for (EntityId id : result) {
+    EXPECT_EQ(1, id % 2);
+  }
+}
+
+TEST_F(BvhTest, multiple_polygons_give_correct_masks)
+{
+  std::mt19937 gen{ 5678 };
+  auto items = randomItems(gen, 2000);
+  bvh.build(items);
+
+  std::vector<std::vector<Vec2f>> polys;
+  for (int i = 0; i < 5; ++i) {
+    polys.push_back(randomPolygon(gen));
+  }
+
+  std::map<EntityId, uint32_t> expected;
+  for (size_t i = 0; i < polys.size(); ++i) {
+    for (EntityId id : bruteForce(items, polys[i])) {
+      expected[id] |= 1u << i;
+    }
+  }
+
+  std::map<EntityId, uint32_t> masks;
+  bvh.forEachItemInPolys(polys.size(),
+    [&polys](size_t i) -> const std::vector<Vec2f>& { return polys[i]; },
+    [&](EntityId id, uint32_t mask) {
+      bool inserted = masks.insert({ id, mask }).second;
+      EXPECT_TRUE(inserted) << "Item " << id << " visited twice";
+    });
+
+  EXPECT_EQ(expected, masks);
+}
+
+TEST_F(BvhTest, index_finds_items_as_they_move_in_and_out_of_the_tree)
+{
+  auto index = createBvhIndex();
+  index->initialise(Vec2f{ 0.f, 0.f }, Vec2f{ 1000.f, 1000.f });
+
+  std::mt19937 gen{ 1234 };
+  auto items = randomItems(gen, 1000);
+  for (auto& item : items) {
+    index->addItem(item.id, item.pos, item.radius);
+  }
+
+  std::uniform_real_distribution<float_t> step(-10.f, 10.f);
+  std::vector<EntityId> result;
+
+  // Before the first update, new items are searched by brute force
+  auto firstPoly = randomPolygon(gen);
+  index->getItems(firstPoly, result);
+  EXPECT_EQ(bruteForce(items, firstPoly), std::set<EntityId>(result.begin(), result.end()));
+
+  for (int frame = 0; frame < 200; ++frame) {
+    // A changing subset moves, so items pass between the grid and the tree
+    for (EntityId id = frame % 10; id < items.size(); id += 10 + frame % 3) {
+      items[id].pos = items[id].pos + Vec2f{ step(gen), step(gen) };
+      index->moveItem(id, items[id].pos, items[id].radius);
+    }
+    if (frame == 100) {
+      for (EntityId id = 900; id < 1000; ++id) {
+        index->removeItem(id);
+      }
+      items.resize(900);
+    }
+    index->update();
+
+    auto poly = randomPolygon(gen);
+    index->getItems(poly, result);
+    std::set<EntityId> found(result.begin(), result.end());
+
+    ASSERT_EQ(result.size(), found.size()) << "Frame " << frame;
+    // The grid may return extra items, but mustn't miss any
+    for (EntityId id : bruteForce(items, poly)) {
+      ASSERT_TRUE(found.contains(id)) << "Frame " << frame << ", item " << id;
+    }
+    for (EntityId id : found) {
+      ASSERT_LT(id, 900u + (frame < 100 ? 100u : 0u)) << "Frame " << frame;
+    }
+  }
+}
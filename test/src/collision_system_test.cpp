@@ -0,0 +1,463 @@
+#include <collision_system.hpp>
+#include <spatial_system.hpp>
+#include <logger.hpp>
+#include <job_system.hpp>
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+
+class CollisionSystemTest : public testing::Test
+{
+  public:
+    virtual void SetUp() override
+    {
+      logger = createLogger(stream, stream, stream, stream);
+      // Some workers even on a single core machine, so batches are split between threads
+      jobs = std::make_unique<JobSystem>(3);
+      spatialSystem = createSpatialSystem(*logger, SpatialIndexType::Grid, jobs.get());
+      collisionSystem = createCollisionSystem(*spatialSystem, *logger, jobs.get());
+      collisionSystem->initialise(Vec2f{ -100.f, -100.f }, Vec2f{ 100.f, 100.f });
+    }
+
+    virtual void TearDown() override {}
+
+    EntityId addVolume(const std::vector<Vec2f>& perimeter, float_t height)
+    {
+      EntityId id = nextId++;
+      spatialSystem->addComponent(std::make_unique<CSpatial>(id, identityMatrix<float_t, 4>(),
+        1.f));
+
+      auto volume = std::make_unique<CCollision>(id);
+      volume->perimeter = perimeter;
+      volume->height = height;
+      collisionSystem->addComponent(std::move(volume));
+
+      walls.push_back(perimeter);
+      return id;
+    }
+
+    // Axis aligned wall from A to B, thickened to a box
+    void addWall(const Vec2f& A, const Vec2f& B, float_t thickness = 0.2f)
+    {
+      Vec2f min{ std::min(A[0], B[0]) - thickness / 2.f, std::min(A[1], B[1]) - thickness / 2.f };
+      Vec2f max{ std::max(A[0], B[0]) + thickness / 2.f, std::max(A[1], B[1]) + thickness / 2.f };
+      addVolume({ min, { max[0], min[1] }, max, { min[0], max[1] } }, 10.f);
+    }
+
+    // Thin wall along an arbitrary segment
+    void addSlantedWall(const Vec2f& A, const Vec2f& B, float_t thickness = 0.2f)
+    {
+      Vec2f n = Vec2f{ A[1] - B[1], B[0] - A[0] }.normalise() * (thickness / 2.f);
+      addVolume({ A + n, B + n, B - n, A - n }, 10.f);
+    }
+
+    // Distance the circle overlaps the nearest wall by, or 0
+    float_t penetration(const Vec3f& pos3, float_t radius) const
+    {
+      Vec2f pos{ pos3[0], pos3[2] };
+      float_t deepest = 0.f;
+      for (auto& wall : walls) {
+        for (size_t i = 0; i < wall.size(); ++i) {
+          LineSegment lseg{ wall[i], wall[(i + 1) % wall.size()] };
+          float_t d = (closestPointOnLineSegment(lseg, pos) - pos).magnitude();
+          deepest = std::max(deepest, radius - d);
+        }
+      }
+      return deepest;
+    }
+
+    Vec3f move(const Vec3f& pos, const Vec3f& delta)
+    {
+      return collisionSystem->tryMove(pos, delta, RADIUS, STEP_HEIGHT);
+    }
+
+    static constexpr float_t RADIUS = 0.5f;
+    static constexpr float_t STEP_HEIGHT = 0.3f;
+
+    std::stringstream stream;
+    LoggerPtr logger;
+    std::unique_ptr<JobSystem> jobs;
+    SpatialSystemPtr spatialSystem;
+    CollisionSystemPtr collisionSystem;
+    std::vector<std::vector<Vec2f>> walls;
+    EntityId nextId = 0;
+};
+
+TEST_F(CollisionSystemTest, unobstructed_move_is_unchanged)
+{
+  addWall({ 5.f, -5.f }, { 5.f, 5.f });
+
+  Vec3f delta = move({ 0.f, 0.f, 0.f }, { 0.3f, 0.1f, -0.2f });
+
+  EXPECT_FLOAT_EQ(0.3f, delta[0]);
+  EXPECT_FLOAT_EQ(0.1f, delta[1]);
+  EXPECT_FLOAT_EQ(-0.2f, delta[2]);
+}
+
+TEST_F(CollisionSystemTest, head_on_move_stops_at_wall)
+{
+  addWall({ 1.f, -5.f }, { 1.f, 5.f });
+
+  Vec3f pos{ 0.f, 0.f, 0.f };
+  Vec3f delta = move(pos, { 0.6f, 0.f, 0.f });
+
+  EXPECT_NEAR(0.4f, delta[0], 0.01f);
+  EXPECT_NEAR(0.f, delta[2], 0.0001f);
+  EXPECT_EQ(0.f, penetration(pos + delta, RADIUS));
+}
+
+TEST_F(CollisionSystemTest, oblique_move_slides_along_wall)
+{
+  addWall({ 1.f, -5.f }, { 1.f, 5.f });
+
+  Vec3f pos{ 0.3f, 0.f, 0.f };
+  Vec3f delta = move(pos, { 0.3f, 0.f, 0.3f });
+
+  EXPECT_NEAR(0.1f, delta[0], 0.01f);
+  EXPECT_NEAR(0.3f, delta[2], 0.0001f);
+  EXPECT_EQ(0.f, penetration(pos + delta, RADIUS));
+}
+
+TEST_F(CollisionSystemTest, low_edges_are_stepped_over)
+{
+  addVolume({ { 1.f, -5.f }, { 3.f, -5.f }, { 3.f, 5.f }, { 1.f, 5.f } }, 0.2f);
+
+  Vec3f delta = move({ 0.f, 0.f, 0.f }, { 0.6f, 0.f, 0.f });
+
+  EXPECT_FLOAT_EQ(0.6f, delta[0]);
+}
+
+TEST_F(CollisionSystemTest, slides_around_convex_corner)
+{
+  // End of a wall along the z axis
+  addWall({ 1.f, -5.f }, { 1.f, 0.f });
+
+  Vec3f pos{ 0.4f, 0.f, -0.2f };
+  Vec3f total{};
+  for (int i = 0; i < 20; ++i) {
+    Vec3f delta = move(pos, { 0.02f, 0.f, 0.1f });
+    pos += delta;
+    total += delta;
+    ASSERT_EQ(0.f, penetration(pos, RADIUS)) << "Step " << i;
+  }
+
+  // Past the end of the wall, the mover is free to go through
+  EXPECT_GT(pos[2], 1.f);
+  EXPECT_GT(total[0], 0.f);
+}
+
+TEST_F(CollisionSystemTest, square_corner_holds_mover_clear_of_both_walls)
+{
+  addWall({ 1.f, -5.f }, { 1.f, 1.f });
+  addWall({ -5.f, 1.f }, { 1.f, 1.f });
+
+  Vec3f pos{ 0.f, 0.f, 0.f };
+  for (int i = 0; i < 20; ++i) {
+    pos += move(pos, { 0.1f, 0.f, 0.1f });
+    ASSERT_EQ(0.f, penetration(pos, RADIUS)) << "Step " << i;
+  }
+
+  EXPECT_NEAR(0.4f, pos[0], 0.02f);
+  EXPECT_NEAR(0.4f, pos[2], 0.02f);
+}
+
+TEST_F(CollisionSystemTest, acute_wedge_never_penetrates)
+{
+  // Walls meeting at 20 degrees, with the mover pushed into the point of the wedge
+  float_t a = degreesToRadians(20.f);
+  addSlantedWall({ 0.f, 0.f }, { 10.f, 0.f });
+  addSlantedWall({ 0.f, 0.f }, { 10.f * cosine(a), 10.f * sine(a) });
+
+  Vec3f pos{ 6.f, 0.f, 1.f };
+  for (int i = 0; i < 50; ++i) {
+    pos += move(pos, { -0.2f, 0.f, 0.f });
+    ASSERT_EQ(0.f, penetration(pos, RADIUS)) << "Step " << i;
+  }
+
+  EXPECT_LT(pos[0], 6.f);
+}
+
+TEST_F(CollisionSystemTest, moves_along_corridor_unimpeded)
+{
+  // Corridor 1.2 wide for a mover 1.0 wide
+  addWall({ -10.f, -0.7f }, { 10.f, -0.7f });
+  addWall({ -10.f, 0.7f }, { 10.f, 0.7f });
+
+  Vec3f delta = move({ 0.f, 0.f, 0.f }, { 0.5f, 0.f, 0.f });
+
+  EXPECT_FLOAT_EQ(0.5f, delta[0]);
+  EXPECT_FLOAT_EQ(0.f, delta[2]);
+}
+
+TEST_F(CollisionSystemTest, zigzags_down_corridor_without_penetrating)
+{
+  addWall({ -10.f, -0.7f }, { 10.f, -0.7f });
+  addWall({ -10.f, 0.7f }, { 10.f, 0.7f });
+
+  Vec3f pos{ -8.f, 0.f, 0.f };
+  for (int i = 0; i < 40; ++i) {
+    float_t side = i % 2 == 0 ? 1.f : -1.f;
+    pos += move(pos, { 0.2f, 0.f, side * 0.4f });
+    ASSERT_EQ(0.f, penetration(pos, RADIUS)) << "Step " << i;
+  }
+
+  EXPECT_NEAR(0.f, pos[0], 0.01f);
+}
+
+TEST_F(CollisionSystemTest, corridor_too_narrow_is_not_entered)
+{
+  // Corridor 0.8 wide for a mover 1.0 wide, with its mouth at x = 1
+  addWall({ 1.f, -0.5f }, { 10.f, -0.5f });
+  addWall({ 1.f, 0.5f }, { 10.f, 0.5f });
+
+  Vec3f pos{ 0.f, 0.f, 0.f };
+  for (int i = 0; i < 20; ++i) {
+    pos += move(pos, { 0.2f, 0.f, 0.f });
+    ASSERT_EQ(0.f, penetration(pos, RADIUS)) << "Step " << i;
+  }
+
+  EXPECT_LT(pos[0], 1.f);
+}
+
+TEST_F(CollisionSystemTest, random_moves_in_cluttered_room_never_penetrate)
+{
+  addWall({ -10.f, -10.f }, { 10.f, -10.f });
+  addWall({ -10.f, 10.f }, { 10.f, 10.f });
+  addWall({ -10.f, -10.f }, { -10.f, 10.f });
+  addWall({ 10.f, -10.f }, { 10.f, 10.f });
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> p(-8.f, 8.f);
+  std::uniform_real_distribution<float_t> length(0.5f, 3.f);
+  for (int i = 0; i < 30; ++i) {
+    Vec2f A{ p(gen), p(gen) };
+    Vec2f B = A + Vec2f{ p(gen), p(gen) }.normalise() * length(gen);
+    addSlantedWall(A, B);
+  }
+
+  Vec3f pos{ 0.f, 0.f, 0.f };
+  while (penetration(pos, RADIUS) > 0.f) {
+    pos = Vec3f{ p(gen), 0.f, p(gen) };
+  }
+
+  std::uniform_real_distribution<float_t> step(-0.3f, 0.3f);
+  for (int i = 0; i < 2000; ++i) {
+    pos += move(pos, { step(gen), 0.f, step(gen) });
+    ASSERT_EQ(0.f, penetration(pos, RADIUS)) << "Step " << i;
+  }
+}
+
+TEST_F(CollisionSystemTest, sweep_reports_time_of_impact_and_normal)
+{
+  addWall({ 2.f, -5.f }, { 2.f, 5.f }, 0.05f);
+
+  SweepHit hit;
+  ASSERT_TRUE(collisionSystem->sweep({ 0.f, 0.f, 0.f }, { 10.f, 0.f, 0.f }, RADIUS, STEP_HEIGHT,
+    hit));
+
+  EXPECT_NEAR(0.1475f, hit.toi, 0.0001f);
+  EXPECT_NEAR(-1.f, hit.normal[0], 0.0001f);
+  EXPECT_NEAR(0.f, hit.normal[2], 0.0001f);
+  EXPECT_FALSE(collisionSystem->sweep({ 0.f, 0.f, 0.f }, { -10.f, 0.f, 0.f }, RADIUS,
+    STEP_HEIGHT, hit));
+}
+
+TEST_F(CollisionSystemTest, high_speed_move_does_not_tunnel_through_thin_wall)
+{
+  addWall({ 2.f, -5.f }, { 2.f, 5.f }, 0.05f);
+
+  for (float_t speed : { 5.f, 20.f, 50.f }) {
+    Vec3f pos{ 0.f, 0.f, 0.f };
+    Vec3f delta = move(pos, { speed, 0.f, 0.f });
+
+    EXPECT_NEAR(1.475f, delta[0], 0.01f) << "Speed " << speed;
+    EXPECT_LT(pos[0] + delta[0], 2.f) << "Speed " << speed;
+    EXPECT_EQ(0.f, penetration(pos + delta, RADIUS)) << "Speed " << speed;
+  }
+}
+
+TEST_F(CollisionSystemTest, high_speed_oblique_move_slides_along_thin_wall)
+{
+  addWall({ 2.f, -50.f }, { 2.f, 50.f }, 0.05f);
+
+  Vec3f pos{ 0.f, 0.f, 0.f };
+  Vec3f delta = move(pos, { 20.f, 0.f, 20.f });
+
+  EXPECT_NEAR(1.475f, delta[0], 0.01f);
+  EXPECT_GT(delta[2], 15.f);
+  EXPECT_EQ(0.f, penetration(pos + delta, RADIUS));
+}
+
+TEST_F(CollisionSystemTest, high_speed_move_is_deflected_by_thin_wall_end)
+{
+  // The path only clips the end of the wall, so the mover slides around it
+  addWall({ 2.f, 0.3f }, { 2.f, 5.f }, 0.05f);
+
+  Vec3f pos{ 0.f, 0.f, 0.f };
+  Vec3f delta = move(pos, { 30.f, 0.f, 0.f });
+
+  EXPECT_GT(delta[0], 2.f);
+  EXPECT_LT(delta[2], -0.2f);
+  EXPECT_EQ(0.f, penetration(pos + delta, RADIUS));
+}
+
+TEST_F(CollisionSystemTest, random_high_speed_moves_in_thin_walled_room_never_escape)
+{
+  addWall({ -10.f, -10.f }, { 10.f, -10.f }, 0.05f);
+  addWall({ -10.f, 10.f }, { 10.f, 10.f }, 0.05f);
+  addWall({ -10.f, -10.f }, { -10.f, 10.f }, 0.05f);
+  addWall({ 10.f, -10.f }, { 10.f, 10.f }, 0.05f);
+
+  std::mt19937 gen{ 4321 };
+  std::uniform_real_distribution<float_t> step(-15.f, 15.f);
+
+  Vec3f pos{ 0.f, 0.f, 0.f };
+  for (int i = 0; i < 500; ++i) {
+    pos += move(pos, { step(gen), 0.f, step(gen) });
+    ASSERT_EQ(0.f, penetration(pos, RADIUS)) << "Step " << i;
+    ASSERT_LT(std::abs(pos[0]), 10.f) << "Step " << i;
+    ASSERT_LT(std::abs(pos[2]), 10.f) << "Step " << i;
+  }
+}
+
+TEST_F(CollisionSystemTest, altitude_is_height_above_highest_floor)
+{
+  addVolume({ { -20.f, -20.f }, { 20.f, -20.f }, { 20.f, 20.f }, { -20.f, 20.f } }, 0.f);
+  addVolume({ { 0.f, 0.f }, { 5.f, 0.f }, { 5.f, 5.f }, { 0.f, 5.f } }, 1.5f);
+
+  EXPECT_FLOAT_EQ(2.f, collisionSystem->altitude({ -5.f, 2.f, -5.f }));
+  EXPECT_FLOAT_EQ(0.5f, collisionSystem->altitude({ 2.f, 2.f, 2.f }));
+  EXPECT_THROW(collisionSystem->altitude({ 50.f, 0.f, 50.f }), std::exception);
+}
+
+TEST_F(CollisionSystemTest, batched_altitude_matches_single_queries)
+{
+  addVolume({ { -20.f, -20.f }, { 20.f, -20.f }, { 20.f, 20.f }, { -20.f, 20.f } }, 0.f);
+  addVolume({ { 0.f, 0.f }, { 5.f, 0.f }, { 5.f, 5.f }, { 2.f, 2.f }, { 0.f, 5.f } }, 1.5f);
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> p(-10.f, 10.f);
+  std::vector<Vec3f> positions;
+  for (int i = 0; i < 100; ++i) {
+    positions.push_back(Vec3f{ p(gen), 3.f, p(gen) });
+  }
+
+  std::vector<float_t> altitudes(positions.size());
+  collisionSystem->altitude(positions, altitudes);
+
+  for (size_t i = 0; i < positions.size(); ++i) {
+    EXPECT_EQ(collisionSystem->altitude(positions[i]), altitudes[i]) << "Position " << i;
+  }
+}
+
+TEST_F(CollisionSystemTest, batched_moves_match_single_moves)
+{
+  addWall({ -40.f, -40.f }, { 40.f, -40.f });
+  addWall({ -40.f, 40.f }, { 40.f, 40.f });
+  addWall({ -40.f, -40.f }, { -40.f, 40.f });
+  addWall({ 40.f, -40.f }, { 40.f, 40.f });
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> p(-38.f, 38.f);
+  std::uniform_real_distribution<float_t> length(0.5f, 4.f);
+  for (int i = 0; i < 200; ++i) {
+    Vec2f A{ p(gen), p(gen) };
+    Vec2f B = A + Vec2f{ p(gen), p(gen) }.normalise() * length(gen);
+    addSlantedWall(A, B, 0.05f);
+  }
+
+  std::uniform_real_distribution<float_t> step(-2.f, 2.f);
+  std::uniform_real_distribution<float_t> radius(0.2f, 0.8f);
+  std::uniform_real_distribution<float_t> stepHeight(0.f, 0.5f);
+
+  const size_t n = 5000;
+  std::vector<Vec3f> positions;
+  std::vector<Vec3f> deltas;
+  std::vector<float_t> radii;
+  std::vector<float_t> stepHeights;
+  for (size_t i = 0; i < n; ++i) {
+    positions.push_back(Vec3f{ p(gen), 0.f, p(gen) });
+    deltas.push_back(Vec3f{ step(gen), 0.f, step(gen) });
+    radii.push_back(radius(gen));
+    stepHeights.push_back(stepHeight(gen));
+  }
+
+  std::vector<Vec3f> results(n);
+  collisionSystem->tryMoveBatch(positions, deltas, radii, stepHeights, results);
+
+  for (size_t i = 0; i < n; ++i) {
+    Vec3f expected = collisionSystem->tryMove(positions[i], deltas[i], radii[i], stepHeights[i]);
+    ASSERT_EQ(expected, results[i]) << "Mover " << i;
+  }
+
+  // Same again, to check the results don't depend on how the work was split
+  std::vector<Vec3f> repeated(n);
+  collisionSystem->tryMoveBatch(positions, deltas, radii, stepHeights, repeated);
+  EXPECT_EQ(results, repeated);
+}
+
+TEST_F(CollisionSystemTest, batch_with_mismatched_spans_throws)
+{
+  std::vector<Vec3f> positions(3);
+  std::vector<Vec3f> deltas(3);
+  std::vector<float_t> radii(2);
+  std::vector<float_t> stepHeights(3);
+  std::vector<Vec3f> results(3);
+
+  EXPECT_THROW(collisionSystem->tryMoveBatch(positions, deltas, radii, stepHeights, results),
+    std::exception);
+}
+
+TEST_F(CollisionSystemTest, removed_volume_no_longer_collides)
+{
+  addVolume({ { -20.f, -20.f }, { 20.f, -20.f }, { 20.f, 20.f }, { -20.f, 20.f } }, 0.f);
+  EntityId wall = addVolume({ { 2.f, -5.f }, { 2.2f, -5.f }, { 2.2f, 5.f }, { 2.f, 5.f } }, 10.f);
+
+  ASSERT_TRUE(collisionSystem->hasComponent(wall));
+  auto& volume = dynamic_cast<const CCollision&>(collisionSystem->getComponent(wall));
+  EXPECT_EQ(4, volume.perimeter.size());
+  EXPECT_LT(move({ 0.f, 0.f, 0.f }, { 3.f, 0.f, 0.f })[0], 2.f);
+
+  collisionSystem->removeComponent(wall);
+
+  EXPECT_FALSE(collisionSystem->hasComponent(wall));
+  EXPECT_THROW(collisionSystem->getComponent(wall), std::exception);
+  EXPECT_FLOAT_EQ(3.f, move({ 0.f, 0.f, 0.f }, { 3.f, 0.f, 0.f })[0]);
+
+  // Removing it again does nothing
+  collisionSystem->removeComponent(wall);
+}
+
+TEST_F(CollisionSystemTest, volume_follows_its_transform)
+{
+  addVolume({ { -20.f, -20.f }, { 20.f, -20.f }, { 20.f, 20.f }, { -20.f, 20.f } }, 0.f);
+  EntityId wall = addVolume({ { 2.f, -5.f }, { 2.2f, -5.f }, { 2.2f, 5.f }, { 2.f, 5.f } }, 10.f);
+
+  spatialSystem->setTransform(wall, translationMatrix4x4(Vec3f{ 10.f, 0.f, 0.f }));
+  spatialSystem->update();
+
+  // The wall has moved out of the way
+  EXPECT_FLOAT_EQ(3.f, move({ 0.f, 0.f, 0.f }, { 3.f, 0.f, 0.f })[0]);
+
+  // And now blocks movers at its new position
+  Vec3f delta = move({ 10.f, 0.f, 0.f }, { 3.f, 0.f, 0.f });
+  EXPECT_LT(10.f + delta[0], 12.f);
+  EXPECT_LE(10.f + delta[0] + RADIUS, 12.f);
+}
+
+TEST_F(CollisionSystemTest, altitude_follows_moving_platform)
+{
+  addVolume({ { -20.f, -20.f }, { 20.f, -20.f }, { 20.f, 20.f }, { -20.f, 20.f } }, 0.f);
+  EntityId platform = addVolume({ { 0.f, 0.f }, { 4.f, 0.f }, { 4.f, 4.f }, { 0.f, 4.f } }, 1.f);
+
+  EXPECT_FLOAT_EQ(1.f, collisionSystem->altitude({ 2.f, 2.f, 2.f }));
+
+  for (int i = 1; i <= 10; ++i) {
+    spatialSystem->setTransform(platform,
+      translationMatrix4x4(Vec3f{ i * 1.f, 0.5f, 0.f }));
+    spatialSystem->update();
+
+    EXPECT_FLOAT_EQ(0.5f, collisionSystem->altitude({ i + 2.f, 2.f, 2.f })) << "Step " << i;
+    EXPECT_FLOAT_EQ(2.f, collisionSystem->altitude({ i - 1.f, 2.f, 2.f })) << "Step " << i;
+  }
+}
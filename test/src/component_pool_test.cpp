@@ -0,0 +1,122 @@
+#include <component_pool.hpp>
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+
+namespace
+{
+
+struct CTest : public Component
+{
+  CTest(EntityId entityId, int value)
+    : Component(entityId)
+    , value(value)
+  {}
+
+  int value;
+};
+
+} // namespace
+
+class ComponentPoolTest : public testing::Test
+{
+  public:
+    virtual void SetUp() override {}
+
+    virtual void TearDown() override {}
+};
+
+TEST_F(ComponentPoolTest, added_components_can_be_found)
+{
+  ComponentPool<CTest> pool;
+  pool.add(3, CTest{ 3, 30 });
+  pool.add(1, CTest{ 1, 10 });
+
+  EXPECT_EQ(2, pool.size());
+  EXPECT_TRUE(pool.contains(1));
+  EXPECT_TRUE(pool.contains(3));
+  EXPECT_FALSE(pool.contains(2));
+  EXPECT_EQ(30, pool.get(3).value);
+  EXPECT_EQ(10, pool.find(1)->value);
+  EXPECT_EQ(nullptr, pool.find(2));
+  EXPECT_THROW(pool.get(2), std::exception);
+}
+
+TEST_F(ComponentPoolTest, adding_twice_throws)
+{
+  ComponentPool<CTest> pool;
+  pool.add(1, CTest{ 1, 10 });
+
+  EXPECT_THROW(pool.add(1, CTest{ 1, 20 }), std::exception);
+  EXPECT_EQ(10, pool.get(1).value);
+}
+
+TEST_F(ComponentPoolTest, removing_keeps_remaining_components_packed)
+{
+  ComponentPool<CTest> pool;
+  for (EntityId id = 0; id < 5; ++id) {
+    pool.add(id, CTest{ id, static_cast<int>(id) * 10 });
+  }
+
+  EXPECT_TRUE(pool.remove(1));
+  EXPECT_FALSE(pool.remove(1));
+
+  ASSERT_EQ(4, pool.size());
+  EXPECT_FALSE(pool.contains(1));
+  for (EntityId id : { 0, 2, 3, 4 }) {
+    EXPECT_EQ(static_cast<int>(id) * 10, pool.get(id).value);
+  }
+
+  size_t i = 0;
+  for (auto& component : pool) {
+    EXPECT_EQ(pool.ids()[i++], component.id());
+  }
+  EXPECT_EQ(4, i);
+}
+
+TEST_F(ComponentPoolTest, stale_id_finds_nothing_once_slot_is_reused)
+{
+  ComponentPool<CTest> pool;
+  EntityId stale = makeEntityId(5, 0);
+  EntityId current = makeEntityId(5, 1);
+
+  pool.add(stale, CTest{ stale, 1 });
+  EXPECT_THROW(pool.add(current, CTest{ current, 2 }), std::exception);
+
+  pool.remove(stale);
+  pool.add(current, CTest{ current, 2 });
+
+  EXPECT_FALSE(pool.contains(stale));
+  EXPECT_EQ(nullptr, pool.find(stale));
+  EXPECT_FALSE(pool.remove(stale));
+  EXPECT_EQ(2, pool.get(current).value);
+}
+
+TEST_F(ComponentPoolTest, matches_map_under_random_adds_and_removes)
+{
+  ComponentPool<CTest> pool;
+  std::map<EntityId, int> expected;
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_int_distribution<EntityId> anyId(0, 5000);
+  std::uniform_int_distribution<int> op(0, 2);
+
+  for (int i = 0; i < 20000; ++i) {
+    EntityId id = anyId(gen);
+    if (op(gen) == 0) {
+      ASSERT_EQ(expected.erase(id) > 0, pool.remove(id));
+    }
+    else if (!expected.contains(id)) {
+      expected[id] = i;
+      pool.add(id, CTest{ id, i });
+    }
+  }
+
+  ASSERT_EQ(expected.size(), pool.size());
+  for (auto& [id, value] : expected) {
+    ASSERT_EQ(value, pool.get(id).value);
+  }
+  for (auto& component : pool) {
+    ASSERT_EQ(expected.at(component.id()), component.value);
+  }
+}
@@ -0,0 +1,134 @@
+#include "alloc_counter.hpp"
+#include <draw_list.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+
+using namespace render;
+
+class DrawListTest : public testing::Test
+{
+  public:
+    virtual void SetUp() override {}
+
+    virtual void TearDown() override {}
+
+    DrawKey key(RenderPass pass, DrawLayer layer, uint64_t pipeline, RenderItemId material,
+      RenderItemId mesh, float_t depth) const
+    {
+      return DrawKey{
+        .pass = pass,
+        .layer = layer,
+        .pipeline = pipeline,
+        .material = material,
+        .mesh = mesh,
+        .depth = depth
+      };
+    }
+};
+
+TEST_F(DrawListTest, sort_matches_stable_sort)
+{
+  std::mt19937_64 gen{ 1234 };
+  std::vector<int> items(10000);
+  DrawList<int> list;
+
+  std::vector<std::pair<uint64_t, int*>> expected;
+  for (size_t i = 0; i < items.size(); ++i) {
+    // Plenty of duplicates, and high bits that vary
+    uint64_t k = (gen() % 50) << 58 | (gen() % 1000);
+    list.add(k, &items[i]);
+    expected.push_back({ k, &items[i] });
+  }
+
+  list.sort();
+  std::stable_sort(expected.begin(), expected.end(),
+    [](auto& a, auto& b) { return a.first < b.first; });
+
+  auto entries = list.entries();
+  ASSERT_EQ(expected.size(), entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    ASSERT_EQ(expected[i].first, entries[i].key);
+    ASSERT_EQ(expected[i].second, entries[i].item);
+  }
+}
+
+TEST_F(DrawListTest, range_finds_each_pass)
+{
+  std::vector<int> items(6);
+  DrawList<int> list;
+
+  list.add(packDrawKey(key(RenderPass::Main, DrawLayer::Opaque, 1, 2, 3, 0.5f)), &items[0]);
+  list.add(packDrawKey(key(RenderPass::Shadow, DrawLayer::Opaque, 1, 2, 3, 0.5f)), &items[1]);
+  list.add(packDrawKey(key(RenderPass::Main, DrawLayer::Transparent, 1, 2, 3, 0.5f)), &items[2]);
+  list.add(packDrawKey(key(RenderPass::Shadow, DrawLayer::Transparent, 9, 9, 9, 1.f)), &items[3]);
+  list.add(packDrawKey(key(RenderPass::Main, DrawLayer::Opaque, 0, 0, 0, 0.f)), &items[4]);
+  list.sort();
+
+  auto shadow = list.range(firstDrawKey(RenderPass::Shadow), lastDrawKey(RenderPass::Shadow));
+  ASSERT_EQ(2, shadow.size());
+  ASSERT_EQ(&items[1], shadow[0].item);
+  ASSERT_EQ(&items[3], shadow[1].item);
+
+  auto main = list.range(firstDrawKey(RenderPass::Main), lastDrawKey(RenderPass::Main));
+  ASSERT_EQ(3, main.size());
+  ASSERT_EQ(&items[4], main[0].item);
+  ASSERT_EQ(&items[0], main[1].item);
+  ASSERT_EQ(&items[2], main[2].item);
+
+  ASSERT_TRUE(list.range(firstDrawKey(RenderPass::Ssr), lastDrawKey(RenderPass::Ssr)).empty());
+}
+
+TEST_F(DrawListTest, key_order)
+{
+  auto k = [this](DrawLayer layer, uint64_t pipeline, RenderItemId material, RenderItemId mesh,
+    float_t depth) {
+
+    return packDrawKey(key(RenderPass::Main, layer, pipeline, material, mesh, depth));
+  };
+  const DrawLayer opaque = DrawLayer::Opaque;
+  const DrawLayer background = DrawLayer::Background;
+  const DrawLayer transparent = DrawLayer::Transparent;
+
+  // Opaque, then background, then transparent
+  ASSERT_LT(k(opaque, 9, 9, 9, 1.f), k(background, 0, 0, 0, 0.f));
+  ASSERT_LT(k(background, 9, 9, 9, 1.f), k(transparent, 0, 0, 0, 0.f));
+  // Then by pipeline, material, and mesh
+  ASSERT_LT(k(opaque, 1, 9, 9, 1.f), k(opaque, 2, 0, 0, 0.f));
+  ASSERT_LT(k(opaque, 1, 1, 9, 1.f), k(opaque, 1, 2, 0, 0.f));
+  ASSERT_LT(k(opaque, 1, 1, 1, 1.f), k(opaque, 1, 1, 2, 0.f));
+  // Opaque draws front to back
+  ASSERT_LT(k(opaque, 1, 1, 1, 0.2f), k(opaque, 1, 1, 1, 0.3f));
+  // Transparent draws back to front, whatever their pipeline
+  ASSERT_LT(k(transparent, 9, 9, 9, 0.8f), k(transparent, 1, 1, 1, 0.2f));
+  ASSERT_LT(k(transparent, 1, 1, 1, 0.5f), k(transparent, 2, 1, 1, 0.5f));
+  // Depth is clipped
+  ASSERT_EQ(k(opaque, 1, 1, 1, 1.f), k(opaque, 1, 1, 1, 5.f));
+  ASSERT_EQ(k(opaque, 1, 1, 1, 0.f), k(opaque, 1, 1, 1, -1.f));
+}
+
+TEST_F(DrawListTest, reused_list_does_not_allocate)
+{
+  std::vector<int> items(1000);
+  DrawList<int> list;
+
+  auto frame = [&]() {
+    list.clear();
+    for (size_t i = 0; i < items.size(); ++i) {
+      DrawLayer layer = i % 7 == 0 ? DrawLayer::Transparent : DrawLayer::Opaque;
+      list.add(packDrawKey(key(RenderPass::Main, layer, i % 5, i % 11, i % 13,
+        static_cast<float_t>(i) / items.size())), &items[i]);
+    }
+    list.sort();
+  };
+
+  frame();
+
+  size_t before = allocationCount();
+  for (int i = 0; i < 10; ++i) {
+    frame();
+  }
+
+  ASSERT_EQ(0, allocationCount() - before);
+  ASSERT_EQ(items.size(), list.size());
+}
@@ -0,0 +1,192 @@
+#include <floor_grid.hpp>
+#include <gtest/gtest.h>
+#include <random>
+
+class FloorGridTest : public testing::Test
+{
+  public:
+    virtual void SetUp() override {}
+
+    virtual void TearDown() override {}
+};
+
+TEST_F(FloorGridTest, point_on_single_floor)
+{
+  FloorGrid grid(Vec2f{ 0.f, 0.f }, Vec2f{ 100.f, 100.f }, 10, 10);
+  grid.addFloor({ { 5.f, 5.f }, { 25.f, 5.f }, { 25.f, 25.f }, { 5.f, 25.f } }, 2.f);
+
+  float_t height = 0.f;
+  ASSERT_TRUE(grid.highestFloor({ 15.f, 15.f }, height));
+  EXPECT_EQ(2.f, height);
+  EXPECT_FALSE(grid.highestFloor({ 30.f, 15.f }, height));
+  EXPECT_EQ(1, grid.numPieces());
+}
+
+TEST_F(FloorGridTest, highest_of_overlapping_floors_wins)
+{
+  FloorGrid grid(Vec2f{ 0.f, 0.f }, Vec2f{ 100.f, 100.f }, 10, 10);
+  grid.addFloor({ { 5.f, 5.f }, { 25.f, 5.f }, { 25.f, 25.f }, { 5.f, 25.f } }, 2.f);
+  grid.addFloor({ { 10.f, 10.f }, { 10.f, 20.f }, { 20.f, 20.f }, { 20.f, 10.f } }, 5.f);
+  grid.addFloor({ { 0.f, 0.f }, { 50.f, 0.f }, { 50.f, 50.f }, { 0.f, 50.f } }, 1.f);
+
+  float_t height = 0.f;
+  ASSERT_TRUE(grid.highestFloor({ 15.f, 15.f }, height));
+  EXPECT_EQ(5.f, height);
+  ASSERT_TRUE(grid.highestFloor({ 7.f, 7.f }, height));
+  EXPECT_EQ(2.f, height);
+  ASSERT_TRUE(grid.highestFloor({ 40.f, 40.f }, height));
+  EXPECT_EQ(1.f, height);
+}
+
+TEST_F(FloorGridTest, concave_floor_excludes_its_notch)
+{
+  FloorGrid grid(Vec2f{ 0.f, 0.f }, Vec2f{ 100.f, 100.f }, 10, 10);
+
+  // L shape
+  grid.addFloor({
+    { 10.f, 10.f },
+    { 30.f, 10.f },
+    { 30.f, 15.f },
+    { 15.f, 15.f },
+    { 15.f, 30.f },
+    { 10.f, 30.f }
+  }, 3.f);
+
+  float_t height = 0.f;
+  EXPECT_TRUE(grid.highestFloor({ 25.f, 12.f }, height));
+  EXPECT_TRUE(grid.highestFloor({ 12.f, 25.f }, height));
+  EXPECT_TRUE(grid.highestFloor({ 12.f, 12.f }, height));
+  EXPECT_FALSE(grid.highestFloor({ 25.f, 25.f }, height));
+  EXPECT_EQ(2, grid.numPieces());
+}
+
+TEST_F(FloorGridTest, no_gap_where_floors_meet)
+{
+  FloorGrid grid(Vec2f{ 0.f, 0.f }, Vec2f{ 100.f, 100.f }, 10, 10);
+  grid.addFloor({ { 5.f, 5.f }, { 20.f, 5.f }, { 20.f, 25.f }, { 5.f, 25.f } }, 1.f);
+  grid.addFloor({ { 20.f, 5.f }, { 35.f, 5.f }, { 35.f, 25.f }, { 20.f, 25.f } }, 1.f);
+
+  float_t height = 0.f;
+  for (float_t y = 5.f; y <= 25.f; y += 0.37f) {
+    EXPECT_TRUE(grid.highestFloor({ 20.f, y }, height)) << "y = " << y;
+  }
+}
+
+TEST_F(FloorGridTest, matches_brute_force_for_random_star_shaped_floors)
+{
+  FloorGrid grid(Vec2f{ 0.f, 0.f }, Vec2f{ 100.f, 100.f }, 20, 20);
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> centre(15.f, 85.f);
+  std::uniform_real_distribution<float_t> r(2.f, 12.f);
+  std::uniform_real_distribution<float_t> h(0.f, 10.f);
+
+  struct Floor
+  {
+    std::vector<Vec2f> perimeter;
+    float_t height;
+  };
+  std::vector<Floor> floors;
+
+  for (int i = 0; i < 40; ++i) {
+    Vec2f c{ centre(gen), centre(gen) };
+    Floor floor{ {}, h(gen) };
+    const int n = 8;
+    for (int k = 0; k < n; ++k) {
+      float_t a = 2.f * PIf * k / n;
+      floor.perimeter.push_back(c + Vec2f{ cosine(a), sine(a) } * r(gen));
+    }
+    if (i % 2 == 1) {
+      std::reverse(floor.perimeter.begin(), floor.perimeter.end());
+    }
+    grid.addFloor(floor.perimeter, floor.height);
+    floors.push_back(floor);
+  }
+
+  std::uniform_real_distribution<float_t> p(0.f, 100.f);
+  for (int i = 0; i < 5000; ++i) {
+    Vec2f pos{ p(gen), p(gen) };
+
+    bool expectedFound = false;
+    float_t expectedHeight = std::numeric_limits<float_t>::lowest();
+    for (auto& floor : floors) {
+      if (pointIsInsidePoly(pos, floor.perimeter) && floor.height > expectedHeight) {
+        expectedHeight = floor.height;
+        expectedFound = true;
+      }
+    }
+
+    float_t height = 0.f;
+    ASSERT_EQ(expectedFound, grid.highestFloor(pos, height)) << "Point " << i;
+    if (expectedFound) {
+      ASSERT_EQ(expectedHeight, height) << "Point " << i;
+    }
+  }
+}
+
+TEST_F(FloorGridTest, removed_floor_is_not_found)
+{
+  FloorGrid grid(Vec2f{ 0.f, 0.f }, Vec2f{ 100.f, 100.f }, 10, 10);
+  grid.addFloor({ { 5.f, 5.f }, { 25.f, 5.f }, { 25.f, 25.f }, { 5.f, 25.f } }, 2.f);
+
+  // L shape, so more than one piece
+  uint32_t id = grid.addFloor({
+    { 10.f, 10.f },
+    { 30.f, 10.f },
+    { 30.f, 15.f },
+    { 15.f, 15.f },
+    { 15.f, 30.f },
+    { 10.f, 30.f }
+  }, 3.f);
+
+  float_t height = 0.f;
+  ASSERT_TRUE(grid.highestFloor({ 12.f, 12.f }, height));
+  EXPECT_EQ(3.f, height);
+
+  grid.removeFloor(id);
+
+  EXPECT_EQ(1, grid.numPieces());
+  ASSERT_TRUE(grid.highestFloor({ 12.f, 12.f }, height));
+  EXPECT_EQ(2.f, height);
+  EXPECT_FALSE(grid.highestFloor({ 28.f, 12.f }, height));
+}
+
+TEST_F(FloorGridTest, floor_moved_many_times_matches_fresh_grid)
+{
+  FloorGrid grid(Vec2f{ 0.f, 0.f }, Vec2f{ 100.f, 100.f }, 20, 20);
+  grid.addFloor({ { 0.f, 0.f }, { 100.f, 0.f }, { 100.f, 100.f }, { 0.f, 100.f } }, 0.f);
+
+  // Alternate between a square and a hexagon so slots are reused with more and fewer edges
+  auto shape = [](int i) {
+    Vec2f c{ 10.f + i * 0.8f, 50.f };
+    std::vector<Vec2f> poly;
+    const int n = i % 2 == 0 ? 4 : 6;
+    for (int k = 0; k < n; ++k) {
+      float_t a = 2.f * PIf * k / n;
+      poly.push_back(c + Vec2f{ cosine(a), sine(a) } * 5.f);
+    }
+    return poly;
+  };
+
+  uint32_t id = grid.addFloor(shape(0), 1.f);
+  for (int i = 1; i < 100; ++i) {
+    grid.removeFloor(id);
+    id = grid.addFloor(shape(i), 1.f);
+  }
+
+  FloorGrid fresh(Vec2f{ 0.f, 0.f }, Vec2f{ 100.f, 100.f }, 20, 20);
+  fresh.addFloor({ { 0.f, 0.f }, { 100.f, 0.f }, { 100.f, 100.f }, { 0.f, 100.f } }, 0.f);
+  fresh.addFloor(shape(99), 1.f);
+
+  EXPECT_EQ(fresh.numPieces(), grid.numPieces());
+
+  for (float_t x = 0.5f; x < 100.f; x += 1.f) {
+    for (float_t y = 40.5f; y < 60.f; y += 1.f) {
+      float_t expected = 0.f;
+      float_t height = 0.f;
+      ASSERT_TRUE(fresh.highestFloor({ x, y }, expected));
+      ASSERT_TRUE(grid.highestFloor({ x, y }, height));
+      ASSERT_EQ(expected, height) << x << ", " << y;
+    }
+  }
+}
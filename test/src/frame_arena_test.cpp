@@ -0,0 +1,255 @@
+#include "alloc_counter.hpp"
+#include <frame_arena.hpp>
+#include <render_system.hpp>
+#include <renderer.hpp>
+#include <spatial_system.hpp>
+#include <camera.hpp>
+#include <logger.hpp>
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+
+using namespace render;
+
+namespace
+{
+
+// Records each frame's draws in an arena, the way the real renderer builds its frame state
+class RecordingRenderer : public Renderer
+{
+  public:
+    struct Draw
+    {
+      MeshHandle mesh;
+      Mat4x4f transform;
+      std::span<const Mat4x4f> jointTransforms;
+    };
+
+    void start() override {}
+    double frameRate() const override { return 0.0; }
+    void onResize() override {}
+    const ViewParams& getViewParams() const override { return m_params; }
+    void checkError() const override {}
+
+    void compileShader(const MeshFeatureSet&, const MaterialFeatureSet&) override {}
+
+    RenderItemId addTexture(TexturePtr) override { return 0; }
+    RenderItemId addNormalMap(TexturePtr) override { return 0; }
+    RenderItemId addCubeMap(std::array<TexturePtr, 6>&&) override { return 0; }
+    void removeTexture(RenderItemId) override {}
+    void removeCubeMap(RenderItemId) override {}
+
+    MeshHandle addMesh(MeshPtr) override { return {}; }
+    void removeMesh(RenderItemId) override {}
+
+    MaterialHandle addMaterial(MaterialPtr) override { return {}; }
+    void removeMaterial(RenderItemId) override {}
+
+    void beginFrame() override
+    {
+      arena.reset();
+      draws = {};
+    }
+
+    void beginPass(RenderPass, const Vec3f&, const Mat4x4f&) override {}
+
+    void drawModel(MeshHandle mesh, MaterialHandle, const Mat4x4f& transform) override
+    {
+      draws.push_back(arena, Draw{ mesh, transform, {} });
+    }
+
+    void drawModel(MeshHandle mesh, MaterialHandle, const Mat4x4f& transform,
+      const std::vector<Mat4x4f>& jointTransforms) override
+    {
+      draws.push_back(arena, Draw{ mesh, transform, arena.copy(jointTransforms) });
+    }
+
+    void drawInstance(MeshHandle mesh, MaterialHandle, const Mat4x4f& transform) override
+    {
+      draws.push_back(arena, Draw{ mesh, transform, {} });
+    }
+
+    void drawLight(const Vec3f&, float_t, float_t, float_t, const Mat4x4f&) override {}
+    void drawSkybox(MeshHandle, MaterialHandle) override {}
+    void endPass() override {}
+    void endFrame() override {}
+
+    FrameArena arena{ 4096 };
+    ArenaVector<Draw> draws;
+
+  private:
+    ViewParams m_params{
+      .hFov = degreesToRadians(90.f),
+      .vFov = degreesToRadians(60.f),
+      .aspectRatio = 1.5f,
+      .nearPlane = 0.1f,
+      .farPlane = 1000.f
+    };
+};
+
+} // namespace
+
+class FrameArenaTest : public testing::Test
+{
+  public:
+    virtual void SetUp() override {}
+
+    virtual void TearDown() override {}
+};
+
+TEST_F(FrameArenaTest, allocations_are_aligned_and_distinct)
+{
+  FrameArena arena(256);
+
+  char* a = static_cast<char*>(arena.allocate(3, 1));
+  double* b = static_cast<double*>(arena.allocate(sizeof(double), alignof(double)));
+  void* c = arena.allocate(10, 64);
+
+  ASSERT_EQ(0, reinterpret_cast<uintptr_t>(b) % alignof(double));
+  ASSERT_EQ(0, reinterpret_cast<uintptr_t>(c) % 64);
+  ASSERT_GE(reinterpret_cast<char*>(b), a + 3);
+  ASSERT_GE(static_cast<char*>(c), reinterpret_cast<char*>(b + 1));
+  ASSERT_EQ(21, arena.bytesUsed());
+}
+
+TEST_F(FrameArenaTest, grows_past_block_size)
+{
+  FrameArena arena(64);
+
+  std::vector<int*> items;
+  for (int i = 0; i < 100; ++i) {
+    items.push_back(arena.create<int>(i));
+  }
+  auto large = arena.allocateArray<int>(1000);
+  large[999] = 123;
+
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_EQ(i, *items[i]);
+  }
+  ASSERT_EQ(123, large[999]);
+  ASSERT_GE(arena.capacity(), 100 * sizeof(int) + 1000 * sizeof(int));
+}
+
+TEST_F(FrameArenaTest, reset_reuses_blocks)
+{
+  FrameArena arena(64);
+
+  auto fill = [&]() {
+    for (int i = 0; i < 100; ++i) {
+      arena.create<int>(i);
+    }
+    arena.allocateArray<int>(1000);
+  };
+
+  fill();
+  size_t capacity = arena.capacity();
+  int* first = nullptr;
+
+  for (int frame = 0; frame < 10; ++frame) {
+    arena.reset();
+    ASSERT_EQ(0, arena.bytesUsed());
+
+    int* p = arena.create<int>(0);
+    if (first == nullptr) {
+      first = p;
+    }
+    ASSERT_EQ(first, p);
+
+    fill();
+    ASSERT_EQ(capacity, arena.capacity());
+  }
+}
+
+TEST_F(FrameArenaTest, arena_vector_keeps_items_when_growing)
+{
+  FrameArena arena(128);
+  ArenaVector<Vec3f> items;
+
+  for (int i = 0; i < 1000; ++i) {
+    items.push_back(arena, Vec3f{ static_cast<float_t>(i), 0.f, 0.f });
+  }
+
+  ASSERT_EQ(1000, items.size());
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(static_cast<float_t>(i), items[i][0]);
+  }
+}
+
+TEST_F(FrameArenaTest, copy)
+{
+  FrameArena arena;
+  std::vector<Mat4x4f> joints(5, identityMatrix<float_t, 4>());
+  joints[3] = translationMatrix4x4(Vec3f{ 1.f, 2.f, 3.f });
+
+  auto copy = arena.copy(joints);
+  joints.clear();
+
+  ASSERT_EQ(5, copy.size());
+  ASSERT_EQ(translationMatrix4x4(Vec3f{ 1.f, 2.f, 3.f }), copy[3]);
+  ASSERT_TRUE(arena.copy(std::vector<Mat4x4f>{}).empty());
+}
+
+TEST_F(FrameArenaTest, steady_state_frame_does_not_allocate)
+{
+  std::stringstream stream;
+  LoggerPtr logger = createLogger(stream, stream, stream, stream);
+  SpatialSystemPtr spatialSystem = createSpatialSystem(*logger);
+  RecordingRenderer renderer;
+  RenderSystemPtr renderSystem = createRenderSystem(*spatialSystem, renderer, *logger);
+
+  spatialSystem->initialise(Vec2f{ -100.f, -100.f }, Vec2f{ 100.f, 100.f });
+
+  MeshHandle mesh;
+  mesh.features.flags.set(MeshFeatures::CastsShadow);
+  mesh.transform = identityMatrix<float_t, 4>();
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> x(-100.f, 100.f);
+
+  std::vector<EntityId> animated;
+  for (int i = 0; i < 1000; ++i) {
+    EntityId id = System::nextId();
+    spatialSystem->addComponent(std::make_unique<CSpatial>(id,
+      translationMatrix4x4(Vec3f{ x(gen), 0.f, x(gen) }), 1.f));
+
+    auto model = std::make_unique<CRenderModel>(id);
+    model->isInstanced = i % 3 == 0;
+    model->submodels.push_back(Submodel{ .mesh = mesh, .material = {}, .skin = nullptr });
+    if (i % 3 == 1) {
+      model->submodels[0].jointTransforms.resize(20, identityMatrix<float_t, 4>());
+      animated.push_back(id);
+    }
+    renderSystem->addComponent(std::move(model));
+  }
+
+  EntityId lightId = System::nextId();
+  spatialSystem->addComponent(std::make_unique<CSpatial>(lightId,
+    lookAt(Vec3f{ 0.f, 100.f, -150.f }, Vec3f{ 0.f, 0.f, 0.f }), 1.f));
+  renderSystem->addComponent(std::make_unique<CRenderLight>(lightId));
+
+  spatialSystem->update();
+  renderSystem->camera().setPosition(Vec3f{ 0.f, 2.f, -150.f });
+
+  auto frame = [&]() {
+    // Stands in for the animation update, which re-poses skinned models every frame
+    for (EntityId id : animated) {
+      auto& model = dynamic_cast<CRenderModel&>(renderSystem->getComponent(id));
+      model.submodels[0].jointTransformsDirty = true;
+    }
+    renderSystem->update();
+  };
+
+  // Let the arena and the render system's buffers grow to fit
+  for (int i = 0; i < 3; ++i) {
+    frame();
+  }
+  ASSERT_GT(renderer.draws.size(), 0);
+
+  size_t before = allocationCount();
+  for (int i = 0; i < 10; ++i) {
+    frame();
+  }
+  size_t allocations = allocationCount() - before;
+
+  ASSERT_EQ(0, allocations);
+}
@@ -0,0 +1,87 @@
+#include <frustum.hpp>
+#include <gtest/gtest.h>
+#include <random>
+
+class FrustumTest : public testing::Test
+{
+  public:
+    virtual void SetUp() override
+    {
+      // Camera at the origin looking along +z, with a 90 degree field of view
+      Mat4x4f view = lookAt(Vec3f{ 0.f, 0.f, 0.f }, Vec3f{ 0.f, 0.f, 1.f });
+      Mat4x4f proj = perspective(PIf / 2.f, PIf / 2.f, 0.1f, 100.f);
+      frustum = computeFrustum(proj * view);
+    }
+
+    virtual void TearDown() override {}
+
+    bool isVisible(const Vec3f& centre, float_t radius)
+    {
+      uint8_t visible = 0;
+      cullSpheres(frustum, &centre[0], &centre[1], &centre[2], &radius, 1, &visible);
+      return visible;
+    }
+
+    Frustum frustum;
+};
+
+TEST_F(FrustumTest, sphere_in_front_of_camera_is_visible)
+{
+  EXPECT_TRUE(isVisible({ 0.f, 0.f, 10.f }, 1.f));
+}
+
+TEST_F(FrustumTest, sphere_behind_camera_is_culled)
+{
+  EXPECT_FALSE(isVisible({ 0.f, 0.f, -10.f }, 1.f));
+}
+
+TEST_F(FrustumTest, sphere_beyond_far_plane_is_culled)
+{
+  EXPECT_FALSE(isVisible({ 0.f, 0.f, 110.f }, 1.f));
+  EXPECT_TRUE(isVisible({ 0.f, 0.f, 100.5f }, 1.f));
+}
+
+TEST_F(FrustumTest, sphere_above_view_is_culled)
+{
+  EXPECT_FALSE(isVisible({ 0.f, 50.f, 10.f }, 1.f));
+  EXPECT_FALSE(isVisible({ 0.f, -50.f, 10.f }, 1.f));
+}
+
+TEST_F(FrustumTest, sphere_beside_view_is_culled)
+{
+  EXPECT_FALSE(isVisible({ 50.f, 0.f, 10.f }, 1.f));
+  EXPECT_FALSE(isVisible({ -50.f, 0.f, 10.f }, 1.f));
+}
+
+TEST_F(FrustumTest, sphere_straddling_plane_is_visible)
+{
+  EXPECT_TRUE(isVisible({ 12.f, 0.f, 10.f }, 3.f));
+}
+
+TEST_F(FrustumTest, batches_match_individual_tests)
+{
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> p(-120.f, 120.f);
+  std::uniform_real_distribution<float_t> r(0.1f, 10.f);
+
+  // Not a multiple of the SIMD width
+  const size_t n = 1003;
+  std::vector<float_t> x(n), y(n), z(n), radius(n);
+  for (size_t i = 0; i < n; ++i) {
+    x[i] = p(gen);
+    y[i] = p(gen);
+    z[i] = p(gen);
+    radius[i] = r(gen);
+  }
+
+  std::vector<uint8_t> visible(n);
+  cullSpheres(frustum, x.data(), y.data(), z.data(), radius.data(), n, visible.data());
+
+  size_t numVisible = 0;
+  for (size_t i = 0; i < n; ++i) {
+    ASSERT_EQ(isVisible({ x[i], y[i], z[i] }, radius[i]), visible[i] != 0) << "Sphere " << i;
+    numVisible += visible[i];
+  }
+  EXPECT_GT(numVisible, 0);
+  EXPECT_LT(numVisible, n);
+}
@@ -1,5 +1,6 @@
 #include <grid.hpp>
 #include <gtest/gtest.h>
+#include <algorithm>
 
 class GridTest : public testing::Test
 {
@@ -86,3 +87,128 @@ TEST_F(GridTest, gridCellsBetweenPoints_out_of_bounds)
 
   EXPECT_EQ(expected, cells);
 }
+
+TEST_F(GridTest, getItems_radius_returns_each_item_once)
+{
+  Grid<char, 10, 10> grid(Vec2f{ 0.f, 0.f }, Vec2f{ 10.f, 10.f });
+
+  grid.addItemByRadius({ 2.5f, 2.5f }, 1.f, 'A');
+  grid.addItemByRadius({ 3.5f, 2.5f }, 1.f, 'B');
+  grid.addItemByRadius({ 8.5f, 8.5f }, 0.2f, 'C');
+
+  std::vector<char> items;
+  grid.getItems({ 3.f, 3.f }, 2.f, items);
+  std::sort(items.begin(), items.end());
+
+  std::vector<char> expected{ 'A', 'B' };
+
+  EXPECT_EQ(expected, items);
+}
+
+TEST_F(GridTest, getItems_buffer_is_cleared_between_queries)
+{
+  Grid<char, 10, 10> grid(Vec2f{ 0.f, 0.f }, Vec2f{ 10.f, 10.f });
+
+  grid.addItemByRadius({ 2.5f, 2.5f }, 1.f, 'A');
+  grid.addItemByRadius({ 8.5f, 8.5f }, 0.2f, 'C');
+
+  std::vector<char> items;
+  grid.getItems({ 2.5f, 2.5f }, 0.1f, items);
+  grid.getItems({ 8.5f, 8.5f }, 0.1f, items);
+
+  std::vector<char> expected{ 'C' };
+
+  EXPECT_EQ(expected, items);
+}
+
+TEST_F(GridTest, forEachItem_poly_visits_each_item_once)
+{
+  Grid<char, 10, 10> grid(Vec2f{ 0.f, 0.f }, Vec2f{ 10.f, 10.f });
+
+  grid.addItemByArea({{ 1.f, 1.f }, { 6.f, 1.f }, { 6.f, 6.f }, { 1.f, 6.f }}, 'A');
+  grid.addItemByRadius({ 4.5f, 4.5f }, 0.2f, 'B');
+  grid.addItemByRadius({ 8.5f, 8.5f }, 0.2f, 'C');
+
+  std::vector<char> items;
+  grid.forEachItem(std::vector<Vec2f>{{ 2.f, 2.f }, { 5.f, 2.f }, { 5.f, 5.f }, { 2.f, 5.f }},
+    [&items](char item) { items.push_back(item); });
+  std::sort(items.begin(), items.end());
+
+  std::vector<char> expected{ 'A', 'B' };
+
+  EXPECT_EQ(expected, items);
+}
+
+TEST_F(GridTest, getItems_point_returns_items_in_cell)
+{
+  Grid<char, 10, 10> grid(Vec2f{ 0.f, 0.f }, Vec2f{ 10.f, 10.f });
+
+  grid.addItemByPerimeter({{ 1.5f, 1.5f }, { 3.5f, 1.5f }, { 3.5f, 3.5f }, { 1.5f, 3.5f }}, 'A');
+  grid.addItemByRadius({ 2.5f, 1.5f }, 0.2f, 'B');
+
+  std::unordered_set<char> expected{ 'A', 'B' };
+
+  EXPECT_EQ(expected, grid.getItems(Vec2f{ 2.5f, 1.5f }));
+  EXPECT_TRUE(grid.getItems(Vec2f{ 2.5f, 2.5f }).empty());
+}
+
+TEST_F(GridTest, moveItemByRadius_leaves_old_cells)
+{
+  Grid<char, 10, 10> grid(Vec2f{ 0.f, 0.f }, Vec2f{ 10.f, 10.f });
+
+  grid.addItemByRadius({ 2.5f, 2.5f }, 1.f, 'A');
+  grid.moveItemByRadius({ 7.5f, 7.5f }, 1.f, 'A');
+
+  std::vector<char> items;
+  grid.getItems({ 2.5f, 2.5f }, 1.f, items);
+  EXPECT_TRUE(items.empty());
+
+  grid.getItems({ 7.5f, 7.5f }, 0.1f, items);
+  EXPECT_EQ(std::vector<char>{ 'A' }, items);
+}
+
+TEST_F(GridTest, moveItemByRadius_overlapping_ranges)
+{
+  Grid<char, 10, 10> grid(Vec2f{ 0.f, 0.f }, Vec2f{ 10.f, 10.f });
+
+  grid.addItemByRadius({ 2.5f, 2.5f }, 1.f, 'A');
+  grid.moveItemByRadius({ 3.5f, 2.5f }, 1.f, 'A');
+
+  EXPECT_TRUE(grid.getItems(Vec2f{ 1.5f, 2.5f }).empty());
+  EXPECT_EQ(1, grid.getItems(Vec2f{ 2.5f, 2.5f }).size());
+  EXPECT_EQ(1, grid.getItems(Vec2f{ 3.5f, 2.5f }).size());
+  EXPECT_EQ(1, grid.getItems(Vec2f{ 4.5f, 2.5f }).size());
+  EXPECT_TRUE(grid.getItems(Vec2f{ 5.5f, 2.5f }).empty());
+}
+
+TEST_F(GridTest, removeItem_evicts_item_from_all_cells)
+{
+  Grid<char, 10, 10> grid(Vec2f{ 0.f, 0.f }, Vec2f{ 10.f, 10.f });
+
+  grid.addItemByArea({{ 1.f, 1.f }, { 6.f, 1.f }, { 6.f, 6.f }, { 1.f, 6.f }}, 'A');
+  grid.addItemByRadius({ 3.5f, 3.5f }, 0.2f, 'B');
+  grid.removeItem('A');
+
+  EXPECT_FALSE(grid.hasItem('A'));
+
+  std::vector<char> items;
+  grid.getItems({ 5.f, 5.f }, 5.f, items);
+  EXPECT_EQ(std::vector<char>{ 'B' }, items);
+}
+
+TEST_F(GridTest, removed_item_can_be_added_again)
+{
+  Grid<char, 10, 10> grid(Vec2f{ 0.f, 0.f }, Vec2f{ 10.f, 10.f });
+
+  grid.addItemByRadius({ 2.5f, 2.5f }, 0.2f, 'A');
+  grid.removeItem('A');
+  grid.addItemByRadius({ 5.5f, 5.5f }, 0.2f, 'C');
+  grid.addItemByRadius({ 8.5f, 8.5f }, 0.2f, 'A');
+
+  std::vector<char> items;
+  grid.getItems({ 5.f, 5.f }, 5.f, items);
+  std::sort(items.begin(), items.end());
+
+  std::vector<char> expected{ 'A', 'C' };
+  EXPECT_EQ(expected, items);
+}
@@ -0,0 +1,250 @@
+#include <job_system.hpp>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <numeric>
+
+class JobSystemTest : public testing::Test
+{
+  public:
+    virtual void SetUp() override {}
+
+    virtual void TearDown() override {}
+};
+
+TEST_F(JobSystemTest, run_and_wait)
+{
+  JobSystem jobs(3);
+  int result = 0;
+
+  Job* job = jobs.create([&]() {
+    for (int i = 0; i < 100; ++i) {
+      result += i;
+    }
+  });
+  jobs.run(job);
+  jobs.wait(job);
+
+  ASSERT_TRUE(job->finished());
+  ASSERT_EQ(4950, result);
+}
+
+TEST_F(JobSystemTest, no_workers)
+{
+  JobSystem jobs(0);
+  ASSERT_EQ(1, jobs.numThreads());
+
+  std::vector<int> values(1000);
+  jobs.parallelFor(values.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      values[i] = static_cast<int>(i);
+    }
+  });
+
+  ASSERT_EQ(999 * 1000 / 2, std::accumulate(values.begin(), values.end(), 0));
+}
+
+TEST_F(JobSystemTest, parent_waits_for_children)
+{
+  JobSystem jobs(3);
+  std::atomic<int> count = 0;
+
+  Job* root = jobs.create([]() {});
+  for (int i = 0; i < 1000; ++i) {
+    jobs.run(jobs.create([&]() { ++count; }, root));
+  }
+  jobs.run(root);
+  jobs.wait(root);
+
+  ASSERT_EQ(1000, count);
+}
+
+TEST_F(JobSystemTest, children_created_inside_jobs)
+{
+  JobSystem jobs(3);
+  std::atomic<int> count = 0;
+
+  Job* root = jobs.create([]() {});
+  for (int i = 0; i < 10; ++i) {
+    Job* parent = jobs.create([&, root]() {
+      for (int j = 0; j < 100; ++j) {
+        jobs.run(jobs.create([&]() { ++count; }, root));
+      }
+    }, root);
+    jobs.run(parent);
+  }
+  jobs.run(root);
+  jobs.wait(root);
+
+  ASSERT_EQ(1000, count);
+}
+
+TEST_F(JobSystemTest, parallel_for_visits_each_index_once)
+{
+  JobSystem jobs(3);
+  std::vector<std::atomic<int>> visits(10007);
+
+  jobs.parallelFor(visits.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      ++visits[i];
+    }
+  }, 100);
+
+  for (size_t i = 0; i < visits.size(); ++i) {
+    ASSERT_EQ(1, visits[i]) << "Index " << i;
+  }
+}
+
+TEST_F(JobSystemTest, parallel_for_with_more_chunks_than_jobs)
+{
+  JobSystem jobs(3);
+  std::vector<std::atomic<int>> visits(300000);
+
+  // Would be over 4096 chunks at the requested grain size
+  for (int frame = 0; frame < 3; ++frame) {
+    jobs.parallelFor(visits.size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        ++visits[i];
+      }
+    }, 64);
+  }
+
+  for (size_t i = 0; i < visits.size(); ++i) {
+    ASSERT_EQ(3, visits[i]) << "Index " << i;
+  }
+}
+
+TEST_F(JobSystemTest, dependencies_run_in_order)
+{
+  JobSystem jobs(3);
+  std::mutex mutex;
+  std::vector<char> order;
+
+  auto record = [&](char c) {
+    std::lock_guard lock(mutex);
+    order.push_back(c);
+  };
+
+  // A before B and C, which both come before D
+  Job* a = jobs.create([&]() { record('a'); });
+  Job* b = jobs.create([&]() { record('b'); });
+  Job* c = jobs.create([&]() { record('c'); });
+  Job* d = jobs.create([&]() { record('d'); });
+  jobs.addDependency(b, a);
+  jobs.addDependency(c, a);
+  jobs.addDependency(d, b);
+  jobs.addDependency(d, c);
+
+  jobs.run(d);
+  jobs.run(c);
+  jobs.run(b);
+  jobs.run(a);
+  jobs.wait(d);
+
+  ASSERT_EQ(4, order.size());
+  ASSERT_EQ('a', order[0]);
+  ASSERT_EQ('d', order[3]);
+}
+
+TEST_F(JobSystemTest, dependency_waits_for_children)
+{
+  JobSystem jobs(3);
+  std::atomic<int> count = 0;
+  int seen = -1;
+
+  Job* parent = jobs.create([]() {});
+  for (int i = 0; i < 100; ++i) {
+    jobs.run(jobs.create([&]() { ++count; }, parent));
+  }
+  Job* after = jobs.create([&]() { seen = count; });
+  jobs.addDependency(after, parent);
+
+  jobs.run(after);
+  jobs.run(parent);
+  jobs.wait(after);
+
+  ASSERT_EQ(100, seen);
+}
+
+TEST_F(JobSystemTest, wait_inside_job)
+{
+  JobSystem jobs(3);
+  int result = 0;
+
+  Job* outer = jobs.create([&]() {
+    int sum = 0;
+    Job* inner = jobs.create([&]() { sum = 42; });
+    jobs.run(inner);
+    jobs.wait(inner);
+    result = sum;
+  });
+  jobs.run(outer);
+  jobs.wait(outer);
+
+  ASSERT_EQ(42, result);
+}
+
+TEST_F(JobSystemTest, exception_on_wait)
+{
+  JobSystem jobs(3);
+
+  Job* job = jobs.create([]() { throw std::runtime_error("Error!"); });
+  jobs.run(job);
+
+  EXPECT_THROW({
+    try {
+      jobs.wait(job);
+    }
+    catch (const std::exception& e) {
+      EXPECT_EQ(std::string("Error!"), e.what());
+      throw;
+    }
+  }, std::exception);
+
+  ASSERT_TRUE(job->finished());
+}
+
+TEST_F(JobSystemTest, exception_only_rethrown_by_its_own_wait)
+{
+  JobSystem jobs(3);
+
+  Job* failing = jobs.create([]() {});
+  jobs.run(jobs.create([]() { throw std::runtime_error("Error!"); }, failing));
+  jobs.run(failing);
+
+  Job* other = jobs.create([]() {});
+  jobs.run(other);
+
+  EXPECT_NO_THROW(jobs.wait(other));
+  EXPECT_NO_THROW(jobs.parallelFor(1000, [](size_t, size_t) {}, 10));
+  EXPECT_THROW(jobs.wait(failing), std::runtime_error);
+}
+
+TEST_F(JobSystemTest, parallel_for_rethrows_exception_from_chunk)
+{
+  JobSystem jobs(3);
+
+  EXPECT_THROW(jobs.parallelFor(1000, [](size_t begin, size_t) {
+    if (begin == 500) {
+      throw std::runtime_error("Error!");
+    }
+  }, 10), std::runtime_error);
+
+  EXPECT_NO_THROW(jobs.parallelFor(1000, [](size_t, size_t) {}, 10));
+}
+
+TEST_F(JobSystemTest, reuses_jobs_across_frames)
+{
+  JobSystem jobs(3);
+  std::atomic<int> count = 0;
+
+  for (int frame = 0; frame < 20; ++frame) {
+    Job* root = jobs.create([]() {});
+    for (int i = 0; i < 1000; ++i) {
+      jobs.run(jobs.create([&]() { ++count; }, root));
+    }
+    jobs.run(root);
+    jobs.wait(root);
+  }
+
+  ASSERT_EQ(20000, count);
+}
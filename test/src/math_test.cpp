@@ -123,6 +123,37 @@ TEST_F(MathTest, lineSegmentCircleIntersect_example_2)
   ASSERT_FALSE(lineSegmentCircleIntersect(lseg, p, radius));
 }
 
+TEST_F(MathTest, sweepCircleLineSegment_hits_segment_interior)
+{
+  LineSegment lseg{{2, -1}, {2, 1}};
+  float_t t = 0;
+  Vec2f normal;
+  ASSERT_TRUE(sweepCircleLineSegment({0, 0}, {4, 0}, 0.5f, lseg, t, normal));
+  ASSERT_NEAR(0.375f, t, 0.0001f);
+  ASSERT_NEAR(-1.f, normal[0], 0.0001f);
+  ASSERT_NEAR(0.f, normal[1], 0.0001f);
+}
+
+TEST_F(MathTest, sweepCircleLineSegment_hits_end_point)
+{
+  LineSegment lseg{{2, 0.3f}, {2, 5}};
+  float_t t = 0;
+  Vec2f normal;
+  ASSERT_TRUE(sweepCircleLineSegment({0, 0}, {4, 0}, 0.5f, lseg, t, normal));
+  ASSERT_NEAR(0.4f, t, 0.0001f);
+  ASSERT_NEAR(-0.8f, normal[0], 0.0001f);
+  ASSERT_NEAR(-0.6f, normal[1], 0.0001f);
+}
+
+TEST_F(MathTest, sweepCircleLineSegment_misses_when_moving_away)
+{
+  LineSegment lseg{{2, -1}, {2, 1}};
+  float_t t = 0;
+  Vec2f normal;
+  ASSERT_FALSE(sweepCircleLineSegment({1.8f, 0}, {-4, 0}, 0.5f, lseg, t, normal));
+  ASSERT_FALSE(sweepCircleLineSegment({0, 0}, {1, 0}, 0.5f, lseg, t, normal));
+}
+
 TEST_F(MathTest, clip_int_clips_to_min)
 {
   ASSERT_EQ(-10, clip(-15, -10, 10));
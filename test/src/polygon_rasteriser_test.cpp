@@ -0,0 +1,179 @@
+#include <polygon_rasteriser.hpp>
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+
+using CellSet = std::set<std::pair<int, int>>;
+
+class PolygonRasteriserTest : public testing::Test
+{
+  public:
+    virtual void SetUp() override {}
+
+    virtual void TearDown() override {}
+
+    CellSet rasterise(const std::vector<Vec2f>& poly, float_t cellSize = 1.f)
+    {
+      CellSet cells;
+      rasteriser.rasterise(poly, Vec2f{ 0.f, 0.f }, Vec2f{ cellSize, cellSize },
+        [&](int j, int first, int last) {
+          for (int i = first; i <= last; ++i) {
+            bool inserted = cells.insert({ i, j }).second;
+            EXPECT_TRUE(inserted) << "Cell (" << i << ", " << j << ") emitted twice";
+          }
+        });
+      return cells;
+    }
+
+    PolygonRasteriser rasteriser;
+};
+
+namespace
+{
+
+// Liang-Barsky clip of segment AB against the box
+bool segmentIntersectsBox(const Vec2f& A, const Vec2f& B, const Vec2f& min, const Vec2f& max)
+{
+  float_t t0 = 0.f;
+  float_t t1 = 1.f;
+  Vec2f d = B - A;
+
+  for (size_t k = 0; k < 2; ++k) {
+    if (d[k] == 0.f) {
+      if (A[k] < min[k] || A[k] > max[k]) {
+        return false;
+      }
+      continue;
+    }
+    float_t ta = (min[k] - A[k]) / d[k];
+    float_t tb = (max[k] - A[k]) / d[k];
+    t0 = std::max(t0, std::min(ta, tb));
+    t1 = std::min(t1, std::max(ta, tb));
+  }
+
+  return t0 <= t1;
+}
+
+bool polyOverlapsCell(const std::vector<Vec2f>& poly, int i, int j)
+{
+  Vec2f min{ float_t(i), float_t(j) };
+  Vec2f max{ float_t(i + 1), float_t(j + 1) };
+
+  if (pointIsInsidePoly(Vec2f{ i + 0.5f, j + 0.5f }, poly)) {
+    return true;
+  }
+  for (size_t k = 0; k < poly.size(); ++k) {
+    if (segmentIntersectsBox(poly[k], poly[(k + 1) % poly.size()], min, max)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+CellSet bruteForce(const std::vector<Vec2f>& poly)
+{
+  CellSet cells;
+  for (int i = -30; i < 30; ++i) {
+    for (int j = -30; j < 30; ++j) {
+      if (polyOverlapsCell(poly, i, j)) {
+        cells.insert({ i, j });
+      }
+    }
+  }
+  return cells;
+}
+
+// Star shaped, so simple but usually concave
+std::vector<Vec2f> randomPolygon(std::mt19937& gen, size_t numVertices)
+{
+  std::uniform_real_distribution<float_t> centre(-10.f, 10.f);
+  std::uniform_real_distribution<float_t> radius(0.5f, 15.f);
+
+  Vec2f c{ centre(gen), centre(gen) };
+  std::vector<Vec2f> poly;
+  for (size_t i = 0; i < numVertices; ++i) {
+    float_t a = 2.f * PIf * static_cast<float_t>(i) / static_cast<float_t>(numVertices);
+    float_t r = radius(gen);
+    poly.push_back(c + Vec2f{ r * cosine(a), r * sine(a) });
+  }
+  return poly;
+}
+
+} // namespace
+
+TEST_F(PolygonRasteriserTest, triangle_within_one_cell)
+{
+  CellSet expected{ { 2, 3 } };
+
+  EXPECT_EQ(expected, rasterise({ { 2.1f, 3.1f }, { 2.9f, 3.1f }, { 2.5f, 3.9f } }));
+}
+
+TEST_F(PolygonRasteriserTest, square_covers_cells_it_overlaps)
+{
+  auto cells = rasterise({ { 0.5f, 0.5f }, { 2.5f, 0.5f }, { 2.5f, 1.5f }, { 0.5f, 1.5f } });
+
+  CellSet expected{ { 0, 0 }, { 1, 0 }, { 2, 0 }, { 0, 1 }, { 1, 1 }, { 2, 1 } };
+
+  EXPECT_EQ(expected, cells);
+}
+
+TEST_F(PolygonRasteriserTest, cells_touched_only_at_max_edge_are_excluded)
+{
+  auto cells = rasterise({ { 1.f, 1.f }, { 3.f, 1.f }, { 3.f, 3.f }, { 1.f, 3.f } });
+
+  CellSet expected{ { 1, 1 }, { 2, 1 }, { 1, 2 }, { 2, 2 } };
+
+  EXPECT_EQ(expected, cells);
+}
+
+TEST_F(PolygonRasteriserTest, concave_polygon_skips_gap)
+{
+  // U shape, open at the top, with a gap over column 2 above row 0
+  std::vector<Vec2f> poly{
+    { 0.5f, 0.5f }, { 4.5f, 0.5f }, { 4.5f, 3.5f }, { 3.5f, 3.5f },
+    { 3.5f, 1.5f }, { 1.5f, 1.5f }, { 1.5f, 3.5f }, { 0.5f, 3.5f }
+  };
+
+  auto cells = rasterise(poly);
+
+  EXPECT_TRUE(cells.contains({ 2, 0 }));
+  EXPECT_TRUE(cells.contains({ 2, 1 }));
+  EXPECT_FALSE(cells.contains({ 2, 2 }));
+  EXPECT_FALSE(cells.contains({ 2, 3 }));
+  EXPECT_TRUE(cells.contains({ 1, 3 }));
+  EXPECT_TRUE(cells.contains({ 3, 3 }));
+  EXPECT_EQ(bruteForce(poly), cells);
+}
+
+TEST_F(PolygonRasteriserTest, rows_are_clipped_to_range)
+{
+  CellSet cells;
+  rasteriser.rasterise({ { 0.5f, 0.5f }, { 1.5f, 0.5f }, { 1.5f, 9.5f }, { 0.5f, 9.5f } },
+    Vec2f{ 0.f, 0.f }, Vec2f{ 1.f, 1.f }, [&](int j, int first, int last) {
+      for (int i = first; i <= last; ++i) {
+        cells.insert({ i, j });
+      }
+    }, 3, 4);
+
+  CellSet expected{ { 0, 3 }, { 1, 3 }, { 0, 4 }, { 1, 4 } };
+
+  EXPECT_EQ(expected, cells);
+}
+
+TEST_F(PolygonRasteriserTest, random_triangles_match_brute_force)
+{
+  std::mt19937 gen{ 1234 };
+  for (int i = 0; i < 100; ++i) {
+    auto poly = randomPolygon(gen, 3);
+    ASSERT_EQ(bruteForce(poly), rasterise(poly)) << "Polygon " << i;
+  }
+}
+
+TEST_F(PolygonRasteriserTest, random_concave_polygons_match_brute_force)
+{
+  std::mt19937 gen{ 5678 };
+  for (int i = 0; i < 100; ++i) {
+    auto poly = randomPolygon(gen, 12);
+    ASSERT_EQ(bruteForce(poly), rasterise(poly)) << "Polygon " << i;
+  }
+}
@@ -0,0 +1,188 @@
+#include <segment_grid.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+
+namespace
+{
+
+bool segmentsEqual(const LineSegment& a, const LineSegment& b)
+{
+  return a.A == b.A && a.B == b.B;
+}
+
+bool contains(const std::vector<LineSegment>& segments, const LineSegment& lseg)
+{
+  return std::any_of(segments.begin(), segments.end(), [&](const LineSegment& s) {
+    return segmentsEqual(s, lseg);
+  });
+}
+
+} // namespace
+
+class SegmentGridTest : public testing::Test
+{
+  public:
+    virtual void SetUp() override {}
+
+    virtual void TearDown() override {}
+};
+
+TEST_F(SegmentGridTest, radius_query_returns_only_segments_within_radius)
+{
+  SegmentGrid grid(Vec2f{ 0.f, 0.f }, Vec2f{ 100.f, 100.f }, 10, 10);
+
+  LineSegment near{ { 12.f, 10.f }, { 12.f, 20.f } };
+  LineSegment far{ { 14.f, 10.f }, { 14.f, 20.f } };
+  grid.addSegment(near, 1.f);
+  grid.addSegment(far, 1.f);
+
+  std::vector<LineSegment> segments;
+  grid.getSegments(Vec2f{ 10.5f, 15.f }, 2.f, 0.f, segments);
+
+  ASSERT_EQ(1, segments.size());
+  EXPECT_TRUE(segmentsEqual(near, segments[0]));
+}
+
+TEST_F(SegmentGridTest, segment_spanning_many_cells_is_returned_once)
+{
+  SegmentGrid grid(Vec2f{ 0.f, 0.f }, Vec2f{ 100.f, 100.f }, 10, 10);
+
+  LineSegment lseg{ { 5.f, 5.f }, { 95.f, 75.f } };
+  grid.addSegment(lseg, 1.f);
+
+  std::vector<LineSegment> segments;
+  grid.getSegments(Vec2f{ 50.f, 40.f }, 30.f, 0.f, segments);
+
+  ASSERT_EQ(1, segments.size());
+  EXPECT_TRUE(segmentsEqual(lseg, segments[0]));
+}
+
+TEST_F(SegmentGridTest, segments_no_taller_than_min_height_are_skipped)
+{
+  SegmentGrid grid(Vec2f{ 0.f, 0.f }, Vec2f{ 100.f, 100.f }, 10, 10);
+
+  std::vector<LineSegment> added;
+  for (int i = 0; i < 10; ++i) {
+    LineSegment lseg{ { 10.f + i * 0.1f, 10.f }, { 10.f + i * 0.1f, 12.f } };
+    grid.addSegment(lseg, static_cast<float_t>((i * 7) % 10));
+    added.push_back(lseg);
+  }
+
+  std::vector<LineSegment> segments;
+  grid.getSegments(Vec2f{ 11.f, 11.f }, 5.f, 4.f, segments);
+
+  ASSERT_EQ(5, segments.size());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ((i * 7) % 10 > 4, contains(segments, added[i])) << "Segment " << i;
+  }
+}
+
+TEST_F(SegmentGridTest, poly_query_returns_segments_in_overlapped_cells)
+{
+  SegmentGrid grid(Vec2f{ 0.f, 0.f }, Vec2f{ 100.f, 100.f }, 10, 10);
+
+  LineSegment inside{ { 22.f, 22.f }, { 24.f, 24.f } };
+  LineSegment outside{ { 52.f, 52.f }, { 54.f, 54.f } };
+  grid.addSegment(inside, 1.f);
+  grid.addSegment(outside, 1.f);
+
+  std::vector<LineSegment> segments;
+  grid.getSegments({ { 15.f, 15.f }, { 35.f, 15.f }, { 35.f, 35.f }, { 15.f, 35.f } }, 0.f,
+    segments);
+
+  ASSERT_EQ(1, segments.size());
+  EXPECT_TRUE(segmentsEqual(inside, segments[0]));
+}
+
+TEST_F(SegmentGridTest, radius_query_matches_brute_force)
+{
+  SegmentGrid grid(Vec2f{ 0.f, 0.f }, Vec2f{ 100.f, 100.f }, 20, 20);
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> p(0.f, 100.f);
+  std::uniform_real_distribution<float_t> offset(-3.f, 3.f);
+  std::uniform_real_distribution<float_t> h(0.f, 5.f);
+
+  struct Wall
+  {
+    LineSegment lseg;
+    float_t height;
+  };
+  std::vector<Wall> walls;
+  for (int i = 0; i < 2000; ++i) {
+    Vec2f A{ p(gen), p(gen) };
+    Vec2f B = A + Vec2f{ offset(gen), offset(gen) };
+    walls.push_back({ { A, B }, h(gen) });
+    grid.addSegment(walls.back().lseg, walls.back().height);
+  }
+
+  std::uniform_real_distribution<float_t> r(0.1f, 6.f);
+  std::vector<LineSegment> segments;
+  for (int i = 0; i < 200; ++i) {
+    Vec2f pos{ p(gen), p(gen) };
+    float_t radius = r(gen);
+    float_t minHeight = h(gen);
+
+    segments.clear();
+    grid.getSegments(pos, radius, minHeight, segments);
+
+    size_t expected = 0;
+    for (auto& wall : walls) {
+      Vec2f toSegment = closestPointOnLineSegment(wall.lseg, pos) - pos;
+      float_t distance = toSegment.magnitude();
+
+      // Leave some slack for differences in rounding
+      if (wall.height <= minHeight || std::abs(distance - radius) < 0.0001f) {
+        continue;
+      }
+      if (distance < radius) {
+        ++expected;
+        ASSERT_TRUE(contains(segments, wall.lseg)) << "Query " << i;
+      }
+      else {
+        ASSERT_FALSE(contains(segments, wall.lseg)) << "Query " << i;
+      }
+    }
+    EXPECT_GE(segments.size(), expected);
+  }
+}
+
+TEST_F(SegmentGridTest, removed_segment_is_not_returned)
+{
+  SegmentGrid grid(Vec2f{ 0.f, 0.f }, Vec2f{ 100.f, 100.f }, 10, 10);
+
+  LineSegment kept{ { 5.f, 5.f }, { 95.f, 75.f } };
+  LineSegment removed{ { 5.f, 75.f }, { 95.f, 5.f } };
+  grid.addSegment(kept, 1.f);
+  uint32_t id = grid.addSegment(removed, 2.f);
+  grid.removeSegment(id);
+
+  EXPECT_EQ(1, grid.numSegments());
+
+  std::vector<LineSegment> segments;
+  grid.getSegments(Vec2f{ 50.f, 40.f }, 60.f, 0.f, segments);
+
+  ASSERT_EQ(1, segments.size());
+  EXPECT_TRUE(segmentsEqual(kept, segments[0]));
+}
+
+TEST_F(SegmentGridTest, ids_of_removed_segments_are_reused)
+{
+  SegmentGrid grid(Vec2f{ 0.f, 0.f }, Vec2f{ 100.f, 100.f }, 10, 10);
+
+  LineSegment lseg{ { 12.f, 10.f }, { 12.f, 20.f } };
+  uint32_t id = grid.addSegment(lseg, 1.f);
+  grid.removeSegment(id);
+
+  LineSegment moved{ { 62.f, 60.f }, { 62.f, 70.f } };
+  EXPECT_EQ(id, grid.addSegment(moved, 1.f));
+
+  std::vector<LineSegment> segments;
+  grid.getSegments(Vec2f{ 12.f, 15.f }, 2.f, 0.f, segments);
+  EXPECT_TRUE(segments.empty());
+
+  grid.getSegments(Vec2f{ 62.f, 65.f }, 2.f, 0.f, segments);
+  ASSERT_EQ(1, segments.size());
+  EXPECT_TRUE(segmentsEqual(moved, segments[0]));
+}
@@ -0,0 +1,195 @@
+#include <sparse_grid.hpp>
+#include <grid.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <map>
+#include <set>
+
+class SparseGridTest : public testing::Test
+{
+  public:
+    virtual void SetUp() override {}
+
+    virtual void TearDown() override {}
+};
+
+TEST_F(SparseGridTest, items_outside_any_bounds_are_indexed)
+{
+  SparseGrid<int> grid(10.f);
+
+  grid.addItemByRadius({ -100000.f, 250000.f }, 1.f, 1);
+  grid.addItemByRadius({ 5.f, 5.f }, 1.f, 2);
+
+  EXPECT_EQ(std::unordered_set<int>{ 1 }, grid.getItems({ -100000.f, 250000.f }, 2.f));
+  EXPECT_EQ(std::unordered_set<int>{ 2 }, grid.getItems({ 5.f, 5.f }));
+}
+
+TEST_F(SparseGridTest, only_occupied_cells_are_stored)
+{
+  SparseGrid<int> grid(10.f);
+
+  grid.addItemByRadius({ 5.f, 5.f }, 1.f, 1);
+  grid.addItemByRadius({ 1000005.f, 5.f }, 1.f, 2);
+  grid.addItemByRadius({ 10.f, 10.f }, 1.f, 3);
+
+  EXPECT_EQ(5, grid.numOccupiedCells());
+
+  grid.removeItem(3);
+
+  EXPECT_EQ(2, grid.numOccupiedCells());
+  EXPECT_EQ(2, grid.numItems());
+}
+
+TEST_F(SparseGridTest, moveItemByRadius_leaves_old_cells)
+{
+  SparseGrid<int> grid(10.f);
+
+  grid.addItemByRadius({ 5.f, 5.f }, 1.f, 1);
+  grid.moveItemByRadius({ -95.f, 5.f }, 1.f, 1);
+
+  EXPECT_TRUE(grid.getItems({ 5.f, 5.f }).empty());
+  EXPECT_EQ(std::unordered_set<int>{ 1 }, grid.getItems({ -95.f, 5.f }));
+  EXPECT_EQ(1, grid.numOccupiedCells());
+}
+
+TEST_F(SparseGridTest, oversized_items_are_returned_by_every_query)
+{
+  SparseGrid<int> grid(10.f);
+
+  grid.addItemByRadius({ 0.f, 0.f }, 10000.f, 1);
+  grid.addItemByRadius({ 505.f, 505.f }, 1.f, 2);
+
+  EXPECT_EQ(1, grid.numOccupiedCells());
+  EXPECT_EQ((std::unordered_set<int>{ 1, 2 }), grid.getItems({ 505.f, 505.f }, 1.f));
+  EXPECT_EQ(std::unordered_set<int>{ 1 }, grid.getItems({ -500.f, 500.f }));
+
+  // Shrinking it bins it normally
+  grid.moveItemByRadius({ 0.f, 0.f }, 1.f, 1);
+
+  EXPECT_TRUE(grid.getItems({ -500.f, 500.f }).empty());
+  EXPECT_EQ(std::unordered_set<int>{ 1 }, grid.getItems({ 0.f, 0.f }));
+}
+
+TEST_F(SparseGridTest, setCellSize_rebins_items)
+{
+  SparseGrid<int> grid(10.f);
+
+  grid.addItemByRadius({ 5.f, 5.f }, 1.f, 1);
+  grid.addItemByRadius({ 95.f, 95.f }, 1.f, 2);
+  grid.setCellSize(100.f);
+
+  EXPECT_EQ(1, grid.numOccupiedCells());
+  EXPECT_EQ((std::unordered_set<int>{ 1, 2 }), grid.getItems({ 50.f, 50.f }));
+}
+
+// With the same cell layout, queries should give the same results as the fixed grid
+TEST_F(SparseGridTest, queries_match_fixed_grid)
+{
+  Grid<int, 10, 10> grid(Vec2f{ 0.f, 0.f }, Vec2f{ 400.f, 400.f });
+  SparseGrid<int> sparseGrid(40.f);
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> x(0.f, 400.f);
+  std::uniform_real_distribution<float_t> r(1.f, 30.f);
+
+  for (int i = 0; i < 200; ++i) {
+    Vec2f pos{ x(gen), x(gen) };
+    float_t radius = r(gen);
+    grid.addItemByRadius(pos, radius, i);
+    sparseGrid.addItemByRadius(pos, radius, i);
+  }
+
+  for (int i = 0; i < 50; ++i) {
+    Vec2f pos{ x(gen), x(gen) };
+    float_t radius = r(gen);
+    EXPECT_EQ(grid.getItems(pos, radius), sparseGrid.getItems(pos, radius));
+    EXPECT_EQ(grid.getItems(pos), sparseGrid.getItems(pos));
+
+    std::vector<Vec2f> poly{ pos, { x(gen), x(gen) }, { x(gen), x(gen) } };
+    EXPECT_EQ(grid.getItems(poly), sparseGrid.getItems(poly));
+  }
+}
+
+TEST_F(SparseGridTest, large_poly_query_scans_occupied_cells)
+{
+  SparseGrid<int> grid(1.f);
+
+  grid.addItemByRadius({ 10.f, 10.f }, 0.1f, 1);
+  grid.addItemByRadius({ -10.f, 10.f }, 0.1f, 2);
+
+  std::vector<int> items;
+  grid.getItems(std::vector<Vec2f>{ { 0.f, 0.f }, { 5000.f, 0.f }, { 0.f, 5000.f } }, items);
+
+  EXPECT_EQ(std::vector<int>{ 1 }, items);
+}
+
+TEST_F(SparseGridTest, forEachItemInPolys_masks_match_separate_queries)
+{
+  SparseGrid<int> grid(10.f);
+
+  std::mt19937 gen{ 1234 };
+  std::uniform_real_distribution<float_t> x(-200.f, 200.f);
+  std::uniform_real_distribution<float_t> r(1.f, 15.f);
+
+  for (int i = 0; i < 300; ++i) {
+    grid.addItemByRadius({ x(gen), x(gen) }, r(gen), i);
+  }
+  grid.addItemByRadius({ 0.f, 0.f }, 100000.f, 1000);
+
+  std::vector<std::vector<Vec2f>> polys;
+  for (int i = 0; i < 5; ++i) {
+    polys.push_back({ { x(gen), x(gen) }, { x(gen), x(gen) }, { x(gen), x(gen) } });
+  }
+
+  std::map<int, uint32_t> masks;
+  grid.forEachItemInPolys(polys.size(),
+    [&polys](size_t i) -> const std::vector<Vec2f>& { return polys[i]; },
+    [&masks](int item, uint32_t mask) {
+      EXPECT_FALSE(masks.contains(item));
+      masks[item] = mask;
+    });
+
+  std::map<int, uint32_t> expected;
+  for (size_t i = 0; i < polys.size(); ++i) {
+    for (int item : grid.getItems(polys[i])) {
+      expected[item] |= 1u << i;
+    }
+  }
+
+  EXPECT_EQ(expected, masks);
+  EXPECT_EQ(0x1fu, masks[1000]);
+}
+
+TEST_F(SparseGridTest, forEachItemOnRay_stops_at_limit)
+{
+  SparseGrid<int> grid(10.f);
+
+  grid.addItemByRadius({ 25.f, 5.f }, 1.f, 1);
+  grid.addItemByRadius({ 55.f, 5.f }, 1.f, 2);
+  grid.addItemByRadius({ 25.f, 30.f }, 1.f, 3);
+
+  std::vector<int> visited;
+  grid.forEachItemOnRay({ 0.f, 5.f }, { 1.f, 0.f }, 100.f, [&](int item) {
+    visited.push_back(item);
+    return 24.f;
+  });
+
+  EXPECT_EQ(std::vector<int>{ 1 }, visited);
+}
+
+TEST_F(SparseGridTest, forEachItemByDistance_finds_distant_items)
+{
+  SparseGrid<int> grid(10.f);
+
+  grid.addItemByRadius({ 5.f, 5.f }, 1.f, 1);
+  grid.addItemByRadius({ 100005.f, 5.f }, 1.f, 2);
+
+  std::set<int> visited;
+  grid.forEachItemByDistance({ 100000.f, 0.f }, [&](int item) {
+    visited.insert(item);
+    return std::numeric_limits<float_t>::infinity();
+  });
+
+  EXPECT_EQ((std::set<int>{ 1, 2 }), visited);
+}
@@ -0,0 +1,172 @@
+#include <spatial_system.hpp>
+#include <logger.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <sstream>
+
+class SpatialSystemTest : public testing::TestWithParam<SpatialIndexType>
+{
+  public:
+    virtual void SetUp() override
+    {
+      logger = createLogger(stream, stream, stream, stream);
+      spatialSystem = createSpatialSystem(*logger, GetParam());
+      spatialSystem->initialise(Vec2f{ 0.f, 0.f }, Vec2f{ 500.f, 500.f });
+
+      std::mt19937 gen{ 1234 };
+      std::uniform_real_distribution<float_t> x(0.f, 500.f);
+      std::uniform_real_distribution<float_t> y(-20.f, 20.f);
+      std::uniform_real_distribution<float_t> r(0.5f, 8.f);
+
+      for (EntityId id = 0; id < 2000; ++id) {
+        spheres.push_back({ Vec3f{ x(gen), y(gen), x(gen) }, r(gen) });
+        spatialSystem->addComponent(std::make_unique<CSpatial>(id,
+          translationMatrix4x4(spheres[id].first), spheres[id].second));
+      }
+      spatialSystem->update();
+    }
+
+    virtual void TearDown() override {}
+
+    float_t surfaceDistance(EntityId id, const Vec3f& pos) const
+    {
+      return std::max(0.f, (spheres[id].first - pos).magnitude() - spheres[id].second);
+    }
+
+    std::stringstream stream;
+    LoggerPtr logger;
+    SpatialSystemPtr spatialSystem;
+    std::vector<std::pair<Vec3f, float_t>> spheres;
+};
+
+TEST_P(SpatialSystemTest, raycast_finds_nearest_hit)
+{
+  std::mt19937 gen{ 5678 };
+  std::uniform_real_distribution<float_t> x(0.f, 500.f);
+  std::uniform_real_distribution<float_t> d(-1.f, 1.f);
+
+  size_t numHits = 0;
+  for (int i = 0; i < 200; ++i) {
+    Vec3f origin{ x(gen), 0.f, x(gen) };
+    Vec3f dir = Vec3f{ d(gen), 0.1f * d(gen), d(gen) };
+
+    float_t expected = std::numeric_limits<float_t>::infinity();
+    for (auto& sphere : spheres) {
+      float_t t = 0.f;
+      if (raySphereIntersect(origin, dir.normalise(), sphere.first, sphere.second, t) &&
+        t <= 100.f) {
+
+        expected = std::min(expected, t);
+      }
+    }
+
+    RaycastHit hit;
+    bool found = spatialSystem->raycast(origin, dir, 100.f, hit);
+
+    ASSERT_EQ(std::isfinite(expected), found) << "Ray " << i;
+    if (found) {
+      ASSERT_NEAR(expected, hit.distance, 0.001f) << "Ray " << i;
+      ++numHits;
+    }
+  }
+
+  EXPECT_GT(numHits, 0);
+}
+
+TEST_P(SpatialSystemTest, raycast_skips_filtered_entities)
+{
+  Vec3f origin = spheres[0].first - Vec3f{ 50.f, 0.f, 0.f };
+
+  RaycastHit hit;
+  ASSERT_TRUE(spatialSystem->raycast(origin, Vec3f{ 1.f, 0.f, 0.f }, 60.f, hit));
+
+  EntityId first = hit.entityId;
+  ASSERT_TRUE(spatialSystem->raycast(origin, Vec3f{ 1.f, 0.f, 0.f }, 60.f, hit,
+    [first](EntityId id) { return id != first; }));
+
+  EXPECT_NE(first, hit.entityId);
+}
+
+TEST_P(SpatialSystemTest, nearest_matches_brute_force)
+{
+  std::mt19937 gen{ 5678 };
+  std::uniform_real_distribution<float_t> x(-100.f, 600.f);
+  std::vector<EntityId> entities;
+
+  for (int i = 0; i < 50; ++i) {
+    Vec3f pos{ x(gen), 0.f, x(gen) };
+
+    std::vector<float_t> expected;
+    for (EntityId id = 0; id < spheres.size(); ++id) {
+      expected.push_back(surfaceDistance(id, pos));
+    }
+    std::sort(expected.begin(), expected.end());
+    expected.resize(10);
+
+    spatialSystem->nearest(pos, 10, entities);
+
+    ASSERT_EQ(10, entities.size());
+    for (size_t j = 0; j < entities.size(); ++j) {
+      ASSERT_NEAR(expected[j], surfaceDistance(entities[j], pos), 0.001f) << "Query " << i;
+    }
+  }
+}
+
+TEST_P(SpatialSystemTest, nearest_applies_filter)
+{
+  std::vector<EntityId> entities;
+  spatialSystem->nearest(Vec3f{ 250.f, 0.f, 250.f }, 5, entities,
+    [](EntityId id) { return id % 2 == 0; });
+
+  ASSERT_EQ(5, entities.size());
+  for (EntityId id : entities) {
+    EXPECT_EQ(0, id % 2);
+  }
+}
+
+TEST_P(SpatialSystemTest, withinRadius_matches_brute_force)
+{
+  std::mt19937 gen{ 5678 };
+  std::uniform_real_distribution<float_t> x(0.f, 500.f);
+  std::vector<EntityId> entities;
+
+  for (int i = 0; i < 50; ++i) {
+    Vec3f pos{ x(gen), 0.f, x(gen) };
+
+    std::vector<EntityId> expected;
+    for (EntityId id = 0; id < spheres.size(); ++id) {
+      if ((spheres[id].first - pos).magnitude() <= 30.f + spheres[id].second) {
+        expected.push_back(id);
+      }
+    }
+
+    spatialSystem->withinRadius(pos, 30.f, entities);
+    std::sort(entities.begin(), entities.end());
+
+    ASSERT_EQ(expected, entities) << "Query " << i;
+  }
+}
+
+TEST_P(SpatialSystemTest, interpolatedTransform_blends_last_update)
+{
+  EntityId id = 7;
+  Vec3f from = spheres[id].first;
+  Vec3f to = from + Vec3f{ 4.f, 0.f, 2.f };
+
+  spatialSystem->setTransform(id, translationMatrix4x4(to));
+  spatialSystem->update();
+
+  auto& spatial = spatialSystem->getComponent(id);
+  Vec3f halfway = getTranslation(spatial.interpolatedTransform(0.5f));
+  EXPECT_NEAR(from[0] + 2.f, halfway[0], 0.001f);
+  EXPECT_NEAR(from[2] + 1.f, halfway[2], 0.001f);
+  EXPECT_EQ(spatial.absTransform(), spatial.interpolatedTransform(1.f));
+
+  // Entities that didn't move in the last update are drawn where they are
+  spatialSystem->update();
+  EXPECT_EQ(spatial.absTransform(), spatial.interpolatedTransform(0.5f));
+}
+
+INSTANTIATE_TEST_SUITE_P(Indices, SpatialSystemTest,
+  testing::Values(SpatialIndexType::Grid, SpatialIndexType::Bvh));
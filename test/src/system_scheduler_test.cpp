@@ -0,0 +1,189 @@
+#include <system_scheduler.hpp>
+#include <job_system.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <sstream>
+
+class SystemSchedulerTest : public testing::Test
+{
+  public:
+    virtual void SetUp() override
+    {
+      m_jobs = std::make_unique<JobSystem>(3);
+      m_scheduler = std::make_unique<SystemScheduler>(*m_jobs);
+    }
+
+    virtual void TearDown() override
+    {
+      m_scheduler.reset();
+      m_jobs.reset();
+    }
+
+    void record(const std::string& stage)
+    {
+      std::lock_guard lock(m_mutex);
+      m_order.push_back(stage);
+    }
+
+    std::unique_ptr<JobSystem> m_jobs;
+    std::unique_ptr<SystemScheduler> m_scheduler;
+    std::mutex m_mutex;
+    std::vector<std::string> m_order;
+};
+
+TEST_F(SystemSchedulerTest, dependencies_follow_reads_and_writes)
+{
+  m_scheduler->addStage("game", { "collision" }, { "spatial" }, []() {});
+  m_scheduler->addStage("spatial", {}, { "spatial", "collision" }, []() {});
+  m_scheduler->addStage("render", { "spatial" }, { "render" }, []() {});
+  m_scheduler->addStage("collision", {}, { "collision" }, []() {});
+  m_scheduler->addStage("audio", { "spatial" }, { "audio" }, []() {});
+
+  ASSERT_EQ(std::vector<uint32_t>{}, m_scheduler->dependencies(0));
+  // Writes after a read and a write
+  ASSERT_EQ(std::vector<uint32_t>({ 0 }), m_scheduler->dependencies(1));
+  // Read after write
+  ASSERT_EQ(std::vector<uint32_t>({ 1 }), m_scheduler->dependencies(2));
+  // Write after write, but not after render, which doesn't touch the collision store
+  ASSERT_EQ(std::vector<uint32_t>({ 1 }), m_scheduler->dependencies(3));
+  // Two readers of the same store don't depend on each other
+  ASSERT_EQ(std::vector<uint32_t>({ 1 }), m_scheduler->dependencies(4));
+}
+
+TEST_F(SystemSchedulerTest, stages_run_after_their_dependencies)
+{
+  for (int frame = 0; frame < 50; ++frame) {
+    m_order.clear();
+    m_scheduler = std::make_unique<SystemScheduler>(*m_jobs);
+
+    m_scheduler->addStage("a", {}, { "x" }, [this]() { record("a"); });
+    m_scheduler->addStage("b", { "x" }, { "y" }, [this]() { record("b"); });
+    m_scheduler->addStage("c", { "x" }, { "z" }, [this]() { record("c"); });
+    m_scheduler->addStage("d", { "y", "z" }, {}, [this]() { record("d"); });
+    m_scheduler->runFrame();
+
+    ASSERT_EQ(4, m_order.size());
+    ASSERT_EQ("a", m_order[0]);
+    ASSERT_EQ("d", m_order[3]);
+  }
+}
+
+TEST_F(SystemSchedulerTest, independent_stages_run_concurrently)
+{
+  std::atomic<bool> aStarted = false;
+  std::atomic<bool> bStarted = false;
+  bool aSawB = false;
+  bool bSawA = false;
+
+  // Each waits a while for the other to start, which only happens if they overlap
+  auto waitFor = [](const std::atomic<bool>& flag) {
+    for (int i = 0; i < 100000 && !flag; ++i) {
+      std::this_thread::yield();
+    }
+    return flag.load();
+  };
+
+  m_scheduler->addStage("a", { "shared" }, { "x" }, [&]() {
+    aStarted = true;
+    aSawB = waitFor(bStarted);
+  });
+  m_scheduler->addStage("b", { "shared" }, { "y" }, [&]() {
+    bStarted = true;
+    bSawA = waitFor(aStarted);
+  });
+  m_scheduler->runFrame();
+
+  ASSERT_TRUE(aSawB);
+  ASSERT_TRUE(bSawA);
+
+  auto& timeline = m_scheduler->timeline();
+  ASSERT_EQ(2, timeline.stages.size());
+  ASSERT_NE(timeline.stages[0].thread, timeline.stages[1].thread);
+  ASSERT_LT(timeline.stages[0].start, timeline.stages[1].end);
+  ASSERT_LT(timeline.stages[1].start, timeline.stages[0].end);
+}
+
+TEST_F(SystemSchedulerTest, main_thread_stages_run_on_caller)
+{
+  std::thread::id caller = std::this_thread::get_id();
+  std::vector<std::thread::id> threads(20);
+  std::vector<std::string> stores;
+
+  for (uint32_t i = 0; i < threads.size(); ++i) {
+    stores.push_back(std::to_string(i));
+    bool mainThread = i % 4 == 0;
+    m_scheduler->addStage(std::to_string(i), { "a" }, { std::to_string(i) }, [&, i]() {
+      threads[i] = std::this_thread::get_id();
+      record(std::to_string(i));
+    }, mainThread);
+  }
+  m_scheduler->addStage("last", stores, {}, [this]() {
+    record("last");
+  }, true);
+  m_scheduler->runFrame();
+
+  for (uint32_t i = 0; i < threads.size(); i += 4) {
+    ASSERT_EQ(caller, threads[i]);
+  }
+  ASSERT_EQ(21, m_order.size());
+  ASSERT_EQ("last", m_order.back());
+}
+
+TEST_F(SystemSchedulerTest, wide_fan_out)
+{
+  std::atomic<int> count = 0;
+  int seen = -1;
+
+  m_scheduler->addStage("source", {}, { "data" }, []() {});
+  for (int i = 0; i < 50; ++i) {
+    m_scheduler->addStage("reader", { "data" }, {}, [&]() { ++count; });
+  }
+  m_scheduler->addStage("sink", {}, { "data" }, [&]() { seen = count; });
+  m_scheduler->runFrame();
+
+  // The source and every reader
+  ASSERT_EQ(51, m_scheduler->dependencies(51).size());
+  ASSERT_EQ(50, seen);
+}
+
+TEST_F(SystemSchedulerTest, exception_on_run_frame)
+{
+  bool laterStageRan = false;
+
+  m_scheduler->addStage("a", {}, { "x" }, []() { throw std::runtime_error("Error!"); });
+  m_scheduler->addStage("b", { "x" }, {}, [&]() { laterStageRan = true; });
+
+  EXPECT_THROW({
+    try {
+      m_scheduler->runFrame();
+    }
+    catch (const std::exception& e) {
+      EXPECT_EQ(std::string("Error!"), e.what());
+      throw;
+    }
+  }, std::exception);
+
+  ASSERT_TRUE(laterStageRan);
+
+  // The next frame runs as normal
+  laterStageRan = false;
+  EXPECT_THROW(m_scheduler->runFrame(), std::exception);
+  ASSERT_TRUE(laterStageRan);
+}
+
+TEST_F(SystemSchedulerTest, timeline_output)
+{
+  m_scheduler->addStage("update", {}, { "x" }, []() {});
+  m_scheduler->addStage("draw", { "x" }, {}, []() {});
+  m_scheduler->runFrame();
+
+  std::stringstream ss;
+  ss << m_scheduler->timeline();
+  std::string output = ss.str();
+
+  ASSERT_NE(std::string::npos, output.find("update"));
+  ASSERT_NE(std::string::npos, output.find("draw"));
+  ASSERT_NE(std::string::npos, output.find("parallelism"));
+}
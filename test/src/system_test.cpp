@@ -0,0 +1,87 @@
+#include <system.hpp>
+#include <gtest/gtest.h>
+#include <set>
+
+class EntityIdAllocatorTest : public testing::Test
+{
+  public:
+    virtual void SetUp() override {}
+
+    virtual void TearDown() override {}
+};
+
+TEST_F(EntityIdAllocatorTest, ids_are_compact_and_distinct)
+{
+  EntityIdAllocator allocator;
+
+  for (uint32_t i = 0; i < 100; ++i) {
+    EntityId id = allocator.allocate();
+    EXPECT_EQ(i, entityIndex(id));
+    EXPECT_EQ(0, entityGeneration(id));
+    EXPECT_TRUE(allocator.isAlive(id));
+  }
+  EXPECT_EQ(100, allocator.numAlive());
+}
+
+TEST_F(EntityIdAllocatorTest, released_id_is_stale)
+{
+  EntityIdAllocator allocator;
+  EntityId id = allocator.allocate();
+  allocator.release(id);
+
+  EXPECT_FALSE(allocator.isAlive(id));
+  EXPECT_THROW(allocator.release(id), std::exception);
+  EXPECT_FALSE(allocator.isAlive(NULL_ENTITY_ID));
+  EXPECT_EQ(0, allocator.numAlive());
+}
+
+TEST_F(EntityIdAllocatorTest, reused_slots_have_new_generation)
+{
+  EntityIdAllocator allocator;
+
+  // Churn enough ids that released slots start being reused
+  std::set<EntityId> seen;
+  std::set<uint32_t> slots;
+  for (int i = 0; i < 5000; ++i) {
+    EntityId id = allocator.allocate();
+    EXPECT_TRUE(seen.insert(id).second) << "Id " << id << " handed out twice";
+    slots.insert(entityIndex(id));
+    allocator.release(id);
+  }
+
+  EXPECT_LT(slots.size(), seen.size());
+}
+
+TEST_F(EntityIdAllocatorTest, slots_are_retired_before_generation_wraps)
+{
+  EntityIdAllocator allocator;
+
+  EntityId first = allocator.allocate();
+  std::set<EntityId> seen{ first };
+  allocator.release(first);
+
+  // Each slot is reused only after many others are released, so cycle through plenty of ids
+  for (uint32_t i = 0; i < 2000 * MAX_ENTITY_GENERATION; ++i) {
+    EntityId id = allocator.allocate();
+    ASSERT_NE(NULL_ENTITY_ID, id);
+    ASSERT_LT(entityGeneration(id), MAX_ENTITY_GENERATION);
+    if (entityIndex(id) == entityIndex(first)) {
+      ASSERT_TRUE(seen.insert(id).second);
+    }
+    allocator.release(id);
+  }
+
+  EXPECT_EQ(MAX_ENTITY_GENERATION, seen.size());
+}
+
+TEST_F(EntityIdAllocatorTest, named_ids_are_looked_up_and_released)
+{
+  EntityId id = System::idFromString("entity_allocator_test_name");
+  EXPECT_EQ(id, System::idFromString("entity_allocator_test_name"));
+  EXPECT_TRUE(System::isAlive(id));
+  EXPECT_NE(id, System::nextId());
+
+  System::releaseId(id);
+  EXPECT_FALSE(System::isAlive(id));
+  EXPECT_NE(id, System::idFromString("entity_allocator_test_name"));
+}
@@ -0,0 +1,83 @@
+#include <time.hpp>
+#include <gtest/gtest.h>
+
+class FixedTimestepTest : public testing::Test
+{
+  public:
+    virtual void SetUp() override {}
+
+    virtual void TearDown() override {}
+};
+
+TEST_F(FixedTimestepTest, steps_are_independent_of_frame_rate)
+{
+  FixedTimestep fast(60);
+  FixedTimestep slow(60);
+
+  unsigned fastSteps = 0;
+  for (int i = 0; i < 240; ++i) {
+    fastSteps += fast.advance(1.0 / 240.0);
+  }
+  unsigned slowSteps = 0;
+  for (int i = 0; i < 30; ++i) {
+    slowSteps += slow.advance(1.0 / 30.0);
+  }
+
+  EXPECT_NEAR(60, fastSteps, 1);
+  EXPECT_NEAR(60, slowSteps, 1);
+}
+
+TEST_F(FixedTimestepTest, alpha_is_fraction_of_next_step)
+{
+  FixedTimestep timestep(10);
+
+  EXPECT_EQ(0, timestep.advance(0.05));
+  EXPECT_NEAR(0.5, timestep.alpha(), 0.0001);
+
+  EXPECT_EQ(1, timestep.advance(0.075));
+  EXPECT_NEAR(0.25, timestep.alpha(), 0.0001);
+}
+
+TEST_F(FixedTimestepTest, long_stall_is_capped)
+{
+  FixedTimestep timestep(60, 5);
+
+  EXPECT_EQ(5, timestep.advance(2.0));
+  EXPECT_LE(timestep.alpha(), 1.0);
+
+  // The dropped time isn't caught up on later
+  EXPECT_LE(timestep.advance(1.0 / 60.0), 2);
+}
+
+class FrameRateLimiterTest : public testing::Test
+{
+  public:
+    virtual void SetUp() override {}
+
+    virtual void TearDown() override {}
+};
+
+TEST_F(FrameRateLimiterTest, waits_out_the_rest_of_each_frame)
+{
+  FrameRateLimiter limiter(100);
+  limiter.wait();
+
+  Timer timer;
+  for (int i = 0; i < 5; ++i) {
+    limiter.wait();
+  }
+
+  EXPECT_GE(timer.elapsed(), 0.045);
+}
+
+TEST_F(FrameRateLimiterTest, zero_frame_rate_is_unlimited)
+{
+  FrameRateLimiter limiter(0);
+
+  Timer timer;
+  for (int i = 0; i < 1000; ++i) {
+    limiter.wait();
+  }
+
+  EXPECT_LT(timer.elapsed(), 0.1);
+}
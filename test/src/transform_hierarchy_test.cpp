@@ -0,0 +1,247 @@
+#include <transform_hierarchy.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+
+class TransformHierarchyTest : public testing::Test
+{
+  public:
+    virtual void SetUp() override {}
+
+    virtual void TearDown() override {}
+};
+
+static Vec3f worldPos(const TransformHierarchy& hierarchy, TransformHierarchy::NodeId node)
+{
+  return getTranslation(hierarchy.world(node));
+}
+
+static bool contains(const std::vector<TransformHierarchy::NodeId>& nodes,
+  TransformHierarchy::NodeId node)
+{
+  return std::find(nodes.begin(), nodes.end(), node) != nodes.end();
+}
+
+TEST_F(TransformHierarchyTest, child_world_is_computed_on_add)
+{
+  TransformHierarchy hierarchy;
+
+  auto a = hierarchy.add(translationMatrix4x4(Vec3f{ 1.f, 0.f, 0.f }));
+  auto b = hierarchy.add(translationMatrix4x4(Vec3f{ 0.f, 2.f, 0.f }), a);
+
+  EXPECT_EQ(Vec3f({ 1.f, 2.f, 0.f }), worldPos(hierarchy, b));
+  EXPECT_EQ(a, hierarchy.parent(b));
+  EXPECT_EQ(2, hierarchy.size());
+}
+
+TEST_F(TransformHierarchyTest, setLocal_propagates_to_descendants)
+{
+  TransformHierarchy hierarchy;
+
+  auto a = hierarchy.add(translationMatrix4x4(Vec3f{ 1.f, 0.f, 0.f }));
+  auto b = hierarchy.add(translationMatrix4x4(Vec3f{ 0.f, 1.f, 0.f }), a);
+  auto c = hierarchy.add(translationMatrix4x4(Vec3f{ 0.f, 0.f, 1.f }), b);
+  auto d = hierarchy.add(identityMatrix<float_t, 4>());
+
+  hierarchy.setLocal(a, translationMatrix4x4(Vec3f{ 5.f, 0.f, 0.f }));
+
+  std::vector<TransformHierarchy::NodeId> changed;
+  hierarchy.update(changed);
+
+  EXPECT_EQ(Vec3f({ 5.f, 1.f, 1.f }), worldPos(hierarchy, c));
+  EXPECT_EQ(3, changed.size());
+  EXPECT_TRUE(contains(changed, a));
+  EXPECT_TRUE(contains(changed, b));
+  EXPECT_TRUE(contains(changed, c));
+  EXPECT_FALSE(contains(changed, d));
+}
+
+TEST_F(TransformHierarchyTest, update_with_nothing_dirty_reports_no_changes)
+{
+  TransformHierarchy hierarchy;
+
+  auto a = hierarchy.add(identityMatrix<float_t, 4>());
+  hierarchy.setLocal(a, translationMatrix4x4(Vec3f{ 1.f, 0.f, 0.f }));
+
+  std::vector<TransformHierarchy::NodeId> changed;
+  hierarchy.update(changed);
+  changed.clear();
+  hierarchy.update(changed);
+
+  EXPECT_TRUE(changed.empty());
+}
+
+TEST_F(TransformHierarchyTest, setParent_moves_subtree)
+{
+  TransformHierarchy hierarchy;
+
+  auto a = hierarchy.add(translationMatrix4x4(Vec3f{ 1.f, 0.f, 0.f }));
+  auto b = hierarchy.add(translationMatrix4x4(Vec3f{ 10.f, 0.f, 0.f }));
+  auto c = hierarchy.add(translationMatrix4x4(Vec3f{ 0.f, 1.f, 0.f }), a);
+  auto d = hierarchy.add(translationMatrix4x4(Vec3f{ 0.f, 0.f, 1.f }), c);
+
+  hierarchy.setParent(c, b);
+
+  std::vector<TransformHierarchy::NodeId> changed;
+  hierarchy.update(changed);
+
+  EXPECT_EQ(b, hierarchy.parent(c));
+  EXPECT_EQ(Vec3f({ 10.f, 1.f, 0.f }), worldPos(hierarchy, c));
+  EXPECT_EQ(Vec3f({ 10.f, 1.f, 1.f }), worldPos(hierarchy, d));
+  EXPECT_TRUE(contains(changed, c));
+  EXPECT_TRUE(contains(changed, d));
+
+  // The new parent must be processed before the child after re-sorting
+  hierarchy.setLocal(b, translationMatrix4x4(Vec3f{ 20.f, 0.f, 0.f }));
+  changed.clear();
+  hierarchy.update(changed);
+
+  EXPECT_EQ(Vec3f({ 20.f, 1.f, 1.f }), worldPos(hierarchy, d));
+}
+
+TEST_F(TransformHierarchyTest, setParent_rejects_cycles)
+{
+  TransformHierarchy hierarchy;
+
+  auto a = hierarchy.add(identityMatrix<float_t, 4>());
+  auto b = hierarchy.add(identityMatrix<float_t, 4>(), a);
+
+  EXPECT_ANY_THROW(hierarchy.setParent(a, b));
+}
+
+TEST_F(TransformHierarchyTest, remove_attaches_children_to_grandparent)
+{
+  TransformHierarchy hierarchy;
+
+  auto a = hierarchy.add(translationMatrix4x4(Vec3f{ 1.f, 0.f, 0.f }));
+  auto b = hierarchy.add(translationMatrix4x4(Vec3f{ 0.f, 1.f, 0.f }), a);
+  auto c = hierarchy.add(translationMatrix4x4(Vec3f{ 0.f, 0.f, 1.f }), b);
+
+  hierarchy.remove(b);
+
+  std::vector<TransformHierarchy::NodeId> changed;
+  hierarchy.update(changed);
+
+  EXPECT_FALSE(hierarchy.contains(b));
+  EXPECT_EQ(a, hierarchy.parent(c));
+  EXPECT_EQ(Vec3f({ 1.f, 0.f, 1.f }), worldPos(hierarchy, c));
+  EXPECT_EQ(std::vector<TransformHierarchy::NodeId>{ c }, changed);
+  EXPECT_EQ(2, hierarchy.size());
+}
+
+TEST_F(TransformHierarchyTest, removing_a_chain_attaches_children_to_nearest_live_ancestor)
+{
+  TransformHierarchy hierarchy;
+
+  auto a = hierarchy.add(translationMatrix4x4(Vec3f{ 1.f, 0.f, 0.f }));
+  auto b = hierarchy.add(translationMatrix4x4(Vec3f{ 0.f, 1.f, 0.f }), a);
+  auto c = hierarchy.add(translationMatrix4x4(Vec3f{ 0.f, 2.f, 0.f }), b);
+  auto d = hierarchy.add(translationMatrix4x4(Vec3f{ 0.f, 0.f, 1.f }), c);
+  auto e = hierarchy.add(translationMatrix4x4(Vec3f{ 0.f, 0.f, 2.f }), c);
+  auto f = hierarchy.add(translationMatrix4x4(Vec3f{ 0.f, 0.f, 3.f }), b);
+
+  hierarchy.remove(c);
+  hierarchy.remove(b);
+
+  // Reported before the rebuild too
+  EXPECT_EQ(a, hierarchy.parent(d));
+
+  std::vector<TransformHierarchy::NodeId> changed;
+  hierarchy.update(changed);
+
+  EXPECT_EQ(a, hierarchy.parent(d));
+  EXPECT_EQ(a, hierarchy.parent(e));
+  EXPECT_EQ(a, hierarchy.parent(f));
+  EXPECT_EQ(Vec3f({ 1.f, 0.f, 1.f }), worldPos(hierarchy, d));
+  EXPECT_EQ(Vec3f({ 1.f, 0.f, 2.f }), worldPos(hierarchy, e));
+  EXPECT_EQ(Vec3f({ 1.f, 0.f, 3.f }), worldPos(hierarchy, f));
+  EXPECT_EQ(3, changed.size());
+  EXPECT_EQ(4, hierarchy.size());
+
+  hierarchy.setLocal(a, translationMatrix4x4(Vec3f{ 5.f, 0.f, 0.f }));
+  hierarchy.update(changed);
+  EXPECT_EQ(Vec3f({ 5.f, 0.f, 2.f }), worldPos(hierarchy, e));
+}
+
+TEST_F(TransformHierarchyTest, removed_ids_are_reused)
+{
+  TransformHierarchy hierarchy;
+
+  auto a = hierarchy.add(identityMatrix<float_t, 4>());
+  hierarchy.remove(a);
+  auto b = hierarchy.add(translationMatrix4x4(Vec3f{ 3.f, 0.f, 0.f }));
+
+  std::vector<TransformHierarchy::NodeId> changed;
+  hierarchy.update(changed);
+
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(Vec3f({ 3.f, 0.f, 0.f }), worldPos(hierarchy, b));
+}
+
+TEST_F(TransformHierarchyTest, update_splits_wide_levels_with_parallelFor)
+{
+  TransformHierarchy hierarchy;
+
+  auto root = hierarchy.add(identityMatrix<float_t, 4>());
+  std::vector<TransformHierarchy::NodeId> children;
+  for (int i = 0; i < 5000; ++i) {
+    children.push_back(hierarchy.add(translationMatrix4x4(Vec3f{ float_t(i), 0.f, 0.f }), root));
+  }
+
+  hierarchy.setLocal(root, translationMatrix4x4(Vec3f{ 0.f, 7.f, 0.f }));
+
+  size_t covered = 0;
+  auto parallelFor = [&](size_t n, const std::function<void(size_t, size_t)>& fn) {
+    for (size_t i = 0; i < n; i += 1000) {
+      size_t end = std::min(n, i + 1000);
+      fn(i, end);
+      covered += end - i;
+    }
+  };
+
+  std::vector<TransformHierarchy::NodeId> changed;
+  hierarchy.update(changed, parallelFor);
+
+  EXPECT_EQ(5000, covered);
+  EXPECT_EQ(5001, changed.size());
+  EXPECT_EQ(Vec3f({ 4999.f, 7.f, 0.f }), worldPos(hierarchy, children.back()));
+}
+
+TEST_F(TransformHierarchyTest, previousWorld_is_from_before_last_update)
+{
+  TransformHierarchy hierarchy;
+
+  auto a = hierarchy.add(translationMatrix4x4(Vec3f{ 1.f, 0.f, 0.f }));
+  auto b = hierarchy.add(translationMatrix4x4(Vec3f{ 0.f, 1.f, 0.f }), a);
+  auto c = hierarchy.add(identityMatrix<float_t, 4>());
+
+  EXPECT_EQ(hierarchy.world(a), hierarchy.previousWorld(a));
+
+  hierarchy.setLocal(a, translationMatrix4x4(Vec3f{ 3.f, 0.f, 0.f }));
+  std::vector<TransformHierarchy::NodeId> changed;
+  hierarchy.update(changed);
+
+  EXPECT_EQ(Vec3f({ 1.f, 1.f, 0.f }), getTranslation(hierarchy.previousWorld(b)));
+  EXPECT_EQ(Vec3f({ 3.f, 1.f, 0.f }), worldPos(hierarchy, b));
+  EXPECT_EQ(&hierarchy.world(c), &hierarchy.previousWorld(c));
+
+  // Nothing moved in this update, so there's nothing to blend from
+  hierarchy.update(changed);
+
+  EXPECT_EQ(&hierarchy.world(b), &hierarchy.previousWorld(b));
+}
+
+TEST_F(TransformHierarchyTest, previousWorld_survives_rebuild)
+{
+  TransformHierarchy hierarchy;
+
+  auto a = hierarchy.add(identityMatrix<float_t, 4>());
+  auto b = hierarchy.add(translationMatrix4x4(Vec3f{ 2.f, 0.f, 0.f }));
+  hierarchy.setParent(b, a);
+  hierarchy.setLocal(b, translationMatrix4x4(Vec3f{ 4.f, 0.f, 0.f }));
+
+  std::vector<TransformHierarchy::NodeId> changed;
+  hierarchy.update(changed);
+
+  EXPECT_EQ(Vec3f({ 2.f, 0.f, 0.f }), getTranslation(hierarchy.previousWorld(b)));
+  EXPECT_EQ(Vec3f({ 4.f, 0.f, 0.f }), worldPos(hierarchy, b));
+}
@@ -1,5 +1,7 @@
 #include <triple_buffer.hpp>
 #include <gtest/gtest.h>
+#include <thread>
+#include <atomic>
 
 class TripleBufferTest : public testing::Test
 {
@@ -45,3 +47,71 @@ TEST_F(TripleBufferTest, can_read_latest_written_value)
 
   ASSERT_EQ(234, buffer.getReadable().value);
 }
+
+TEST_F(TripleBufferTest, readComplete_without_new_data_keeps_readable)
+{
+  struct Data
+  {
+    int value = 0;
+  };
+
+  TripleBuffer<Data> buffer;
+
+  buffer.getWritable().value = 123;
+  buffer.writeComplete();
+  buffer.readComplete();
+  ASSERT_EQ(123, buffer.getReadable().value);
+
+  // Nothing new has been written, so the reader mustn't go back to an older buffer
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(123, buffer.readComplete().value);
+  }
+}
+
+TEST_F(TripleBufferTest, writer_and_reader_never_share_a_buffer)
+{
+  struct Data
+  {
+    int values[64] = {};
+  };
+
+  const int numFrames = 200000;
+  TripleBuffer<Data> buffer;
+  std::atomic<bool> done = false;
+
+  std::thread writer([&]() {
+    for (int frame = 1; frame <= numFrames; ++frame) {
+      Data& data = buffer.getWritable();
+      for (int& value : data.values) {
+        value = frame;
+      }
+      buffer.writeComplete();
+
+      // Gives the reader a look in on a single core
+      if (frame % 64 == 0) {
+        std::this_thread::yield();
+      }
+    }
+    done = true;
+  });
+
+  // Every frame the reader sees should be whole, and frames should never go backwards
+  int last = 0;
+  bool torn = false;
+  bool backwards = false;
+  while (!done || last < numFrames) {
+    const Data& data = buffer.readComplete();
+    int frame = data.values[0];
+    for (int value : data.values) {
+      torn = torn || value != frame;
+    }
+    backwards = backwards || frame < last;
+    last = frame;
+  }
+
+  writer.join();
+
+  ASSERT_FALSE(torn);
+  ASSERT_FALSE(backwards);
+  ASSERT_EQ(numFrames, last);
+}